@@ -0,0 +1,138 @@
+#include "alloc_tracker.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+
+/**
+ * \brief Prefix of every tracked block, padded so that the caller's part keeps malloc()'s alignment.
+ */
+typedef union {
+    size_t size;
+    max_align_t alignment;
+} AllocHeader;
+
+typedef struct {
+    atomic_uint_fast64_t allocations;
+    atomic_uint_fast64_t frees;
+    atomic_uint_fast64_t bytes_allocated;
+    atomic_uint_fast64_t bytes_freed;
+    atomic_uint_fast64_t live_bytes;
+    atomic_uint_fast64_t peak_bytes;
+} AllocCounters;
+
+static const char* const subsystem_names[ALLOC_SUBSYSTEM_COUNT] = {"tasks", "fleet", "oracle", "trace"};
+
+// One entry per subsystem, then the totals.
+static AllocCounters counters[ALLOC_SUBSYSTEM_COUNT + 1];
+
+static void count_allocation(AllocCounters* entry, size_t size) {
+    uint64_t live = atomic_fetch_add_explicit(&entry->live_bytes, size, memory_order_relaxed) + size;
+    uint64_t peak = atomic_load_explicit(&entry->peak_bytes, memory_order_relaxed);
+
+    atomic_fetch_add_explicit(&entry->allocations, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&entry->bytes_allocated, size, memory_order_relaxed);
+    while (live > peak && !atomic_compare_exchange_weak_explicit(&entry->peak_bytes, &peak, live, memory_order_relaxed,
+                                                                 memory_order_relaxed)) {
+    }
+}
+
+static void count_free(AllocCounters* entry, size_t size) {
+    atomic_fetch_add_explicit(&entry->frees, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&entry->bytes_freed, size, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&entry->live_bytes, size, memory_order_relaxed);
+}
+
+static void* track(AllocSubsystem subsystem, AllocHeader* header, size_t size) {
+    if (header == NULL) {
+        return NULL;
+    }
+    header->size = size;
+    count_allocation(&counters[subsystem], size);
+    count_allocation(&counters[ALLOC_SUBSYSTEM_COUNT], size);
+    return header + 1;
+}
+
+static AllocHeader* untrack(AllocSubsystem subsystem, void* block) {
+    AllocHeader* header = (AllocHeader*)block - 1;
+
+    count_free(&counters[subsystem], header->size);
+    count_free(&counters[ALLOC_SUBSYSTEM_COUNT], header->size);
+    return header;
+}
+
+void* tracked_malloc(AllocSubsystem subsystem, size_t size) {
+    if (size > SIZE_MAX - sizeof(AllocHeader)) {
+        return NULL;
+    }
+    return track(subsystem, malloc(sizeof(AllocHeader) + size), size);
+}
+
+void* tracked_calloc(AllocSubsystem subsystem, size_t count, size_t size) {
+    if (size != 0 && count > (SIZE_MAX - sizeof(AllocHeader)) / size) {
+        return NULL;
+    }
+    return track(subsystem, calloc(1, sizeof(AllocHeader) + count * size), count * size);
+}
+
+void* tracked_realloc(AllocSubsystem subsystem, void* block, size_t size) {
+    AllocHeader* header = NULL;
+    AllocHeader* resized = NULL;
+
+    if (block == NULL) {
+        return tracked_malloc(subsystem, size);
+    }
+    if (size > SIZE_MAX - sizeof(AllocHeader)) {
+        return NULL;
+    }
+    header = (AllocHeader*)block - 1;
+    resized = realloc(header, sizeof(AllocHeader) + size);
+    if (resized == NULL) {
+        return NULL;
+    }
+    count_free(&counters[subsystem], resized->size);
+    count_free(&counters[ALLOC_SUBSYSTEM_COUNT], resized->size);
+    return track(subsystem, resized, size);
+}
+
+void tracked_free(AllocSubsystem subsystem, void* block) {
+    if (block != NULL) {
+        free(untrack(subsystem, block));
+    }
+}
+
+void alloc_tracker_stats(AllocSubsystem subsystem, AllocStats* stats) {
+    const AllocCounters* entry = &counters[subsystem < ALLOC_SUBSYSTEM_COUNT ? subsystem : ALLOC_SUBSYSTEM_COUNT];
+
+    stats->allocations = atomic_load_explicit(&entry->allocations, memory_order_relaxed);
+    stats->frees = atomic_load_explicit(&entry->frees, memory_order_relaxed);
+    stats->bytes_allocated = atomic_load_explicit(&entry->bytes_allocated, memory_order_relaxed);
+    stats->bytes_freed = atomic_load_explicit(&entry->bytes_freed, memory_order_relaxed);
+    stats->live_allocations = stats->allocations - stats->frees;
+    stats->live_bytes = atomic_load_explicit(&entry->live_bytes, memory_order_relaxed);
+    stats->peak_bytes = atomic_load_explicit(&entry->peak_bytes, memory_order_relaxed);
+}
+
+static void write_stats(const AllocStats* stats, const char* prefix, FILE* output) {
+    fprintf(output, "\"%sallocations\": %llu, \"%sfrees\": %llu, \"%sbytes_allocated\": %llu, \"%sbytes_freed\": %llu, "
+            "\"%slive_allocations\": %llu, \"%slive_bytes\": %llu, \"%speak_bytes\": %llu",
+            prefix, (unsigned long long)stats->allocations, prefix, (unsigned long long)stats->frees,
+            prefix, (unsigned long long)stats->bytes_allocated, prefix, (unsigned long long)stats->bytes_freed,
+            prefix, (unsigned long long)stats->live_allocations, prefix, (unsigned long long)stats->live_bytes,
+            prefix, (unsigned long long)stats->peak_bytes);
+}
+
+void alloc_tracker_write_json(FILE* output) {
+    AllocStats stats;
+
+    alloc_tracker_stats(ALLOC_SUBSYSTEM_COUNT, &stats);
+    fprintf(output, "{\n    ");
+    write_stats(&stats, "total_", output);
+    fprintf(output, ",\n    \"subsystems\": {");
+    for (size_t i = 0; i < ALLOC_SUBSYSTEM_COUNT; i++) {
+        alloc_tracker_stats((AllocSubsystem)i, &stats);
+        fprintf(output, "%s\n      \"%s\": {", i > 0 ? "," : "", subsystem_names[i]);
+        write_stats(&stats, "", output);
+        fprintf(output, "}");
+    }
+    fprintf(output, "\n    }\n  }");
+}
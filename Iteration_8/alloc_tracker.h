@@ -0,0 +1,91 @@
+#ifndef ALLOC_TRACKER_H
+#define ALLOC_TRACKER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * \brief Owner of a tracked allocation.
+ */
+typedef enum {
+    ALLOC_SUBSYSTEM_TASKS,    ///< Task queues.
+    ALLOC_SUBSYSTEM_FLEET,    ///< Per-node arrays of fleet simulations.
+    ALLOC_SUBSYSTEM_ORACLE,   ///< States and indexes of the offline schedule oracle.
+    ALLOC_SUBSYSTEM_TRACE,    ///< Block indexes of trace writers.
+    ALLOC_SUBSYSTEM_COUNT     ///< Number of subsystems.
+} AllocSubsystem;
+
+/**
+ * \brief Allocation counts and bytes of a subsystem since the start of the process.
+ *
+ * Byte counts are the sizes requested by the callers, without the tracker's
+ * header. A reallocation counts as a free followed by an allocation, as
+ * Valgrind does.
+ */
+typedef struct {
+    uint64_t allocations;
+    uint64_t frees;
+    uint64_t bytes_allocated;
+    uint64_t bytes_freed;
+    uint64_t live_allocations;  ///< Allocations not freed yet, leaks when read at exit.
+    uint64_t live_bytes;
+    uint64_t peak_bytes;        ///< Highest live_bytes reached.
+} AllocStats;
+
+/**
+ * \brief Allocates memory on behalf of a subsystem.
+ *
+ * The counters are updated with relaxed atomic operations, so tracking stays
+ * on in performance runs and in contexts running on several threads.
+ *
+ * \param subsystem Owner of the block.
+ * \param size Bytes to allocate.
+ * \return The block, aligned like malloc(), or NULL if allocation fails.
+ */
+void* tracked_malloc(AllocSubsystem subsystem, size_t size);
+
+/**
+ * \brief Allocates zeroed memory for an array on behalf of a subsystem.
+ *
+ * \param subsystem Owner of the block.
+ * \param count Number of elements.
+ * \param size Size of one element.
+ * \return The block, or NULL if allocation fails or the size overflows.
+ */
+void* tracked_calloc(AllocSubsystem subsystem, size_t count, size_t size);
+
+/**
+ * \brief Resizes a tracked block.
+ *
+ * \param subsystem Owner of the block.
+ * \param block Block from this subsystem, or NULL to allocate a new one.
+ * \param size New size in bytes.
+ * \return The resized block, or NULL if allocation fails, in which case block is left untouched.
+ */
+void* tracked_realloc(AllocSubsystem subsystem, void* block, size_t size);
+
+/**
+ * \brief Frees a tracked block.
+ *
+ * \param subsystem Owner the block was allocated for.
+ * \param block Block to free, or NULL.
+ */
+void tracked_free(AllocSubsystem subsystem, void* block);
+
+/**
+ * \brief Reads the counters of a subsystem.
+ *
+ * \param subsystem Subsystem to read, or ALLOC_SUBSYSTEM_COUNT for the totals of all subsystems.
+ * \param stats Destination.
+ */
+void alloc_tracker_stats(AllocSubsystem subsystem, AllocStats* stats);
+
+/**
+ * \brief Writes the totals and the counters of every subsystem as a JSON object.
+ *
+ * \param output Destination; the object is not followed by a newline, so it may be nested.
+ */
+void alloc_tracker_write_json(FILE* output);
+
+#endif // ALLOC_TRACKER_H
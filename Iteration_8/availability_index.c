@@ -0,0 +1,348 @@
+#include "availability_index.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "error_handling.h"
+
+typedef struct {
+    SimTime position;
+    int8_t coverage_delta;
+    float power_delta;
+} WindowEdge;
+
+static int compare_edges(const void* left, const void* right) {
+    const WindowEdge* a = (const WindowEdge*)left;
+    const WindowEdge* b = (const WindowEdge*)right;
+    return (a->position > b->position) - (a->position < b->position);
+}
+
+static bool is_run_start(const AvailabilityIndex* index, uint16_t segment) {
+    const AvailabilityInterval* intervals = index->intervals;
+
+    if (segment > 0) {
+        return intervals[segment - 1].end != intervals[segment].start;
+    }
+    // The first segment continues the last one when the window wraps around the period.
+    return !(intervals[0].start == 0 && intervals[index->count - 1].end == index->period);
+}
+
+/**
+ * \brief Index of the last segment starting at or before offset, or -1.
+ */
+static int find_segment(const AvailabilityIndex* index, SimTime offset) {
+    int low = 0;
+    int high = index->count;
+
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (index->intervals[middle].start <= offset) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low - 1;
+}
+
+static double energy_before_offset(const AvailabilityIndex* index, SimTime offset) {
+    int segment = find_segment(index, offset);
+    const AvailabilityInterval* interval = NULL;
+
+    if (segment < 0) {
+        return 0.0;
+    }
+
+    interval = &index->intervals[segment];
+    if (offset >= interval->end) {
+        return index->cumulative_mj[segment + 1];
+    }
+    return index->cumulative_mj[segment] + (double)interval->power_mw * (offset - interval->start);
+}
+
+static double energy_before(const AvailabilityIndex* index, SimTime time) {
+    SimTime periods = time / index->period;
+    return periods * index->cumulative_mj[index->count] + energy_before_offset(index, time % index->period);
+}
+
+static void build_lookup_tables(AvailabilityIndex* index) {
+    uint16_t count = index->count;
+    uint16_t last_run_begin = count;
+
+    index->cumulative_mj[0] = 0.0;
+    for (uint16_t i = 0; i < count; i++) {
+        const AvailabilityInterval* interval = &index->intervals[i];
+        index->cumulative_mj[i + 1] = index->cumulative_mj[i] + (double)interval->power_mw * (interval->end - interval->start);
+    }
+
+    index->next_run[count] = count;
+    for (int i = (int)count - 1; i >= 0; i--) {
+        bool contiguous = (i + 1 < count) && index->intervals[i].end == index->intervals[i + 1].start;
+        index->run_end[i] = contiguous ? index->run_end[i + 1] : index->intervals[i].end;
+        index->next_run[i] = is_run_start(index, (uint16_t)i) ? (uint16_t)i : index->next_run[i + 1];
+        if (is_run_start(index, (uint16_t)i) && last_run_begin == count) {
+            // Scanning backwards, the first run start met begins the last window of the period.
+            last_run_begin = (uint16_t)i;
+        }
+    }
+
+    if (count == 0 || is_run_start(index, 0)) {
+        return;
+    }
+
+    if (index->next_run[0] == count) {
+        // A single window covering the whole period never ends.
+        for (uint16_t i = 0; i < count; i++) {
+            index->run_end[i] = SIM_TIME_NEVER;
+        }
+        return;
+    }
+
+    // Segments of the last window continue into the first window of the next period.
+    for (uint16_t i = last_run_begin; i < count; i++) {
+        index->run_end[i] = index->period + index->run_end[0];
+    }
+}
+
+void availability_index_init(AvailabilityIndex* index, SimTime period) {
+    if (index == NULL) {
+        return;
+    }
+
+    memset(index, 0, sizeof(*index));
+    index->period = period > 0 ? period : SECONDS_PER_DAY;
+    index->built = true;
+}
+
+bool availability_index_add(AvailabilityIndex* index, SimTime start, SimTime duration, float power_mw) {
+    SimTime offset = 0;
+    SimTime end = 0;
+
+    if (index == NULL || duration == 0 || duration > index->period) {
+        return false;
+    }
+
+    if (index->built && index->count > 0) {
+        handle_error("Cannot add windows to an index that is already built");
+        return false;
+    }
+
+    offset = start % index->period;
+    end = offset + duration;
+    if (index->count + (end > index->period ? 2 : 1) > AVAILABILITY_INDEX_CAPACITY) {
+        handle_error("Availability index is full");
+        return false;
+    }
+
+    index->built = false;
+    if (end > index->period) {
+        index->intervals[index->count++] = (AvailabilityInterval){offset, index->period, power_mw};
+        index->intervals[index->count++] = (AvailabilityInterval){0, end - index->period, power_mw};
+    } else {
+        index->intervals[index->count++] = (AvailabilityInterval){offset, end, power_mw};
+    }
+    return true;
+}
+
+bool availability_index_build(AvailabilityIndex* index) {
+    WindowEdge edges[2 * AVAILABILITY_INDEX_CAPACITY];
+    uint16_t edge_count = 0;
+    uint16_t segment_count = 0;
+    int coverage = 0;
+    float power = 0.0f;
+
+    if (index == NULL) {
+        return false;
+    }
+
+    for (uint16_t i = 0; i < index->count; i++) {
+        edges[edge_count++] = (WindowEdge){index->intervals[i].start, 1, index->intervals[i].power_mw};
+        edges[edge_count++] = (WindowEdge){index->intervals[i].end, -1, -index->intervals[i].power_mw};
+    }
+    qsort(edges, edge_count, sizeof(WindowEdge), compare_edges);
+
+    for (uint16_t i = 0; i < edge_count;) {
+        SimTime position = edges[i].position;
+        AvailabilityInterval* previous = segment_count > 0 ? &index->intervals[segment_count - 1] : NULL;
+
+        while (i < edge_count && edges[i].position == position) {
+            coverage += edges[i].coverage_delta;
+            power += edges[i].power_delta;
+            i++;
+        }
+
+        if (previous != NULL && previous->end == SIM_TIME_NEVER) {
+            previous->end = position;
+        }
+
+        if (coverage <= 0 || i == edge_count) {
+            continue;
+        }
+
+        if (power < 0.0f) {
+            power = 0.0f;
+        }
+
+        if (previous != NULL && previous->end == position && previous->power_mw == power) {
+            previous->end = SIM_TIME_NEVER;
+            continue;
+        }
+
+        if (segment_count >= AVAILABILITY_INDEX_CAPACITY) {
+            handle_error("Merged availability schedule exceeds the index capacity");
+            index->count = 0;
+            build_lookup_tables(index);
+            index->built = true;
+            return false;
+        }
+
+        index->intervals[segment_count++] = (AvailabilityInterval){position, SIM_TIME_NEVER, power};
+    }
+
+    index->count = segment_count;
+    build_lookup_tables(index);
+    index->built = true;
+    return true;
+}
+
+bool availability_index_sync(AvailabilityIndex* index, const EnergySource* source) {
+    SimTime interval_seconds = 0;
+
+    if (index == NULL || source == NULL) {
+        return false;
+    }
+
+    if (index->has_profile && index->profile.start_hour == source->start_hour &&
+        index->profile.duration_hours == source->duration_hours &&
+        index->profile.occurrences_per_day == source->occurrences_per_day &&
+        index->profile.harvest_power_mw == source->harvest_power_mw) {
+        return false;
+    }
+
+    availability_index_init(index, SECONDS_PER_DAY);
+    index->profile = *source;
+    index->has_profile = true;
+    if (source->occurrences_per_day == 0 || source->duration_hours == 0) {
+        return true;
+    }
+
+    interval_seconds = (24u / source->occurrences_per_day) * SECONDS_PER_HOUR;
+    for (uint8_t i = 0; i < source->occurrences_per_day; i++) {
+        SimTime start = source->start_hour * SECONDS_PER_HOUR + i * interval_seconds;
+        SimTime duration = source->duration_hours * SECONDS_PER_HOUR;
+        if (!availability_index_add(index, start, duration > SECONDS_PER_DAY ? SECONDS_PER_DAY : duration,
+                                    source->harvest_power_mw)) {
+            break;
+        }
+    }
+
+    availability_index_build(index);
+    return true;
+}
+
+bool availability_index_union(AvailabilityIndex* combined, const AvailabilityIndex* const* indexes, size_t count) {
+    if (combined == NULL || indexes == NULL || count == 0) {
+        return false;
+    }
+
+    availability_index_init(combined, indexes[0]->period);
+    for (size_t i = 0; i < count; i++) {
+        if (indexes[i]->period != combined->period) {
+            handle_error("Cannot combine availability indexes with different periods");
+            return false;
+        }
+
+        for (uint16_t j = 0; j < indexes[i]->count; j++) {
+            const AvailabilityInterval* interval = &indexes[i]->intervals[j];
+            if (!availability_index_add(combined, interval->start, interval->end - interval->start, interval->power_mw)) {
+                return false;
+            }
+        }
+    }
+
+    return availability_index_build(combined);
+}
+
+bool availability_index_is_available(const AvailabilityIndex* index, SimTime time) {
+    SimTime offset = 0;
+    int segment = 0;
+
+    if (index == NULL || index->count == 0) {
+        return false;
+    }
+
+    offset = time % index->period;
+    segment = find_segment(index, offset);
+    return segment >= 0 && offset < index->intervals[segment].end;
+}
+
+float availability_index_power_at(const AvailabilityIndex* index, SimTime time) {
+    SimTime offset = 0;
+    int segment = 0;
+
+    if (index == NULL || index->count == 0) {
+        return 0.0f;
+    }
+
+    offset = time % index->period;
+    segment = find_segment(index, offset);
+    if (segment < 0 || offset >= index->intervals[segment].end) {
+        return 0.0f;
+    }
+    return index->intervals[segment].power_mw;
+}
+
+SimTime availability_index_next_window_start(const AvailabilityIndex* index, SimTime time) {
+    SimTime base = 0;
+    SimTime offset = 0;
+    int segment = 0;
+    uint16_t first = 0;
+    uint16_t next = 0;
+
+    if (index == NULL || index->count == 0) {
+        return SIM_TIME_NEVER;
+    }
+
+    base = time - time % index->period;
+    offset = time % index->period;
+    segment = find_segment(index, offset);
+    first = (segment >= 0 && index->intervals[segment].start == offset) ? (uint16_t)segment : (uint16_t)(segment + 1);
+    next = index->next_run[first];
+    if (next < index->count) {
+        return base + index->intervals[next].start;
+    }
+
+    next = index->next_run[0];
+    if (next < index->count) {
+        return base + index->period + index->intervals[next].start;
+    }
+    return SIM_TIME_NEVER;
+}
+
+SimTime availability_index_current_window_end(const AvailabilityIndex* index, SimTime time) {
+    SimTime offset = 0;
+    int segment = 0;
+
+    if (index == NULL || index->count == 0) {
+        return time;
+    }
+
+    offset = time % index->period;
+    segment = find_segment(index, offset);
+    if (segment < 0 || offset >= index->intervals[segment].end) {
+        return time;
+    }
+
+    if (index->run_end[segment] == SIM_TIME_NEVER) {
+        return SIM_TIME_NEVER;
+    }
+    return time - offset + index->run_end[segment];
+}
+
+double availability_index_expected_energy(const AvailabilityIndex* index, SimTime start, SimTime end) {
+    if (index == NULL || index->count == 0 || end <= start) {
+        return 0.0;
+    }
+
+    return energy_before(index, end) - energy_before(index, start);
+}
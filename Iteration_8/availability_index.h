@@ -0,0 +1,148 @@
+#ifndef AVAILABILITY_INDEX_H
+#define AVAILABILITY_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "energy_manager.h"
+
+/**
+ * \brief Maximum number of windows held by one index.
+ */
+#define AVAILABILITY_INDEX_CAPACITY 64
+
+/**
+ * \brief Window of a periodic schedule during which energy is harvested.
+ */
+typedef struct {
+    SimTime start;   ///< Offset of the first second of the window within the period.
+    SimTime end;     ///< Offset one past the last second of the window, at most the period.
+    float power_mw;  ///< Harvested power during the window, in milliwatts.
+} AvailabilityInterval;
+
+/**
+ * \brief Sorted interval index of a periodic availability schedule.
+ *
+ * Windows are added with availability_index_add() at any resolution, then
+ * availability_index_build() merges overlaps into disjoint, sorted segments
+ * and precomputes cumulative energy and window boundaries so that every
+ * query is a single binary search. A contiguous run of segments, possibly
+ * wrapping around the end of the period, forms one availability window.
+ */
+typedef struct {
+    SimTime period;                                           ///< Repetition period of the schedule.
+    uint16_t count;                                           ///< Number of windows or built segments.
+    bool built;                                               ///< Whether segments and lookup tables are current.
+    AvailabilityInterval intervals[AVAILABILITY_INDEX_CAPACITY]; ///< Disjoint segments sorted by start.
+    double cumulative_mj[AVAILABILITY_INDEX_CAPACITY + 1];    ///< Energy harvested before each segment.
+    SimTime run_end[AVAILABILITY_INDEX_CAPACITY];             ///< End of the window containing each segment.
+    uint16_t next_run[AVAILABILITY_INDEX_CAPACITY + 1];       ///< First window-starting segment at or after each one.
+    EnergySource profile;                                     ///< Profile the index was compiled from, if any.
+    bool has_profile;                                         ///< Whether profile holds a compiled EnergySource.
+} AvailabilityIndex;
+
+/**
+ * \brief Clears an index.
+ *
+ * \param index Index to initialize.
+ * \param period Repetition period of the schedule, in seconds.
+ */
+void availability_index_init(AvailabilityIndex* index, SimTime period);
+
+/**
+ * \brief Adds a window to an index that is being assembled.
+ *
+ * Windows may overlap, in which case their power adds up, and may wrap
+ * around the end of the period.
+ *
+ * \param index Index to extend.
+ * \param start Offset of the window within the period.
+ * \param duration Length of the window in seconds, at most the period.
+ * \param power_mw Harvested power during the window.
+ * \return False if the index is full or the window is invalid.
+ */
+bool availability_index_add(AvailabilityIndex* index, SimTime start, SimTime duration, float power_mw);
+
+/**
+ * \brief Merges the added windows into sorted segments and builds lookup tables.
+ *
+ * \param index Index to build.
+ * \return False if the merged schedule does not fit in the index.
+ */
+bool availability_index_build(AvailabilityIndex* index);
+
+/**
+ * \brief Compiles the daily schedule of an energy source when it changed.
+ *
+ * The index remembers the profile it was compiled from and is only rebuilt
+ * when the schedule or power of the source differs.
+ *
+ * \param index Index to keep in sync.
+ * \param source Energy source whose schedule is compiled.
+ * \return True if the index was rebuilt.
+ */
+bool availability_index_sync(AvailabilityIndex* index, const EnergySource* source);
+
+/**
+ * \brief Builds the union of several indexes sharing the same period.
+ *
+ * The combined index is available whenever any input is, with the power
+ * of overlapping windows summed.
+ *
+ * \param combined Index receiving the union.
+ * \param indexes Built indexes to combine.
+ * \param count Number of indexes.
+ * \return False if the periods differ or the union does not fit.
+ */
+bool availability_index_union(AvailabilityIndex* combined, const AvailabilityIndex* const* indexes, size_t count);
+
+/**
+ * \brief Tells whether energy is harvested at a given time.
+ *
+ * \param index Built index.
+ * \param time Simulated time to query.
+ * \return True if time falls in a window.
+ */
+bool availability_index_is_available(const AvailabilityIndex* index, SimTime time);
+
+/**
+ * \brief Returns the harvested power at a given time.
+ *
+ * \param index Built index.
+ * \param time Simulated time to query.
+ * \return Power in milliwatts, 0 outside windows.
+ */
+float availability_index_power_at(const AvailabilityIndex* index, SimTime time);
+
+/**
+ * \brief Returns the start of the first window beginning at or after a time.
+ *
+ * \param index Built index.
+ * \param time Simulated time to query.
+ * \return Start of the next window, or SIM_TIME_NEVER if the schedule is
+ *         empty or always available.
+ */
+SimTime availability_index_next_window_start(const AvailabilityIndex* index, SimTime time);
+
+/**
+ * \brief Returns the end of the window containing a time.
+ *
+ * \param index Built index.
+ * \param time Simulated time to query.
+ * \return End of the current window, time itself when no window is active,
+ *         or SIM_TIME_NEVER if the schedule is always available.
+ */
+SimTime availability_index_current_window_end(const AvailabilityIndex* index, SimTime time);
+
+/**
+ * \brief Returns the energy expected to be harvested over a time range.
+ *
+ * \param index Built index.
+ * \param start First second of the range.
+ * \param end One past the last second of the range.
+ * \return Energy in millijoules.
+ */
+double availability_index_expected_energy(const AvailabilityIndex* index, SimTime start, SimTime end);
+
+#endif // AVAILABILITY_INDEX_H
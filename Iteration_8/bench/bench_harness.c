@@ -0,0 +1,233 @@
+/**
+ * \file bench_harness.c
+ * \brief Warm-up, repetitions, nanosecond timing and statistics for microbenchmarks.
+ *
+ * Every case is warmed up, then timed over a fixed number of samples with
+ * CLOCK_MONOTONIC. A sample holds one run of the case when it needs an
+ * untimed setup, else a batch of runs grown until the sample lasts
+ * min_sample_ns. The median cost of reading the clock is subtracted from
+ * every sample, and times are reported per operation. The median and the
+ * median absolute deviation are robust to the preemptions a shared host
+ * adds to a few samples, which p99 and max then show.
+ */
+#include "bench_harness.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_WARMUP_RUNS 64
+#define DEFAULT_SAMPLES 200
+#define DEFAULT_MIN_SAMPLE_NS 20000.0
+#define MAX_BATCH (1u << 24)
+#define OVERHEAD_SAMPLES 1001
+
+static double now_ns(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+static int compare_doubles(const void* left, const void* right) {
+    double a = *(const double*)left;
+    double b = *(const double*)right;
+
+    return (a > b) - (a < b);
+}
+
+/**
+ * \brief Nearest-rank percentile of sorted values.
+ */
+static double percentile(const double* sorted, uint32_t count, double fraction) {
+    size_t index = (size_t)(fraction * (count - 1) + 0.5);
+
+    return sorted[index < count ? index : count - 1];
+}
+
+static const char* option_value(const char* argument, const char* name) {
+    size_t length = strlen(name);
+
+    if (strncmp(argument, name, length) == 0 && argument[length] == '=') {
+        return argument + length + 1;
+    }
+    return NULL;
+}
+
+void bench_suite_init(BenchSuite* suite, const char* name) {
+    double deltas[OVERHEAD_SAMPLES];
+
+    memset(suite, 0, sizeof(*suite));
+    suite->name = name;
+    suite->warmup_runs = DEFAULT_WARMUP_RUNS;
+    suite->samples = DEFAULT_SAMPLES;
+    suite->min_sample_ns = DEFAULT_MIN_SAMPLE_NS;
+
+    for (size_t i = 0; i < OVERHEAD_SAMPLES; i++) {
+        double start = now_ns();
+
+        deltas[i] = now_ns() - start;
+    }
+    qsort(deltas, OVERHEAD_SAMPLES, sizeof(deltas[0]), compare_doubles);
+    suite->timer_overhead_ns = deltas[OVERHEAD_SAMPLES / 2];
+}
+
+bool bench_suite_parse_options(BenchSuite* suite, int argc, char* argv[], const char** json_path) {
+    *json_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        const char* value = NULL;
+
+        if ((value = option_value(argv[i], "--samples")) != NULL) {
+            suite->samples = (uint32_t)strtoul(value, NULL, 10);
+            if (suite->samples == 0 || suite->samples > BENCH_MAX_SAMPLES) {
+                return false;
+            }
+        } else if ((value = option_value(argv[i], "--warmup")) != NULL) {
+            suite->warmup_runs = (uint32_t)strtoul(value, NULL, 10);
+        } else if ((value = option_value(argv[i], "--filter")) != NULL) {
+            suite->filter = value;
+        } else if ((value = option_value(argv[i], "--json")) != NULL) {
+            *json_path = value;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+BenchCase* bench_suite_add(BenchSuite* suite, const char* name, void (*setup)(void*), void (*run)(void*), void* state,
+                           uint32_t operations) {
+    BenchCase* bench_case = NULL;
+
+    if (suite->case_count == BENCH_MAX_CASES) {
+        return NULL;
+    }
+    bench_case = &suite->cases[suite->case_count++];
+    memset(bench_case, 0, sizeof(*bench_case));
+    bench_case->name = name;
+    bench_case->setup = setup;
+    bench_case->run = run;
+    bench_case->state = state;
+    bench_case->operations = operations > 0 ? operations : 1;
+    return bench_case;
+}
+
+/**
+ * \brief Doubles the batch of a case without setup until one sample lasts min_sample_ns.
+ */
+static uint32_t calibrate_batch(const BenchSuite* suite, const BenchCase* bench_case) {
+    uint32_t batch = 1;
+
+    if (bench_case->setup != NULL) {
+        return 1;
+    }
+    while (batch < MAX_BATCH) {
+        double start = now_ns();
+
+        for (uint32_t i = 0; i < batch; i++) {
+            bench_case->run(bench_case->state);
+        }
+        if (now_ns() - start >= suite->min_sample_ns) {
+            break;
+        }
+        batch *= 2;
+    }
+    return batch;
+}
+
+static void measure_case(const BenchSuite* suite, const BenchCase* bench_case, BenchStats* stats) {
+    double samples[BENCH_MAX_SAMPLES];
+    double deviations[BENCH_MAX_SAMPLES];
+    uint32_t count = suite->samples;
+
+    for (uint32_t i = 0; i < suite->warmup_runs; i++) {
+        if (bench_case->setup != NULL) {
+            bench_case->setup(bench_case->state);
+        }
+        bench_case->run(bench_case->state);
+    }
+
+    stats->batch = calibrate_batch(suite, bench_case);
+    for (uint32_t s = 0; s < count; s++) {
+        double start = 0.0;
+        double elapsed = 0.0;
+
+        if (bench_case->setup != NULL) {
+            bench_case->setup(bench_case->state);
+        }
+        start = now_ns();
+        for (uint32_t i = 0; i < stats->batch; i++) {
+            bench_case->run(bench_case->state);
+        }
+        elapsed = now_ns() - start - suite->timer_overhead_ns;
+        samples[s] = (elapsed > 0.0 ? elapsed : 0.0) / ((double)stats->batch * bench_case->operations);
+    }
+
+    qsort(samples, count, sizeof(samples[0]), compare_doubles);
+    stats->samples = count;
+    stats->min_ns = samples[0];
+    stats->median_ns = percentile(samples, count, 0.5);
+    stats->p95_ns = percentile(samples, count, 0.95);
+    stats->p99_ns = percentile(samples, count, 0.99);
+    stats->max_ns = samples[count - 1];
+    for (uint32_t s = 0; s < count; s++) {
+        deviations[s] = samples[s] > stats->median_ns ? samples[s] - stats->median_ns : stats->median_ns - samples[s];
+    }
+    qsort(deviations, count, sizeof(deviations[0]), compare_doubles);
+    stats->mad_ns = percentile(deviations, count, 0.5);
+}
+
+void bench_suite_run(BenchSuite* suite, FILE* output) {
+    fprintf(output, "%-32s %-18s %10s %10s %8s %10s %10s %9s\n", "function", "parameter", "median_ns", "min_ns", "mad_ns",
+            "p95_ns", "p99_ns", "batch");
+    for (uint32_t c = 0; c < suite->case_count; c++) {
+        const BenchCase* bench_case = &suite->cases[c];
+        const BenchStats* stats = &suite->stats[c];
+
+        if (suite->filter != NULL && strstr(bench_case->name, suite->filter) == NULL) {
+            continue;
+        }
+        measure_case(suite, bench_case, &suite->stats[c]);
+        suite->measured[c] = true;
+        fprintf(output, "%-32s %-18s %10.1f %10.1f %8.1f %10.1f %10.1f %9u\n", bench_case->name, bench_case->parameter,
+                stats->median_ns, stats->min_ns, stats->mad_ns, stats->p95_ns, stats->p99_ns, stats->batch);
+        fflush(output);
+    }
+}
+
+static void write_json_string(FILE* output, const char* text) {
+    fputc('"', output);
+    for (const char* c = text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', output);
+        }
+        fputc(*c, output);
+    }
+    fputc('"', output);
+}
+
+void bench_suite_write_json(const BenchSuite* suite, FILE* output) {
+    bool first = true;
+
+    fprintf(output, "{\n  \"suite\": ");
+    write_json_string(output, suite->name);
+    fprintf(output, ",\n  \"unit\": \"ns/op\",\n  \"timer_overhead_ns\": %.1f,\n  \"warmup_runs\": %u,\n"
+            "  \"samples\": %u,\n  \"results\": [", suite->timer_overhead_ns, suite->warmup_runs, suite->samples);
+    for (uint32_t c = 0; c < suite->case_count; c++) {
+        const BenchCase* bench_case = &suite->cases[c];
+        const BenchStats* stats = &suite->stats[c];
+
+        if (!suite->measured[c]) {
+            continue;
+        }
+        fprintf(output, "%s\n    {\"name\": ", first ? "" : ",");
+        write_json_string(output, bench_case->name);
+        fprintf(output, ", \"parameter\": ");
+        write_json_string(output, bench_case->parameter);
+        fprintf(output, ", \"operations\": %u, \"batch\": %u, \"median_ns\": %.2f, \"min_ns\": %.2f, \"mad_ns\": %.2f, "
+                "\"p95_ns\": %.2f, \"p99_ns\": %.2f, \"max_ns\": %.2f}", bench_case->operations, stats->batch,
+                stats->median_ns, stats->min_ns, stats->mad_ns, stats->p95_ns, stats->p99_ns, stats->max_ns);
+        first = false;
+    }
+    fprintf(output, "\n  ]\n}\n");
+}
@@ -0,0 +1,107 @@
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * \brief Maximum number of timed samples of one case.
+ */
+#define BENCH_MAX_SAMPLES 4096
+
+/**
+ * \brief Maximum number of cases of one suite.
+ */
+#define BENCH_MAX_CASES 128
+
+/**
+ * \brief One measured operation and its input size.
+ *
+ * run() is timed; setup(), if any, runs untimed before every run, for
+ * instance to refill a queue that run() drains. Cases without setup are
+ * repeated in batches long enough to dwarf the timer's own cost.
+ */
+typedef struct {
+    const char* name;          ///< Function under test, such as "enqueue_task".
+    char parameter[48];        ///< Input size or shape, such as "queue=64".
+    void (*setup)(void* state);
+    void (*run)(void* state);
+    void* state;               ///< Argument of setup() and run().
+    uint32_t operations;       ///< Operations performed by one run(), used to report per-operation times.
+} BenchCase;
+
+/**
+ * \brief Statistics of a case, in nanoseconds per operation.
+ */
+typedef struct {
+    uint32_t samples;
+    uint32_t batch;            ///< Runs per timed sample.
+    double min_ns;
+    double median_ns;
+    double mad_ns;             ///< Median absolute deviation from the median.
+    double p95_ns;
+    double p99_ns;
+    double max_ns;
+} BenchStats;
+
+/**
+ * \brief A set of cases measured with the same settings.
+ */
+typedef struct {
+    const char* name;
+    uint32_t warmup_runs;      ///< Untimed runs before the samples.
+    uint32_t samples;          ///< Timed samples per case, at most BENCH_MAX_SAMPLES.
+    double min_sample_ns;      ///< Shortest sample a batch is grown to, without setup().
+    const char* filter;        ///< Only cases whose name contains it run, NULL for all.
+    double timer_overhead_ns;  ///< Median cost of reading the clock, subtracted from every sample.
+    BenchCase cases[BENCH_MAX_CASES];
+    BenchStats stats[BENCH_MAX_CASES];
+    bool measured[BENCH_MAX_CASES];
+    uint32_t case_count;
+} BenchSuite;
+
+/**
+ * \brief Initializes a suite with default settings and measures the timer overhead.
+ *
+ * \param suite Suite to initialize.
+ * \param name Name recorded in the JSON report.
+ */
+void bench_suite_init(BenchSuite* suite, const char* name);
+
+/**
+ * \brief Applies --samples=N, --warmup=N, --filter=TEXT and --json=FILE from the command line.
+ *
+ * \param suite Initialized suite.
+ * \param argc Number of arguments.
+ * \param argv Arguments.
+ * \param json_path Destination of --json=FILE, NULL if absent.
+ * \return False if an argument is unknown or out of range.
+ */
+bool bench_suite_parse_options(BenchSuite* suite, int argc, char* argv[], const char** json_path);
+
+/**
+ * \brief Adds a case to a suite.
+ *
+ * \return The case, whose parameter may be filled in, or NULL if the suite is full.
+ */
+BenchCase* bench_suite_add(BenchSuite* suite, const char* name, void (*setup)(void*), void (*run)(void*), void* state,
+                           uint32_t operations);
+
+/**
+ * \brief Measures every case matching the filter and prints one table line per case.
+ *
+ * \param suite Suite to run.
+ * \param output Destination of the table.
+ */
+void bench_suite_run(BenchSuite* suite, FILE* output);
+
+/**
+ * \brief Writes the measured cases as a JSON document.
+ *
+ * \param suite Suite that was run.
+ * \param output Destination of the document.
+ */
+void bench_suite_write_json(const BenchSuite* suite, FILE* output);
+
+#endif // BENCH_HARNESS_H
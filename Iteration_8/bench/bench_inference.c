@@ -0,0 +1,213 @@
+/**
+ * \file bench_inference.c
+ * \brief Throughput and arena usage of the int8 inference engine.
+ *
+ * Builds one synthetic model per layer kind, with deterministic weights,
+ * runs each for a fixed time with every kernel variant the CPU supports and
+ * reports inferences per second and the bytes of tensor arena the model
+ * reserves. The shipped harvest forecaster is measured the same way.
+ *
+ * Build from the repository root:
+ *   gcc -O2 -o bin/bench_inference Iteration_8/bench/bench_inference.c \
+ *       Iteration_8/inference_engine.c Iteration_8/inference_kernels.c Iteration_8/energy_forecast_model.c \
+ *       Iteration_8/error_handling.c
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../energy_forecast_model.h"
+#include "../inference_engine.h"
+
+#define BLOB_CAPACITY 65536
+#define ARENA_SIZE 2048
+#define BENCH_SECONDS 0.5
+
+typedef struct {
+    _Alignas(4) uint8_t data[BLOB_CAPACITY];
+    size_t size;
+    uint32_t seed;
+} BlobBuilder;
+
+static const KernelVariant variants[] = {
+    KERNEL_VARIANT_SCALAR, KERNEL_VARIANT_SSE41, KERNEL_VARIANT_AVX2, KERNEL_VARIANT_NEON
+};
+
+static BlobBuilder builder;
+static _Alignas(4) uint8_t arena[ARENA_SIZE];
+
+static void append(const void* bytes, size_t length) {
+    if (builder.size + length + 3 > BLOB_CAPACITY) {
+        fprintf(stderr, "Benchmark model does not fit in %d bytes\n", BLOB_CAPACITY);
+        exit(1);
+    }
+    memcpy(builder.data + builder.size, bytes, length);
+    builder.size += length;
+    while (builder.size % 4 != 0) {
+        builder.data[builder.size++] = 0;
+    }
+}
+
+static int8_t next_weight(void) {
+    builder.seed = builder.seed * 1664525u + 1013904223u;
+    return (int8_t)((int)(builder.seed >> 24) % 255 - 127);
+}
+
+static void append_weights(size_t count) {
+    size_t start = builder.size;
+
+    builder.size += count;
+    if (builder.size + 3 > BLOB_CAPACITY) {
+        fprintf(stderr, "Benchmark model does not fit in %d bytes\n", BLOB_CAPACITY);
+        exit(1);
+    }
+    for (size_t i = 0; i < count; i++) {
+        builder.data[start + i] = (uint8_t)next_weight();
+    }
+    while (builder.size % 4 != 0) {
+        builder.data[builder.size++] = 0;
+    }
+}
+
+static void append_constant(size_t count, float scale) {
+    for (size_t i = 0; i < count; i++) {
+        append(&scale, sizeof(scale));
+    }
+}
+
+static void append_zero_bias(size_t count) {
+    int32_t zero = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        append(&zero, sizeof(zero));
+    }
+}
+
+static void begin_model(uint16_t layer_count, uint16_t input_length, uint16_t input_channels, uint16_t output_length) {
+    ModelHeader header = {INFERENCE_MODEL_MAGIC, INFERENCE_MODEL_VERSION, layer_count, input_length,
+                          input_channels, output_length, 0, 1.0f / 127.0f, 0};
+
+    builder.size = 0;
+    builder.seed = 12345u;
+    append(&header, sizeof(header));
+}
+
+/**
+ * \brief Appends a layer whose weights are scaled to keep activations in range.
+ */
+static void add_layer(LayerType type, ActivationType activation, uint16_t in_dim, uint16_t out_dim, uint16_t kernel) {
+    ModelLayerHeader header = {(uint8_t)type, (uint8_t)activation, 0, in_dim, out_dim, kernel, 1, 1.0f / 127.0f, 0, 0};
+    size_t header_offset = builder.size;
+    size_t payload_start = 0;
+    size_t rows = out_dim;
+    size_t columns = type == LAYER_CONV1D ? (size_t)kernel * in_dim : in_dim;
+    float scale = 1.0f / (127.0f * (float)columns);
+
+    append(&header, sizeof(header));
+    payload_start = builder.size;
+    if (type == LAYER_GRU || type == LAYER_LSTM) {
+        rows *= type == LAYER_GRU ? 3 : 4;
+        append_weights(rows * columns);
+        append_weights(rows * out_dim);
+        append_constant(rows, scale);
+        append_constant(rows, 1.0f / (127.0f * out_dim));
+        append_zero_bias(rows);
+        append_zero_bias(rows);
+    } else {
+        append_weights(rows * columns);
+        append_constant(rows, scale);
+        append_zero_bias(rows);
+    }
+
+    header.payload_size = (uint32_t)(builder.size - payload_start);
+    memcpy(builder.data + header_offset, &header, sizeof(header));
+}
+
+static double now_seconds(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static double inferences_per_second(InferenceModel* model, const float* input, size_t input_length, float* output) {
+    unsigned long runs = 0;
+    double start = now_seconds();
+    double elapsed = 0.0;
+
+    do {
+        for (int i = 0; i < 64; i++) {
+            inference_model_run(model, input, input_length, output, model->output_length);
+        }
+        runs += 64;
+        elapsed = now_seconds() - start;
+    } while (elapsed < BENCH_SECONDS);
+
+    return runs / elapsed;
+}
+
+static void bench(const char* name, const uint8_t* data, size_t size) {
+    InferenceModel model;
+    float input[1024];
+    float output[64];
+    float reference = 0.0f;
+    size_t input_length = 0;
+    double scalar_rate = 0.0;
+
+    if (!inference_model_load(&model, data, size, arena, sizeof(arena))) {
+        fprintf(stderr, "%s: model rejected\n", name);
+        exit(1);
+    }
+
+    input_length = (size_t)model.input_length * model.input_channels;
+    for (size_t i = 0; i < input_length; i++) {
+        input[i] = (float)((i * 7) % 11) / 10.0f;
+    }
+
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        double rate = 0.0;
+
+        if (!inference_model_set_kernels(&model, variants[v])) {
+            continue;
+        }
+
+        rate = inferences_per_second(&model, input, input_length, output);
+        if (variants[v] == KERNEL_VARIANT_SCALAR) {
+            scalar_rate = rate;
+            reference = output[0];
+        } else if (output[0] != reference) {
+            printf("%s: %s output differs from scalar\n", name, model.kernels->name);
+        }
+        printf("%-12s %-8s %8zu %10zu %14.0f %8.2fx\n", name, model.kernels->name, size, model.arena_used,
+               rate, rate / scalar_rate);
+    }
+}
+
+int main(void) {
+    printf("%-12s %-8s %8s %10s %14s %9s\n", "model", "variant", "bytes", "arena", "inferences/s", "speed-up");
+
+    begin_model(2, 1, 64, 16);
+    add_layer(LAYER_DENSE, ACTIVATION_RELU, 64, 32, 0);
+    add_layer(LAYER_DENSE, ACTIVATION_NONE, 32, 16, 0);
+    bench("dense", builder.data, builder.size);
+
+    begin_model(2, 48, 2, 1);
+    add_layer(LAYER_CONV1D, ACTIVATION_RELU, 2, 8, 5);
+    add_layer(LAYER_DENSE, ACTIVATION_NONE, 44 * 8, 1, 0);
+    bench("conv1d", builder.data, builder.size);
+
+    begin_model(2, 24, 2, 1);
+    add_layer(LAYER_GRU, ACTIVATION_NONE, 2, 16, 0);
+    add_layer(LAYER_DENSE, ACTIVATION_NONE, 16, 1, 0);
+    bench("gru", builder.data, builder.size);
+
+    begin_model(2, 24, 2, 1);
+    add_layer(LAYER_LSTM, ACTIVATION_NONE, 2, 16, 0);
+    add_layer(LAYER_DENSE, ACTIVATION_NONE, 16, 1, 0);
+    bench("lstm", builder.data, builder.size);
+
+    bench("forecaster", energy_forecast_model, energy_forecast_model_size);
+    return 0;
+}
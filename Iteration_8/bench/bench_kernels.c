@@ -0,0 +1,173 @@
+/**
+ * \file bench_kernels.c
+ * \brief Compares the scalar and SIMD variants of the inference kernels.
+ *
+ * For every variant available on the running CPU, times the int8
+ * matrix-vector product on layer-sized shapes and the requantization of a
+ * layer output with each activation, checks the results against the scalar
+ * kernels and prints the speed-up.
+ *
+ * Build from the repository root:
+ *   gcc -O2 -o bin/bench_kernels Iteration_8/bench/bench_kernels.c Iteration_8/inference_kernels.c
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../inference_kernels.h"
+
+#define MAX_ROWS 256
+#define MAX_COLUMNS 512
+#define REQUANTIZE_COUNT 1024
+#define BENCH_SECONDS 0.2
+
+typedef struct {
+    size_t rows;
+    size_t columns;
+} MatVecShape;
+
+static const MatVecShape shapes[] = {
+    {4, 3},      // forecaster convolution
+    {48, 16},    // recurrent gates, hidden size 16
+    {32, 64},    // dense hidden layer
+    {64, 352},   // dense over a flattened convolution
+    {256, 512}   // large dense layer
+};
+
+static const KernelVariant variants[] = {
+    KERNEL_VARIANT_SCALAR, KERNEL_VARIANT_SSE41, KERNEL_VARIANT_AVX2, KERNEL_VARIANT_NEON
+};
+
+static const char* activation_names[] = {"none", "relu", "tanh", "sigmoid"};
+
+static int8_t weights[MAX_ROWS * MAX_COLUMNS];
+static int8_t input[MAX_COLUMNS];
+static int32_t bias[MAX_ROWS];
+static int32_t expected[MAX_ROWS];
+static int32_t actual[MAX_ROWS];
+static int32_t accumulators[REQUANTIZE_COUNT];
+static float scales[REQUANTIZE_COUNT];
+static int8_t expected_q[REQUANTIZE_COUNT];
+static int8_t actual_q[REQUANTIZE_COUNT];
+
+static double now_seconds(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void fill_inputs(void) {
+    uint32_t seed = 2463534242u;
+
+    for (size_t i = 0; i < sizeof(weights); i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        weights[i] = (int8_t)((int)(seed % 255) - 127);
+    }
+    for (size_t i = 0; i < MAX_COLUMNS; i++) {
+        input[i] = weights[(i * 31) % sizeof(weights)];
+    }
+    for (size_t i = 0; i < MAX_ROWS; i++) {
+        bias[i] = (int32_t)(i * 37) - 4000;
+    }
+    for (size_t i = 0; i < REQUANTIZE_COUNT; i++) {
+        accumulators[i] = (int32_t)((i * 7919) % 40000) - 20000;
+        scales[i] = 1.0f / (127.0f * (float)(1 + i % 7));
+    }
+}
+
+/**
+ * \brief Returns nanoseconds per matrix-vector product.
+ */
+static double time_matvec(const InferenceKernels* kernels, const MatVecShape* shape) {
+    unsigned long calls = 0;
+    double start = now_seconds();
+    double elapsed = 0.0;
+
+    do {
+        for (int i = 0; i < 32; i++) {
+            kernels->matvec_s8(weights, shape->rows, shape->columns, input, bias, actual);
+        }
+        calls += 32;
+        elapsed = now_seconds() - start;
+    } while (elapsed < BENCH_SECONDS);
+
+    return elapsed * 1e9 / calls;
+}
+
+/**
+ * \brief Returns nanoseconds per requantization of REQUANTIZE_COUNT values.
+ */
+static double time_requantize(const InferenceKernels* kernels, ActivationType activation) {
+    unsigned long calls = 0;
+    double start = now_seconds();
+    double elapsed = 0.0;
+
+    do {
+        for (int i = 0; i < 32; i++) {
+            kernels->requantize(accumulators, REQUANTIZE_COUNT, 1.0f / 127.0f, scales, activation, 1.0f / 127.0f, actual_q);
+        }
+        calls += 32;
+        elapsed = now_seconds() - start;
+    } while (elapsed < BENCH_SECONDS);
+
+    return elapsed * 1e9 / calls;
+}
+
+int main(void) {
+    const InferenceKernels* scalar = inference_kernels_get(KERNEL_VARIANT_SCALAR);
+    bool mismatch = false;
+
+    fill_inputs();
+    printf("auto-selected kernels: %s\n\n", inference_kernels_get(KERNEL_VARIANT_AUTO)->name);
+
+    printf("%-20s %-8s %12s %9s\n", "matvec rows x cols", "variant", "ns/call", "speed-up");
+    for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++) {
+        char label[32];
+        double scalar_ns = time_matvec(scalar, &shapes[s]);
+
+        snprintf(label, sizeof(label), "%zu x %zu", shapes[s].rows, shapes[s].columns);
+        scalar->matvec_s8(weights, shapes[s].rows, shapes[s].columns, input, bias, expected);
+        for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+            const InferenceKernels* kernels = inference_kernels_get(variants[v]);
+            double ns = 0.0;
+
+            if (kernels == NULL) {
+                continue;
+            }
+            ns = kernels == scalar ? scalar_ns : time_matvec(kernels, &shapes[s]);
+            if (memcmp(expected, actual, shapes[s].rows * sizeof(int32_t)) != 0) {
+                printf("%s matvec differs from scalar on %s\n", kernels->name, label);
+                mismatch = true;
+            }
+            printf("%-20s %-8s %12.1f %8.2fx\n", label, kernels->name, ns, scalar_ns / ns);
+        }
+    }
+
+    printf("\n%-20s %-8s %12s %9s\n", "requantize x1024", "variant", "ns/call", "speed-up");
+    for (int a = ACTIVATION_NONE; a <= ACTIVATION_SIGMOID; a++) {
+        double scalar_ns = time_requantize(scalar, (ActivationType)a);
+
+        memcpy(expected_q, actual_q, sizeof(actual_q));
+        for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+            const InferenceKernels* kernels = inference_kernels_get(variants[v]);
+            double ns = 0.0;
+
+            if (kernels == NULL) {
+                continue;
+            }
+            ns = kernels == scalar ? scalar_ns : time_requantize(kernels, (ActivationType)a);
+            if (memcmp(expected_q, actual_q, sizeof(actual_q)) != 0) {
+                printf("%s requantize differs from scalar with %s\n", kernels->name, activation_names[a]);
+                mismatch = true;
+            }
+            printf("%-20s %-8s %12.1f %8.2fx\n", activation_names[a], kernels->name, ns, scalar_ns / ns);
+        }
+    }
+
+    return mismatch ? 1 : 0;
+}
@@ -0,0 +1,221 @@
+/**
+ * \file bench_planner.c
+ * \brief Greedy and lookahead scheduling of periodic jobs against the offline optimum.
+ *
+ * Simulates a year of hourly slots with a cloudy solar harvester, a small
+ * battery and a periodic workload. The greedy policy attempts every due job
+ * as soon as energy allows, in dependency order; the metric policy does the
+ * same in the order of the heuristic metric of the greedy scheduling policy,
+ * like execute_tasks; the lookahead policy attempts
+ * the jobs the planner places in the current slot, with the Holt-Winters
+ * forecast and with a perfect forecast. All policies run through
+ * schedule_simulate, so they differ only in which jobs they attempt, and are
+ * compared with the optimal schedule computed by the oracle. Jobs per joule
+ * are completed jobs per joule harvested, the same harvest for every policy.
+ *
+ * Build from the repository root:
+ *   gcc -O2 -o bin/bench_planner Iteration_8/bench/bench_planner.c \
+ *       $(find Iteration_8 -maxdepth 1 -name '*.c' ! -name main.c)
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../energy_manager.h"
+#include "../lookahead_planner.h"
+#include "../prng.h"
+#include "../schedule_oracle.h"
+#include "../scheduling_policy.h"
+
+#define SIMULATED_DAYS 365u
+#define SLOT_COUNT (SIMULATED_DAYS * 24u)
+#define HORIZON_SLOTS 24u
+#define CAPACITY_MJ 400.0f
+#define RESERVE_MJ 100.0f
+#define INITIAL_CHARGE_MJ 200.0f
+#define PEAK_HARVEST_MJ 80.0f
+#define HARVEST_SEED 1u
+#define HARVEST_STREAM 0u
+
+/**
+ * \brief Periodic workload, dependencies listed before their dependents.
+ */
+static const PlanTask workload[] = {
+    {4.0f, 1, 1, true, 0},            // sense
+    {15.0f, 3, 3, false, 1u << 0},    // aggregate
+    {60.0f, 6, 6, false, 1u << 1},    // upload
+    {150.0f, 24, 24, false, 0},       // retrain
+    {20.0f, 12, 12, true, 0},         // heartbeat
+};
+
+#define WORKLOAD_SIZE (sizeof(workload) / sizeof(workload[0]))
+
+/**
+ * \brief Priority and weight of each workload task, as Task fields for the heuristic metric.
+ */
+static const uint8_t workload_priorities[WORKLOAD_SIZE] = {2, 1, 3, 1, 3};
+static const uint8_t workload_weights[WORKLOAD_SIZE] = {1, 2, 3, 3, 1};
+
+/**
+ * \brief State of the lookahead policy.
+ */
+typedef struct {
+    LookaheadPlanner planner;
+    SeasonalForecaster forecaster;
+    bool perfect_forecast;
+    double total_replan_us;
+    double max_replan_us;
+    uint32_t max_evaluations;
+} LookaheadContext;
+
+static float harvest[SLOT_COUNT];
+static double harvested_mj;
+
+/**
+ * \brief Solar harvest of every hour: a daylight bump scaled by a daily and an hourly cloud factor.
+ */
+static void generate_harvest(void) {
+    static const float daylight[24] = {0, 0, 0, 0, 0, 0, 0.05f, 0.2f, 0.4f, 0.6f, 0.8f, 0.95f,
+                                       1.0f, 0.95f, 0.8f, 0.6f, 0.4f, 0.2f, 0.05f, 0, 0, 0, 0, 0};
+    Prng prng;
+
+    prng_seed(&prng, HARVEST_SEED, HARVEST_STREAM);
+
+    for (uint32_t day = 0; day < SIMULATED_DAYS; day++) {
+        float weather = 0.25f + prng_unit(&prng);
+
+        for (uint32_t hour = 0; hour < 24; hour++) {
+            float clouds = 0.7f + 0.6f * prng_unit(&prng);
+            harvest[day * 24 + hour] = PEAK_HARVEST_MJ * daylight[hour] * weather * clouds;
+            harvested_mj += harvest[day * 24 + hour];
+        }
+    }
+}
+
+static double now_us(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+static uint32_t choose_greedy(void* context, uint32_t slot, float charge_mj, uint32_t pending) {
+    (void)context;
+    (void)slot;
+    (void)charge_mj;
+    return pending;
+}
+
+/**
+ * \brief Execution order of the greedy scheduling policy, from its heuristic metric.
+ */
+static void metric_order(uint8_t* order) {
+    const SchedulingPolicy* policy = scheduling_policy_default();
+    GoalParameters goal_params = {MAXIMIZE_TASKS, 0};
+    float ranks[WORKLOAD_SIZE];
+
+    for (uint8_t i = 0; i < WORKLOAD_SIZE; i++) {
+        Task task;
+
+        memset(&task, 0, sizeof(task));
+        task.priority = workload_priorities[i];
+        task.weight = workload_weights[i];
+        task.critical = workload[i].critical;
+        task.energy_cost_mj = workload[i].energy_mj;
+        ranks[i] = policy->rank_task(&task, &goal_params, 1.0f);
+    }
+    schedule_order_by_rank(ranks, WORKLOAD_SIZE, order);
+}
+
+static uint32_t choose_lookahead(void* context, uint32_t slot, float charge_mj, uint32_t pending) {
+    LookaheadContext* lookahead = context;
+    float forecast[HORIZON_SLOTS] = {0};
+    uint32_t attempted = 0;
+    double start = 0.0;
+    double elapsed = 0.0;
+
+    if (slot > 0) {
+        seasonal_forecaster_update(&lookahead->forecaster, (uint8_t)((slot - 1) % 24), harvest[slot - 1]);
+    }
+    if (lookahead->perfect_forecast) {
+        for (uint32_t k = 0; k < HORIZON_SLOTS && slot + k < SLOT_COUNT; k++) {
+            forecast[k] = harvest[slot + k];
+        }
+    } else {
+        seasonal_forecaster_forecast(&lookahead->forecaster, forecast, HORIZON_SLOTS);
+    }
+
+    start = now_us();
+    lookahead_planner_replan(&lookahead->planner, slot, forecast, charge_mj);
+    elapsed = now_us() - start;
+    lookahead->total_replan_us += elapsed;
+    lookahead->max_replan_us = elapsed > lookahead->max_replan_us ? elapsed : lookahead->max_replan_us;
+    if (lookahead->planner.evaluations > lookahead->max_evaluations) {
+        lookahead->max_evaluations = lookahead->planner.evaluations;
+    }
+
+    for (uint8_t i = 0; i < WORKLOAD_SIZE; i++) {
+        if ((pending & (1u << i)) != 0 && lookahead_planner_should_run(&lookahead->planner, i)) {
+            attempted |= 1u << i;
+        }
+    }
+    return attempted;
+}
+
+static void lookahead_completed(void* context, uint8_t task) {
+    LookaheadContext* lookahead = context;
+    lookahead_planner_complete(&lookahead->planner, task);
+}
+
+static void print_row(const char* name, const ScheduleOutcome* outcome, const ScheduleOutcome* optimum,
+                      double mean_us, double max_us) {
+    printf("%-20s %9u %9u %10.0f %10.0f %8.2f %7.4f %9.2f %9.1f\n", name, outcome->completed,
+           outcome->critical_released - outcome->critical_completed, outcome->consumed_mj, outcome->wasted_mj,
+           outcome->completed / (harvested_mj / 1000.0), (double)outcome->completed / optimum->completed,
+           mean_us, max_us);
+}
+
+int main(void) {
+    ScheduleScenario scenario = {workload, WORKLOAD_SIZE, harvest, SLOT_COUNT, CAPACITY_MJ, RESERVE_MJ, INITIAL_CHARGE_MJ};
+    static LookaheadContext lookahead;
+    uint8_t order[WORKLOAD_SIZE];
+    SchedulePolicy greedy = {choose_greedy, NULL, NULL, NULL};
+    SchedulePolicy metric = {choose_greedy, NULL, NULL, order};
+    SchedulePolicy planned = {choose_lookahead, lookahead_completed, &lookahead, NULL};
+    ScheduleOutcome optimum;
+    ScheduleOutcome outcome;
+    double start = 0.0;
+    double oracle_us = 0.0;
+
+    generate_harvest();
+    start = now_us();
+    if (!schedule_oracle_solve(&scenario, ORACLE_MAXIMIZE_TASKS, NULL, &optimum)) {
+        return 1;
+    }
+    oracle_us = now_us() - start;
+
+    printf("%u days, %u jobs released, oracle solved in %.0f ms over %llu states\n", SIMULATED_DAYS, optimum.released,
+           oracle_us / 1000.0, (unsigned long long)optimum.states);
+    printf("%-20s %9s %9s %10s %10s %8s %7s %9s %9s\n", "policy", "completed", "crit miss", "used mJ", "wasted mJ",
+           "jobs/J", "ratio", "mean us", "max us");
+
+    schedule_simulate(&scenario, &greedy, &outcome);
+    print_row("greedy", &outcome, &optimum, 0.0, 0.0);
+    metric_order(order);
+    schedule_simulate(&scenario, &metric, &outcome);
+    print_row("metric", &outcome, &optimum, 0.0, 0.0);
+
+    for (int perfect = 0; perfect <= 1; perfect++) {
+        memset(&lookahead, 0, sizeof(lookahead));
+        lookahead.perfect_forecast = perfect != 0;
+        lookahead_planner_init(&lookahead.planner, workload, WORKLOAD_SIZE, HORIZON_SLOTS, CAPACITY_MJ, RESERVE_MJ);
+        seasonal_forecaster_init(&lookahead.forecaster, 0.3f, 0.01f, 0.3f);
+        schedule_simulate(&scenario, &planned, &outcome);
+        print_row(perfect ? "lookahead (perfect)" : "lookahead", &outcome, &optimum,
+                  lookahead.total_replan_us / SLOT_COUNT, lookahead.max_replan_us);
+    }
+
+    print_row("oracle", &optimum, &optimum, 0.0, 0.0);
+    return 0;
+}
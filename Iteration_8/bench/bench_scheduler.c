@@ -0,0 +1,510 @@
+/**
+ * \file bench_scheduler.c
+ * \brief Microbenchmarks of the scheduler's hot functions across input sizes.
+ *
+ * Measures the task queue operations at several queue sizes, execute_tasks
+ * on chain, fan-out/fan-in and random layered dependency graphs, the energy
+ * profile queries and updates at several history lengths, and predict_energy
+ * on dense models of growing input length next to the shipped forecaster.
+ * The timer wheel is measured under 1K to 128K pending hourly timers: arming
+ * and cancelling a batch of one-shot timers due within a day, finding the
+ * next expiry, and advancing by one hour, which fires every pending timer.
+ * Task metrics follow the task index, so execute_tasks always dequeues a task
+ * before its dependencies and pays for the deferrals.
+ *
+ * Build from the repository root:
+ *   gcc -O2 -o bin/bench_scheduler Iteration_8/bench/bench_scheduler.c Iteration_8/bench/bench_harness.c \
+ *       $(find Iteration_8 -maxdepth 1 -name '*.c' ! -name main.c)
+ *
+ * Run with --json=FILE to also write the results as JSON.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench_harness.h"
+#include "../energy_forecast_model.h"
+#include "../energy_manager.h"
+#include "../energy_pool.h"
+#include "../hardware_abstraction.h"
+#include "../prng.h"
+#include "../task_manager.h"
+#include "../timer_wheel.h"
+
+#define QUEUE_SIZE_COUNT 4
+#define DAG_SHAPE_COUNT 3
+#define DAG_SIZE_COUNT 3
+#define OCCURRENCE_COUNT 4
+#define HISTORY_COUNT 4
+#define MODEL_COUNT 3
+#define MAX_QUEUE_SIZE 255
+#define MAX_INPUT_LENGTH 336
+#define HIDDEN_UNITS 16
+#define BLOB_CAPACITY 8192
+#define ARENA_SIZE 4096
+#define BENCH_SEED 42u
+#define NOON (12u * SECONDS_PER_HOUR)
+#define WHEEL_SIZE_COUNT 3
+#define MAX_WHEEL_TIMERS 131072
+#define WHEEL_BATCH 256
+#define MS_PER_HOUR (SECONDS_PER_HOUR * 1000u)
+#define MS_PER_DAY (SECONDS_PER_DAY * 1000u)
+
+typedef struct {
+    TaskQueue* queue;
+    Task tasks[MAX_QUEUE_SIZE];
+    uint8_t count;
+} QueueBench;
+
+typedef enum {
+    DAG_CHAIN,   ///< Every task depends on the previous one.
+    DAG_FAN,     ///< One root, independent middle tasks and a sink depending on all of them.
+    DAG_RANDOM   ///< Every task depends on a random subset of the earlier ones, at least one.
+} DagShape;
+
+typedef struct {
+    TaskQueue* queue;
+    Task tasks[MAX_TASKS];
+    Task* dependencies[MAX_TASKS][MAX_TASKS];
+    uint8_t count;
+    EnergySource sources[2];
+    BatteryState battery;
+    EnergyPool pool;
+    GoalParameters goal;
+    HardwareContext hardware;
+} DagBench;
+
+typedef struct {
+    EnergySource source;
+} SourceBench;
+
+typedef struct {
+    AvailabilityIndex index;
+    uint32_t available_hours;
+} IndexBench;
+
+typedef struct {
+    EnergySource sources[2];
+    BatteryState battery;
+    EnergyPool pool;
+    uint32_t available_hours;
+} PoolBench;
+
+typedef struct {
+    _Alignas(4) uint8_t blob[BLOB_CAPACITY];
+    size_t size;
+    _Alignas(4) uint8_t arena[ARENA_SIZE];
+    TinyMLModel model;
+    float input[MAX_INPUT_LENGTH];
+    size_t input_length;
+    float prediction;
+} ModelBench;
+
+typedef struct {
+    TimerWheel wheel;
+    WheelTimer timers[MAX_WHEEL_TIMERS];  ///< Hourly timers kept pending throughout.
+    WheelTimer batch[WHEEL_BATCH];        ///< One-shot timers armed and cancelled by the cases.
+    uint32_t offsets[WHEEL_BATCH];        ///< Delay of each batch timer, within a day.
+    uint32_t count;
+    uint64_t next_expiry;
+} WheelBench;
+
+static const uint8_t queue_sizes[QUEUE_SIZE_COUNT] = {4, 16, 64, MAX_QUEUE_SIZE};
+static const uint8_t dag_sizes[DAG_SIZE_COUNT] = {3, 6, MAX_TASKS};
+static const char* const dag_names[DAG_SHAPE_COUNT] = {"chain", "fan", "random"};
+static const uint8_t occurrences[OCCURRENCE_COUNT] = {1, 4, 12, 24};
+static const uint16_t history_days[HISTORY_COUNT] = {5, 30, STREAM_STATS_MAX_WINDOW, 0};
+static const uint16_t model_inputs[MODEL_COUNT] = {24, 96, MAX_INPUT_LENGTH};
+static const uint32_t wheel_sizes[WHEEL_SIZE_COUNT] = {1024, 16384, MAX_WHEEL_TIMERS};
+
+static QueueBench queue_benches[QUEUE_SIZE_COUNT];
+static DagBench dag_benches[DAG_SHAPE_COUNT][DAG_SIZE_COUNT];
+static IndexBench index_benches[OCCURRENCE_COUNT];
+static PoolBench pool_benches[OCCURRENCE_COUNT];
+static SourceBench profile_benches[HISTORY_COUNT];
+static ModelBench model_benches[MODEL_COUNT + 1];
+static WheelBench wheel_benches[WHEEL_SIZE_COUNT];
+static BenchSuite suite;
+
+static void noop_task(void* context) {
+    (void)context;
+}
+
+static void empty_queue(void* state) {
+    ((QueueBench*)state)->queue->size = 0;
+}
+
+static void enqueue_all(void* state) {
+    QueueBench* bench = (QueueBench*)state;
+
+    for (uint8_t i = 0; i < bench->count; i++) {
+        enqueue_task(bench->queue, &bench->tasks[i]);
+    }
+}
+
+static void fill_queue(void* state) {
+    empty_queue(state);
+    enqueue_all(state);
+}
+
+static void drain_queue(void* state) {
+    QueueBench* bench = (QueueBench*)state;
+
+    while (bench->queue->size > 0) {
+        dequeue_task(bench->queue);
+    }
+}
+
+static void prepare_dag(void* state) {
+    DagBench* bench = (DagBench*)state;
+
+    bench->battery.charge_mj = bench->battery.capacity_mj;
+    energy_pool_begin_step(&bench->pool, NOON, NOON + SECONDS_PER_HOUR);
+    for (uint8_t i = 0; i < bench->count; i++) {
+        bench->tasks[i].completed = false;
+        enqueue_task(bench->queue, &bench->tasks[i]);
+    }
+}
+
+static void run_dag(void* state) {
+    DagBench* bench = (DagBench*)state;
+
+    execute_tasks(bench->queue, &bench->pool, &bench->goal, NOON, &bench->hardware);
+}
+
+static void query_index_day(void* state) {
+    IndexBench* bench = (IndexBench*)state;
+    uint32_t available_hours = 0;
+
+    for (uint8_t hour = 0; hour < 24; hour++) {
+        available_hours += availability_index_is_available(&bench->index, hour * SECONDS_PER_HOUR);
+    }
+    bench->available_hours = available_hours;
+}
+
+static void query_pool_day(void* state) {
+    PoolBench* bench = (PoolBench*)state;
+    uint32_t available_hours = 0;
+
+    for (uint8_t hour = 0; hour < 24; hour++) {
+        available_hours += energy_pool_is_available(&bench->pool, hour * SECONDS_PER_HOUR, 1.0f, false);
+    }
+    bench->available_hours = available_hours;
+}
+
+static void update_profile(void* state) {
+    update_energy_profile(&((SourceBench*)state)->source);
+}
+
+static void predict(void* state) {
+    ModelBench* bench = (ModelBench*)state;
+
+    bench->prediction = predict_energy(&bench->model, bench->input, bench->input_length);
+}
+
+static void cancel_batch(void* state) {
+    WheelBench* bench = (WheelBench*)state;
+
+    for (size_t i = 0; i < WHEEL_BATCH; i++) {
+        timer_wheel_cancel(&bench->wheel, &bench->batch[i]);
+    }
+}
+
+static void schedule_batch(void* state) {
+    WheelBench* bench = (WheelBench*)state;
+
+    for (size_t i = 0; i < WHEEL_BATCH; i++) {
+        timer_wheel_schedule(&bench->wheel, &bench->batch[i], bench->wheel.now + bench->offsets[i], 0);
+    }
+}
+
+static void find_next_expiry(void* state) {
+    WheelBench* bench = (WheelBench*)state;
+
+    bench->next_expiry = timer_wheel_next_expiry(&bench->wheel);
+}
+
+static void advance_hour(void* state) {
+    WheelBench* bench = (WheelBench*)state;
+
+    timer_wheel_advance(&bench->wheel, bench->wheel.now + MS_PER_HOUR);
+}
+
+static void describe(BenchCase* bench_case, const char* format, ...) {
+    va_list arguments;
+
+    if (bench_case == NULL) {
+        return;
+    }
+    va_start(arguments, format);
+    vsnprintf(bench_case->parameter, sizeof(bench_case->parameter), format, arguments);
+    va_end(arguments);
+}
+
+static bool add_queue_cases(void) {
+    Prng random;
+
+    prng_seed(&random, BENCH_SEED, 0);
+    for (size_t s = 0; s < QUEUE_SIZE_COUNT; s++) {
+        QueueBench* bench = &queue_benches[s];
+
+        bench->count = queue_sizes[s];
+        bench->queue = init_task_queue(bench->count);
+        if (bench->queue == NULL) {
+            return false;
+        }
+        for (uint8_t i = 0; i < bench->count; i++) {
+            bench->tasks[i].taskFunction = noop_task;
+            bench->tasks[i].heuristic_metric = prng_unit(&random);
+        }
+        describe(bench_suite_add(&suite, "enqueue_task", empty_queue, enqueue_all, bench, bench->count), "queue=%u",
+                 bench->count);
+        describe(bench_suite_add(&suite, "dequeue_task", fill_queue, drain_queue, bench, bench->count), "queue=%u",
+                 bench->count);
+    }
+    return true;
+}
+
+static void link_tasks(DagBench* bench, DagShape shape, Prng* random) {
+    for (uint8_t i = 1; i < bench->count; i++) {
+        Task* task = &bench->tasks[i];
+
+        if (shape == DAG_CHAIN || (shape == DAG_FAN && i < bench->count - 1)) {
+            bench->dependencies[i][task->num_dependencies++] = &bench->tasks[shape == DAG_CHAIN ? i - 1 : 0];
+        } else if (shape == DAG_FAN) {
+            for (uint8_t j = 1; j < i; j++) {
+                bench->dependencies[i][task->num_dependencies++] = &bench->tasks[j];
+            }
+        } else {
+            for (uint8_t j = 0; j < i; j++) {
+                if (prng_below(random, 3) == 0) {
+                    bench->dependencies[i][task->num_dependencies++] = &bench->tasks[j];
+                }
+            }
+            if (task->num_dependencies == 0) {
+                bench->dependencies[i][task->num_dependencies++] = &bench->tasks[prng_below(random, i)];
+            }
+        }
+    }
+}
+
+static bool add_dag_cases(void) {
+    Prng random;
+
+    prng_seed(&random, BENCH_SEED, 1);
+    for (size_t shape = 0; shape < DAG_SHAPE_COUNT; shape++) {
+        for (size_t s = 0; s < DAG_SIZE_COUNT; s++) {
+            DagBench* bench = &dag_benches[shape][s];
+            EnergySource solar = {SOLAR, 0, 24, 1, {0}, 0.0f, 1000000.0f, 0};
+            EnergySource storage = {BATTERY, 0, 24, 1, {0}, 0.0f, 0.0f, 0};
+
+            bench->count = dag_sizes[s];
+            bench->queue = init_task_queue(MAX_TASKS);
+            if (bench->queue == NULL) {
+                return false;
+            }
+            for (uint8_t i = 0; i < bench->count; i++) {
+                Task* task = &bench->tasks[i];
+
+                task->taskFunction = noop_task;
+                task->priority = 1;
+                task->weight = 1;
+                task->heuristic_metric = (float)i;
+                task->dependencies = bench->dependencies[i];
+                task->energy_cost_mj = 1.0f;
+            }
+            link_tasks(bench, (DagShape)shape, &random);
+
+            bench->sources[0] = solar;
+            bench->sources[1] = storage;
+            bench->battery.capacity_mj = 1000000.0f;
+            energy_pool_init(&bench->pool);
+            energy_pool_add_source(&bench->pool, &bench->sources[0]);
+            energy_pool_add_battery(&bench->pool, &bench->sources[1], &bench->battery);
+            energy_pool_refresh(&bench->pool);
+            bench->goal.goal = MAXIMIZE_TASKS;
+            bench->goal.duration_days = 1;
+            init_peripherals(&bench->hardware, NULL);
+            set_time_scale(&bench->hardware, 0.0f);
+
+            describe(bench_suite_add(&suite, "execute_tasks", prepare_dag, run_dag, bench, 1), "%s,tasks=%u",
+                     dag_names[shape], bench->count);
+        }
+    }
+    return true;
+}
+
+static bool add_energy_cases(void) {
+    for (size_t i = 0; i < OCCURRENCE_COUNT; i++) {
+        EnergySource solar = {SOLAR, 0, 1, occurrences[i], {0}, 0.0f, 1000.0f, 0};
+        EnergySource storage = {BATTERY, 0, 24, 1, {0}, 0.0f, 0.0f, 0};
+        PoolBench* pool = &pool_benches[i];
+
+        availability_index_init(&index_benches[i].index, SECONDS_PER_DAY);
+        availability_index_sync(&index_benches[i].index, &solar);
+        describe(bench_suite_add(&suite, "availability_index_is_available", NULL, query_index_day, &index_benches[i],
+                                 24),
+                 "occurrences=%u", occurrences[i]);
+
+        // An empty battery leaves the answer to the solar windows, as on a node running from its harvest.
+        pool->sources[0] = solar;
+        pool->sources[1] = storage;
+        pool->battery.capacity_mj = 1000.0f;
+        energy_pool_init(&pool->pool);
+        energy_pool_add_source(&pool->pool, &pool->sources[0]);
+        energy_pool_add_battery(&pool->pool, &pool->sources[1], &pool->battery);
+        energy_pool_refresh(&pool->pool);
+        energy_pool_begin_step(&pool->pool, 0, SECONDS_PER_HOUR);
+        describe(bench_suite_add(&suite, "energy_pool_is_available", NULL, query_pool_day, pool, 24),
+                 "occurrences=%u", occurrences[i]);
+    }
+
+    for (size_t i = 0; i < HISTORY_COUNT; i++) {
+        EnergySource source = {SOLAR, 6, 8, 1, {0}, 0.0f, 1000.0f, 0};
+        SourceBench* bench = &profile_benches[i];
+
+        bench->source = source;
+        if (history_days[i] == 0) {
+            if (!configure_energy_history(&bench->source, STREAM_STATS_EXPONENTIAL, 1, 0.1f)) {
+                return false;
+            }
+            describe(bench_suite_add(&suite, "update_energy_profile", NULL, update_profile, bench, 1), "exponential");
+        } else {
+            if (!configure_energy_history(&bench->source, STREAM_STATS_WINDOW, history_days[i], 0.0f)) {
+                return false;
+            }
+            describe(bench_suite_add(&suite, "update_energy_profile", NULL, update_profile, bench, 1), "window=%u",
+                     history_days[i]);
+        }
+    }
+    return true;
+}
+
+static bool add_wheel_cases(void) {
+    Prng random;
+
+    prng_seed(&random, BENCH_SEED, 0);
+    for (size_t s = 0; s < WHEEL_SIZE_COUNT; s++) {
+        WheelBench* bench = &wheel_benches[s];
+
+        bench->count = wheel_sizes[s];
+        timer_wheel_init(&bench->wheel, 0);
+        for (uint32_t i = 0; i < bench->count; i++) {
+            wheel_timer_init(&bench->timers[i], NULL, NULL);
+            timer_wheel_schedule(&bench->wheel, &bench->timers[i], 1u + prng_below(&random, MS_PER_HOUR), MS_PER_HOUR);
+        }
+        for (size_t i = 0; i < WHEEL_BATCH; i++) {
+            wheel_timer_init(&bench->batch[i], NULL, NULL);
+            bench->offsets[i] = 1u + prng_below(&random, MS_PER_DAY);
+        }
+        describe(bench_suite_add(&suite, "timer_wheel_schedule", cancel_batch, schedule_batch, bench, WHEEL_BATCH),
+                 "pending=%u", bench->count);
+        describe(bench_suite_add(&suite, "timer_wheel_cancel", schedule_batch, cancel_batch, bench, WHEEL_BATCH),
+                 "pending=%u", bench->count);
+        describe(bench_suite_add(&suite, "timer_wheel_next_expiry", NULL, find_next_expiry, bench, 1), "pending=%u",
+                 bench->count);
+        describe(bench_suite_add(&suite, "timer_wheel_advance", cancel_batch, advance_hour, bench, bench->count),
+                 "pending=%u hour", bench->count);
+    }
+    return true;
+}
+
+static void append(ModelBench* bench, const void* bytes, size_t length) {
+    memcpy(bench->blob + bench->size, bytes, length);
+    bench->size += (length + 3) & ~(size_t)3;
+}
+
+/**
+ * \brief Appends a dense layer with deterministic weights scaled to keep activations in range.
+ */
+static void append_dense(ModelBench* bench, Prng* random, ActivationType activation, uint16_t in_dim,
+                         uint16_t out_dim) {
+    ModelLayerHeader header = {(uint8_t)LAYER_DENSE, (uint8_t)activation, 0, in_dim, out_dim, 0, 1, 1.0f / 127.0f, 0, 0};
+    size_t weights = (size_t)in_dim * out_dim;
+    size_t header_offset = bench->size;
+    size_t payload_start = 0;
+    float scale = 1.0f / (127.0f * (float)in_dim);
+    int32_t zero = 0;
+
+    append(bench, &header, sizeof(header));
+    payload_start = bench->size;
+    for (size_t i = 0; i < weights; i++) {
+        bench->blob[bench->size + i] = (uint8_t)(int8_t)((int)prng_below(random, 255) - 127);
+    }
+    bench->size += (weights + 3) & ~(size_t)3;
+    for (uint16_t row = 0; row < out_dim; row++) {
+        append(bench, &scale, sizeof(scale));
+    }
+    for (uint16_t row = 0; row < out_dim; row++) {
+        append(bench, &zero, sizeof(zero));
+    }
+    header.payload_size = (uint32_t)(bench->size - payload_start);
+    memcpy(bench->blob + header_offset, &header, sizeof(header));
+}
+
+static bool add_model_case(ModelBench* bench, const uint8_t* blob, size_t size, size_t input_length,
+                           const char* parameter) {
+    Prng random;
+
+    prng_seed(&random, BENCH_SEED, 2);
+    prng_fill_unit(&random, bench->input, input_length);
+    bench->input_length = input_length;
+    if (!load_tinyml_model(&bench->model, blob, size, bench->arena, ARENA_SIZE)) {
+        return false;
+    }
+    describe(bench_suite_add(&suite, "predict_energy", NULL, predict, bench, 1), "%s,input=%zu", parameter,
+             input_length);
+    return true;
+}
+
+static bool add_model_cases(void) {
+    Prng random;
+
+    prng_seed(&random, BENCH_SEED, 3);
+    for (size_t i = 0; i < MODEL_COUNT; i++) {
+        ModelBench* bench = &model_benches[i];
+        ModelHeader header = {INFERENCE_MODEL_MAGIC, INFERENCE_MODEL_VERSION, 2, 1, model_inputs[i], 1, 0,
+                              1.0f / 127.0f, 0};
+
+        append(bench, &header, sizeof(header));
+        append_dense(bench, &random, ACTIVATION_RELU, model_inputs[i], HIDDEN_UNITS);
+        append_dense(bench, &random, ACTIVATION_NONE, HIDDEN_UNITS, 1);
+        if (!add_model_case(bench, bench->blob, bench->size, model_inputs[i], "dense")) {
+            return false;
+        }
+    }
+    return add_model_case(&model_benches[MODEL_COUNT], energy_forecast_model, energy_forecast_model_size,
+                          ENERGY_FORECAST_HISTORY_HOURS, "forecaster");
+}
+
+int main(int argc, char* argv[]) {
+    const char* json_path = NULL;
+    FILE* json = NULL;
+
+    bench_suite_init(&suite, "scheduler");
+    if (!bench_suite_parse_options(&suite, argc, argv, &json_path)) {
+        fprintf(stderr, "Usage: %s [--samples=N] [--warmup=N] [--filter=TEXT] [--json=FILE]\n", argv[0]);
+        return 1;
+    }
+    if (!add_queue_cases() || !add_dag_cases() || !add_energy_cases() || !add_wheel_cases() ||
+        !add_model_cases()) {
+        fprintf(stderr, "Failed to set up the benchmarks\n");
+        return 1;
+    }
+
+    printf("timer overhead %.1f ns, %u warm-up runs, %u samples per case, times in ns per operation\n",
+           suite.timer_overhead_ns, suite.warmup_runs, suite.samples);
+    bench_suite_run(&suite, stdout);
+
+    if (json_path != NULL) {
+        json = fopen(json_path, "w");
+        if (json == NULL) {
+            perror(json_path);
+            return 1;
+        }
+        bench_suite_write_json(&suite, json);
+        fclose(json);
+        printf("Results written to %s\n", json_path);
+    }
+    return 0;
+}
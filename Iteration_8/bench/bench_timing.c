@@ -0,0 +1,118 @@
+/**
+ * \file bench_timing.c
+ * \brief Wake-up lateness and drift of relative sleeps against absolute periodic deadlines.
+ *
+ * Runs the same periodic loop twice, each period doing a fixed amount of
+ * busy work and then waiting: first with a relative sleep of one period,
+ * as sleep_ms did with usleep, then with periodic_deadline_wait(). Every
+ * wake-up is compared with its ideal time, start + k * period, and the
+ * p50, p99 and maximum lateness and the drift after the last period are
+ * reported. Relative sleeps drift by the work and overhead of every period;
+ * absolute deadlines keep a bounded lateness.
+ *
+ * Build from the repository root:
+ *   gcc -O2 -o bin/bench_timing Iteration_8/bench/bench_timing.c Iteration_8/monotonic_clock.c
+ *
+ * Run with [--periods=N] [--period-us=N] [--work-us=N].
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../monotonic_clock.h"
+
+#define DEFAULT_PERIODS 2000u
+#define DEFAULT_PERIOD_US 1000u
+#define DEFAULT_WORK_US 300u
+#define NS_PER_US 1000u
+
+typedef struct {
+    JitterStats jitter;
+    uint64_t drift_ns;
+    uint64_t missed;
+} TimingResult;
+
+static void busy_wait(uint64_t duration_ns) {
+    uint64_t end_ns = monotonic_now_ns() + duration_ns;
+
+    while (monotonic_now_ns() < end_ns) {
+    }
+}
+
+static void run_relative(uint32_t periods, uint64_t period_ns, uint64_t work_ns, TimingResult* result) {
+    uint64_t start_ns = monotonic_now_ns();
+    struct timespec period;
+    uint64_t now_ns = start_ns;
+
+    period.tv_sec = (time_t)(period_ns / NS_PER_SECOND);
+    period.tv_nsec = (long)(period_ns % NS_PER_SECOND);
+    jitter_stats_init(&result->jitter);
+    for (uint32_t k = 1; k <= periods; k++) {
+        uint64_t ideal_ns = start_ns + k * period_ns;
+
+        busy_wait(work_ns);
+        nanosleep(&period, NULL);
+        now_ns = monotonic_now_ns();
+        jitter_stats_add(&result->jitter, now_ns > ideal_ns ? now_ns - ideal_ns : 0);
+    }
+    result->drift_ns = now_ns - (start_ns + periods * period_ns);
+    result->missed = 0;
+}
+
+static void run_absolute(uint32_t periods, uint64_t period_ns, uint64_t work_ns, TimingResult* result) {
+    uint64_t start_ns = monotonic_now_ns();
+    PeriodicDeadline deadline;
+    uint64_t now_ns = start_ns;
+
+    periodic_deadline_init(&deadline, start_ns, period_ns);
+    jitter_stats_init(&result->jitter);
+    for (uint32_t k = 1; k <= periods; k++) {
+        busy_wait(work_ns);
+        periodic_deadline_wait(&deadline, &result->jitter);
+    }
+    now_ns = monotonic_now_ns();
+    result->drift_ns = now_ns > deadline.next_ns - period_ns ? now_ns - (deadline.next_ns - period_ns) : 0;
+    result->missed = deadline.missed;
+}
+
+static void print_result(const char* name, const TimingResult* result) {
+    printf("%-10s %12.1f %12.1f %12.1f %14.1f %8llu\n", name, jitter_stats_percentile(&result->jitter, 0.5f) / 1e3,
+           jitter_stats_percentile(&result->jitter, 0.99f) / 1e3, result->jitter.max_ns / 1e3, result->drift_ns / 1e3,
+           (unsigned long long)result->missed);
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t periods = DEFAULT_PERIODS;
+    uint64_t period_us = DEFAULT_PERIOD_US;
+    uint64_t work_us = DEFAULT_WORK_US;
+    TimingResult relative;
+    TimingResult absolute;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--periods=", 10) == 0) {
+            periods = (uint32_t)strtoul(argv[i] + 10, NULL, 10);
+        } else if (strncmp(argv[i], "--period-us=", 12) == 0) {
+            period_us = strtoull(argv[i] + 12, NULL, 10);
+        } else if (strncmp(argv[i], "--work-us=", 10) == 0) {
+            work_us = strtoull(argv[i] + 10, NULL, 10);
+        } else {
+            fprintf(stderr, "Usage: %s [--periods=N] [--period-us=N] [--work-us=N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (periods == 0 || period_us == 0 || work_us >= period_us) {
+        fprintf(stderr, "Periods and period must be positive and the work shorter than the period\n");
+        return 1;
+    }
+
+    run_relative(periods, period_us * NS_PER_US, work_us * NS_PER_US, &relative);
+    run_absolute(periods, period_us * NS_PER_US, work_us * NS_PER_US, &absolute);
+
+    printf("%u periods of %llu us with %llu us of work, lateness of the last %u wake-ups in us\n", periods,
+           (unsigned long long)period_us, (unsigned long long)work_us, JITTER_WINDOW);
+    printf("%-10s %12s %12s %12s %14s %8s\n", "sleep", "p50", "p99", "max", "final_drift", "missed");
+    print_result("relative", &relative);
+    print_result("absolute", &absolute);
+    return 0;
+}
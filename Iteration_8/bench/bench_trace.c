@@ -0,0 +1,193 @@
+/**
+ * \file bench_trace.c
+ * \brief Scan and range-query throughput of the indexed trace format.
+ *
+ * Writes a synthetic trace in the raw and the indexed format, then measures
+ * a full sequential scan of each and random interval integrals answered
+ * from the block summaries against a scan of the same interval.
+ *
+ * Build from the repository root:
+ *   gcc -O2 -o bin/bench_trace Iteration_8/bench/bench_trace.c Iteration_8/energy_trace.c \
+ *       Iteration_8/trace_format.c Iteration_8/error_handling.c Iteration_8/alloc_tracker.c Iteration_8/prng.c
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../energy_trace.h"
+#include "../prng.h"
+#include "../trace_format.h"
+
+#define SAMPLE_COUNT (16u * 1024u * 1024u)
+#define QUERY_COUNT 20000u
+#define RAW_PATH "/tmp/bench_trace.raw"
+#define INDEXED_PATH "/tmp/bench_trace.osti"
+#define BENCH_SEED 1u
+
+static double now_seconds(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * \brief Writes the same irregularly sampled trace in both formats.
+ */
+static void write_traces(void) {
+    EnergyTraceRawHeader header = {ENERGY_TRACE_RAW_MAGIC, 1, SAMPLE_COUNT};
+    FILE* raw = fopen(RAW_PATH, "wb");
+    TraceFileWriter writer;
+    Prng prng;
+    uint32_t time = 0;
+
+    if (raw == NULL || !trace_file_writer_open(&writer, INDEXED_PATH, 0.05f)) {
+        fprintf(stderr, "Cannot create the benchmark traces\n");
+        exit(1);
+    }
+
+    prng_seed(&prng, BENCH_SEED, 0);
+    fwrite(&header, sizeof(header), 1, raw);
+    for (uint32_t i = 0; i < SAMPLE_COUNT; i++) {
+        EnergyTraceRecord record = {time, (float)prng_below(&prng, 20000) * 0.05f};
+
+        fwrite(&record, sizeof(record), 1, raw);
+        trace_file_writer_add(&writer, record.time_s, record.power_mw);
+        time += 1 + prng_below(&prng, 8);
+    }
+
+    if (fclose(raw) != 0 || !trace_file_writer_close(&writer)) {
+        fprintf(stderr, "Cannot write the benchmark traces\n");
+        exit(1);
+    }
+}
+
+static void bench_raw_scan(void) {
+    EnergyTrace trace;
+    SimTime time = 0;
+    float power_mw = 0.0f;
+    double sum = 0.0;
+    double start = 0.0;
+    double elapsed = 0.0;
+    size_t samples = 0;
+
+    energy_trace_open(&trace, RAW_PATH, false);
+    start = now_seconds();
+    while (energy_trace_next_sample(&trace, &time, &power_mw)) {
+        sum += power_mw;
+        samples++;
+    }
+    elapsed = now_seconds() - start;
+    printf("%-24s %12zu bytes %10.1f Msamples/s  (sum %.0f)\n", "raw scan", trace.size, samples / elapsed / 1e6, sum);
+    energy_trace_close(&trace);
+}
+
+static void bench_indexed_scan(const TraceFile* file, bool with_times) {
+    static uint32_t times[TRACE_FILE_BLOCK_SAMPLES];
+    static float powers[TRACE_FILE_BLOCK_SAMPLES];
+    double sum = 0.0;
+    double start = now_seconds();
+    double elapsed = 0.0;
+    size_t samples = 0;
+
+    for (size_t block = 0; block < file->header->block_count; block++) {
+        size_t count = trace_file_decode_block(file, block, with_times ? times : NULL, powers);
+        float block_sum = 0.0f;
+
+        for (size_t i = 0; i < count; i++) {
+            block_sum += powers[i];
+        }
+        sum += block_sum;
+        samples += count;
+    }
+    elapsed = now_seconds() - start;
+    printf("%-24s %12zu bytes %10.1f Msamples/s  (sum %.0f)\n", with_times ? "indexed scan" : "indexed power column",
+           file->size, samples / elapsed / 1e6, sum);
+}
+
+/**
+ * \brief Integrates an interval by decoding every block it overlaps.
+ */
+static double scan_energy(const TraceFile* file, uint32_t start, uint32_t end) {
+    static uint32_t times[TRACE_FILE_BLOCK_SAMPLES];
+    static float powers[TRACE_FILE_BLOCK_SAMPLES];
+    long first = trace_file_find_block(file, start);
+    long last = trace_file_find_block(file, end - 1);
+    double energy_mj = 0.0;
+
+    for (long block = first; block >= 0 && block <= last; block++) {
+        size_t count = trace_file_decode_block(file, (size_t)block, times, powers);
+
+        for (size_t i = 0; i < count; i++) {
+            uint32_t next = i + 1 < count ? times[i + 1] : file->index[block].end_time;
+            uint32_t from = times[i] > start ? times[i] : start;
+            uint32_t to = next < end ? next : end;
+
+            if (to > from) {
+                energy_mj += (double)powers[i] * (to - from);
+            }
+        }
+    }
+    return energy_mj;
+}
+
+static void bench_queries(const TraceFile* file) {
+    uint32_t starts[QUERY_COUNT];
+    uint32_t ends[QUERY_COUNT];
+    Prng prng;
+    uint32_t span = file->header->end_time;
+    double indexed_sum = 0.0;
+    double scan_sum = 0.0;
+    double start = 0.0;
+    double indexed_time = 0.0;
+    double scan_time = 0.0;
+
+    prng_seed(&prng, BENCH_SEED, 1);
+    for (uint32_t i = 0; i < QUERY_COUNT; i++) {
+        uint32_t a = prng_below(&prng, span);
+        uint32_t b = prng_below(&prng, span);
+
+        starts[i] = a < b ? a : b;
+        ends[i] = a < b ? b : a + 1;
+    }
+
+    start = now_seconds();
+    for (uint32_t i = 0; i < QUERY_COUNT; i++) {
+        indexed_sum += trace_file_energy(file, starts[i], ends[i]);
+    }
+    indexed_time = now_seconds() - start;
+
+    // The scan is far slower; a hundredth of the queries is enough.
+    start = now_seconds();
+    for (uint32_t i = 0; i < QUERY_COUNT / 100; i++) {
+        scan_sum += scan_energy(file, starts[i], ends[i]);
+    }
+    scan_time = (now_seconds() - start) * 100.0;
+
+    for (uint32_t i = 0; i < QUERY_COUNT / 100; i++) {
+        scan_sum -= trace_file_energy(file, starts[i], ends[i]);
+    }
+    printf("%-24s %10.2f us/query\n", "range query, index", indexed_time / QUERY_COUNT * 1e6);
+    printf("%-24s %10.2f us/query  (%.0fx, mismatch %.3g mJ, checksum %.0f)\n", "range query, scan",
+           scan_time / QUERY_COUNT * 1e6, scan_time / indexed_time, scan_sum, indexed_sum);
+}
+
+int main(void) {
+    EnergyTrace indexed;
+
+    write_traces();
+    bench_raw_scan();
+
+    if (!energy_trace_open(&indexed, INDEXED_PATH, false)) {
+        return 1;
+    }
+    bench_indexed_scan(&indexed.indexed, true);
+    bench_indexed_scan(&indexed.indexed, false);
+    bench_queries(&indexed.indexed);
+    energy_trace_close(&indexed);
+
+    remove(RAW_PATH);
+    remove(INDEXED_PATH);
+    return 0;
+}
@@ -0,0 +1,305 @@
+#include "checkpoint.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "error_handling.h"
+#include "fault_injection.h"
+
+#define CHECKPOINT_MAGIC 0x4f534350u ///< "OSCP" marker of a checkpoint file.
+#define CHECKPOINT_VERSION 1u
+#define CHECKPOINT_PAGE_SIZE 4096u   ///< Slot alignment, a multiple of the usual page size.
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t state_size;
+    uint32_t region_size;
+} CheckpointFileHeader;
+
+typedef struct {
+    uint32_t sequence;                            ///< 0 while the slot is being written.
+    uint32_t header_crc;                          ///< CRC of the sequence and region CRC table.
+    uint32_t region_crc[CHECKPOINT_MAX_REGIONS];  ///< CRC of every region of the payload.
+} CheckpointSlotHeader;
+
+static const uint32_t crc32_nibble_table[16] = {
+    0x00000000u, 0x1db71064u, 0x3b6e20c8u, 0x26d930acu,
+    0x76dc4190u, 0x6b6b51f4u, 0x4db26158u, 0x5005713cu,
+    0xedb88320u, 0xf00f9344u, 0xd6d6a3e8u, 0xcb61b38cu,
+    0x9b64c2b0u, 0x86d3d2d4u, 0xa00ae278u, 0xbdbdf21cu
+};
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t length) {
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = crc32_nibble_table[(crc ^ data[i]) & 0x0f] ^ (crc >> 4);
+        crc = crc32_nibble_table[(crc ^ (data[i] >> 4)) & 0x0f] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+static size_t round_up_to_page(size_t size) {
+    return (size + CHECKPOINT_PAGE_SIZE - 1) / CHECKPOINT_PAGE_SIZE * CHECKPOINT_PAGE_SIZE;
+}
+
+static size_t slot_stride(const CheckpointStore* store) {
+    return round_up_to_page(sizeof(CheckpointSlotHeader) + store->state_size);
+}
+
+static CheckpointSlotHeader* slot_header(const CheckpointStore* store, uint8_t slot) {
+    return (CheckpointSlotHeader*)(store->mapping + CHECKPOINT_PAGE_SIZE + slot * slot_stride(store));
+}
+
+static uint8_t* slot_payload(const CheckpointStore* store, uint8_t slot) {
+    return (uint8_t*)slot_header(store, slot) + sizeof(CheckpointSlotHeader);
+}
+
+static size_t region_length(const CheckpointStore* store, uint8_t region) {
+    size_t offset = (size_t)region * CHECKPOINT_REGION_SIZE;
+    size_t remaining = store->state_size - offset;
+    return remaining < CHECKPOINT_REGION_SIZE ? remaining : CHECKPOINT_REGION_SIZE;
+}
+
+static uint64_t all_regions_mask(const CheckpointStore* store) {
+    return store->region_count == 64 ? UINT64_MAX : ((1ull << store->region_count) - 1ull);
+}
+
+static uint32_t compute_header_crc(const CheckpointSlotHeader* header) {
+    uint32_t crc = crc32_update(0, (const uint8_t*)&header->sequence, sizeof(header->sequence));
+    return crc32_update(crc, (const uint8_t*)header->region_crc, sizeof(header->region_crc));
+}
+
+static bool flush_range(const CheckpointStore* store, const void* start, size_t length) {
+    uintptr_t begin = (uintptr_t)start - (uintptr_t)store->mapping;
+    uintptr_t aligned_begin = begin / CHECKPOINT_PAGE_SIZE * CHECKPOINT_PAGE_SIZE;
+
+    return msync(store->mapping + aligned_begin, begin + length - aligned_begin, MS_SYNC) == 0;
+}
+
+static bool is_slot_valid(const CheckpointStore* store, uint8_t slot) {
+    const CheckpointSlotHeader* header = slot_header(store, slot);
+    const uint8_t* payload = slot_payload(store, slot);
+
+    if (header->sequence == 0 || header->header_crc != compute_header_crc(header)) {
+        return false;
+    }
+
+    for (uint8_t region = 0; region < store->region_count; region++) {
+        const uint8_t* data = payload + (size_t)region * CHECKPOINT_REGION_SIZE;
+        if (crc32_update(0, data, region_length(store, region)) != header->region_crc[region]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool format_file(CheckpointStore* store) {
+    CheckpointFileHeader* header = (CheckpointFileHeader*)store->mapping;
+
+    memset(store->mapping, 0, store->mapping_size);
+    header->magic = CHECKPOINT_MAGIC;
+    header->version = CHECKPOINT_VERSION;
+    header->state_size = (uint32_t)store->state_size;
+    header->region_size = CHECKPOINT_REGION_SIZE;
+    return msync(store->mapping, store->mapping_size, MS_SYNC) == 0;
+}
+
+bool checkpoint_open(CheckpointStore* store, const char* path, void* state, size_t state_size) {
+    struct stat file_info;
+    const CheckpointFileHeader* header = NULL;
+    bool needs_format = false;
+
+    if (store == NULL || path == NULL || state == NULL || state_size == 0) {
+        handle_error("Invalid checkpoint parameters");
+        return false;
+    }
+
+    if (state_size > CHECKPOINT_MAX_STATE_SIZE) {
+        handle_error("Checkpoint state exceeds the maximum supported size");
+        return false;
+    }
+
+    memset(store, 0, sizeof(*store));
+    store->fd = -1;
+    store->state = (uint8_t*)state;
+    store->state_size = state_size;
+    store->region_count = (uint8_t)((state_size + CHECKPOINT_REGION_SIZE - 1) / CHECKPOINT_REGION_SIZE);
+    store->mapping_size = CHECKPOINT_PAGE_SIZE + 2 * slot_stride(store);
+
+    store->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (store->fd < 0) {
+        handle_error("Failed to open checkpoint file");
+        return false;
+    }
+
+    if (fstat(store->fd, &file_info) != 0) {
+        handle_error("Failed to inspect checkpoint file");
+        checkpoint_close(store);
+        return false;
+    }
+
+    if ((size_t)file_info.st_size != store->mapping_size) {
+        needs_format = true;
+        if (ftruncate(store->fd, (off_t)store->mapping_size) != 0) {
+            handle_error("Failed to size checkpoint file");
+            checkpoint_close(store);
+            return false;
+        }
+    }
+
+    store->mapping = (uint8_t*)mmap(NULL, store->mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, store->fd, 0);
+    if (store->mapping == MAP_FAILED) {
+        store->mapping = NULL;
+        handle_error("Failed to map checkpoint file");
+        checkpoint_close(store);
+        return false;
+    }
+
+    header = (const CheckpointFileHeader*)store->mapping;
+    if (header->magic != CHECKPOINT_MAGIC || header->version != CHECKPOINT_VERSION ||
+        header->state_size != state_size || header->region_size != CHECKPOINT_REGION_SIZE) {
+        needs_format = true;
+    }
+
+    if (needs_format && !format_file(store)) {
+        handle_error("Failed to format checkpoint file");
+        checkpoint_close(store);
+        return false;
+    }
+
+    store->dirty_mask[0] = all_regions_mask(store);
+    store->dirty_mask[1] = all_regions_mask(store);
+    store->active_slot = 1;
+    return true;
+}
+
+bool checkpoint_restore(CheckpointStore* store) {
+    bool valid[2];
+    uint8_t newest = 0;
+
+    if (store == NULL || store->mapping == NULL) {
+        return false;
+    }
+
+    valid[0] = is_slot_valid(store, 0);
+    valid[1] = is_slot_valid(store, 1);
+    if (!valid[0] && !valid[1]) {
+        return false;
+    }
+
+    if (!valid[0] || (valid[1] && slot_header(store, 1)->sequence > slot_header(store, 0)->sequence)) {
+        newest = 1;
+    }
+
+    memcpy(store->state, slot_payload(store, newest), store->state_size);
+    store->active_slot = newest;
+    store->sequence = slot_header(store, newest)->sequence;
+    store->dirty_mask[newest] = 0;
+    store->dirty_mask[newest ^ 1] = all_regions_mask(store);
+    return true;
+}
+
+void checkpoint_mark_dirty(CheckpointStore* store, size_t offset, size_t length) {
+    uint8_t first = 0;
+    uint8_t last = 0;
+
+    if (store == NULL || store->mapping == NULL || length == 0 || offset >= store->state_size) {
+        return;
+    }
+
+    if (offset + length > store->state_size) {
+        length = store->state_size - offset;
+    }
+
+    first = (uint8_t)(offset / CHECKPOINT_REGION_SIZE);
+    last = (uint8_t)((offset + length - 1) / CHECKPOINT_REGION_SIZE);
+    for (uint8_t region = first; region <= last; region++) {
+        store->dirty_mask[0] |= 1ull << region;
+        store->dirty_mask[1] |= 1ull << region;
+    }
+}
+
+bool checkpoint_commit(CheckpointStore* store) {
+    uint8_t target = 0;
+    uint64_t pending = 0;
+    CheckpointSlotHeader* header = NULL;
+    uint8_t* payload = NULL;
+    size_t dirty_begin = SIZE_MAX;
+    size_t dirty_end = 0;
+
+    if (store == NULL || store->mapping == NULL) {
+        return false;
+    }
+
+    target = store->active_slot ^ 1;
+    pending = store->dirty_mask[target];
+    if (pending == 0 && store->dirty_mask[store->active_slot] == 0) {
+        return true;
+    }
+
+    header = slot_header(store, target);
+    payload = slot_payload(store, target);
+
+    // Invalidate the slot first so a torn write can never be mistaken for a valid image.
+    header->sequence = 0;
+    if (!flush_range(store, header, sizeof(header->sequence))) {
+        handle_error("Failed to invalidate checkpoint slot");
+        return false;
+    }
+
+    FAULT_POINT(FAULT_SITE_CHECKPOINT);
+    for (uint8_t region = 0; region < store->region_count; region++) {
+        size_t offset = (size_t)region * CHECKPOINT_REGION_SIZE;
+        size_t length = region_length(store, region);
+
+        if ((pending & (1ull << region)) == 0) {
+            continue;
+        }
+
+        memcpy(payload + offset, store->state + offset, length);
+        header->region_crc[region] = crc32_update(0, payload + offset, length);
+        if (offset < dirty_begin) {
+            dirty_begin = offset;
+        }
+        dirty_end = offset + length;
+    }
+
+    if (dirty_end > 0 && !flush_range(store, payload + dirty_begin, dirty_end - dirty_begin)) {
+        handle_error("Failed to flush checkpoint data");
+        return false;
+    }
+
+    FAULT_POINT(FAULT_SITE_CHECKPOINT);
+    header->sequence = store->sequence + 1;
+    header->header_crc = compute_header_crc(header);
+    if (!flush_range(store, header, sizeof(*header))) {
+        handle_error("Failed to publish checkpoint slot");
+        return false;
+    }
+
+    store->sequence++;
+    store->active_slot = target;
+    store->dirty_mask[target] = 0;
+    return true;
+}
+
+void checkpoint_close(CheckpointStore* store) {
+    if (store == NULL) {
+        return;
+    }
+
+    if (store->mapping != NULL) {
+        munmap(store->mapping, store->mapping_size);
+        store->mapping = NULL;
+    }
+
+    if (store->fd >= 0) {
+        close(store->fd);
+        store->fd = -1;
+    }
+}
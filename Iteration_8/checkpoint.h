@@ -0,0 +1,99 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * \brief Size in bytes of one dirty-tracking region of the persisted state.
+ */
+#define CHECKPOINT_REGION_SIZE 64
+
+/**
+ * \brief Maximum number of regions, which bounds the persisted state size.
+ */
+#define CHECKPOINT_MAX_REGIONS 64
+
+/**
+ * \brief Largest state image that can be checkpointed, in bytes.
+ */
+#define CHECKPOINT_MAX_STATE_SIZE (CHECKPOINT_REGION_SIZE * CHECKPOINT_MAX_REGIONS)
+
+/**
+ * \brief Memory-mapped, double-buffered store for a fixed-size state image.
+ *
+ * The backing file stands in for FRAM or flash on a batteryless node. It
+ * holds two slots; every commit writes the slot that does not contain the
+ * latest image and only publishes it once its data is durable, so a power
+ * failure at any point leaves at least one complete image behind.
+ * Only the regions marked dirty since a slot was last written are copied.
+ */
+typedef struct {
+    int fd;                     ///< Descriptor of the backing file, -1 when closed.
+    uint8_t* mapping;           ///< Shared mapping of the backing file.
+    size_t mapping_size;        ///< Size of the mapping in bytes.
+    uint8_t* state;             ///< RAM image of the persisted state, owned by the caller.
+    size_t state_size;          ///< Size of the RAM image in bytes.
+    uint8_t region_count;       ///< Number of regions covering the RAM image.
+    uint64_t dirty_mask[2];     ///< Regions each slot is missing compared to the RAM image.
+    uint8_t active_slot;        ///< Slot holding the latest committed image.
+    uint32_t sequence;          ///< Sequence number of the latest committed image.
+} CheckpointStore;
+
+/**
+ * \brief Opens or creates a checkpoint file and maps it into memory.
+ *
+ * The file is (re)initialized when it does not match the expected layout,
+ * for instance after the persisted state structure changed size.
+ *
+ * \param store Store to initialize.
+ * \param path Path of the backing file.
+ * \param state RAM image to persist; it must outlive the store.
+ * \param state_size Size of the RAM image, at most CHECKPOINT_MAX_STATE_SIZE.
+ * \return True on success, false if the file could not be opened or mapped.
+ */
+bool checkpoint_open(CheckpointStore* store, const char* path, void* state, size_t state_size);
+
+/**
+ * \brief Loads the newest valid image from the backing file into the RAM image.
+ *
+ * Both slots are validated with their checksums, so a slot torn by a power
+ * failure during a commit is ignored in favor of the previous one.
+ *
+ * \param store Open store.
+ * \return True if an image was restored, false if no valid image exists.
+ */
+bool checkpoint_restore(CheckpointStore* store);
+
+/**
+ * \brief Records that a byte range of the RAM image has been modified.
+ *
+ * Calling this on a store that is not open is a no-op, so callers do not
+ * need to check whether persistence is enabled.
+ *
+ * \param store Store tracking the RAM image.
+ * \param offset Offset of the first modified byte.
+ * \param length Number of modified bytes.
+ */
+void checkpoint_mark_dirty(CheckpointStore* store, size_t offset, size_t length);
+
+/**
+ * \brief Atomically persists the RAM image.
+ *
+ * Writes the dirty regions into the inactive slot, flushes them, then
+ * publishes the slot with a new sequence number.
+ *
+ * \param store Store to commit.
+ * \return True if the image is durable, false on I/O failure.
+ */
+bool checkpoint_commit(CheckpointStore* store);
+
+/**
+ * \brief Unmaps and closes the backing file.
+ *
+ * \param store Store to close.
+ */
+void checkpoint_close(CheckpointStore* store);
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,26 @@
+#ifndef ENERGY_FORECAST_MODEL_H
+#define ENERGY_FORECAST_MODEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * \brief Hours of harvest history consumed by the forecast model.
+ */
+#define ENERGY_FORECAST_HISTORY_HOURS 24
+
+/**
+ * \brief Int8 model forecasting the normalized harvest of the next hour.
+ *
+ * The input is the normalized harvest power of the last
+ * ENERGY_FORECAST_HISTORY_HOURS hours, oldest first. Generated by
+ * tools/gen_forecast_model.py; do not edit.
+ */
+extern const uint8_t energy_forecast_model[];
+
+/**
+ * \brief Size of energy_forecast_model in bytes.
+ */
+extern const size_t energy_forecast_model_size;
+
+#endif // ENERGY_FORECAST_MODEL_H
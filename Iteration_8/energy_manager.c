@@ -1,9 +1,10 @@
 #include "energy_manager.h"
 #include "hardware_abstraction.h"
-//#include "tensorflow/lite/micro/all_ops_resolver.h"
-//#include "tensorflow/lite/micro/micro_error_reporter.h"
 
-#define HISTORY_DAYS 5 ///< Number of days to maintain energy availability history.
+#include <string.h>
+
+#define FULL_SEASON_MASK ((1u << FORECAST_SEASON_HOURS) - 1u) ///< Every hour of the day observed.
+
 
 /**
  * \brief Loads a TinyML model into memory and prepares it for inference.
@@ -17,13 +18,13 @@
  * \return True if the model is loaded successfully, false otherwise.
  */
 bool load_tinyml_model(TinyMLModel* ml_model, const uint8_t* model_data, size_t model_size, uint8_t* tensor_arena, size_t tensor_arena_size) {
-    (void)ml_model;
-    (void)model_data;
-    (void)model_size;
-    (void)tensor_arena;
-    (void)tensor_arena_size;
-    // Model loading logic commented for demonstration.
-    return true;
+    if (ml_model == NULL) {
+        return false;
+    }
+
+    ml_model->tensor_arena = tensor_arena;
+    ml_model->tensor_arena_size = tensor_arena_size;
+    return inference_model_load(&ml_model->engine, model_data, model_size, tensor_arena, tensor_arena_size);
 }
 
 /**
@@ -33,21 +34,58 @@ bool load_tinyml_model(TinyMLModel* ml_model, const uint8_t* model_data, size_t
  * \param input Pointer to the input data array.
  * \param input_length Length of the input data array.
  * 
- * \return Predicted energy availability as a float value.
+ * \return Predicted energy availability as a float value, or 0 if inference fails.
  */
 float predict_energy(TinyMLModel* ml_model, const float* input, size_t input_length) {
-    (void)ml_model;
-    (void)input;
-    (void)input_length;
-    // Prediction logic commented for demonstration.
-    return 1.0f;
+    float prediction = 0.0f;
+
+    if (ml_model == NULL || !inference_model_run(&ml_model->engine, input, input_length, &prediction, 1)) {
+        return 0.0f;
+    }
+    return prediction;
+}
+
+/**
+ * \brief Configures how much availability history a source keeps.
+ *
+ * \param source Energy source to configure; its history is cleared.
+ * \param mode Sliding window or exponentially weighted statistics.
+ * \param window_days Window length in days (window mode).
+ * \param alpha Weight of the newest day (exponential mode).
+ * \return False if the parameters are out of range.
+ */
+bool configure_energy_history(EnergySource* source, StreamStatsMode mode, uint16_t window_days, float alpha) {
+    if (source == NULL) {
+        return false;
+    }
+
+    return stream_stats_init(&source->history, mode, window_days, alpha);
+}
+
+/**
+ * \brief Records the hours a source was available during one day and updates its predictability.
+ *
+ * \param source Energy source to update.
+ * \param available_hours Hours of availability observed during the day.
+ */
+void record_energy_availability(EnergySource* source, float available_hours) {
+    if (source == NULL) {
+        return;
+    }
+
+    if (source->history.mode == STREAM_STATS_WINDOW && source->history.window == 0) {
+        configure_energy_history(source, STREAM_STATS_WINDOW, DEFAULT_HISTORY_DAYS, 0.0f);
+    }
+
+    stream_stats_push(&source->history, available_hours);
+    source->predictability = 1.0f / (1.0f + stream_stats_variance(&source->history));
 }
 
 /**
  * \brief Updates the energy source profile by recording historical data and calculating predictability.
  * 
- * This function shifts historical availability data, calculates the mean and variance of availability,
- * and updates the predictability score of the energy source.
+ * This function pushes today's availability into the source's streaming statistics, at a cost
+ * independent of the history length, and derives the predictability score from their variance.
  * 
  * \param source Pointer to the EnergySource structure to update.
  */
@@ -57,56 +95,131 @@ void update_energy_profile(EnergySource *source) {
     }
 
     uint8_t available_hours_today = source->duration_hours * source->occurrences_per_day;
-    for (int i = HISTORY_DAYS - 1; i > 0; i--) {
-        source->availability_history[i] = source->availability_history[i - 1];
+    record_energy_availability(source, available_hours_today);
+}
+
+/**
+ * \brief Resets a seasonal forecaster.
+ *
+ * \param forecaster Forecaster to initialize.
+ * \param alpha Level smoothing factor, in (0, 1].
+ * \param beta Trend smoothing factor, in [0, 1].
+ * \param gamma Seasonal smoothing factor, in [0, 1].
+ * \return False if a factor is out of range.
+ */
+bool seasonal_forecaster_init(SeasonalForecaster* forecaster, float alpha, float beta, float gamma) {
+    if (forecaster == NULL || alpha <= 0.0f || alpha > 1.0f || beta < 0.0f || beta > 1.0f ||
+        gamma < 0.0f || gamma > 1.0f) {
+        return false;
     }
-    source->availability_history[0] = available_hours_today;
 
-    float total = 0;
-    float variance = 0;
-    for (int i = 0; i < HISTORY_DAYS; i++) {
-        total += source->availability_history[i];
+    memset(forecaster, 0, sizeof(*forecaster));
+    forecaster->alpha = alpha;
+    forecaster->beta = beta;
+    forecaster->gamma = gamma;
+    return true;
+}
+
+/**
+ * \brief Adds the harvest observed during one hour, in O(1).
+ *
+ * Until every hour of the day has been seen the observations are stored as
+ * they are; then their mean becomes the level and the offsets from it the
+ * seasonal states. Afterwards the additive Holt-Winters recurrences apply.
+ *
+ * \param forecaster Forecaster to update.
+ * \param hour Hour of the day of the observation (0-23).
+ * \param harvest Energy harvested during that hour.
+ */
+void seasonal_forecaster_update(SeasonalForecaster* forecaster, uint8_t hour, float harvest) {
+    float previous_level = 0.0f;
+    float* season = NULL;
+
+    if (forecaster == NULL || hour >= FORECAST_SEASON_HOURS) {
+        return;
     }
-    float mean = total / HISTORY_DAYS;
-    for (int i = 0; i < HISTORY_DAYS; i++) {
-        variance += (source->availability_history[i] - mean) * (source->availability_history[i] - mean);
+
+    season = &forecaster->seasonal[hour];
+    forecaster->last_hour = hour;
+    forecaster->observations++;
+
+    if (forecaster->observed_hours != FULL_SEASON_MASK) {
+        float sum = 0.0f;
+
+        *season = harvest;
+        forecaster->observed_hours |= 1u << hour;
+        if (forecaster->observed_hours != FULL_SEASON_MASK) {
+            return;
+        }
+
+        for (uint8_t i = 0; i < FORECAST_SEASON_HOURS; i++) {
+            sum += forecaster->seasonal[i];
+        }
+        forecaster->level = sum / FORECAST_SEASON_HOURS;
+        forecaster->trend = 0.0f;
+        for (uint8_t i = 0; i < FORECAST_SEASON_HOURS; i++) {
+            forecaster->seasonal[i] -= forecaster->level;
+        }
+        return;
     }
-    source->predictability = 1.0f / (1.0f + (variance / HISTORY_DAYS));
+
+    previous_level = forecaster->level;
+    forecaster->level = forecaster->alpha * (harvest - *season) +
+                        (1.0f - forecaster->alpha) * (previous_level + forecaster->trend);
+    forecaster->trend = forecaster->beta * (forecaster->level - previous_level) +
+                        (1.0f - forecaster->beta) * forecaster->trend;
+    *season = forecaster->gamma * (harvest - forecaster->level) + (1.0f - forecaster->gamma) * *season;
 }
 
 /**
- * \brief Checks if energy is currently available based on the energy source's profile.
- * 
- * This function determines availability by evaluating the energy source's scheduled availability
- * within the simulated current hour.
- * 
- * \param source Pointer to the EnergySource structure to evaluate.
- * 
- * \return True if energy is available, false otherwise.
+ * \brief Forecasts the harvest of each hour following the latest observation, in O(hours).
+ *
+ * \param forecaster Forecaster to query.
+ * \param forecast Destination, forecast[k] is the harvest expected k + 1 hours after the latest observation.
+ * \param hours Number of hours to forecast.
+ * \return Number of hours written, 0 if nothing was observed yet.
  */
-bool is_energy_available(EnergySource *source) {
-    if (source == NULL || source->occurrences_per_day == 0) {
-        return false;
+size_t seasonal_forecaster_forecast(const SeasonalForecaster* forecaster, float* forecast, size_t hours) {
+    bool initialized = false;
+
+    if (forecaster == NULL || forecast == NULL || forecaster->observations == 0) {
+        return 0;
     }
 
-    uint8_t current_hour = get_current_hour();
-    uint8_t interval_hours = 24 / source->occurrences_per_day;
-
-    for (uint8_t i = 0; i < source->occurrences_per_day; i++) {
-        uint8_t start_time = (source->start_hour + i * interval_hours) % 24;
-        uint8_t end_time = (start_time + source->duration_hours) % 24;
-
-        if (start_time < end_time) {
-            if (current_hour >= start_time && current_hour < end_time) {
-                return true;
-            }
-        } else {
-            if (current_hour >= start_time || current_hour < end_time) {
-                return true;
-            }
+    initialized = forecaster->observed_hours == FULL_SEASON_MASK;
+    for (size_t k = 0; k < hours; k++) {
+        uint8_t hour = (uint8_t)((forecaster->last_hour + 1 + k) % FORECAST_SEASON_HOURS);
+        float value = 0.0f;
+
+        if (initialized) {
+            value = forecaster->level + (float)(k + 1) * forecaster->trend + forecaster->seasonal[hour];
+        } else if (forecaster->observed_hours & (1u << hour)) {
+            // Hours not observed yet forecast no harvest.
+            value = forecaster->seasonal[hour];
+        }
+        forecast[k] = value > 0.0f ? value : 0.0f;
+    }
+    return hours;
+}
+
+/**
+ * \brief Finds the first forecast hour whose harvest reaches a threshold.
+ *
+ * \param forecaster Forecaster to query.
+ * \param horizon_hours Number of hours to look ahead.
+ * \param threshold Harvest the hour must reach.
+ * \return Hours after the latest observation (1 for the next hour), or 0 if none in the horizon.
+ */
+uint8_t seasonal_forecaster_next_surplus(const SeasonalForecaster* forecaster, uint8_t horizon_hours, float threshold) {
+    float forecast[UINT8_MAX];
+    size_t count = seasonal_forecaster_forecast(forecaster, forecast, horizon_hours);
+
+    for (size_t k = 0; k < count; k++) {
+        if (forecast[k] >= threshold) {
+            return (uint8_t)(k + 1);
         }
     }
-    return false;
+    return 0;
 }
 
 /**
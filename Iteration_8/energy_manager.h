@@ -4,7 +4,28 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stddef.h>
-//#include "tensorflow/lite/micro/micro_interpreter.h"
+
+#include "inference_engine.h"
+#include "stream_stats.h"
+
+/**
+ * \brief Window length used when a source's history was not configured, in days.
+ */
+#define DEFAULT_HISTORY_DAYS 5
+
+/**
+ * \brief Simulated time in seconds since the start of the simulation.
+ */
+typedef uint32_t SimTime;
+
+/// \brief Number of simulated seconds in one hour.
+#define SECONDS_PER_HOUR 3600u
+
+/// \brief Number of simulated seconds in one day, the period of an EnergySource profile.
+#define SECONDS_PER_DAY 86400u
+
+/// \brief Sentinel returned by time queries when no such instant exists.
+#define SIM_TIME_NEVER UINT32_MAX
 
 /**
  * \brief Enumerates types of energy sources.
@@ -23,17 +44,41 @@ typedef struct {
     uint8_t start_hour;           ///< Hour of the first occurrence (0-23).
     uint8_t duration_hours;       ///< Duration of each active period in hours.
     uint8_t occurrences_per_day;  ///< Number of active periods per day.
-    uint8_t availability_history[5]; ///< Historical data of availability over 5 days (in hours).
+    StreamStats history;          ///< Online statistics of past availability (in hours).
     float predictability;         ///< Predictability score based on historical data.
+    float harvest_power_mw;       ///< Power harvested during an active period, in milliwatts.
+    SimTime active_seconds;       ///< Seconds a measured trace of the source harvested so far today.
 } EnergySource;
 
+/**
+ * \brief Number of seasonal states of a forecaster, one per hour of the day.
+ */
+#define FORECAST_SEASON_HOURS 24
+
+/**
+ * \brief Additive Holt-Winters forecaster of hourly harvest.
+ *
+ * Keeps a smoothed level, a trend and one seasonal offset per hour of the
+ * day. Once every hour of the day has been observed, the seasonal offsets
+ * are initialized from them; until then forecasts repeat the observed hours.
+ */
+typedef struct {
+    float alpha;                              ///< Level smoothing factor (0-1].
+    float beta;                               ///< Trend smoothing factor [0-1].
+    float gamma;                              ///< Seasonal smoothing factor [0-1].
+    float level;                              ///< Deseasonalized harvest per hour.
+    float trend;                              ///< Change of the level per hour.
+    float seasonal[FORECAST_SEASON_HOURS];    ///< Offset of each hour of the day from the level.
+    uint8_t last_hour;                        ///< Hour of the day of the latest observation.
+    uint32_t observed_hours;                  ///< Bit mask of the hours of the day observed at least once.
+    uint32_t observations;                    ///< Number of hours observed.
+} SeasonalForecaster;
+
 /**
  * \brief Represents a TinyML model for energy prediction.
  */
 typedef struct {
-    // const tflite::Model* model;             ///< Pointer to the loaded TensorFlow Lite model.
-    // tflite::MicroInterpreter* interpreter; ///< Pointer to the TinyML interpreter.
-    // tflite::MicroAllocator* allocator;     ///< Pointer to the TinyML allocator.
+    InferenceModel engine;          ///< Int8 model run by the in-tree inference engine.
     uint8_t* tensor_arena;          ///< Pointer to the tensor arena memory buffer.
     size_t tensor_arena_size;       ///< Size of the tensor arena in bytes.
 } TinyMLModel;
@@ -47,6 +92,8 @@ typedef struct {
  * \param tensor_arena Pointer to a memory buffer for tensors.
  * \param tensor_arena_size Size of the tensor memory buffer in bytes.
  * 
+ * The model data must be a blob in the inference engine format (see inference_engine.h).
+ * 
  * \return True if the model is loaded successfully, false otherwise.
  */
 bool load_tinyml_model(TinyMLModel* ml_model, const uint8_t* model_data, size_t model_size, uint8_t* tensor_arena, size_t tensor_arena_size);
@@ -58,40 +105,81 @@ bool load_tinyml_model(TinyMLModel* ml_model, const uint8_t* model_data, size_t
  * \param input Pointer to the input data array.
  * \param input_length Length of the input data array.
  * 
- * \return Predicted energy availability as a float value.
+ * \return Predicted energy availability as a float value, or 0 if inference fails.
  */
 float predict_energy(TinyMLModel* ml_model, const float* input, size_t input_length);
 
 /**
- * \brief Returns the current simulated hour.
+ * \brief Configures how much availability history a source keeps.
  *
- * The implementation is provided by the main simulation entry point.
+ * \param source Energy source to configure; its history is cleared.
+ * \param mode Sliding window or exponentially weighted statistics.
+ * \param window_days Window length in days (window mode).
+ * \param alpha Weight of the newest day (exponential mode).
+ * \return False if the parameters are out of range.
+ */
+bool configure_energy_history(EnergySource* source, StreamStatsMode mode, uint16_t window_days, float alpha);
+
+/**
+ * \brief Records the hours a source was available during one day and updates its predictability.
+ *
+ * A source whose history was never configured uses a DEFAULT_HISTORY_DAYS window.
  *
- * \return Current simulated hour in the range 0-23.
+ * \param source Energy source to update.
+ * \param available_hours Hours of availability observed during the day.
  */
-uint8_t get_current_hour(void);
+void record_energy_availability(EnergySource* source, float available_hours);
 
 /**
  * \brief Updates the energy source profile by recording historical data and calculating predictability.
  * 
- * This function shifts historical availability data, calculates the mean and variance of availability,
- * and updates the predictability score of the energy source.
+ * This function pushes today's availability into the source's streaming statistics, at a cost
+ * independent of the history length, and derives the predictability score from their variance.
+ * A source whose history was never configured uses a DEFAULT_HISTORY_DAYS window.
  * 
  * \param source Pointer to the EnergySource structure to update.
  */
 void update_energy_profile(EnergySource* source);
 
 /**
- * \brief Checks if energy is currently available based on the energy source's profile.
- * 
- * This function determines availability by evaluating the energy source's scheduled availability
- * within the simulated current hour.
- * 
- * \param source Pointer to the EnergySource structure to evaluate.
- * 
- * \return True if energy is available, false otherwise.
+ * \brief Resets a seasonal forecaster.
+ *
+ * \param forecaster Forecaster to initialize.
+ * \param alpha Level smoothing factor, in (0, 1].
+ * \param beta Trend smoothing factor, in [0, 1].
+ * \param gamma Seasonal smoothing factor, in [0, 1].
+ * \return False if a factor is out of range.
+ */
+bool seasonal_forecaster_init(SeasonalForecaster* forecaster, float alpha, float beta, float gamma);
+
+/**
+ * \brief Adds the harvest observed during one hour, in O(1).
+ *
+ * \param forecaster Forecaster to update.
+ * \param hour Hour of the day of the observation (0-23).
+ * \param harvest Energy harvested during that hour.
+ */
+void seasonal_forecaster_update(SeasonalForecaster* forecaster, uint8_t hour, float harvest);
+
+/**
+ * \brief Forecasts the harvest of each hour following the latest observation, in O(hours).
+ *
+ * \param forecaster Forecaster to query.
+ * \param forecast Destination, forecast[k] is the harvest expected k + 1 hours after the latest observation.
+ * \param hours Number of hours to forecast.
+ * \return Number of hours written, 0 if nothing was observed yet.
+ */
+size_t seasonal_forecaster_forecast(const SeasonalForecaster* forecaster, float* forecast, size_t hours);
+
+/**
+ * \brief Finds the first forecast hour whose harvest reaches a threshold.
+ *
+ * \param forecaster Forecaster to query.
+ * \param horizon_hours Number of hours to look ahead.
+ * \param threshold Harvest the hour must reach.
+ * \return Hours after the latest observation (1 for the next hour), or 0 if none in the horizon.
  */
-bool is_energy_available(EnergySource* source);
+uint8_t seasonal_forecaster_next_surplus(const SeasonalForecaster* forecaster, uint8_t horizon_hours, float threshold);
 
 /**
  * \brief Integrates real-world energy profiling tools.
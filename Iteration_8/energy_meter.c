@@ -0,0 +1,215 @@
+#include "energy_meter.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RAPL_ROOT "/sys/class/powercap/intel-rapl:"
+
+static const char* const phase_names[ENERGY_PHASE_COUNT] = {"scheduling", "tasks", "idle"};
+
+static double clock_seconds(clockid_t clock) {
+    struct timespec now;
+
+    clock_gettime(clock, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static bool read_counter(int fd, uint64_t* value) {
+    char text[32];
+    ssize_t length = pread(fd, text, sizeof(text) - 1, 0);
+
+    if (length <= 0) {
+        return false;
+    }
+    text[length] = '\0';
+    *value = strtoull(text, NULL, 10);
+    return true;
+}
+
+static bool read_file_counter(const char* path, uint64_t* value) {
+    int fd = open(path, O_RDONLY);
+    bool read = false;
+
+    if (fd < 0) {
+        return false;
+    }
+    read = read_counter(fd, value);
+    close(fd);
+    return read;
+}
+
+/**
+ * \brief Opens the energy counter of every top-level package domain; subdomains are part of them.
+ */
+static void open_rapl_zones(EnergyMeter* meter) {
+    for (size_t zone = 0; zone < ENERGY_METER_MAX_ZONES; zone++) {
+        char path[64];
+        uint64_t range_uj = 0;
+        int fd = -1;
+
+        snprintf(path, sizeof(path), RAPL_ROOT "%zu/max_energy_range_uj", zone);
+        if (!read_file_counter(path, &range_uj)) {
+            break;
+        }
+        snprintf(path, sizeof(path), RAPL_ROOT "%zu/energy_uj", zone);
+        fd = open(path, O_RDONLY);
+        if (fd < 0 || !read_counter(fd, &meter->zone_last_uj[meter->zone_count])) {
+            // Readable by root only since the Platypus side channel (CVE-2020-8694).
+            if (fd >= 0) {
+                close(fd);
+            }
+            continue;
+        }
+        meter->zone_fds[meter->zone_count] = fd;
+        meter->zone_range_uj[meter->zone_count] = range_uj;
+        meter->zone_count++;
+    }
+    meter->rapl = meter->zone_count > 0;
+}
+
+/**
+ * \brief Advances energy_j, wall_s and cpu_s to now.
+ */
+static void sample(EnergyMeter* meter) {
+    double wall_s = clock_seconds(CLOCK_MONOTONIC);
+    double cpu_s = clock_seconds(CLOCK_PROCESS_CPUTIME_ID);
+
+    if (meter->rapl) {
+        uint64_t delta_uj = 0;
+
+        for (size_t zone = 0; zone < meter->zone_count; zone++) {
+            uint64_t now_uj = 0;
+
+            if (!read_counter(meter->zone_fds[zone], &now_uj)) {
+                continue;
+            }
+            delta_uj += now_uj >= meter->zone_last_uj[zone] ? now_uj - meter->zone_last_uj[zone]
+                                                            : now_uj + meter->zone_range_uj[zone] - meter->zone_last_uj[zone];
+            meter->zone_last_uj[zone] = now_uj;
+        }
+        meter->energy_j += (double)delta_uj / 1e6;
+    } else {
+        meter->energy_j += meter->model.idle_w * (wall_s - meter->wall_s) + meter->model.active_w * (cpu_s - meter->cpu_s);
+    }
+    meter->wall_s = wall_s;
+    meter->cpu_s = cpu_s;
+}
+
+void energy_meter_init(EnergyMeter* meter, const PowerModel* model) {
+    memset(meter, 0, sizeof(*meter));
+    meter->model = *model;
+    open_rapl_zones(meter);
+    meter->wall_s = clock_seconds(CLOCK_MONOTONIC);
+    meter->cpu_s = clock_seconds(CLOCK_PROCESS_CPUTIME_ID);
+    meter->start_wall_s = meter->wall_s;
+    meter->phase = ENERGY_PHASE_SCHEDULING;
+    meter->phase_start_s = meter->wall_s;
+}
+
+void energy_meter_enter(EnergyMeter* meter, EnergyPhase phase) {
+    sample(meter);
+    meter->phase_j[meter->phase] += meter->energy_j - meter->phase_start_j;
+    meter->phase_s[meter->phase] += meter->wall_s - meter->phase_start_s;
+    meter->phase = phase;
+    meter->phase_start_j = meter->energy_j;
+    meter->phase_start_s = meter->wall_s;
+    meter->task_start_j = meter->energy_j;
+}
+
+void energy_meter_task_begin(EnergyMeter* meter) {
+    sample(meter);
+    meter->task_start_j = meter->energy_j;
+}
+
+void energy_meter_task_end(EnergyMeter* meter, size_t task) {
+    if (task >= MAX_TASKS) {
+        return;
+    }
+    sample(meter);
+    meter->task_j[task] += meter->energy_j - meter->task_start_j;
+    meter->task_runs[task]++;
+    meter->task_start_j = meter->energy_j;
+}
+
+void energy_meter_close(EnergyMeter* meter) {
+    energy_meter_enter(meter, meter->phase);
+    for (size_t zone = 0; zone < meter->zone_count; zone++) {
+        close(meter->zone_fds[zone]);
+    }
+    meter->zone_count = 0;
+}
+
+bool energy_meter_calibrate(PowerModel* model, double seconds) {
+    PowerModel unused = {0.0f, 0.0f, false};
+    EnergyMeter meter;
+    double idle_j = 0.0;
+    double idle_s = 0.0;
+    double start_j = 0.0;
+    double start_s = 0.0;
+    double start_cpu_s = 0.0;
+    volatile uint32_t spin = 1;
+
+    energy_meter_init(&meter, &unused);
+    if (!meter.rapl) {
+        return false;
+    }
+
+    sample(&meter);
+    start_j = meter.energy_j;
+    start_s = meter.wall_s;
+    usleep((useconds_t)(seconds * 1e6));
+    sample(&meter);
+    idle_j = meter.energy_j - start_j;
+    idle_s = meter.wall_s - start_s;
+
+    start_j = meter.energy_j;
+    start_s = meter.wall_s;
+    start_cpu_s = meter.cpu_s;
+    while (clock_seconds(CLOCK_MONOTONIC) - start_s < seconds) {
+        for (int i = 0; i < 100000; i++) {
+            spin = spin * 1664525u + 1013904223u;
+        }
+    }
+    sample(&meter);
+    energy_meter_close(&meter);
+
+    model->idle_w = idle_s > 0.0 ? (float)(idle_j / idle_s) : 0.0f;
+    model->active_w = meter.cpu_s > start_cpu_s
+        ? (float)((meter.energy_j - start_j - model->idle_w * (meter.wall_s - start_s)) / (meter.cpu_s - start_cpu_s))
+        : 0.0f;
+    if (model->active_w < 0.0f) {
+        model->active_w = 0.0f;
+    }
+    model->calibrated = true;
+    return true;
+}
+
+void energy_meter_write_json(const EnergyMeter* meter, size_t task_count, FILE* output) {
+    double total_j = 0.0;
+    double elapsed_s = meter->wall_s - meter->start_wall_s;
+
+    for (size_t phase = 0; phase < ENERGY_PHASE_COUNT; phase++) {
+        total_j += meter->phase_j[phase];
+    }
+    fprintf(output, "{\n    \"energy_source\": \"%s\",\n    \"energy_j\": %.6f,\n    \"average_power_w\": %.6f,\n",
+            meter->rapl ? "rapl" : (meter->model.calibrated ? "model" : "default-model"), total_j, elapsed_s > 0.0 ? total_j / elapsed_s : 0.0);
+    if (!meter->rapl) {
+        fprintf(output, "    \"model_active_w\": %.4f,\n    \"model_idle_w\": %.4f,\n", meter->model.active_w,
+                meter->model.idle_w);
+    }
+    fprintf(output, "    \"phases\": {");
+    for (size_t phase = 0; phase < ENERGY_PHASE_COUNT; phase++) {
+        fprintf(output, "%s\n      \"%s\": {\"joules\": %.6f, \"seconds\": %.6f}", phase > 0 ? "," : "",
+                phase_names[phase], meter->phase_j[phase], meter->phase_s[phase]);
+    }
+    fprintf(output, "\n    },\n    \"tasks\": [");
+    for (size_t task = 0; task < task_count && task < MAX_TASKS; task++) {
+        fprintf(output, "%s\n      {\"task\": %zu, \"runs\": %u, \"joules\": %.6f, \"joules_per_run\": %.9f}",
+                task > 0 ? "," : "", task, meter->task_runs[task], meter->task_j[task],
+                meter->task_runs[task] > 0 ? meter->task_j[task] / meter->task_runs[task] : 0.0);
+    }
+    fprintf(output, "\n    ]\n  }");
+}
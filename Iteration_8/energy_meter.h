@@ -0,0 +1,144 @@
+#ifndef ENERGY_METER_H
+#define ENERGY_METER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "task_manager.h"
+
+/**
+ * \brief Maximum number of RAPL package domains read by a meter.
+ */
+#define ENERGY_METER_MAX_ZONES 8
+
+/**
+ * \brief Active power of the default model, in watts: a 95 W TDP shared by 16 hardware threads.
+ *
+ * A TDP split per thread is not a measurement of any host; reports modelled
+ * with it are labelled "default-model".
+ */
+#define POWER_MODEL_DEFAULT_ACTIVE_W 5.9375f
+
+/**
+ * \brief Idle power of the default model, in watts.
+ */
+#define POWER_MODEL_DEFAULT_IDLE_W 0.0f
+
+/**
+ * \brief Part of a scheduler step that energy is attributed to.
+ */
+typedef enum {
+    ENERGY_PHASE_SCHEDULING,  ///< Planning, queueing and bookkeeping between tasks.
+    ENERGY_PHASE_TASKS,       ///< execute_tasks(), including the waits of the tasks.
+    ENERGY_PHASE_IDLE,        ///< Deep sleep when no task can run.
+    ENERGY_PHASE_COUNT        ///< Number of phases.
+} EnergyPhase;
+
+/**
+ * \brief Power drawn by the process when no RAPL counter is readable.
+ *
+ * The power is idle_w plus active_w times the CPU utilization of the
+ * process, so an interval costs idle_w * wall seconds + active_w * CPU seconds.
+ * energy_meter_calibrate() fits both coefficients on a host with RAPL.
+ */
+typedef struct {
+    float active_w;   ///< Power of one fully busy CPU, in watts.
+    float idle_w;     ///< Power while the process waits, in watts.
+    bool calibrated;  ///< Whether the coefficients were measured or given, rather than the defaults.
+} PowerModel;
+
+/**
+ * \brief Measures the energy of a run and attributes it to phases and tasks.
+ *
+ * On Linux hosts exposing /sys/class/powercap/intel-rapl:N/energy_uj (Intel,
+ * and AMD since Linux 5.8), the package counters are read at every phase or
+ * task boundary; they cover the whole package, other processes included, and
+ * advance about once per millisecond, so sub-millisecond tasks are
+ * quantized while totals stay exact. Elsewhere, or without permission to read
+ * them, the energy comes from a PowerModel.
+ */
+typedef struct {
+    bool rapl;                                        ///< Energy read from RAPL rather than modelled.
+    int zone_fds[ENERGY_METER_MAX_ZONES];             ///< Open energy_uj files.
+    uint64_t zone_range_uj[ENERGY_METER_MAX_ZONES];   ///< Value at which each counter wraps.
+    uint64_t zone_last_uj[ENERGY_METER_MAX_ZONES];    ///< Latest reading of each counter.
+    size_t zone_count;
+    PowerModel model;                                 ///< Coefficients of the modelled energy.
+    double energy_j;                                  ///< Energy since energy_meter_init() at the latest sample.
+    double wall_s;                                    ///< Monotonic time of the latest sample.
+    double cpu_s;                                     ///< Process CPU time of the latest sample.
+    double start_wall_s;                              ///< Monotonic time of energy_meter_init().
+    EnergyPhase phase;                                ///< Current phase.
+    double phase_start_j;                             ///< energy_j when the current phase began.
+    double phase_start_s;                             ///< wall_s when the current phase began.
+    double phase_j[ENERGY_PHASE_COUNT];               ///< Energy of each finished phase interval.
+    double phase_s[ENERGY_PHASE_COUNT];               ///< Time spent in each phase.
+    double task_start_j;                              ///< energy_j when the current task began.
+    double task_j[MAX_TASKS];                         ///< Energy attributed to each task.
+    uint32_t task_runs[MAX_TASKS];                    ///< Completed runs of each task.
+} EnergyMeter;
+
+/**
+ * \brief Opens the RAPL counters, or falls back to the model, and starts the scheduling phase.
+ *
+ * \param meter Meter to initialize.
+ * \param model Power model used when RAPL is unavailable.
+ */
+void energy_meter_init(EnergyMeter* meter, const PowerModel* model);
+
+/**
+ * \brief Ends the current phase and starts another one.
+ *
+ * Entering ENERGY_PHASE_TASKS also starts the first task.
+ *
+ * \param meter Initialized meter.
+ * \param phase Phase starting now.
+ */
+void energy_meter_enter(EnergyMeter* meter, EnergyPhase phase);
+
+/**
+ * \brief Starts attributing energy to the next task.
+ *
+ * \param meter Initialized meter.
+ */
+void energy_meter_task_begin(EnergyMeter* meter);
+
+/**
+ * \brief Attributes the energy since the task began to a task.
+ *
+ * \param meter Initialized meter.
+ * \param task Index of the task, below MAX_TASKS.
+ */
+void energy_meter_task_end(EnergyMeter* meter, size_t task);
+
+/**
+ * \brief Ends the current phase and closes the RAPL counters.
+ *
+ * \param meter Initialized meter.
+ */
+void energy_meter_close(EnergyMeter* meter);
+
+/**
+ * \brief Fits a PowerModel to the RAPL counters of this host.
+ *
+ * Measures the package while the process sleeps, then while it spins, each
+ * for the given duration. Run it on an otherwise idle host.
+ *
+ * \param model Destination of the fitted coefficients.
+ * \param seconds Duration of each measurement.
+ * \return False if no RAPL counter is readable.
+ */
+bool energy_meter_calibrate(PowerModel* model, double seconds);
+
+/**
+ * \brief Writes the energy of a closed meter as a JSON object.
+ *
+ * \param meter Closed meter.
+ * \param task_count Number of tasks to report, at most MAX_TASKS.
+ * \param output Destination; the object is not followed by a newline, so it may be nested.
+ */
+void energy_meter_write_json(const EnergyMeter* meter, size_t task_count, FILE* output);
+
+#endif // ENERGY_METER_H
@@ -0,0 +1,273 @@
+#include "energy_pool.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "error_handling.h"
+
+static int add_entry(EnergyPool* pool, EnergySource* source, BatteryState* battery, EnergyTrace* trace) {
+    EnergyPoolEntry* entry = NULL;
+
+    if (pool == NULL || source == NULL) {
+        handle_error("Cannot add a NULL energy source");
+        return ENERGY_SOURCE_NONE;
+    }
+
+    if (pool->count >= MAX_ENERGY_SOURCES) {
+        handle_error("Energy pool is full");
+        return ENERGY_SOURCE_NONE;
+    }
+
+    entry = &pool->entries[pool->count];
+    memset(entry, 0, sizeof(*entry));
+    entry->source = source;
+    entry->battery = battery;
+    entry->trace = trace;
+    availability_index_init(&entry->index, SECONDS_PER_DAY);
+    pool->count++;
+    energy_pool_refresh(pool);
+    return pool->count - 1;
+}
+
+static bool is_harvester(const EnergyPoolEntry* entry) {
+    return entry->battery == NULL;
+}
+
+static bool is_scheduled_harvester(const EnergyPoolEntry* entry) {
+    return entry->battery == NULL && entry->trace == NULL;
+}
+
+static float usable_charge(const BatteryState* battery, bool critical) {
+    float usable = critical ? battery->charge_mj : battery->charge_mj - battery->reserve_mj;
+    return usable > 0.0f ? usable : 0.0f;
+}
+
+void energy_pool_init(EnergyPool* pool) {
+    if (pool == NULL) {
+        return;
+    }
+
+    memset(pool, 0, sizeof(*pool));
+    availability_index_init(&pool->harvest, SECONDS_PER_DAY);
+}
+
+int energy_pool_add_source(EnergyPool* pool, EnergySource* source) {
+    return add_entry(pool, source, NULL, NULL);
+}
+
+int energy_pool_add_trace(EnergyPool* pool, EnergySource* source, EnergyTrace* trace) {
+    if (trace == NULL) {
+        handle_error("A trace-driven source needs an open trace");
+        return ENERGY_SOURCE_NONE;
+    }
+    return add_entry(pool, source, NULL, trace);
+}
+
+int energy_pool_add_battery(EnergyPool* pool, EnergySource* source, BatteryState* battery) {
+    if (battery == NULL) {
+        handle_error("A storage source needs a battery state");
+        return ENERGY_SOURCE_NONE;
+    }
+    return add_entry(pool, source, battery, NULL);
+}
+
+void energy_pool_refresh(EnergyPool* pool) {
+    const AvailabilityIndex* harvesters[MAX_ENERGY_SOURCES];
+    size_t harvester_count = 0;
+    bool changed = false;
+
+    if (pool == NULL) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < pool->count; i++) {
+        EnergyPoolEntry* entry = &pool->entries[i];
+        if (!is_scheduled_harvester(entry)) {
+            continue;
+        }
+
+        changed |= availability_index_sync(&entry->index, entry->source);
+        harvesters[harvester_count++] = &entry->index;
+    }
+
+    if (!changed) {
+        return;
+    }
+
+    if (harvester_count == 0) {
+        availability_index_init(&pool->harvest, SECONDS_PER_DAY);
+    } else {
+        availability_index_union(&pool->harvest, harvesters, harvester_count);
+    }
+}
+
+void energy_pool_update_profiles(EnergyPool* pool) {
+    if (pool == NULL) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < pool->count; i++) {
+        EnergyPoolEntry* entry = &pool->entries[i];
+
+        if (entry->trace != NULL) {
+            record_energy_availability(entry->source, (float)entry->source->active_seconds / SECONDS_PER_HOUR);
+            entry->source->active_seconds = 0;
+        } else if (is_harvester(entry)) {
+            update_energy_profile(entry->source);
+        }
+    }
+}
+
+void energy_pool_begin_step(EnergyPool* pool, SimTime start, SimTime end) {
+    if (pool == NULL) {
+        return;
+    }
+
+    pool->step_start = start;
+    pool->step_end = end;
+    pool->step_harvest_mj = 0.0f;
+    for (uint8_t i = 0; i < pool->count; i++) {
+        EnergyPoolEntry* entry = &pool->entries[i];
+
+        if (entry->trace != NULL) {
+            entry->step_budget_mj = (float)energy_trace_energy(entry->trace, start, end);
+            entry->step_active = entry->step_budget_mj > 0.0f;
+        } else if (is_harvester(entry)) {
+            entry->step_budget_mj = (float)availability_index_expected_energy(&entry->index, start, end);
+        } else {
+            entry->step_budget_mj = 0.0f;
+        }
+        pool->step_harvest_mj += entry->step_budget_mj;
+    }
+}
+
+void energy_pool_end_step(EnergyPool* pool) {
+    float surplus_mj = 0.0f;
+
+    if (pool == NULL) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < pool->count; i++) {
+        EnergyPoolEntry* entry = &pool->entries[i];
+
+        if (entry->step_active) {
+            entry->source->active_seconds += pool->step_end - pool->step_start;
+            entry->step_active = false;
+        }
+        if (is_harvester(entry)) {
+            surplus_mj += entry->step_budget_mj;
+            entry->step_budget_mj = 0.0f;
+        }
+    }
+
+    for (uint8_t i = 0; i < pool->count && surplus_mj > 0.0f; i++) {
+        BatteryState* battery = pool->entries[i].battery;
+        float room_mj = 0.0f;
+
+        if (battery == NULL) {
+            continue;
+        }
+
+        room_mj = battery->capacity_mj - battery->charge_mj;
+        if (room_mj <= 0.0f) {
+            continue;
+        }
+
+        if (surplus_mj < room_mj) {
+            room_mj = surplus_mj;
+        }
+        battery->charge_mj += room_mj;
+        surplus_mj -= room_mj;
+    }
+}
+
+bool energy_pool_is_harvesting(const EnergyPool* pool, SimTime time) {
+    if (pool == NULL) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < pool->count; i++) {
+        if (pool->entries[i].trace != NULL && pool->entries[i].step_budget_mj > 0.0f) {
+            return true;
+        }
+    }
+    return availability_index_is_available(&pool->harvest, time);
+}
+
+bool energy_pool_is_available(const EnergyPool* pool, SimTime time, float energy_mj, bool critical) {
+    return energy_pool_select_source(pool, time, energy_mj, critical) != ENERGY_SOURCE_NONE;
+}
+
+int energy_pool_select_source(const EnergyPool* pool, SimTime time, float energy_mj, bool critical) {
+    int best_harvester = ENERGY_SOURCE_NONE;
+    int best_battery = ENERGY_SOURCE_NONE;
+    float best_score = -1.0f;
+    float best_charge = -1.0f;
+
+    if (pool == NULL) {
+        return ENERGY_SOURCE_NONE;
+    }
+
+    for (uint8_t i = 0; i < pool->count; i++) {
+        const EnergyPoolEntry* entry = &pool->entries[i];
+
+        if (is_harvester(entry)) {
+            float score = entry->step_budget_mj * entry->source->predictability;
+            bool active = entry->trace != NULL || availability_index_is_available(&entry->index, time);
+            if (active && entry->step_budget_mj >= energy_mj && score > best_score) {
+                best_harvester = i;
+                best_score = score;
+            }
+        } else {
+            float charge = usable_charge(entry->battery, critical);
+            if (charge >= energy_mj && charge > best_charge) {
+                best_battery = i;
+                best_charge = charge;
+            }
+        }
+    }
+
+    return best_harvester != ENERGY_SOURCE_NONE ? best_harvester : best_battery;
+}
+
+void energy_pool_draw(EnergyPool* pool, int source_index, float energy_mj) {
+    EnergyPoolEntry* entry = NULL;
+
+    if (pool == NULL || source_index < 0 || source_index >= pool->count) {
+        handle_error("Cannot draw energy from an unknown source");
+        return;
+    }
+
+    entry = &pool->entries[source_index];
+    if (is_harvester(entry)) {
+        entry->step_budget_mj -= energy_mj;
+        if (entry->step_budget_mj < 0.0f) {
+            entry->step_budget_mj = 0.0f;
+        }
+    } else {
+        entry->battery->charge_mj -= energy_mj;
+        if (entry->battery->charge_mj < 0.0f) {
+            entry->battery->charge_mj = 0.0f;
+        }
+    }
+}
+
+float energy_pool_predictability(const EnergyPool* pool) {
+    float weighted_sum = 0.0f;
+    float total_power = 0.0f;
+
+    if (pool == NULL) {
+        return 0.0f;
+    }
+
+    for (uint8_t i = 0; i < pool->count; i++) {
+        const EnergyPoolEntry* entry = &pool->entries[i];
+        if (is_harvester(entry)) {
+            weighted_sum += entry->source->harvest_power_mw * entry->source->predictability;
+            total_power += entry->source->harvest_power_mw;
+        }
+    }
+
+    return total_power > 0.0f ? weighted_sum / total_power : 0.0f;
+}
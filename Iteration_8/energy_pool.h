@@ -0,0 +1,186 @@
+#ifndef ENERGY_POOL_H
+#define ENERGY_POOL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "availability_index.h"
+#include "energy_manager.h"
+#include "energy_trace.h"
+
+/**
+ * \brief Maximum number of energy sources managed by one pool.
+ */
+#define MAX_ENERGY_SOURCES 4
+
+/**
+ * \brief Returned by energy_pool_select_source() when no source can supply a task.
+ */
+#define ENERGY_SOURCE_NONE -1
+
+/**
+ * \brief Charge state of a storage element such as a battery or supercapacitor.
+ */
+typedef struct {
+    float capacity_mj;  ///< Maximum stored energy in millijoules.
+    float charge_mj;    ///< Currently stored energy in millijoules.
+    float reserve_mj;   ///< Charge kept for critical tasks; non-critical tasks cannot draw below it.
+} BatteryState;
+
+/**
+ * \brief One source managed by an energy pool.
+ */
+typedef struct {
+    EnergySource* source;       ///< Profile, history and predictability of the source.
+    BatteryState* battery;      ///< Charge state of a BATTERY source, NULL for harvesters.
+    AvailabilityIndex index;    ///< Compiled daily schedule of a harvester.
+    EnergyTrace* trace;         ///< Measured harvest replacing the schedule, NULL for scheduled sources.
+    float step_budget_mj;       ///< Harvest still available to tasks in the current step.
+    bool step_active;           ///< A trace harvested during the current step.
+} EnergyPoolEntry;
+
+/**
+ * \brief Set of heterogeneous energy sources used together by one node.
+ *
+ * Harvesters (solar, wind) supply tasks directly while they are active and
+ * their surplus charges the storage elements. Storage is drawn only when no
+ * harvester can supply a task, and non-critical tasks may not draw it below
+ * its reserve, which keeps the battery for critical tasks.
+ */
+typedef struct {
+    EnergyPoolEntry entries[MAX_ENERGY_SOURCES]; ///< Managed sources.
+    uint8_t count;                               ///< Number of managed sources.
+    AvailabilityIndex harvest;                   ///< Union of all scheduled harvesters.
+    float step_harvest_mj;                       ///< Energy harvested by all sources in the current step.
+    SimTime step_start;                          ///< Start of the current energy step.
+    SimTime step_end;                            ///< End of the current energy step.
+} EnergyPool;
+
+/**
+ * \brief Clears a pool.
+ *
+ * \param pool Pool to initialize.
+ */
+void energy_pool_init(EnergyPool* pool);
+
+/**
+ * \brief Adds a harvesting source to the pool.
+ *
+ * \param pool Target pool.
+ * \param source Harvester profile; it must outlive the pool.
+ * \return Index of the source in the pool, or ENERGY_SOURCE_NONE if the pool is full.
+ */
+int energy_pool_add_source(EnergyPool* pool, EnergySource* source);
+
+/**
+ * \brief Adds a harvester whose production is replayed from a measured trace.
+ *
+ * The source's schedule fields are ignored; its history and predictability
+ * are derived from the hours the trace actually harvested.
+ *
+ * \param pool Target pool.
+ * \param source Harvester profile; it must outlive the pool.
+ * \param trace Open trace; it must outlive the pool.
+ * \return Index of the source in the pool, or ENERGY_SOURCE_NONE if the pool is full.
+ */
+int energy_pool_add_trace(EnergyPool* pool, EnergySource* source, EnergyTrace* trace);
+
+/**
+ * \brief Adds a storage source to the pool.
+ *
+ * \param pool Target pool.
+ * \param source Source profile of type BATTERY; it must outlive the pool.
+ * \param battery Charge state of the storage; it must outlive the pool.
+ * \return Index of the source in the pool, or ENERGY_SOURCE_NONE if the pool is full.
+ */
+int energy_pool_add_battery(EnergyPool* pool, EnergySource* source, BatteryState* battery);
+
+/**
+ * \brief Recompiles the schedules of harvesters whose profile changed.
+ *
+ * \param pool Pool to refresh.
+ */
+void energy_pool_refresh(EnergyPool* pool);
+
+/**
+ * \brief Updates the history and predictability of every harvester.
+ *
+ * Call it once per simulated day, when the day ends: each harvester records
+ * one sample, the hours it was available during that day.
+ *
+ * \param pool Pool whose harvesters are updated.
+ */
+void energy_pool_update_profiles(EnergyPool* pool);
+
+/**
+ * \brief Starts an energy step, setting the harvest budget of each active harvester.
+ *
+ * \param pool Pool to update.
+ * \param start First second of the step.
+ * \param end One past the last second of the step.
+ */
+void energy_pool_begin_step(EnergyPool* pool, SimTime start, SimTime end);
+
+/**
+ * \brief Ends the current energy step, storing unused harvest in the storage elements.
+ *
+ * The step is also added to the active seconds of every trace that harvested
+ * during it, which live in the EnergySource so that they are checkpointed.
+ *
+ * \param pool Pool to update.
+ */
+void energy_pool_end_step(EnergyPool* pool);
+
+/**
+ * \brief Tells whether any scheduled harvester is active, or any trace harvested in the current step.
+ *
+ * \param pool Pool to query.
+ * \param time Simulated time.
+ * \return True if harvested energy is available.
+ */
+bool energy_pool_is_harvesting(const EnergyPool* pool, SimTime time);
+
+/**
+ * \brief Tells whether the pool can supply a task of the given criticality now.
+ *
+ * \param pool Pool to query.
+ * \param time Simulated time.
+ * \param energy_mj Energy the task needs.
+ * \param critical Whether the task may draw the storage reserve.
+ * \return True if a source can supply the task.
+ */
+bool energy_pool_is_available(const EnergyPool* pool, SimTime time, float energy_mj, bool critical);
+
+/**
+ * \brief Chooses the source a task should draw from.
+ *
+ * Active harvesters are preferred, the one with the largest predictability
+ * weighted budget first. Storage is used only when no harvester can supply
+ * the task, and only down to its reserve for non-critical tasks.
+ *
+ * \param pool Pool to query.
+ * \param time Simulated time.
+ * \param energy_mj Energy the task needs.
+ * \param critical Whether the task may draw the storage reserve.
+ * \return Index of the chosen source, or ENERGY_SOURCE_NONE.
+ */
+int energy_pool_select_source(const EnergyPool* pool, SimTime time, float energy_mj, bool critical);
+
+/**
+ * \brief Consumes energy from a source chosen by energy_pool_select_source().
+ *
+ * \param pool Pool to update.
+ * \param source_index Index of the source to draw from.
+ * \param energy_mj Energy consumed.
+ */
+void energy_pool_draw(EnergyPool* pool, int source_index, float energy_mj);
+
+/**
+ * \brief Combined predictability of the harvesters, weighted by their harvest power.
+ *
+ * \param pool Pool to query.
+ * \return Predictability score in the range 0-1.
+ */
+float energy_pool_predictability(const EnergyPool* pool);
+
+#endif // ENERGY_POOL_H
@@ -0,0 +1,455 @@
+#include "energy_trace.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "error_handling.h"
+
+#define ENERGY_TRACE_RAW_VERSION 1u
+#define TRACE_PAGE_SIZE 4096u ///< Granularity of page releases, a multiple of the usual page size.
+
+static bool is_digit(uint8_t c) {
+    return c >= '0' && c <= '9';
+}
+
+static void skip_blanks(const uint8_t* data, size_t end, size_t* cursor) {
+    while (*cursor < end && (data[*cursor] == ' ' || data[*cursor] == '\t')) {
+        (*cursor)++;
+    }
+}
+
+/**
+ * \brief Parses an unsigned integer without reading past the end of the mapping.
+ */
+static bool parse_unsigned(const uint8_t* data, size_t end, size_t* cursor, uint32_t* value) {
+    uint64_t result = 0;
+    size_t start = *cursor;
+
+    while (*cursor < end && is_digit(data[*cursor])) {
+        result = result * 10u + (uint64_t)(data[*cursor] - '0');
+        if (result > UINT32_MAX) {
+            return false;
+        }
+        (*cursor)++;
+    }
+
+    *value = (uint32_t)result;
+    return *cursor > start;
+}
+
+/**
+ * \brief Parses a decimal number with optional sign, fraction and exponent.
+ */
+static bool parse_decimal(const uint8_t* data, size_t end, size_t* cursor, double* value) {
+    double result = 0.0;
+    double scale = 1.0;
+    bool negative = false;
+    bool any_digit = false;
+
+    if (*cursor < end && (data[*cursor] == '-' || data[*cursor] == '+')) {
+        negative = data[*cursor] == '-';
+        (*cursor)++;
+    }
+
+    while (*cursor < end && is_digit(data[*cursor])) {
+        result = result * 10.0 + (data[*cursor] - '0');
+        any_digit = true;
+        (*cursor)++;
+    }
+
+    if (*cursor < end && data[*cursor] == '.') {
+        (*cursor)++;
+        while (*cursor < end && is_digit(data[*cursor])) {
+            scale /= 10.0;
+            result += (data[*cursor] - '0') * scale;
+            any_digit = true;
+            (*cursor)++;
+        }
+    }
+
+    if (any_digit && *cursor < end && (data[*cursor] == 'e' || data[*cursor] == 'E')) {
+        size_t exponent_start = ++(*cursor);
+        bool negative_exponent = false;
+        uint32_t exponent = 0;
+
+        if (*cursor < end && (data[*cursor] == '-' || data[*cursor] == '+')) {
+            negative_exponent = data[*cursor] == '-';
+            (*cursor)++;
+        }
+        if (!parse_unsigned(data, end, cursor, &exponent) || exponent > 38) {
+            *cursor = exponent_start;
+            return false;
+        }
+        while (exponent-- > 0) {
+            result = negative_exponent ? result / 10.0 : result * 10.0;
+        }
+    }
+
+    *value = negative ? -result : result;
+    return any_digit;
+}
+
+static size_t next_line(const uint8_t* data, size_t end, size_t cursor) {
+    const uint8_t* newline = memchr(data + cursor, '\n', end - cursor);
+    return newline != NULL ? (size_t)(newline - data) + 1 : end;
+}
+
+/**
+ * \brief Parses one "seconds,power_mw" line starting at `line`.
+ */
+static bool parse_csv_line(const uint8_t* data, size_t end, size_t line, SimTime* time, float* power_mw) {
+    size_t cursor = line;
+    uint32_t seconds = 0;
+    double power = 0.0;
+
+    skip_blanks(data, end, &cursor);
+    if (!parse_unsigned(data, end, &cursor, &seconds)) {
+        return false;
+    }
+    skip_blanks(data, end, &cursor);
+    if (cursor >= end || (data[cursor] != ',' && data[cursor] != ';')) {
+        return false;
+    }
+    cursor++;
+    skip_blanks(data, end, &cursor);
+    if (!parse_decimal(data, end, &cursor, &power)) {
+        return false;
+    }
+
+    *time = seconds;
+    *power_mw = (float)power;
+    return true;
+}
+
+/**
+ * \brief Decodes the sample at the read position and moves past it.
+ */
+static bool read_sample(EnergyTrace* trace, SimTime* time, float* power_mw) {
+    if (trace->format == ENERGY_TRACE_RAW) {
+        EnergyTraceRecord record;
+
+        if (trace->size - trace->position < sizeof(record)) {
+            return false;
+        }
+        memcpy(&record, trace->mapping + trace->position, sizeof(record));
+        trace->position += sizeof(record);
+        *time = record.time_s;
+        *power_mw = record.power_mw;
+        return true;
+    }
+
+    // Headers, comments and malformed lines are skipped.
+    while (trace->position < trace->size) {
+        size_t line = trace->position;
+
+        trace->position = next_line(trace->mapping, trace->size, line);
+        if (parse_csv_line(trace->mapping, trace->size, line, time, power_mw)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * \brief Finds the time of the last sample without scanning the file.
+ */
+static bool last_sample_time(const EnergyTrace* trace, SimTime* time) {
+    float power_mw = 0.0f;
+    size_t end = trace->size;
+
+    if (trace->format == ENERGY_TRACE_RAW) {
+        EnergyTraceRecord record;
+
+        if (trace->size - trace->data_start < sizeof(record)) {
+            return false;
+        }
+        memcpy(&record, trace->mapping + trace->size - sizeof(record), sizeof(record));
+        *time = record.time_s;
+        return true;
+    }
+
+    while (end > trace->data_start) {
+        size_t line = end - 1;
+
+        while (line > trace->data_start && trace->mapping[line - 1] != '\n') {
+            line--;
+        }
+        if (parse_csv_line(trace->mapping, end, line, time, &power_mw)) {
+            return true;
+        }
+        end = line;
+    }
+    return false;
+}
+
+/**
+ * \brief Releases the pages read long ago, keeping memory use bounded.
+ */
+static void release_consumed_pages(EnergyTrace* trace) {
+    size_t release_end = 0;
+
+    if (trace->position < trace->released + 2 * ENERGY_TRACE_RELEASE_WINDOW) {
+        return;
+    }
+
+    release_end = (trace->position - ENERGY_TRACE_RELEASE_WINDOW) / TRACE_PAGE_SIZE * TRACE_PAGE_SIZE;
+    madvise((void*)(trace->mapping + trace->released), release_end - trace->released, MADV_DONTNEED);
+    trace->released = release_end;
+}
+
+static void load_next_sample(EnergyTrace* trace) {
+    if (!read_sample(trace, &trace->next_time, &trace->next_power_mw)) {
+        trace->next_time = SIM_TIME_NEVER;
+        trace->next_power_mw = 0.0f;
+    }
+}
+
+/**
+ * \brief Converts a simulated time into trace time, restarting a looping trace when needed.
+ */
+static SimTime to_trace_time(EnergyTrace* trace, SimTime time) {
+    SimTime local = 0;
+
+    if (time < trace->loop_offset) {
+        trace->loop_offset = 0;
+        energy_trace_rewind(trace);
+    }
+
+    local = time - trace->loop_offset;
+    if (trace->loop && trace->period > 0 && local >= trace->period) {
+        trace->loop_offset += local / trace->period * trace->period;
+        local = time - trace->loop_offset;
+        energy_trace_rewind(trace);
+    }
+
+    if (local < trace->time && trace->position != trace->data_start) {
+        energy_trace_rewind(trace);
+    }
+
+    while (trace->next_time <= local) {
+        trace->time = trace->next_time;
+        trace->power_mw = trace->next_power_mw;
+        load_next_sample(trace);
+    }
+    release_consumed_pages(trace);
+    return local;
+}
+
+bool energy_trace_open(EnergyTrace* trace, const char* path, bool loop) {
+    struct stat file_info;
+    EnergyTraceRawHeader header;
+    void* mapping = NULL;
+
+    if (trace == NULL || path == NULL) {
+        return false;
+    }
+
+    memset(trace, 0, sizeof(*trace));
+    trace->fd = open(path, O_RDONLY);
+    if (trace->fd < 0) {
+        handle_error("Cannot open energy trace");
+        return false;
+    }
+
+    if (fstat(trace->fd, &file_info) != 0 || file_info.st_size <= 0) {
+        handle_error("Energy trace is empty");
+        energy_trace_close(trace);
+        return false;
+    }
+
+    trace->size = (size_t)file_info.st_size;
+    trace->mapping_size = trace->size;
+    mapping = mmap(NULL, trace->mapping_size, PROT_READ, MAP_PRIVATE, trace->fd, 0);
+    if (mapping == MAP_FAILED) {
+        handle_error("Cannot map energy trace");
+        energy_trace_close(trace);
+        return false;
+    }
+    trace->mapping = mapping;
+    madvise(mapping, trace->size, MADV_SEQUENTIAL);
+
+    trace->format = ENERGY_TRACE_CSV;
+    trace->loop = loop;
+    if (trace->size >= sizeof(TraceFileHeader) && ((const TraceFileHeader*)trace->mapping)->magic == TRACE_FILE_MAGIC) {
+        if (!trace_file_attach(&trace->indexed, trace->mapping, trace->size)) {
+            handle_error("Unsupported or corrupted indexed energy trace");
+            energy_trace_close(trace);
+            return false;
+        }
+        // Queries jump through the index instead of streaming the file.
+        madvise(mapping, trace->size, MADV_RANDOM);
+        trace->format = ENERGY_TRACE_INDEXED;
+        trace->period = trace->indexed.header->end_time;
+        return true;
+    }
+    if (trace->size >= sizeof(header)) {
+        memcpy(&header, trace->mapping, sizeof(header));
+        if (header.magic == ENERGY_TRACE_RAW_MAGIC) {
+            if (header.version != ENERGY_TRACE_RAW_VERSION ||
+                header.record_count > (trace->size - sizeof(header)) / sizeof(EnergyTraceRecord)) {
+                handle_error("Unsupported or truncated raw energy trace");
+                energy_trace_close(trace);
+                return false;
+            }
+            trace->format = ENERGY_TRACE_RAW;
+            trace->data_start = sizeof(header);
+            trace->size = sizeof(header) + header.record_count * sizeof(EnergyTraceRecord);
+        }
+    }
+
+    energy_trace_rewind(trace);
+    if (trace->next_time == SIM_TIME_NEVER && trace->position == trace->data_start) {
+        handle_error("Energy trace holds no sample");
+        energy_trace_close(trace);
+        return false;
+    }
+
+    // The last sample lasts as long as the first one, which sets the length of a loop.
+    if (last_sample_time(trace, &trace->period) && trace->next_time != SIM_TIME_NEVER) {
+        trace->period += trace->next_time - trace->time;
+    }
+    return true;
+}
+
+/**
+ * \brief Maps a simulated time onto an indexed trace, which needs no read position.
+ */
+static SimTime indexed_time(const EnergyTrace* trace, SimTime time) {
+    if (trace->loop && trace->period > 0) {
+        return time % trace->period;
+    }
+    return time;
+}
+
+/**
+ * \brief Integrates an indexed trace, splitting the interval at loop boundaries.
+ */
+static double indexed_energy(const EnergyTrace* trace, SimTime start, SimTime end) {
+    double energy_mj = 0.0;
+
+    if (!trace->loop || trace->period == 0) {
+        return trace_file_energy(&trace->indexed, start, end);
+    }
+
+    while (start < end) {
+        SimTime local = start % trace->period;
+        SimTime span = trace->period - local;
+
+        if (span > end - start) {
+            span = end - start;
+        }
+        // Whole loops all hold the same energy.
+        if (local == 0 && end - start >= trace->period) {
+            SimTime loops = (end - start) / trace->period;
+
+            energy_mj += trace->indexed.total_energy_mj * loops;
+            start += loops * trace->period;
+            continue;
+        }
+        energy_mj += trace_file_energy(&trace->indexed, local, local + span);
+        start += span;
+    }
+    return energy_mj;
+}
+
+float energy_trace_power_at(EnergyTrace* trace, SimTime time) {
+    SimTime local = 0;
+
+    if (trace == NULL || trace->mapping == NULL) {
+        return 0.0f;
+    }
+    if (trace->format == ENERGY_TRACE_INDEXED) {
+        return trace_file_power_at(&trace->indexed, indexed_time(trace, time));
+    }
+
+    local = to_trace_time(trace, time);
+    if (local < trace->time || (trace->next_time == SIM_TIME_NEVER && local >= trace->period)) {
+        return 0.0f;
+    }
+    return trace->power_mw;
+}
+
+double energy_trace_energy(EnergyTrace* trace, SimTime start, SimTime end) {
+    double energy_mj = 0.0;
+    SimTime time = start;
+
+    if (trace == NULL || trace->mapping == NULL) {
+        return 0.0;
+    }
+    if (trace->format == ENERGY_TRACE_INDEXED) {
+        return indexed_energy(trace, start, end);
+    }
+
+    while (time < end) {
+        float power_mw = energy_trace_power_at(trace, time);
+        SimTime local = time - trace->loop_offset;
+        SimTime change = SIM_TIME_NEVER;
+
+        if (local < trace->time) {
+            change = trace->loop_offset + trace->time;
+        } else if (trace->next_time != SIM_TIME_NEVER) {
+            change = trace->loop_offset + trace->next_time;
+        } else if (local < trace->period) {
+            change = trace->loop_offset + trace->period;
+        }
+
+        if (change > end || change <= time) {
+            change = end;
+        }
+        energy_mj += (double)power_mw * (double)(change - time);
+        time = change;
+    }
+    return energy_mj;
+}
+
+bool energy_trace_next_sample(EnergyTrace* trace, SimTime* time, float* power_mw) {
+    if (trace == NULL || trace->mapping == NULL || trace->format == ENERGY_TRACE_INDEXED ||
+        trace->time == SIM_TIME_NEVER) {
+        return false;
+    }
+
+    *time = trace->time;
+    *power_mw = trace->power_mw;
+    trace->time = trace->next_time;
+    trace->power_mw = trace->next_power_mw;
+    if (trace->next_time != SIM_TIME_NEVER) {
+        load_next_sample(trace);
+    }
+    release_consumed_pages(trace);
+    return true;
+}
+
+void energy_trace_rewind(EnergyTrace* trace) {
+    if (trace == NULL || trace->mapping == NULL || trace->format == ENERGY_TRACE_INDEXED) {
+        return;
+    }
+
+    trace->position = trace->data_start;
+    trace->released = 0;
+    if (!read_sample(trace, &trace->time, &trace->power_mw)) {
+        trace->time = 0;
+        trace->power_mw = 0.0f;
+        trace->next_time = SIM_TIME_NEVER;
+        trace->position = trace->data_start;
+        return;
+    }
+    load_next_sample(trace);
+}
+
+void energy_trace_close(EnergyTrace* trace) {
+    if (trace == NULL) {
+        return;
+    }
+
+    if (trace->mapping != NULL) {
+        munmap((void*)trace->mapping, trace->mapping_size);
+    }
+    if (trace->fd >= 0) {
+        close(trace->fd);
+    }
+    memset(trace, 0, sizeof(*trace));
+    trace->fd = -1;
+}
@@ -0,0 +1,139 @@
+#ifndef ENERGY_TRACE_H
+#define ENERGY_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "energy_manager.h"
+#include "trace_format.h"
+
+/**
+ * \brief Magic number of a raw binary trace ("OSTR" in file order).
+ */
+#define ENERGY_TRACE_RAW_MAGIC 0x5254534fu
+
+/**
+ * \brief Bytes of a trace kept mapped behind the read position.
+ *
+ * Consumed pages beyond this distance are released with madvise(), so the
+ * resident size of a trace stays bounded whatever the file size.
+ */
+#define ENERGY_TRACE_RELEASE_WINDOW (4u * 1024u * 1024u)
+
+/**
+ * \brief Encoding of a trace file.
+ */
+typedef enum {
+    ENERGY_TRACE_CSV,      ///< Text lines "seconds,power_mw"; other lines are skipped.
+    ENERGY_TRACE_RAW,      ///< EnergyTraceRawHeader followed by EnergyTraceRecord entries.
+    ENERGY_TRACE_INDEXED   ///< Block-indexed columnar file, see trace_format.h.
+} EnergyTraceFormat;
+
+/**
+ * \brief Header of a raw binary trace.
+ */
+typedef struct {
+    uint32_t magic;         ///< ENERGY_TRACE_RAW_MAGIC.
+    uint32_t version;       ///< Format version, currently 1.
+    uint64_t record_count;  ///< Number of records following the header.
+} EnergyTraceRawHeader;
+
+/**
+ * \brief One sample of a raw binary trace.
+ */
+typedef struct {
+    uint32_t time_s;    ///< Simulated time of the sample, in seconds.
+    float power_mw;     ///< Harvested power from this sample to the next, in milliwatts.
+} EnergyTraceRecord;
+
+/**
+ * \brief Harvest trace replayed as simulated time advances.
+ *
+ * The file is memory-mapped read-only and samples are decoded in place,
+ * without copying. Each sample holds its power until the next sample, and
+ * the last one for as long as the first.
+ * Reads must move forward in time; consumed pages are released, so memory
+ * use does not grow with the trace length. A looping trace restarts at its
+ * first sample once simulated time passes its end.
+ *
+ * Indexed traces are not read sequentially: any time or interval is found
+ * through the block index, so queries may go backwards and long intervals
+ * cost two block decodes.
+ */
+typedef struct {
+    int fd;                       ///< Descriptor of the trace file, -1 when closed.
+    const uint8_t* mapping;       ///< Read-only mapping of the whole file.
+    size_t mapping_size;          ///< Size of the mapping in bytes.
+    size_t size;                  ///< Bytes of the file holding the trace.
+    EnergyTraceFormat format;     ///< Encoding of the file.
+    size_t data_start;            ///< Offset of the first sample.
+    size_t position;              ///< Offset of the sample following the current one.
+    size_t released;              ///< Offset below which pages have been released.
+    SimTime time;                 ///< Time of the current sample.
+    float power_mw;               ///< Power of the current sample.
+    SimTime next_time;            ///< Time of the next sample, SIM_TIME_NEVER at the end.
+    float next_power_mw;          ///< Power of the next sample.
+    SimTime period;               ///< Duration of the trace, the length of one loop.
+    SimTime loop_offset;          ///< Simulated time at which the current loop started.
+    bool loop;                    ///< Whether the trace restarts after its last sample.
+    TraceFile indexed;            ///< Attached file of an indexed trace.
+} EnergyTrace;
+
+/**
+ * \brief Maps a trace file and positions it on its first sample.
+ *
+ * The format is detected from the raw or indexed header magic; other files
+ * are parsed as CSV.
+ *
+ * \param trace Trace to open.
+ * \param path Path of the trace file.
+ * \param loop Whether to replay the trace from the start after its end.
+ * \return False if the file cannot be mapped or holds no sample.
+ */
+bool energy_trace_open(EnergyTrace* trace, const char* path, bool loop);
+
+/**
+ * \brief Returns the power harvested at a time.
+ *
+ * \param trace Open trace.
+ * \param time Simulated time, not earlier than the previous query.
+ * \return Power in milliwatts, 0 before the first and after the last sample.
+ */
+float energy_trace_power_at(EnergyTrace* trace, SimTime time);
+
+/**
+ * \brief Integrates the harvested energy over an interval.
+ *
+ * \param trace Open trace.
+ * \param start First second of the interval, not earlier than the previous query.
+ * \param end One past the last second of the interval.
+ * \return Energy in millijoules.
+ */
+double energy_trace_energy(EnergyTrace* trace, SimTime start, SimTime end);
+
+/**
+ * \brief Returns the current sample and moves to the next one, for converters.
+ *
+ * \param trace Open CSV or raw trace, rewound before the first call.
+ * \param time Destination of the sample time.
+ * \param power_mw Destination of the sample power.
+ * \return False once every sample has been returned, and for indexed traces.
+ */
+bool energy_trace_next_sample(EnergyTrace* trace, SimTime* time, float* power_mw);
+
+/**
+ * \brief Moves back to the first sample.
+ *
+ * \param trace Open trace.
+ */
+void energy_trace_rewind(EnergyTrace* trace);
+
+/**
+ * \brief Unmaps the trace and closes its file.
+ *
+ * \param trace Trace to close.
+ */
+void energy_trace_close(EnergyTrace* trace);
+
+#endif // ENERGY_TRACE_H
@@ -0,0 +1,94 @@
+#include "fault_injection.h"
+
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "error_handling.h"
+#include "prng.h"
+
+static const char* const fault_site_names[FAULT_SITE_COUNT] = {
+    "scheduler_step",
+    "task_start",
+    "task_body",
+    "task_end",
+    "checkpoint"
+};
+
+static FaultConfig fault_config;
+static bool fault_armed = false;
+static int fault_log_fd = -1;
+static uint32_t fault_counter = 0;
+static Prng fault_random;
+
+bool fault_injection_init(const FaultConfig* config) {
+    if (config == NULL) {
+        return false;
+    }
+
+    fault_config = *config;
+    fault_counter = 0;
+    // Independent from the generators of the run, which --seed controls.
+    prng_seed(&fault_random, config->seed, 0);
+    fault_armed = config->fail_at_point > 0 || config->failure_rate > 0.0f;
+
+    if (config->log_path != NULL) {
+        fault_log_fd = open(config->log_path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fault_log_fd < 0) {
+            handle_error("Failed to open fault injection log");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void fault_point(FaultSite site) {
+    bool fail = false;
+
+    if (!fault_armed) {
+        return;
+    }
+
+    fault_counter++;
+    if (fault_config.fail_at_point > 0) {
+        fail = (fault_counter == fault_config.fail_at_point);
+    } else {
+        fail = prng_unit(&fault_random) < fault_config.failure_rate;
+    }
+
+    if (fail) {
+        fault_log_event("power_failure site=%s point=%u", fault_site_names[site], fault_counter);
+        _exit(FAULT_EXIT_CODE);
+    }
+}
+
+void fault_log_event(const char* format, ...) {
+    char line[160];
+    va_list args;
+    int length = 0;
+
+    if (fault_log_fd < 0) {
+        return;
+    }
+
+    va_start(args, format);
+    length = vsnprintf(line, sizeof(line) - 1, format, args);
+    va_end(args);
+
+    if (length < 0) {
+        return;
+    }
+    if (length > (int)sizeof(line) - 2) {
+        length = (int)sizeof(line) - 2;
+    }
+    line[length] = '\n';
+    if (write(fault_log_fd, line, (size_t)length + 1) < 0) {
+        handle_error("Failed to write fault injection log");
+    }
+}
+
+uint32_t fault_points_reached(void) {
+    return fault_counter;
+}
@@ -0,0 +1,83 @@
+#ifndef FAULT_INJECTION_H
+#define FAULT_INJECTION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * \brief Process exit status used to signal a simulated power failure.
+ */
+#define FAULT_EXIT_CODE 86
+
+/**
+ * \brief Instrumented locations where a power failure may be injected.
+ */
+typedef enum {
+    FAULT_SITE_SCHEDULER_STEP,   ///< Between two steps of execute_tasks.
+    FAULT_SITE_TASK_START,       ///< Right before a task function runs.
+    FAULT_SITE_TASK_BODY,        ///< Inside a task function.
+    FAULT_SITE_TASK_END,         ///< After a task function returned, before it is marked completed.
+    FAULT_SITE_CHECKPOINT,       ///< In the middle of a checkpoint commit.
+    FAULT_SITE_COUNT             ///< Number of fault sites.
+} FaultSite;
+
+/**
+ * \brief Fault injection settings of a run.
+ */
+typedef struct {
+    uint32_t fail_at_point;  ///< Scripted mode: fail when this fault point is reached (1-based), 0 to disable.
+    float failure_rate;      ///< Random mode: probability of failing at each fault point.
+    uint32_t seed;           ///< Seed of the random mode.
+    const char* log_path;    ///< File receiving the event log, or NULL.
+} FaultConfig;
+
+/**
+ * \brief Arms fault injection and opens the event log.
+ *
+ * Without a call to this function fault points are inert.
+ *
+ * \param config Settings to apply.
+ * \return True on success, false if the event log could not be opened.
+ */
+bool fault_injection_init(const FaultConfig* config);
+
+/**
+ * \brief Marks a location where execution may be killed.
+ *
+ * When the configured failure triggers, the event is logged and the
+ * process terminates immediately with FAULT_EXIT_CODE, without flushing
+ * buffered output, like a node losing power.
+ *
+ * \param site Kind of location reached.
+ */
+void fault_point(FaultSite site);
+
+/**
+ * \brief Appends one line to the event log.
+ *
+ * Lines are written with a single unbuffered write so they survive an
+ * injected failure. Nothing is written when no log is configured.
+ *
+ * \param format printf-style format of the line, without trailing newline.
+ */
+void fault_log_event(const char* format, ...);
+
+/**
+ * \brief Returns the number of fault points reached so far.
+ *
+ * \return Fault point counter of the current process.
+ */
+uint32_t fault_points_reached(void);
+
+/**
+ * \brief Marks a fault point unless fault injection is compiled out.
+ *
+ * Define FAULT_INJECTION_DISABLED to remove every fault point from a build.
+ */
+#ifdef FAULT_INJECTION_DISABLED
+#define FAULT_POINT(site) ((void)0)
+#else
+#define FAULT_POINT(site) fault_point(site)
+#endif
+
+#endif // FAULT_INJECTION_H
@@ -0,0 +1,474 @@
+#include "fleet.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "alloc_tracker.h"
+#include "error_handling.h"
+
+// Roles of the simulation tasks, in the order of the scheduler's task table.
+#define SAMPLE_TASK 0
+#define AVERAGE_TASK 1
+#define SEND_TASK 2
+
+static void* fleet_array(Fleet* fleet, size_t element_size) {
+    void* array = NULL;
+
+    if (fleet->allocation_count == FLEET_MAX_ARRAYS) {
+        return NULL;
+    }
+    array = tracked_calloc(ALLOC_SUBSYSTEM_FLEET, fleet->node_count, element_size);
+    if (array != NULL) {
+        fleet->allocations[fleet->allocation_count++] = array;
+    }
+    return array;
+}
+
+static bool allocate_node_arrays(Fleet* fleet) {
+    bool allocated = true;
+
+    fleet->weather = fleet_array(fleet, sizeof(float));
+    fleet->step_harvest_mj = fleet_array(fleet, sizeof(float));
+    fleet->reading = fleet_array(fleet, sizeof(float));
+    fleet->charge_mj = fleet_array(fleet, sizeof(float));
+    fleet->awake = fleet_array(fleet, sizeof(uint32_t));
+    fleet->measure_index = fleet_array(fleet, sizeof(uint32_t));
+    fleet->buffer_full = fleet_array(fleet, sizeof(uint32_t));
+    fleet->last_average = fleet_array(fleet, sizeof(float));
+    fleet->reports = fleet_array(fleet, sizeof(uint32_t));
+    fleet->executed = fleet_array(fleet, sizeof(uint32_t));
+    fleet->sleep_hours = fleet_array(fleet, sizeof(uint32_t));
+    fleet->harvested_mj = fleet_array(fleet, sizeof(double));
+    fleet->wasted_mj = fleet_array(fleet, sizeof(double));
+    allocated = fleet->weather != NULL && fleet->step_harvest_mj != NULL &&
+                fleet->reading != NULL && fleet->charge_mj != NULL && fleet->awake != NULL &&
+                fleet->measure_index != NULL && fleet->buffer_full != NULL && fleet->last_average != NULL &&
+                fleet->reports != NULL && fleet->executed != NULL && fleet->sleep_hours != NULL && fleet->harvested_mj != NULL &&
+                fleet->wasted_mj != NULL;
+
+    for (size_t w = 0; w < PRNG_STATE_WORDS; w++) {
+        fleet->random.state[w] = fleet_array(fleet, sizeof(uint32_t));
+        allocated = allocated && fleet->random.state[w] != NULL;
+    }
+    fleet->random.count = fleet->node_count;
+    for (size_t i = 0; i < NUM_ENERGY_SOURCES; i++) {
+        fleet->harvest_scale[i] = fleet_array(fleet, sizeof(float));
+        allocated = allocated && fleet->harvest_scale[i] != NULL;
+    }
+    for (size_t i = 0; i < NUM_SIMULATION_TASKS; i++) {
+        fleet->ran[i] = fleet_array(fleet, sizeof(uint32_t));
+        fleet->completions[i] = fleet_array(fleet, sizeof(uint32_t));
+        allocated = allocated && fleet->ran[i] != NULL && fleet->completions[i] != NULL;
+    }
+    for (size_t m = 0; m < NUM_MEASURES; m++) {
+        fleet->samples[m] = fleet_array(fleet, sizeof(float));
+        allocated = allocated && fleet->samples[m] != NULL;
+    }
+    return allocated;
+}
+
+/**
+ * \brief Orders the prototype's tasks so that every task follows its dependency.
+ *
+ * \return False if a task has several dependencies or the dependencies form a cycle.
+ */
+static bool order_tasks(Fleet* fleet) {
+    const Task* tasks = fleet->prototype->tasks;
+    bool placed[NUM_SIMULATION_TASKS] = {false};
+    size_t count = 0;
+
+    for (size_t i = 0; i < NUM_SIMULATION_TASKS; i++) {
+        if (tasks[i].num_dependencies > 1) {
+            return false;
+        }
+        fleet->task_dependency[i] = tasks[i].num_dependencies == 1 ? (int8_t)(tasks[i].dependencies[0] - tasks) : -1;
+        fleet->task_chain_critical[i] = tasks[i].critical;
+    }
+
+    while (count < NUM_SIMULATION_TASKS) {
+        size_t placed_before = count;
+
+        for (size_t i = 0; i < NUM_SIMULATION_TASKS; i++) {
+            int8_t dependency = fleet->task_dependency[i];
+
+            if (!placed[i] && (dependency < 0 || placed[dependency])) {
+                placed[i] = true;
+                fleet->task_order[count++] = (uint8_t)i;
+            }
+        }
+        if (count == placed_before) {
+            return false;
+        }
+    }
+
+    // Like execute_tasks, a task required by a critical one may draw the battery reserve.
+    for (size_t k = NUM_SIMULATION_TASKS; k-- > 0;) {
+        uint8_t task = fleet->task_order[k];
+
+        if (fleet->task_chain_critical[task] && fleet->task_dependency[task] >= 0) {
+            fleet->task_chain_critical[fleet->task_dependency[task]] = true;
+        }
+    }
+    return true;
+}
+
+bool fleet_init(Fleet* fleet, const SchedulerContext* prototype, uint32_t node_count, float variation) {
+    const SchedulerOptions* options = &prototype->options;
+
+    memset(fleet, 0, sizeof(*fleet));
+    fleet->prototype = prototype;
+    fleet->node_count = node_count;
+    fleet->variation = variation;
+
+    if (options->policy != scheduling_policy_default() || options->checkpoint_path != NULL) {
+        handle_error("Fleet mode supports the greedy scheduler without checkpoint");
+        return false;
+    }
+    for (size_t i = 0; i < NUM_ENERGY_SOURCES; i++) {
+        if (options->trace_paths[i] != NULL) {
+            handle_error("Fleet mode supports synthetic harvest only");
+            return false;
+        }
+    }
+    if (node_count == 0 || variation < 0.0f || variation > 1.0f) {
+        handle_error("Invalid fleet size or variation");
+        return false;
+    }
+    if (!order_tasks(fleet)) {
+        handle_error("Fleet mode needs tasks with at most one dependency each and no cycle");
+        return false;
+    }
+    if (!allocate_node_arrays(fleet)) {
+        handle_error("Cannot allocate the fleet state");
+        fleet_free(fleet);
+        return false;
+    }
+
+    prng_lanes_seed(&fleet->random, options->seed, SCHEDULER_STREAM_FLEET);
+    for (size_t i = 0; i < NUM_ENERGY_SOURCES; i++) {
+        float* scale = fleet->harvest_scale[i];
+
+        prng_lanes_unit(&fleet->random, scale);
+        for (uint32_t n = 0; n < node_count; n++) {
+            scale[n] = 1.0f + variation * (2.0f * scale[n] - 1.0f);
+        }
+    }
+    for (uint32_t n = 0; n < node_count; n++) {
+        fleet->charge_mj[n] = prototype->node.battery.charge_mj;
+        fleet->measure_index[n] = prototype->node.measure_index;
+        fleet->buffer_full[n] = prototype->node.buffer_full;
+    }
+    return true;
+}
+
+static void draw_weather(Fleet* fleet) {
+    float* restrict weather = fleet->weather;
+    float variation = fleet->variation;
+    uint32_t count = fleet->node_count;
+
+    prng_lanes_unit(&fleet->random, weather);
+    for (uint32_t n = 0; n < count; n++) {
+        weather[n] = 1.0f - variation * weather[n];
+    }
+}
+
+/**
+ * \brief Sets the harvest of the hour starting at now; the schedule is shared, its power is per node.
+ */
+static void collect_harvest(Fleet* fleet, SimTime now) {
+    const EnergyPool* pool = &fleet->prototype->energy_pool;
+    float* restrict harvest = fleet->step_harvest_mj;
+    const float* restrict weather = fleet->weather;
+    double* restrict harvested = fleet->harvested_mj;
+    uint32_t count = fleet->node_count;
+
+    memset(harvest, 0, count * sizeof(*harvest));
+    for (uint8_t i = 0; i < pool->count && i < NUM_ENERGY_SOURCES; i++) {
+        const float* restrict scale = fleet->harvest_scale[i];
+        float energy_mj = 0.0f;
+
+        if (pool->entries[i].battery != NULL) {
+            continue;
+        }
+        energy_mj = (float)availability_index_expected_energy(&pool->entries[i].index, now, now + SECONDS_PER_HOUR);
+        if (energy_mj <= 0.0f) {
+            continue;
+        }
+        for (uint32_t n = 0; n < count; n++) {
+            harvest[n] += energy_mj * scale[n];
+        }
+    }
+
+    for (uint32_t n = 0; n < count; n++) {
+        harvest[n] *= weather[n];
+        harvested[n] += harvest[n];
+    }
+}
+
+/**
+ * \brief Wakes the nodes that can supply any task, like the sleep check of scheduler_step().
+ */
+static void check_awake(Fleet* fleet) {
+    const Task* tasks = fleet->prototype->tasks;
+    float reserve_mj = fleet->prototype->node.battery.reserve_mj;
+    const float* restrict harvest = fleet->step_harvest_mj;
+    const float* restrict charge = fleet->charge_mj;
+    uint32_t* restrict awake = fleet->awake;
+    uint32_t* restrict sleep_hours = fleet->sleep_hours;
+    uint32_t count = fleet->node_count;
+
+    memset(awake, 0, count * sizeof(*awake));
+    for (size_t i = 0; i < NUM_SIMULATION_TASKS; i++) {
+        float cost_mj = tasks[i].energy_cost_mj;
+        float kept_mj = tasks[i].critical ? 0.0f : reserve_mj;
+
+        for (uint32_t n = 0; n < count; n++) {
+            float usable_mj = charge[n] > kept_mj ? charge[n] - kept_mj : 0.0f;
+            awake[n] |= (uint32_t)(harvest[n] >= cost_mj) | (uint32_t)(usable_mj >= cost_mj);
+        }
+    }
+    for (uint32_t n = 0; n < count; n++) {
+        sleep_hours[n] += awake[n] ^ 1u;
+    }
+}
+
+/**
+ * \brief Runs a task on the nodes whose dependency ran and whose energy covers it.
+ */
+static void run_task(Fleet* fleet, uint8_t task) {
+    float cost_mj = fleet->prototype->tasks[task].energy_cost_mj;
+    float kept_mj = fleet->task_chain_critical[task] ? 0.0f : fleet->prototype->node.battery.reserve_mj;
+    int8_t dependency = fleet->task_dependency[task];
+    const uint32_t* restrict ready = dependency >= 0 ? fleet->ran[dependency] : fleet->awake;
+    float* restrict harvest = fleet->step_harvest_mj;
+    float* restrict charge = fleet->charge_mj;
+    uint32_t* restrict ran = fleet->ran[task];
+    uint32_t* restrict completions = fleet->completions[task];
+    uint32_t count = fleet->node_count;
+
+    for (uint32_t n = 0; n < count; n++) {
+        float usable_mj = charge[n] > kept_mj ? charge[n] - kept_mj : 0.0f;
+        uint32_t from_harvest = harvest[n] >= cost_mj;
+        uint32_t run = ready[n] & (from_harvest | (uint32_t)(usable_mj >= cost_mj));
+
+        harvest[n] -= run & from_harvest ? cost_mj : 0.0f;
+        charge[n] -= run & (from_harvest ^ 1u) ? cost_mj : 0.0f;
+        ran[n] = run;
+        completions[n] += run;
+    }
+}
+
+/**
+ * \brief Applies the sensor side of the tasks that ran: sampling, averaging a full buffer, sending it.
+ */
+static void update_sensor_buffers(Fleet* fleet) {
+    const uint32_t* restrict sampled = fleet->ran[SAMPLE_TASK];
+    const uint32_t* restrict averaged = fleet->ran[AVERAGE_TASK];
+    const uint32_t* restrict sent = fleet->ran[SEND_TASK];
+    uint32_t* restrict measure_index = fleet->measure_index;
+    uint32_t* restrict buffer_full = fleet->buffer_full;
+    uint32_t* restrict reports = fleet->reports;
+    uint32_t* restrict executed = fleet->executed;
+    float* restrict reading = fleet->reading;
+    float* restrict last_average = fleet->last_average;
+    uint32_t count = fleet->node_count;
+
+    // Every node draws a reading each hour, used or not, so that the draw is one vector loop.
+    prng_lanes_unit(&fleet->random, reading);
+    for (uint32_t n = 0; n < count; n++) {
+        float temperature = -40.0f + reading[n] * 100.0f;
+
+        reading[n] = ((int)(temperature * 10.0f)) / 10.0f;
+    }
+    // One pass per slot instead of a scatter, so that every pass vectorizes.
+    for (uint32_t m = 0; m < NUM_MEASURES; m++) {
+        float* restrict slot = fleet->samples[m];
+
+        for (uint32_t n = 0; n < count; n++) {
+            slot[n] = sampled[n] && measure_index[n] == m ? reading[n] : slot[n];
+        }
+    }
+    for (uint32_t n = 0; n < count; n++) {
+        uint32_t next_index = measure_index[n] + 1 == NUM_MEASURES ? 0 : measure_index[n] + 1;
+
+        measure_index[n] = sampled[n] ? next_index : measure_index[n];
+        buffer_full[n] |= sampled[n] & (uint32_t)(next_index == 0);
+        reading[n] = 0.0f;
+    }
+
+    for (uint32_t m = 0; m < NUM_MEASURES; m++) {
+        const float* restrict slot = fleet->samples[m];
+
+        for (uint32_t n = 0; n < count; n++) {
+            reading[n] += slot[n];
+        }
+    }
+    for (uint32_t n = 0; n < count; n++) {
+        uint32_t transmitted = sent[n] & buffer_full[n];
+        float average = reading[n] / NUM_MEASURES;
+
+        last_average[n] = averaged[n] & buffer_full[n] ? average : last_average[n];
+        reports[n] += transmitted;
+        executed[n] += sampled[n] + (averaged[n] & buffer_full[n]) + transmitted;
+        measure_index[n] = transmitted ? 0 : measure_index[n];
+        buffer_full[n] &= transmitted ^ 1u;
+    }
+}
+
+/**
+ * \brief Stores the harvest left at the end of the hour, like energy_pool_end_step().
+ */
+static void store_surplus(Fleet* fleet) {
+    float capacity_mj = fleet->prototype->node.battery.capacity_mj;
+    float* restrict harvest = fleet->step_harvest_mj;
+    float* restrict charge = fleet->charge_mj;
+    double* restrict wasted = fleet->wasted_mj;
+    uint32_t count = fleet->node_count;
+
+    for (uint32_t n = 0; n < count; n++) {
+        float room_mj = capacity_mj > charge[n] ? capacity_mj - charge[n] : 0.0f;
+        float stored_mj = harvest[n] < room_mj ? harvest[n] : room_mj;
+
+        charge[n] += stored_mj;
+        wasted[n] += harvest[n] - stored_mj;
+        harvest[n] = 0.0f;
+    }
+}
+
+void fleet_step(Fleet* fleet) {
+    SimTime now = fleet->simulated_day * SECONDS_PER_DAY + fleet->simulated_hour * SECONDS_PER_HOUR;
+    struct timespec start;
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (fleet->simulated_hour == 0) {
+        draw_weather(fleet);
+    }
+    collect_harvest(fleet, now);
+    check_awake(fleet);
+    for (size_t k = 0; k < NUM_SIMULATION_TASKS; k++) {
+        run_task(fleet, fleet->task_order[k]);
+    }
+    update_sensor_buffers(fleet);
+    store_surplus(fleet);
+
+    fleet->simulated_hour = (fleet->simulated_hour + 1) % 24;
+    if (fleet->simulated_hour == 0) {
+        fleet->simulated_day++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    fleet->elapsed_s += (double)(end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+void fleet_run(Fleet* fleet, uint32_t days) {
+    for (uint32_t hour = 0; hour < days * 24u; hour++) {
+        fleet_step(fleet);
+    }
+}
+
+static int compare_counts(const void* left, const void* right) {
+    uint32_t a = *(const uint32_t*)left;
+    uint32_t b = *(const uint32_t*)right;
+
+    return (a > b) - (a < b);
+}
+
+/**
+ * \brief Totals of a fleet, summed over its nodes.
+ */
+typedef struct {
+    uint64_t completions[NUM_SIMULATION_TASKS];
+    uint64_t completed;
+    uint64_t executed;
+    uint64_t reports;
+    uint64_t sleep_hours;
+    uint32_t silent_nodes;    ///< Nodes that never delivered a report.
+    double consumed_mj;
+    double harvested_mj;
+    double wasted_mj;
+    double charge_mj;
+} FleetTotals;
+
+static void sum_fleet(const Fleet* fleet, FleetTotals* totals) {
+    memset(totals, 0, sizeof(*totals));
+    for (uint32_t n = 0; n < fleet->node_count; n++) {
+        for (size_t i = 0; i < NUM_SIMULATION_TASKS; i++) {
+            totals->completions[i] += fleet->completions[i][n];
+        }
+        totals->reports += fleet->reports[n];
+        totals->executed += fleet->executed[n];
+        totals->sleep_hours += fleet->sleep_hours[n];
+        totals->silent_nodes += fleet->reports[n] == 0;
+        totals->harvested_mj += fleet->harvested_mj[n];
+        totals->wasted_mj += fleet->wasted_mj[n];
+        totals->charge_mj += fleet->charge_mj[n];
+    }
+    for (size_t i = 0; i < NUM_SIMULATION_TASKS; i++) {
+        totals->completed += totals->completions[i];
+        totals->consumed_mj += totals->completions[i] * (double)fleet->prototype->tasks[i].energy_cost_mj;
+    }
+}
+
+void fleet_print_report(const Fleet* fleet, FILE* output) {
+    FleetTotals totals;
+    uint32_t* per_node = tracked_malloc(ALLOC_SUBSYSTEM_FLEET, fleet->node_count * sizeof(*per_node));
+    double node_hours = (double)fleet->node_count * (fleet->simulated_day * 24u + fleet->simulated_hour);
+
+    sum_fleet(fleet, &totals);
+    fprintf(output, "Fleet of %u nodes over %u days: %.0f node-hours in %.2f s (%.2f M node-hours/s)\n",
+            fleet->node_count, fleet->simulated_day, node_hours, fleet->elapsed_s,
+            fleet->elapsed_s > 0.0 ? node_hours / fleet->elapsed_s / 1e6 : 0.0);
+    fprintf(output, "Completed tasks: %llu (", (unsigned long long)totals.completed);
+    for (size_t i = 0; i < NUM_SIMULATION_TASKS; i++) {
+        fprintf(output, "%stask%zu=%llu", i > 0 ? " " : "", i, (unsigned long long)totals.completions[i]);
+    }
+    fprintf(output, "), useful executions: %llu, reports delivered: %llu, nodes without any report: %u\n",
+            (unsigned long long)totals.executed, (unsigned long long)totals.reports, totals.silent_nodes);
+
+    if (per_node != NULL) {
+        uint64_t completed = 0;
+
+        for (uint32_t n = 0; n < fleet->node_count; n++) {
+            per_node[n] = 0;
+            for (size_t i = 0; i < NUM_SIMULATION_TASKS; i++) {
+                per_node[n] += fleet->completions[i][n];
+            }
+            completed += per_node[n];
+        }
+        qsort(per_node, fleet->node_count, sizeof(*per_node), compare_counts);
+        fprintf(output, "Completed tasks per node: mean %.1f, p5 %u, min %u, max %u\n",
+                (double)completed / fleet->node_count, per_node[fleet->node_count / 20], per_node[0],
+                per_node[fleet->node_count - 1]);
+        tracked_free(ALLOC_SUBSYSTEM_FLEET, per_node);
+    }
+
+    fprintf(output, "Energy per node: harvested %.1f mJ, consumed %.1f mJ, lost to a full battery %.1f mJ, "
+            "final charge %.1f mJ\n", totals.harvested_mj / fleet->node_count, totals.consumed_mj / fleet->node_count,
+            totals.wasted_mj / fleet->node_count, totals.charge_mj / fleet->node_count);
+    fprintf(output, "Sleeping node-hours: %llu (%.2f %%)\n", (unsigned long long)totals.sleep_hours,
+            node_hours > 0.0 ? totals.sleep_hours * 100.0 / node_hours : 0.0);
+}
+
+void fleet_print_summary(const Fleet* fleet, FILE* output) {
+    FleetTotals totals;
+
+    sum_fleet(fleet, &totals);
+    fprintf(output, "summary nodes=%u days=%u seed=%llu completed=%llu executed=%llu reports=%llu", fleet->node_count,
+            fleet->simulated_day, (unsigned long long)fleet->prototype->options.seed,
+            (unsigned long long)totals.completed, (unsigned long long)totals.executed,
+            (unsigned long long)totals.reports);
+    for (size_t i = 0; i < NUM_SIMULATION_TASKS; i++) {
+        fprintf(output, " task%zu=%llu", i, (unsigned long long)totals.completions[i]);
+    }
+    // Fleet nodes wake up every hour they sleep.
+    fprintf(output, " sleep_hours=%llu wakeups=%llu consumed_mj=%.1f harvested_mj=%.1f battery_mj=%.1f\n",
+            (unsigned long long)totals.sleep_hours, (unsigned long long)totals.sleep_hours, totals.consumed_mj, totals.harvested_mj, totals.charge_mj);
+}
+
+void fleet_free(Fleet* fleet) {
+    for (size_t i = 0; i < fleet->allocation_count; i++) {
+        tracked_free(ALLOC_SUBSYSTEM_FLEET, fleet->allocations[i]);
+    }
+    fleet->allocation_count = 0;
+}
@@ -0,0 +1,118 @@
+#ifndef FLEET_H
+#define FLEET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "prng.h"
+#include "scheduler.h"
+
+/**
+ * \brief Maximum number of per-node arrays of a fleet.
+ */
+#define FLEET_MAX_ARRAYS 40
+
+/**
+ * \brief Many copies of one node simulated in lockstep, hour by hour.
+ *
+ * Every node runs the greedy policy of the scheduler reduced to its energy
+ * balance: the tasks of an hour run in dependency order, each drawn whole
+ * from the node's harvest of the hour if it covers the task, else from the
+ * battery, and a task whose energy is missing skips its dependents. The
+ * harvesters of a node count as one source, which only differs from the
+ * scheduler when no single harvester but their sum could supply a task.
+ *
+ * Node state is stored as one array per field (struct of arrays), so that
+ * each step of an hour is a loop over all nodes that the compiler can
+ * vectorize. Nodes differ by a constant scale of each harvester's power and
+ * a daily weather factor of their harvest, both drawn from `variation`.
+ * Node n draws them, and its sensor readings, from generator stream
+ * SCHEDULER_STREAM_FLEET + n of the prototype's seed.
+ */
+typedef struct {
+    const SchedulerContext* prototype;   ///< Node whose tasks, harvesters and battery every node copies.
+    uint32_t node_count;
+    float variation;                     ///< Spread of the per-node harvest, in the range 0-1.
+    uint8_t task_order[NUM_SIMULATION_TASKS];  ///< Tasks in dependency order.
+    int8_t task_dependency[NUM_SIMULATION_TASKS]; ///< Task that must have run in the same hour, -1 for none.
+    bool task_chain_critical[NUM_SIMULATION_TASKS]; ///< Critical, or required by a critical task.
+    uint8_t simulated_hour;
+    uint32_t simulated_day;
+    double elapsed_s;                    ///< Wall-clock time spent in fleet_step().
+
+    // Per-node arrays, node_count elements each.
+    PrngLanes random;                    ///< Harvest, weather and sensor generator of every node.
+    float* harvest_scale[NUM_ENERGY_SOURCES]; ///< Power of each harvester relative to the prototype.
+    float* weather;                      ///< Harvest factor of the current day.
+    float* step_harvest_mj;              ///< Harvest still available in the current hour.
+    float* reading;                      ///< Sensor reading of the current hour, then scratch of the averaging.
+    float* charge_mj;                    ///< Battery charge.
+    uint32_t* awake;                     ///< Whether the node runs a task cycle in the current hour.
+    uint32_t* ran[NUM_SIMULATION_TASKS]; ///< Whether each task ran in the current hour.
+    float* samples[NUM_MEASURES];        ///< Sensor buffer, one array per slot.
+    uint32_t* measure_index;
+    uint32_t* buffer_full;
+    float* last_average;                 ///< Last average computed from a full buffer.
+    uint32_t* completions[NUM_SIMULATION_TASKS];
+    uint32_t* reports;                   ///< Transmissions of a full buffer.
+    uint32_t* executed;                  ///< Task runs that did useful work: samples, and averages and transmissions of a full buffer.
+    uint32_t* sleep_hours;
+    double* harvested_mj;
+    double* wasted_mj;                   ///< Harvest a full battery could not store.
+
+    void* allocations[FLEET_MAX_ARRAYS];
+    size_t allocation_count;
+} Fleet;
+
+/**
+ * \brief Allocates a fleet of copies of an initialized node.
+ *
+ * \param fleet Fleet to initialize.
+ * \param prototype Node to copy; it must outlive the fleet and use the greedy
+ *        scheduler with synthetic harvest, without checkpoint.
+ * \param node_count Number of nodes, at least one.
+ * \param variation Spread of the per-node harvest, 0 for identical nodes.
+ * \return False if the prototype is unsupported or memory is missing.
+ */
+bool fleet_init(Fleet* fleet, const SchedulerContext* prototype, uint32_t node_count, float variation);
+
+/**
+ * \brief Simulates one hour of every node.
+ *
+ * \param fleet Initialized fleet.
+ */
+void fleet_step(Fleet* fleet);
+
+/**
+ * \brief Simulates whole days of every node.
+ *
+ * \param fleet Initialized fleet.
+ * \param days Number of days to simulate.
+ */
+void fleet_run(Fleet* fleet, uint32_t days);
+
+/**
+ * \brief Prints fleet-wide throughput, task and energy statistics.
+ *
+ * \param fleet Initialized fleet.
+ * \param output Destination of the report.
+ */
+void fleet_print_report(const Fleet* fleet, FILE* output);
+
+/**
+ * \brief Prints the fleet totals in the format of scheduler_print_summary(), with the node count.
+ *
+ * \param fleet Initialized fleet.
+ * \param output Destination of the line.
+ */
+void fleet_print_summary(const Fleet* fleet, FILE* output);
+
+/**
+ * \brief Releases the arrays of a fleet.
+ *
+ * \param fleet Fleet to release.
+ */
+void fleet_free(Fleet* fleet);
+
+#endif // FLEET_H
@@ -1,5 +1,48 @@
 #include "hardware_abstraction.h"
 
+#include <stdarg.h>
+#include <string.h>
+
+/**
+ * \brief Power states of an RP2040-class microcontroller board.
+ */
+static const PowerStateSpec power_states[POWER_STATE_COUNT] = {
+    {"active", 80.0f, 0, 0, 0.0f},
+    {"idle", 20.0f, 0, 0, 0.0f},
+    {"light sleep", 5.0f, 1, 1, 0.02f},
+    {"deep sleep", 0.8f, 5, 10, 0.5f},
+    {"hibernate", 0.05f, 50, 500, 600.0f}
+};
+
+/**
+ * \brief Adds an idle period spent in a state to the board's counters.
+ */
+static void account_power_state(HardwareContext* hardware, PowerState state, uint64_t idle_ms) {
+    const PowerStateSpec* spec = &power_states[state];
+    uint64_t latency_ms = (uint64_t)spec->entry_latency_ms + spec->exit_latency_ms;
+    uint64_t resident_ms = idle_ms > latency_ms ? idle_ms - latency_ms : 0;
+
+    hardware->state_entries[state]++;
+    hardware->state_residency_ms[state] += idle_ms;
+    hardware->state_energy_mj[state] += spec->transition_mj + spec->power_mw * (double)resident_ms / 1000.0;
+}
+
+void set_time_scale(HardwareContext* hardware, float scale) {
+    hardware->time_scale = scale < 0.0f ? 0.0f : scale;
+    hardware->deadline_ns = 0;
+}
+
+void console_print(HardwareContext* hardware, const char* format, ...) {
+    va_list arguments;
+
+    if (hardware->console == NULL) {
+        return;
+    }
+    va_start(arguments, format);
+    vfprintf(hardware->console, format, arguments);
+    va_end(arguments);
+}
+
 /**
  * \brief Initializes hardware peripherals.
  * 
@@ -9,8 +52,17 @@
  * \note In a real embedded system, this function would include actual
  * hardware initialization code.
  */
-void init_peripherals() {
-    printf("Initializing peripherals (simulated for Linux)...\n");
+void init_peripherals(HardwareContext* hardware, FILE* console) {
+    hardware->time_scale = 1.0f;
+    hardware->console = console;
+    hardware->slept_ms = 0;
+    hardware->deadline_ns = 0;
+    hardware->missed_deadlines = 0;
+    jitter_stats_init(&hardware->jitter);
+    memset(hardware->state_entries, 0, sizeof(hardware->state_entries));
+    memset(hardware->state_residency_ms, 0, sizeof(hardware->state_residency_ms));
+    memset(hardware->state_energy_mj, 0, sizeof(hardware->state_energy_mj));
+    console_print(hardware, "Initializing peripherals (simulated for Linux)...\n");
 }
 
 /**
@@ -18,8 +70,48 @@ void init_peripherals() {
  * 
  * \param ms Duration of the delay in milliseconds.
  */
-void delay(uint32_t ms) {
-    sleep_ms(ms);
+void delay(HardwareContext* hardware, uint32_t ms) {
+    account_power_state(hardware, select_power_state(ms, POWER_STATE_DEEP_SLEEP), ms);
+    sleep_ms(hardware, ms);
+}
+
+const PowerStateSpec* power_state_spec(PowerState state) {
+    return &power_states[state];
+}
+
+uint32_t power_state_break_even_ms(PowerState state) {
+    const PowerStateSpec* idle = &power_states[POWER_STATE_IDLE];
+    const PowerStateSpec* spec = &power_states[state];
+    float latency_ms = (float)spec->entry_latency_ms + (float)spec->exit_latency_ms;
+    float break_even_ms = 0.0f;
+
+    if (state <= POWER_STATE_IDLE) {
+        return 0;
+    }
+    if (spec->power_mw >= idle->power_mw) {
+        return UINT32_MAX;
+    }
+    // Idle for T costs P_idle * T; sleeping costs E_transition + P_state * (T - latency).
+    break_even_ms = (spec->transition_mj * 1000.0f - spec->power_mw * latency_ms) / (idle->power_mw - spec->power_mw);
+    return (uint32_t)(break_even_ms > latency_ms ? break_even_ms + 0.5f : latency_ms);
+}
+
+PowerState select_power_state(uint64_t idle_ms, PowerState deepest) {
+    for (int state = deepest; state > POWER_STATE_IDLE; state--) {
+        if (power_state_break_even_ms((PowerState)state) <= idle_ms) {
+            return (PowerState)state;
+        }
+    }
+    return POWER_STATE_IDLE;
+}
+
+PowerState enter_low_power(HardwareContext* hardware, uint64_t idle_ms, PowerState deepest, uint32_t wait_ms) {
+    PowerState state = select_power_state(idle_ms, deepest);
+
+    console_print(hardware, "Entering %s for %llu ms.\n", power_states[state].name, (unsigned long long)idle_ms);
+    account_power_state(hardware, state, idle_ms);
+    sleep_ms(hardware, wait_ms);
+    return state;
 }
 
 /**
@@ -30,9 +122,10 @@ void delay(uint32_t ms) {
  * 
  * \param duration_ms Duration of the deep sleep in milliseconds.
  */
-void enter_deep_sleep(uint32_t duration_ms) {
-    printf("Entering deep sleep for %u ms.\n", duration_ms);
-    sleep_ms(duration_ms);
+void enter_deep_sleep(HardwareContext* hardware, uint32_t duration_ms) {
+    console_print(hardware, "Entering deep sleep for %u ms.\n", duration_ms);
+    account_power_state(hardware, POWER_STATE_DEEP_SLEEP, duration_ms);
+    sleep_ms(hardware, duration_ms);
 }
 
 /**
@@ -42,24 +135,41 @@ void enter_deep_sleep(uint32_t duration_ms) {
  * 
  * \param times Number of times the LED should blink.
  */
-void blink_led(uint8_t times) {
-    printf("Simulating blinking LED %d times...\n", times);
+void blink_led(HardwareContext* hardware, uint8_t times) {
+    console_print(hardware, "Simulating blinking LED %d times...\n", times);
     for (uint8_t i = 0; i < times; i++) {
-        printf("LED ON\n");
-        usleep(200000);  // 200 ms
-        printf("LED OFF\n");
-        usleep(200000);
+        console_print(hardware, "LED ON\n");
+        sleep_ms(hardware, 200);
+        console_print(hardware, "LED OFF\n");
+        sleep_ms(hardware, 200);
     }
 }
 
 /**
  * \brief Delays the execution for a specified duration in milliseconds.
  * 
- * This function converts the given duration from milliseconds to microseconds
- * and calls `usleep` to perform the delay.
+ * This function moves the board's deadline on by the scaled duration and
+ * sleeps until it on CLOCK_MONOTONIC. A board that stalled past the end of
+ * this wait restarts its deadlines from now, like periodic_deadline_wait().
  * 
  * \param ms Duration of the delay in milliseconds.
  */
-void sleep_ms(uint32_t ms) {
-    usleep(ms * 1000);  // Convert milliseconds to microseconds
+void sleep_ms(HardwareContext* hardware, uint32_t ms) {
+    uint64_t scaled_ns = (uint64_t)((double)ms * hardware->time_scale * (double)NS_PER_MS);
+    uint64_t now_ns = 0;
+
+    hardware->slept_ms += ms;
+    if (scaled_ns == 0) {
+        return;
+    }
+    now_ns = monotonic_now_ns();
+    if (hardware->deadline_ns == 0) {
+        hardware->deadline_ns = now_ns;
+    } else if (now_ns > hardware->deadline_ns + scaled_ns) {
+        // Drop the time lost rather than return at once until the deadlines catch up.
+        hardware->deadline_ns = now_ns;
+        hardware->missed_deadlines++;
+    }
+    hardware->deadline_ns += scaled_ns;
+    jitter_stats_add(&hardware->jitter, monotonic_sleep_until(hardware->deadline_ns));
 }
@@ -2,12 +2,66 @@
 #define HARDWARE_ABSTRACTION_H
 
 #include <stdint.h>
-#include <unistd.h>
 #include <stdio.h>
 
+#include "monotonic_clock.h"
+
 /// \brief GPIO pin number assigned to the LED.
 #define LED_PIN 25
 
+/**
+ * \brief Power states of the board, from the shallowest to the deepest.
+ */
+typedef enum {
+    POWER_STATE_ACTIVE,       ///< Running code.
+    POWER_STATE_IDLE,         ///< Core halted until the next interrupt, clocks running.
+    POWER_STATE_LIGHT_SLEEP,  ///< Clocks gated, peripherals and RAM powered.
+    POWER_STATE_DEEP_SLEEP,   ///< Only the RTC and RAM retention powered.
+    POWER_STATE_HIBERNATE,    ///< Everything but the RTC off; RAM is lost and the node resumes from its checkpoint.
+    POWER_STATE_COUNT         ///< Number of power states.
+} PowerState;
+
+/**
+ * \brief Electrical model of a power state.
+ */
+typedef struct {
+    const char* name;
+    float power_mw;             ///< Draw while in the state.
+    uint32_t entry_latency_ms;  ///< Time to enter the state, drawing the transition energy.
+    uint32_t exit_latency_ms;   ///< Time to resume running code.
+    float transition_mj;        ///< Energy of one entry and exit.
+} PowerStateSpec;
+
+/**
+ * \brief Simulated board of one scheduler instance.
+ *
+ * Each scheduler owns its board, so several schedulers can run in one
+ * process, each on its own thread.
+ */
+typedef struct {
+    float time_scale;   ///< Factor applied to every simulated wait.
+    FILE* console;      ///< Destination of the board's serial output, NULL to discard it.
+    uint64_t slept_ms;  ///< Simulated milliseconds spent waiting, before scaling.
+    uint64_t deadline_ns; ///< CLOCK_MONOTONIC deadline of the last wait, 0 before the first one.
+    uint64_t missed_deadlines; ///< Waits whose whole duration had already passed, after which the deadlines restarted.
+    JitterStats jitter;   ///< Lateness of the board's wake-ups.
+    uint32_t state_entries[POWER_STATE_COUNT];   ///< Times each low-power state was entered.
+    uint64_t state_residency_ms[POWER_STATE_COUNT]; ///< Simulated time spent in each state, transitions included.
+    double state_energy_mj[POWER_STATE_COUNT];   ///< Energy of each state, transitions included.
+} HardwareContext;
+
+/**
+ * \brief Scales every simulated wait performed by the hardware layer.
+ *
+ * A scale of 1 waits in real time, 0 skips waits entirely, which lets batch
+ * experiments run a long simulated period as fast as the CPU allows. The
+ * next wait starts a new series of deadlines.
+ *
+ * \param hardware Board to configure.
+ * \param scale Non-negative factor applied to sleep durations.
+ */
+void set_time_scale(HardwareContext* hardware, float scale);
+
 /**
  * \brief Initializes hardware peripherals.
  * 
@@ -15,26 +69,91 @@
  * In a simulation environment, it outputs a message indicating initialization.
  * 
  * \note This function is a placeholder for actual hardware initialization in an embedded system.
+ *
+ * \param hardware Board to initialize.
+ * \param console Destination of the serial output, NULL to discard it.
  */
-void init_peripherals();
+void init_peripherals(HardwareContext* hardware, FILE* console);
+
+/**
+ * \brief Writes formatted text to the board's console, if it has one.
+ *
+ * \param hardware Board whose console receives the text.
+ * \param format printf-style format.
+ */
+void console_print(HardwareContext* hardware, const char* format, ...) __attribute__((format(printf, 2, 3)));
 
 /**
  * \brief Delays execution for a specified duration.
  * 
- * This function pauses execution for the given duration in milliseconds.
+ * This function pauses execution for the given duration in milliseconds,
+ * in the deepest power state that pays off and keeps RAM.
  * 
+ * \param hardware Board that waits.
  * \param ms Duration of the delay in milliseconds.
  */
-void delay(uint32_t ms);
+void delay(HardwareContext* hardware, uint32_t ms);
 
 /**
  * \brief Sleeps for a specified duration in milliseconds.
  *
  * This low-level helper backs the higher-level delay and deep-sleep helpers.
+ * Each wait ends at an absolute deadline, the scaled duration after the
+ * deadline of the previous wait, so the work between waits does not add up
+ * and a real-time run stays aligned with the wall clock. When the board
+ * stalled past the end of a wait, the deadlines restart from the current
+ * time and the wait counts as missed, so a stall is not followed by waits
+ * that return back to back. The lateness of every wake-up is recorded in
+ * the board's jitter statistics.
  *
+ * \param hardware Board that waits.
  * \param ms Duration of the sleep in milliseconds.
  */
-void sleep_ms(uint32_t ms);
+void sleep_ms(HardwareContext* hardware, uint32_t ms);
+
+/**
+ * \brief Returns the electrical model of a power state.
+ *
+ * \param state Power state, below POWER_STATE_COUNT.
+ * \return Model of the state.
+ */
+const PowerStateSpec* power_state_spec(PowerState state);
+
+/**
+ * \brief Returns the shortest idle period for which a state saves energy over staying idle.
+ *
+ * Entering the state pays its transition energy and latencies, so it only
+ * pays off once the lower draw over the rest of the period makes up for
+ * them. The period also has to cover both latencies.
+ *
+ * \param state Power state.
+ * \return Break-even time in milliseconds, 0 for the active and idle states.
+ */
+uint32_t power_state_break_even_ms(PowerState state);
+
+/**
+ * \brief Picks the deepest state whose break-even time fits before the next event.
+ *
+ * \param idle_ms Time until the next event, in simulated milliseconds.
+ * \param deepest Deepest state allowed, for instance POWER_STATE_DEEP_SLEEP when RAM must be kept.
+ * \return Selected state, POWER_STATE_IDLE if no sleep state pays off.
+ */
+PowerState select_power_state(uint64_t idle_ms, PowerState deepest);
+
+/**
+ * \brief Enters the best power state for an idle period, then waits.
+ *
+ * The state is chosen by select_power_state() and its residency and
+ * energy over idle_ms are added to the board's counters. The wait itself
+ * is sleep_ms(wait_ms), so callers may compress long idle periods.
+ *
+ * \param hardware Board that sleeps.
+ * \param idle_ms Simulated time until the next event.
+ * \param deepest Deepest state allowed.
+ * \param wait_ms Duration of the wait, before scaling.
+ * \return State the board slept in.
+ */
+PowerState enter_low_power(HardwareContext* hardware, uint64_t idle_ms, PowerState deepest, uint32_t wait_ms);
 
 /**
  * \brief Simulates entering deep sleep mode.
@@ -42,17 +161,19 @@ void sleep_ms(uint32_t ms);
  * This function simulates a deep sleep state to conserve energy by delaying
  * execution for the specified duration.
  * 
+ * \param hardware Board that sleeps.
  * \param duration_ms Duration of the deep sleep in milliseconds.
  */
-void enter_deep_sleep(uint32_t duration_ms);
+void enter_deep_sleep(HardwareContext* hardware, uint32_t duration_ms);
 
 /**
  * \brief Simulates blinking an LED a specified number of times.
  * 
  * This function outputs messages to simulate the LED turning on and off.
  * 
+ * \param hardware Board whose LED blinks.
  * \param times Number of times the LED should blink.
  */
-void blink_led(uint8_t times);
+void blink_led(HardwareContext* hardware, uint8_t times);
 
 #endif // HARDWARE_ABSTRACTION_H
@@ -0,0 +1,371 @@
+#include "inference_engine.h"
+
+#include <string.h>
+
+#include "error_handling.h"
+
+#define RECURRENT_STATE_SCALE (1.0f / 127.0f) ///< Fixed scale of recurrent hidden states.
+
+static size_t align4(size_t value) {
+    return (value + 3u) & ~(size_t)3u;
+}
+
+/**
+ * \brief Moves a cursor past a padded item, stopping at the end of the blob.
+ *
+ * The padding of the last item may be missing from a blob, so the cursor is
+ * clamped rather than moved past end, where end - cursor would wrap around.
+ */
+static const uint8_t* skip_padded(const uint8_t* cursor, const uint8_t* end, size_t bytes) {
+    size_t padded = align4(bytes);
+
+    return padded < (size_t)(end - cursor) ? cursor + padded : end;
+}
+
+static void run_dense(const InferenceModel* model, const InferenceLayer* layer, const int8_t* input, int8_t* output) {
+    model->kernels->matvec_s8(layer->weights, layer->out_dim, layer->in_dim, input, layer->bias, model->accumulators);
+    model->kernels->requantize(model->accumulators, layer->out_dim, layer->in_scale, layer->scales,
+                               layer->activation, layer->out_scale, output);
+}
+
+static void run_conv1d(const InferenceModel* model, const InferenceLayer* layer, const int8_t* input, int8_t* output) {
+    size_t window = (size_t)layer->kernel * layer->in_dim;
+
+    // Channels-last layout makes every receptive field one contiguous run of kernel * in_dim values.
+    for (uint16_t position = 0; position < layer->out_length; position++) {
+        const int8_t* field = input + (size_t)position * layer->stride * layer->in_dim;
+        model->kernels->matvec_s8(layer->weights, layer->out_dim, window, field, layer->bias, model->accumulators);
+        model->kernels->requantize(model->accumulators, layer->out_dim, layer->in_scale, layer->scales,
+                                   layer->activation, layer->out_scale, output + (size_t)position * layer->out_dim);
+    }
+}
+
+/**
+ * \brief Computes the input and recurrent pre-activations of every gate.
+ */
+static void project_gates(const InferenceModel* model, const InferenceLayer* layer, uint16_t gate_rows,
+                          const int8_t* step_input, const int8_t* hidden, float* input_part, float* recurrent_part) {
+    int32_t* from_input = model->accumulators;
+    int32_t* from_state = model->accumulators + gate_rows;
+
+    model->kernels->matvec_s8(layer->weights, gate_rows, layer->in_dim, step_input, layer->bias, from_input);
+    model->kernels->matvec_s8(layer->recurrent_weights, gate_rows, layer->out_dim, hidden, layer->recurrent_bias, from_state);
+    for (uint16_t row = 0; row < gate_rows; row++) {
+        input_part[row] = (float)from_input[row] * layer->in_scale * layer->scales[row];
+        recurrent_part[row] = (float)from_state[row] * RECURRENT_STATE_SCALE * layer->recurrent_scales[row];
+    }
+}
+
+static void run_gru(const InferenceModel* model, const InferenceLayer* layer, const int8_t* input, int8_t* hidden) {
+    uint16_t size = layer->out_dim;
+    float* gates = model->scratch;
+    float* recurrent_part = model->scratch + 3 * size;
+
+    memset(hidden, 0, size);
+    for (uint16_t step = 0; step < layer->in_length; step++) {
+        project_gates(model, layer, (uint16_t)(3 * size), input + (size_t)step * layer->in_dim, hidden, gates, recurrent_part);
+        for (uint16_t row = 0; row < 2 * size; row++) {
+            gates[row] += recurrent_part[row];
+        }
+        model->kernels->activate(ACTIVATION_SIGMOID, gates, 2 * (size_t)size);
+        for (uint16_t unit = 0; unit < size; unit++) {
+            gates[2 * size + unit] += gates[size + unit] * recurrent_part[2 * size + unit];
+        }
+        model->kernels->activate(ACTIVATION_TANH, gates + 2 * size, size);
+
+        for (uint16_t unit = 0; unit < size; unit++) {
+            float update = gates[unit];
+            float previous = hidden[unit] * RECURRENT_STATE_SCALE;
+            hidden[unit] = inference_quantize((1.0f - update) * gates[2 * size + unit] + update * previous,
+                                              RECURRENT_STATE_SCALE);
+        }
+    }
+}
+
+static void run_lstm(const InferenceModel* model, const InferenceLayer* layer, const int8_t* input, int8_t* hidden) {
+    uint16_t size = layer->out_dim;
+    float* gates = model->scratch;
+    float* recurrent_part = model->scratch + 4 * size;
+    float* cell = model->scratch + 8 * size;
+    float* cell_output = model->scratch + 9 * size;
+
+    memset(hidden, 0, size);
+    memset(cell, 0, sizeof(float) * size);
+    for (uint16_t step = 0; step < layer->in_length; step++) {
+        project_gates(model, layer, (uint16_t)(4 * size), input + (size_t)step * layer->in_dim, hidden, gates, recurrent_part);
+        for (uint16_t row = 0; row < 4 * size; row++) {
+            gates[row] += recurrent_part[row];
+        }
+        model->kernels->activate(ACTIVATION_SIGMOID, gates, 2 * (size_t)size);
+        model->kernels->activate(ACTIVATION_TANH, gates + 2 * size, size);
+        model->kernels->activate(ACTIVATION_SIGMOID, gates + 3 * size, size);
+
+        for (uint16_t unit = 0; unit < size; unit++) {
+            cell[unit] = gates[size + unit] * cell[unit] + gates[unit] * gates[2 * size + unit];
+            cell_output[unit] = cell[unit];
+        }
+        model->kernels->activate(ACTIVATION_TANH, cell_output, size);
+        for (uint16_t unit = 0; unit < size; unit++) {
+            hidden[unit] = inference_quantize(gates[3 * size + unit] * cell_output[unit], RECURRENT_STATE_SCALE);
+        }
+    }
+}
+
+/**
+ * \brief Reads the next array of a payload and checks that it stays inside it.
+ */
+static const uint8_t* take_array(const uint8_t** cursor, const uint8_t* end, size_t bytes) {
+    const uint8_t* array = *cursor;
+
+    if (array > end || (size_t)(end - array) < bytes) {
+        return NULL;
+    }
+    *cursor = skip_padded(array, end, bytes);
+    return array;
+}
+
+static bool resolve_layer(InferenceLayer* layer, const ModelLayerHeader* header, const uint8_t* payload,
+                          uint16_t* length, uint16_t* channels, float* scale) {
+    const uint8_t* cursor = payload;
+    const uint8_t* end = payload + header->payload_size;
+    size_t rows = header->out_dim;
+    size_t columns = header->in_dim;
+
+    memset(layer, 0, sizeof(*layer));
+    layer->type = (LayerType)header->type;
+    layer->activation = (ActivationType)header->activation;
+    layer->in_dim = header->in_dim;
+    layer->out_dim = header->out_dim;
+    layer->kernel = header->kernel;
+    layer->stride = header->stride > 0 ? header->stride : 1;
+    layer->in_length = *length;
+    layer->in_scale = *scale;
+    layer->out_scale = header->output_scale;
+
+    if (header->in_dim == 0 || header->out_dim == 0 || header->output_scale <= 0.0f) {
+        return false;
+    }
+
+    switch (layer->type) {
+    case LAYER_DENSE:
+        if ((size_t)*length * *channels != header->in_dim) {
+            return false;
+        }
+        layer->out_length = 1;
+        break;
+    case LAYER_CONV1D:
+        if (*channels != header->in_dim || header->kernel == 0 || *length < header->kernel) {
+            return false;
+        }
+        columns = (size_t)header->kernel * header->in_dim;
+        layer->out_length = (uint16_t)((*length - header->kernel) / layer->stride + 1);
+        break;
+    case LAYER_GRU:
+    case LAYER_LSTM:
+        if (*channels != header->in_dim) {
+            return false;
+        }
+        rows = (size_t)header->out_dim * (layer->type == LAYER_GRU ? 3 : 4);
+        layer->out_length = 1;
+        layer->out_scale = RECURRENT_STATE_SCALE;
+        break;
+    default:
+        return false;
+    }
+
+    layer->weights = (const int8_t*)take_array(&cursor, end, rows * columns);
+    if (layer->type == LAYER_GRU || layer->type == LAYER_LSTM) {
+        layer->recurrent_weights = (const int8_t*)take_array(&cursor, end, rows * header->out_dim);
+        layer->scales = (const float*)take_array(&cursor, end, rows * sizeof(float));
+        layer->recurrent_scales = (const float*)take_array(&cursor, end, rows * sizeof(float));
+        layer->bias = (const int32_t*)take_array(&cursor, end, rows * sizeof(int32_t));
+        layer->recurrent_bias = (const int32_t*)take_array(&cursor, end, rows * sizeof(int32_t));
+        if (layer->recurrent_weights == NULL || layer->recurrent_scales == NULL || layer->recurrent_bias == NULL) {
+            return false;
+        }
+    } else {
+        layer->scales = (const float*)take_array(&cursor, end, rows * sizeof(float));
+        layer->bias = (const int32_t*)take_array(&cursor, end, rows * sizeof(int32_t));
+    }
+
+    if (layer->weights == NULL || layer->scales == NULL || layer->bias == NULL) {
+        return false;
+    }
+
+    *length = layer->out_length;
+    *channels = layer->out_dim;
+    *scale = layer->out_scale;
+    return true;
+}
+
+static size_t scratch_floats(const InferenceLayer* layer) {
+    switch (layer->type) {
+    case LAYER_GRU:
+        return (size_t)6 * layer->out_dim;
+    case LAYER_LSTM:
+        return (size_t)10 * layer->out_dim;
+    default:
+        return 0;
+    }
+}
+
+static size_t accumulator_count(const InferenceLayer* layer) {
+    switch (layer->type) {
+    case LAYER_GRU:
+        return (size_t)6 * layer->out_dim;
+    case LAYER_LSTM:
+        return (size_t)8 * layer->out_dim;
+    default:
+        return layer->out_dim;
+    }
+}
+
+bool inference_model_load(InferenceModel* model, const uint8_t* data, size_t size, uint8_t* arena, size_t arena_size) {
+    const ModelHeader* header = (const ModelHeader*)data;
+    const uint8_t* cursor = NULL;
+    const uint8_t* end = data + size;
+    uint16_t length = 0;
+    uint16_t channels = 0;
+    float scale = 0.0f;
+    size_t largest_tensor = 0;
+    size_t largest_scratch = 0;
+    size_t largest_accumulators = 0;
+    size_t buffer_bytes = 0;
+    uintptr_t arena_start = 0;
+
+    if (model == NULL) {
+        return false;
+    }
+    memset(model, 0, sizeof(*model));
+
+    if (data == NULL || arena == NULL || size < sizeof(ModelHeader) || ((uintptr_t)data & 3u) != 0) {
+        handle_error("Invalid model blob or tensor arena");
+        return false;
+    }
+
+    if (header->magic != INFERENCE_MODEL_MAGIC || header->version != INFERENCE_MODEL_VERSION ||
+        header->layer_count == 0 || header->layer_count > INFERENCE_MAX_LAYERS || header->input_scale <= 0.0f) {
+        handle_error("Unsupported model blob");
+        return false;
+    }
+
+    length = header->input_length;
+    channels = header->input_channels;
+    scale = header->input_scale;
+    largest_tensor = (size_t)length * channels;
+    cursor = data + sizeof(ModelHeader);
+
+    for (uint16_t i = 0; i < header->layer_count; i++) {
+        const ModelLayerHeader* layer_header = (const ModelLayerHeader*)cursor;
+        InferenceLayer* layer = &model->layers[i];
+
+        if (cursor > end || (size_t)(end - cursor) < sizeof(ModelLayerHeader) ||
+            (size_t)(end - cursor) - sizeof(ModelLayerHeader) < layer_header->payload_size) {
+            handle_error("Truncated model blob");
+            return false;
+        }
+
+        if (!resolve_layer(layer, layer_header, cursor + sizeof(ModelLayerHeader), &length, &channels, &scale)) {
+            handle_error("Malformed model layer");
+            return false;
+        }
+
+        if ((size_t)length * channels > largest_tensor) {
+            largest_tensor = (size_t)length * channels;
+        }
+        if (scratch_floats(layer) > largest_scratch) {
+            largest_scratch = scratch_floats(layer);
+        }
+        if (accumulator_count(layer) > largest_accumulators) {
+            largest_accumulators = accumulator_count(layer);
+        }
+        cursor = skip_padded(cursor, end, sizeof(ModelLayerHeader) + layer_header->payload_size);
+    }
+
+    if ((size_t)length * channels != header->output_length) {
+        handle_error("Model output size does not match its last layer");
+        return false;
+    }
+
+    arena_start = ((uintptr_t)arena + 3u) & ~(uintptr_t)3u;
+    buffer_bytes = align4(largest_tensor);
+    model->arena_used = (size_t)(arena_start - (uintptr_t)arena) + 2 * buffer_bytes +
+                        largest_accumulators * sizeof(int32_t) + largest_scratch * sizeof(float);
+    if (model->arena_used > arena_size) {
+        handle_error("Tensor arena is too small for the model");
+        return false;
+    }
+
+    model->buffers[0] = (int8_t*)arena_start;
+    model->buffers[1] = (int8_t*)(arena_start + buffer_bytes);
+    model->accumulators = (int32_t*)(arena_start + 2 * buffer_bytes);
+    model->scratch = (float*)(model->accumulators + largest_accumulators);
+    model->kernels = inference_kernels_get(KERNEL_VARIANT_AUTO);
+    model->data = data;
+    model->size = size;
+    model->layer_count = (uint8_t)header->layer_count;
+    model->input_length = header->input_length;
+    model->input_channels = header->input_channels;
+    model->output_length = header->output_length;
+    model->input_scale = header->input_scale;
+    model->loaded = true;
+    return true;
+}
+
+bool inference_model_set_kernels(InferenceModel* model, KernelVariant variant) {
+    const InferenceKernels* kernels = inference_kernels_get(variant);
+
+    if (model == NULL || kernels == NULL) {
+        return false;
+    }
+
+    model->kernels = kernels;
+    return true;
+}
+
+bool inference_model_run(InferenceModel* model, const float* input, size_t input_length, float* output, size_t output_length) {
+    size_t expected_input = 0;
+    uint8_t current = 0;
+    const InferenceLayer* last = NULL;
+
+    if (model == NULL || !model->loaded || input == NULL || output == NULL) {
+        return false;
+    }
+
+    expected_input = (size_t)model->input_length * model->input_channels;
+    if (input_length != expected_input || output_length < model->output_length) {
+        return false;
+    }
+
+    for (size_t i = 0; i < input_length; i++) {
+        model->buffers[0][i] = inference_quantize(input[i], model->input_scale);
+    }
+
+    for (uint8_t i = 0; i < model->layer_count; i++) {
+        const InferenceLayer* layer = &model->layers[i];
+        const int8_t* source = model->buffers[current];
+        int8_t* destination = model->buffers[current ^ 1];
+
+        switch (layer->type) {
+        case LAYER_DENSE:
+            run_dense(model, layer, source, destination);
+            break;
+        case LAYER_CONV1D:
+            run_conv1d(model, layer, source, destination);
+            break;
+        case LAYER_GRU:
+            run_gru(model, layer, source, destination);
+            break;
+        case LAYER_LSTM:
+            run_lstm(model, layer, source, destination);
+            break;
+        }
+        current ^= 1;
+    }
+
+    last = &model->layers[model->layer_count - 1];
+    for (uint16_t i = 0; i < model->output_length; i++) {
+        output[i] = model->buffers[current][i] * last->out_scale;
+    }
+    return true;
+}
@@ -0,0 +1,163 @@
+#ifndef INFERENCE_ENGINE_H
+#define INFERENCE_ENGINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "inference_kernels.h"
+
+/**
+ * \brief Magic number of a model blob ("OSML" in file order).
+ */
+#define INFERENCE_MODEL_MAGIC 0x4c4d534fu
+
+/**
+ * \brief Version of the model blob format understood by the engine.
+ */
+#define INFERENCE_MODEL_VERSION 1
+
+/**
+ * \brief Maximum number of layers in a model.
+ */
+#define INFERENCE_MAX_LAYERS 8
+
+/**
+ * \brief Layer kinds supported by the engine.
+ */
+typedef enum {
+    LAYER_DENSE = 1,   ///< Fully connected layer over the flattened input.
+    LAYER_CONV1D = 2,  ///< Valid 1D convolution over a channels-last sequence.
+    LAYER_GRU = 3,     ///< GRU returning its last hidden state.
+    LAYER_LSTM = 4     ///< LSTM returning its last hidden state.
+} LayerType;
+
+/**
+ * \brief Header of a model blob.
+ *
+ * A blob is this header followed by `layer_count` layers, each a
+ * ModelLayerHeader and its payload. All multi-byte values are little-endian
+ * and every array starts on a 4-byte boundary.
+ */
+typedef struct {
+    uint32_t magic;           ///< INFERENCE_MODEL_MAGIC.
+    uint16_t version;         ///< INFERENCE_MODEL_VERSION.
+    uint16_t layer_count;     ///< Number of layers.
+    uint16_t input_length;    ///< Sequence length of the input.
+    uint16_t input_channels;  ///< Channels per input step.
+    uint16_t output_length;   ///< Number of outputs of the last layer.
+    uint16_t reserved;
+    float input_scale;        ///< Quantization scale of the input tensor.
+    uint32_t reserved2;
+} ModelHeader;
+
+/**
+ * \brief Header of one layer in a model blob.
+ *
+ * Payloads, each array padded to 4 bytes:
+ * - dense: int8 weights[out][in], float scales[out], int32 bias[out];
+ * - conv1d: int8 weights[out][kernel][in], float scales[out], int32 bias[out];
+ * - GRU (G = 3) and LSTM (G = 4): int8 input weights[G*out][in],
+ *   int8 recurrent weights[G*out][out], float input scales[G*out],
+ *   float recurrent scales[G*out], int32 input bias[G*out],
+ *   int32 recurrent bias[G*out]. Gates are ordered z, r, n (GRU) and
+ *   i, f, g, o (LSTM).
+ *
+ * Weights are symmetric int8 with one scale per output channel, and a bias
+ * is quantized with the product of its input scale and channel scale.
+ * Recurrent layers use the fixed scale 1/127 for their hidden state.
+ */
+typedef struct {
+    uint8_t type;          ///< LayerType.
+    uint8_t activation;    ///< ActivationType, ignored by recurrent layers.
+    uint16_t reserved;
+    uint16_t in_dim;       ///< Input features (dense) or channels (others).
+    uint16_t out_dim;      ///< Output features, channels or hidden size.
+    uint16_t kernel;       ///< Convolution kernel size.
+    uint16_t stride;       ///< Convolution stride.
+    float output_scale;    ///< Quantization scale of the layer output.
+    uint32_t payload_size; ///< Size of the payload following the header.
+    uint32_t reserved2;
+} ModelLayerHeader;
+
+/**
+ * \brief One layer resolved against a loaded blob.
+ */
+typedef struct {
+    LayerType type;
+    ActivationType activation;
+    uint16_t in_dim;
+    uint16_t out_dim;
+    uint16_t kernel;
+    uint16_t stride;
+    uint16_t in_length;              ///< Sequence length of the layer input.
+    uint16_t out_length;             ///< Sequence length of the layer output.
+    float in_scale;                  ///< Scale of the layer input.
+    float out_scale;                 ///< Scale of the layer output.
+    const int8_t* weights;           ///< Input weights inside the blob.
+    const float* scales;             ///< Per-channel scales of the input weights.
+    const int32_t* bias;             ///< Bias of the input weights.
+    const int8_t* recurrent_weights; ///< Recurrent weights, recurrent layers only.
+    const float* recurrent_scales;   ///< Per-channel scales of the recurrent weights.
+    const int32_t* recurrent_bias;   ///< Bias of the recurrent weights.
+} InferenceLayer;
+
+/**
+ * \brief Model loaded for inference.
+ *
+ * Weights stay in the blob; only activations and recurrent state are
+ * placed in the caller's arena, so inference never touches the heap.
+ */
+typedef struct {
+    const uint8_t* data;                      ///< Model blob.
+    size_t size;                              ///< Size of the blob in bytes.
+    InferenceLayer layers[INFERENCE_MAX_LAYERS]; ///< Resolved layers.
+    uint8_t layer_count;                      ///< Number of layers.
+    uint16_t input_length;                    ///< Sequence length of the input.
+    uint16_t input_channels;                  ///< Channels per input step.
+    uint16_t output_length;                   ///< Number of outputs.
+    float input_scale;                        ///< Quantization scale of the input.
+    int8_t* buffers[2];                       ///< Ping-pong activation buffers in the arena.
+    int32_t* accumulators;                    ///< Matrix-vector results in the arena.
+    float* scratch;                           ///< Recurrent gate and cell state in the arena.
+    size_t arena_used;                        ///< Bytes of the arena reserved by the model.
+    const InferenceKernels* kernels;          ///< Kernel table selected for the running CPU.
+    bool loaded;                              ///< Whether the model passed validation.
+} InferenceModel;
+
+/**
+ * \brief Validates a model blob and plans its tensors inside an arena.
+ *
+ * \param model Model to initialize.
+ * \param data Model blob, 4-byte aligned; it must outlive the model.
+ * \param size Size of the blob in bytes.
+ * \param arena Memory for activations and recurrent state.
+ * \param arena_size Size of the arena in bytes.
+ * The fastest kernel variant supported by the CPU is selected here, once.
+ *
+ * \return False if the blob is malformed or the arena is too small.
+ */
+bool inference_model_load(InferenceModel* model, const uint8_t* data, size_t size, uint8_t* arena, size_t arena_size);
+
+/**
+ * \brief Forces the kernel variant used by a loaded model.
+ *
+ * \param model Loaded model.
+ * \param variant Variant to use, KERNEL_VARIANT_AUTO for the best supported one.
+ * \return False if the variant is not available on this CPU or build.
+ */
+bool inference_model_set_kernels(InferenceModel* model, KernelVariant variant);
+
+/**
+ * \brief Runs one inference.
+ *
+ * \param model Loaded model.
+ * \param input Input values, input_length * input_channels of them, step-major.
+ * \param input_length Number of input values.
+ * \param output Destination of the dequantized outputs.
+ * \param output_length Capacity of the output array.
+ * \return False if the model is not loaded or the sizes do not match.
+ */
+bool inference_model_run(InferenceModel* model, const float* input, size_t input_length, float* output, size_t output_length);
+
+#endif // INFERENCE_ENGINE_H
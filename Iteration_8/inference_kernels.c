@@ -0,0 +1,408 @@
+#include "inference_kernels.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define INFERENCE_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define TANH_SATURATION 4.97f ///< Beyond this magnitude tanh rounds to +/-1 in float.
+
+float inference_tanh(float x) {
+    float x2 = 0.0f;
+
+    if (x > TANH_SATURATION) {
+        return 1.0f;
+    }
+    if (x < -TANH_SATURATION) {
+        return -1.0f;
+    }
+
+    // [7/6] Pade approximant, so the engine does not depend on libm.
+    x2 = x * x;
+    return x * (135135.0f + x2 * (17325.0f + x2 * (378.0f + x2))) /
+           (135135.0f + x2 * (62370.0f + x2 * (3150.0f + x2 * 28.0f)));
+}
+
+float inference_sigmoid(float x) {
+    return 0.5f * (1.0f + inference_tanh(0.5f * x));
+}
+
+float inference_activate(ActivationType activation, float value) {
+    switch (activation) {
+    case ACTIVATION_RELU:
+        return value > 0.0f ? value : 0.0f;
+    case ACTIVATION_TANH:
+        return inference_tanh(value);
+    case ACTIVATION_SIGMOID:
+        return inference_sigmoid(value);
+    case ACTIVATION_NONE:
+    default:
+        return value;
+    }
+}
+
+int8_t inference_quantize(float value, float scale) {
+    float scaled = value / scale;
+
+    if (scaled > 127.0f) {
+        scaled = 127.0f;
+    } else if (scaled < -127.0f) {
+        scaled = -127.0f;
+    }
+    return (int8_t)(int)(scaled + (scaled >= 0.0f ? 0.5f : -0.5f));
+}
+
+static void matvec_s8_scalar(const int8_t* weights, size_t rows, size_t columns,
+                             const int8_t* input, const int32_t* bias, int32_t* output) {
+    for (size_t r = 0; r < rows; r++) {
+        const int8_t* row = weights + r * columns;
+        int32_t sum = bias[r];
+
+        for (size_t c = 0; c < columns; c++) {
+            sum += (int32_t)row[c] * (int32_t)input[c];
+        }
+        output[r] = sum;
+    }
+}
+
+static void requantize_scalar(const int32_t* accumulators, size_t count, float input_scale,
+                              const float* scales, ActivationType activation, float output_scale, int8_t* output) {
+    for (size_t i = 0; i < count; i++) {
+        float value = (float)accumulators[i] * input_scale * scales[i];
+        output[i] = inference_quantize(inference_activate(activation, value), output_scale);
+    }
+}
+
+static void activate_scalar(ActivationType activation, float* values, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        values[i] = inference_activate(activation, values[i]);
+    }
+}
+
+#ifdef INFERENCE_KERNELS_X86
+
+/*
+ * The x86 variants are compiled with per-function target attributes, so the
+ * rest of the tree keeps the baseline instruction set and the best variant is
+ * chosen at run time. They evaluate the same float expressions in the same
+ * order as the scalar code, without FMA contraction, so results are identical.
+ */
+
+__attribute__((target("sse4.1")))
+static int32_t horizontal_sum_sse41(__m128i sum) {
+    sum = _mm_hadd_epi32(sum, sum);
+    sum = _mm_hadd_epi32(sum, sum);
+    return _mm_cvtsi128_si32(sum);
+}
+
+__attribute__((target("sse4.1")))
+static void matvec_s8_sse41(const int8_t* weights, size_t rows, size_t columns,
+                            const int8_t* input, const int32_t* bias, int32_t* output) {
+    // Rows shorter than one vector gain nothing from the horizontal reduction.
+    if (columns < 8) {
+        matvec_s8_scalar(weights, rows, columns, input, bias, output);
+        return;
+    }
+
+    for (size_t r = 0; r < rows; r++) {
+        const int8_t* row = weights + r * columns;
+        __m128i sum = _mm_setzero_si128();
+        size_t c = 0;
+        int32_t total = 0;
+
+        for (; c + 8 <= columns; c += 8) {
+            __m128i w = _mm_cvtepi8_epi16(_mm_loadl_epi64((const __m128i*)(row + c)));
+            __m128i x = _mm_cvtepi8_epi16(_mm_loadl_epi64((const __m128i*)(input + c)));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(w, x));
+        }
+
+        total = bias[r] + horizontal_sum_sse41(sum);
+        for (; c < columns; c++) {
+            total += (int32_t)row[c] * (int32_t)input[c];
+        }
+        output[r] = total;
+    }
+}
+
+__attribute__((target("sse4.1")))
+static __m128 tanh_sse41(__m128 x) {
+    const __m128 limit = _mm_set1_ps(TANH_SATURATION);
+    __m128 above = _mm_cmpgt_ps(x, limit);
+    __m128 below = _mm_cmplt_ps(x, _mm_sub_ps(_mm_setzero_ps(), limit));
+    __m128 x2 = _mm_mul_ps(x, x);
+    __m128 numerator = _mm_add_ps(_mm_set1_ps(378.0f), x2);
+    __m128 denominator = _mm_mul_ps(x2, _mm_set1_ps(28.0f));
+    __m128 result;
+
+    numerator = _mm_add_ps(_mm_set1_ps(17325.0f), _mm_mul_ps(x2, numerator));
+    numerator = _mm_add_ps(_mm_set1_ps(135135.0f), _mm_mul_ps(x2, numerator));
+    numerator = _mm_mul_ps(x, numerator);
+    denominator = _mm_add_ps(_mm_set1_ps(3150.0f), denominator);
+    denominator = _mm_add_ps(_mm_set1_ps(62370.0f), _mm_mul_ps(x2, denominator));
+    denominator = _mm_add_ps(_mm_set1_ps(135135.0f), _mm_mul_ps(x2, denominator));
+    result = _mm_div_ps(numerator, denominator);
+
+    result = _mm_blendv_ps(result, _mm_set1_ps(1.0f), above);
+    return _mm_blendv_ps(result, _mm_set1_ps(-1.0f), below);
+}
+
+__attribute__((target("sse4.1")))
+static __m128 activate_sse41(ActivationType activation, __m128 values) {
+    const __m128 half = _mm_set1_ps(0.5f);
+
+    switch (activation) {
+    case ACTIVATION_RELU:
+        return _mm_and_ps(values, _mm_cmpgt_ps(values, _mm_setzero_ps()));
+    case ACTIVATION_TANH:
+        return tanh_sse41(values);
+    case ACTIVATION_SIGMOID:
+        return _mm_mul_ps(half, _mm_add_ps(_mm_set1_ps(1.0f), tanh_sse41(_mm_mul_ps(half, values))));
+    case ACTIVATION_NONE:
+    default:
+        return values;
+    }
+}
+
+__attribute__((target("sse4.1")))
+static __m128i quantize_sse41(__m128 values, __m128 output_scale) {
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    __m128 scaled = _mm_div_ps(values, output_scale);
+
+    scaled = _mm_min_ps(_mm_max_ps(scaled, _mm_set1_ps(-127.0f)), _mm_set1_ps(127.0f));
+    // Round half away from zero: add 0.5 with the sign of the value, then truncate.
+    scaled = _mm_add_ps(scaled, _mm_or_ps(_mm_set1_ps(0.5f), _mm_and_ps(scaled, sign_mask)));
+    return _mm_cvttps_epi32(scaled);
+}
+
+__attribute__((target("sse4.1")))
+static void requantize_sse41(const int32_t* accumulators, size_t count, float input_scale,
+                             const float* scales, ActivationType activation, float output_scale, int8_t* output) {
+    const __m128 in_scale = _mm_set1_ps(input_scale);
+    const __m128 out_scale = _mm_set1_ps(output_scale);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 value = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(accumulators + i)));
+        __m128i quantized;
+        int32_t packed = 0;
+
+        value = _mm_mul_ps(_mm_mul_ps(value, in_scale), _mm_loadu_ps(scales + i));
+        quantized = quantize_sse41(activate_sse41(activation, value), out_scale);
+        quantized = _mm_packs_epi32(quantized, quantized);
+        quantized = _mm_packs_epi16(quantized, quantized);
+        packed = _mm_cvtsi128_si32(quantized);
+        memcpy(output + i, &packed, sizeof(packed));
+    }
+
+    requantize_scalar(accumulators + i, count - i, input_scale, scales + i, activation, output_scale, output + i);
+}
+
+__attribute__((target("sse4.1")))
+static void activate_sse41_values(ActivationType activation, float* values, size_t count) {
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(values + i, activate_sse41(activation, _mm_loadu_ps(values + i)));
+    }
+    activate_scalar(activation, values + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void matvec_s8_avx2(const int8_t* weights, size_t rows, size_t columns,
+                           const int8_t* input, const int32_t* bias, int32_t* output) {
+    if (columns < 16) {
+        matvec_s8_sse41(weights, rows, columns, input, bias, output);
+        return;
+    }
+
+    for (size_t r = 0; r < rows; r++) {
+        const int8_t* row = weights + r * columns;
+        __m256i sum = _mm256_setzero_si256();
+        __m128i folded;
+        size_t c = 0;
+        int32_t total = 0;
+
+        for (; c + 16 <= columns; c += 16) {
+            __m256i w = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(row + c)));
+            __m256i x = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(input + c)));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(w, x));
+        }
+
+        folded = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        if (c + 8 <= columns) {
+            __m128i w = _mm_cvtepi8_epi16(_mm_loadl_epi64((const __m128i*)(row + c)));
+            __m128i x = _mm_cvtepi8_epi16(_mm_loadl_epi64((const __m128i*)(input + c)));
+            folded = _mm_add_epi32(folded, _mm_madd_epi16(w, x));
+            c += 8;
+        }
+        folded = _mm_hadd_epi32(folded, folded);
+        folded = _mm_hadd_epi32(folded, folded);
+        total = bias[r] + _mm_cvtsi128_si32(folded);
+        for (; c < columns; c++) {
+            total += (int32_t)row[c] * (int32_t)input[c];
+        }
+        output[r] = total;
+    }
+}
+
+__attribute__((target("avx2")))
+static __m256 tanh_avx2(__m256 x) {
+    const __m256 limit = _mm256_set1_ps(TANH_SATURATION);
+    __m256 above = _mm256_cmp_ps(x, limit, _CMP_GT_OQ);
+    __m256 below = _mm256_cmp_ps(x, _mm256_sub_ps(_mm256_setzero_ps(), limit), _CMP_LT_OQ);
+    __m256 x2 = _mm256_mul_ps(x, x);
+    __m256 numerator = _mm256_add_ps(_mm256_set1_ps(378.0f), x2);
+    __m256 denominator = _mm256_mul_ps(x2, _mm256_set1_ps(28.0f));
+    __m256 result;
+
+    numerator = _mm256_add_ps(_mm256_set1_ps(17325.0f), _mm256_mul_ps(x2, numerator));
+    numerator = _mm256_add_ps(_mm256_set1_ps(135135.0f), _mm256_mul_ps(x2, numerator));
+    numerator = _mm256_mul_ps(x, numerator);
+    denominator = _mm256_add_ps(_mm256_set1_ps(3150.0f), denominator);
+    denominator = _mm256_add_ps(_mm256_set1_ps(62370.0f), _mm256_mul_ps(x2, denominator));
+    denominator = _mm256_add_ps(_mm256_set1_ps(135135.0f), _mm256_mul_ps(x2, denominator));
+    result = _mm256_div_ps(numerator, denominator);
+
+    result = _mm256_blendv_ps(result, _mm256_set1_ps(1.0f), above);
+    return _mm256_blendv_ps(result, _mm256_set1_ps(-1.0f), below);
+}
+
+__attribute__((target("avx2")))
+static __m256 activate_avx2(ActivationType activation, __m256 values) {
+    const __m256 half = _mm256_set1_ps(0.5f);
+
+    switch (activation) {
+    case ACTIVATION_RELU:
+        return _mm256_and_ps(values, _mm256_cmp_ps(values, _mm256_setzero_ps(), _CMP_GT_OQ));
+    case ACTIVATION_TANH:
+        return tanh_avx2(values);
+    case ACTIVATION_SIGMOID:
+        return _mm256_mul_ps(half, _mm256_add_ps(_mm256_set1_ps(1.0f), tanh_avx2(_mm256_mul_ps(half, values))));
+    case ACTIVATION_NONE:
+    default:
+        return values;
+    }
+}
+
+__attribute__((target("avx2")))
+static void requantize_avx2(const int32_t* accumulators, size_t count, float input_scale,
+                            const float* scales, ActivationType activation, float output_scale, int8_t* output) {
+    const __m256 in_scale = _mm256_set1_ps(input_scale);
+    const __m256 out_scale = _mm256_set1_ps(output_scale);
+    const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256 value = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(accumulators + i)));
+        __m128i quantized;
+        __m256i rounded;
+
+        value = _mm256_mul_ps(_mm256_mul_ps(value, in_scale), _mm256_loadu_ps(scales + i));
+        value = _mm256_div_ps(activate_avx2(activation, value), out_scale);
+        value = _mm256_min_ps(_mm256_max_ps(value, _mm256_set1_ps(-127.0f)), _mm256_set1_ps(127.0f));
+        value = _mm256_add_ps(value, _mm256_or_ps(_mm256_set1_ps(0.5f), _mm256_and_ps(value, sign_mask)));
+        rounded = _mm256_cvttps_epi32(value);
+
+        quantized = _mm_packs_epi32(_mm256_castsi256_si128(rounded), _mm256_extracti128_si256(rounded, 1));
+        quantized = _mm_packs_epi16(quantized, quantized);
+        _mm_storel_epi64((__m128i*)(void*)(output + i), quantized);
+    }
+
+    requantize_sse41(accumulators + i, count - i, input_scale, scales + i, activation, output_scale, output + i);
+}
+
+__attribute__((target("avx2")))
+static void activate_avx2_values(ActivationType activation, float* values, size_t count) {
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(values + i, activate_avx2(activation, _mm256_loadu_ps(values + i)));
+    }
+    activate_sse41_values(activation, values + i, count - i);
+}
+
+static const InferenceKernels sse41_kernels = {
+    KERNEL_VARIANT_SSE41, "sse4.1", matvec_s8_sse41, requantize_sse41, activate_sse41_values
+};
+
+static const InferenceKernels avx2_kernels = {
+    KERNEL_VARIANT_AVX2, "avx2", matvec_s8_avx2, requantize_avx2, activate_avx2_values
+};
+
+#endif // INFERENCE_KERNELS_X86
+
+#if defined(__ARM_NEON)
+
+static void matvec_s8_neon(const int8_t* weights, size_t rows, size_t columns,
+                           const int8_t* input, const int32_t* bias, int32_t* output) {
+    for (size_t r = 0; r < rows; r++) {
+        const int8_t* row = weights + r * columns;
+        int32x4_t sum = vdupq_n_s32(0);
+        int32x2_t pair;
+        size_t c = 0;
+        int32_t total = 0;
+
+        // Each half is widened separately, so -128 * -128 products cannot overflow int16 pairs.
+        for (; c + 16 <= columns; c += 16) {
+            int8x16_t w = vld1q_s8(row + c);
+            int8x16_t x = vld1q_s8(input + c);
+            sum = vpadalq_s16(sum, vmull_s8(vget_low_s8(w), vget_low_s8(x)));
+            sum = vpadalq_s16(sum, vmull_s8(vget_high_s8(w), vget_high_s8(x)));
+        }
+
+        pair = vadd_s32(vget_low_s32(sum), vget_high_s32(sum));
+        total = bias[r] + vget_lane_s32(vpadd_s32(pair, pair), 0);
+        for (; c < columns; c++) {
+            total += (int32_t)row[c] * (int32_t)input[c];
+        }
+        output[r] = total;
+    }
+}
+
+// ARMv7 NEON has no exact float division, so activations stay scalar to keep results identical.
+static const InferenceKernels neon_kernels = {
+    KERNEL_VARIANT_NEON, "neon", matvec_s8_neon, requantize_scalar, activate_scalar
+};
+
+#endif // __ARM_NEON
+
+static const InferenceKernels scalar_kernels = {
+    KERNEL_VARIANT_SCALAR, "scalar", matvec_s8_scalar, requantize_scalar, activate_scalar
+};
+
+const InferenceKernels* inference_kernels_get(KernelVariant variant) {
+    switch (variant) {
+    case KERNEL_VARIANT_AUTO:
+#if defined(INFERENCE_KERNELS_X86)
+        if (__builtin_cpu_supports("avx2")) {
+            return &avx2_kernels;
+        }
+        if (__builtin_cpu_supports("sse4.1")) {
+            return &sse41_kernels;
+        }
+#elif defined(__ARM_NEON)
+        return &neon_kernels;
+#endif
+        return &scalar_kernels;
+    case KERNEL_VARIANT_SCALAR:
+        return &scalar_kernels;
+#if defined(INFERENCE_KERNELS_X86)
+    case KERNEL_VARIANT_SSE41:
+        return __builtin_cpu_supports("sse4.1") ? &sse41_kernels : NULL;
+    case KERNEL_VARIANT_AVX2:
+        return __builtin_cpu_supports("avx2") ? &avx2_kernels : NULL;
+#endif
+#if defined(__ARM_NEON)
+    case KERNEL_VARIANT_NEON:
+        return &neon_kernels;
+#endif
+    default:
+        return NULL;
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef INFERENCE_KERNELS_H
+#define INFERENCE_KERNELS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * \brief Activation applied to the output of dense and convolution layers.
+ */
+typedef enum {
+    ACTIVATION_NONE = 0,
+    ACTIVATION_RELU = 1,
+    ACTIVATION_TANH = 2,
+    ACTIVATION_SIGMOID = 3
+} ActivationType;
+
+/**
+ * \brief Instruction set a kernel table is built for.
+ */
+typedef enum {
+    KERNEL_VARIANT_AUTO,    ///< Best variant supported by the running CPU.
+    KERNEL_VARIANT_SCALAR,  ///< Portable C.
+    KERNEL_VARIANT_SSE41,   ///< x86 SSE4.1.
+    KERNEL_VARIANT_AVX2,    ///< x86 AVX2.
+    KERNEL_VARIANT_NEON     ///< ARM NEON.
+} KernelVariant;
+
+/**
+ * \brief Int8 matrix-vector product with a 32-bit bias.
+ *
+ * Computes output[r] = bias[r] + sum(weights[r][c] * input[c]) for a
+ * row-major matrix whose rows are `columns` values apart.
+ */
+typedef void (*MatVecS8Kernel)(const int8_t* weights, size_t rows, size_t columns,
+                               const int8_t* input, const int32_t* bias, int32_t* output);
+
+/**
+ * \brief Converts accumulators to real values, activates and requantizes them.
+ *
+ * Computes output[i] = quantize(activation(accumulators[i] * input_scale * scales[i]), output_scale),
+ * rounding half away from zero and saturating to [-127, 127].
+ */
+typedef void (*RequantizeKernel)(const int32_t* accumulators, size_t count, float input_scale,
+                                 const float* scales, ActivationType activation, float output_scale, int8_t* output);
+
+/**
+ * \brief Applies an activation to float values in place.
+ */
+typedef void (*ActivateKernel)(ActivationType activation, float* values, size_t count);
+
+/**
+ * \brief Table of the hot loops of the inference engine for one instruction set.
+ *
+ * Every variant evaluates the same float expressions in the same order, so
+ * a model gives bit-identical predictions whichever table the CPU selects
+ * (as long as the build does not enable FMA contraction).
+ */
+typedef struct {
+    KernelVariant variant;     ///< Instruction set of the table.
+    const char* name;          ///< Human-readable variant name.
+    MatVecS8Kernel matvec_s8;  ///< Int8 matrix-vector product.
+    RequantizeKernel requantize; ///< Activation and requantization of layer outputs.
+    ActivateKernel activate;   ///< Float activation of recurrent gates.
+} InferenceKernels;
+
+/**
+ * \brief Returns the kernel table of a variant.
+ *
+ * \param variant Requested variant; KERNEL_VARIANT_AUTO picks the best one
+ *        the running CPU supports.
+ * \return Kernel table, or NULL if the variant is not compiled in or not
+ *         supported by the CPU.
+ */
+const InferenceKernels* inference_kernels_get(KernelVariant variant);
+
+/**
+ * \brief Hyperbolic tangent approximation shared by all variants.
+ *
+ * \param x Input value.
+ * \return tanh(x) within about 1e-5.
+ */
+float inference_tanh(float x);
+
+/**
+ * \brief Logistic sigmoid derived from inference_tanh().
+ *
+ * \param x Input value.
+ * \return 1 / (1 + exp(-x)) within about 1e-5.
+ */
+float inference_sigmoid(float x);
+
+/**
+ * \brief Applies an activation to one value.
+ *
+ * \param activation Activation to apply.
+ * \param value Input value.
+ * \return Activated value.
+ */
+float inference_activate(ActivationType activation, float value);
+
+/**
+ * \brief Quantizes a value to symmetric int8.
+ *
+ * \param value Real value.
+ * \param scale Quantization scale.
+ * \return value / scale rounded half away from zero, saturated to [-127, 127].
+ */
+int8_t inference_quantize(float value, float scale);
+
+#endif // INFERENCE_KERNELS_H
@@ -0,0 +1,584 @@
+#include "lookahead_planner.h"
+
+#include <string.h>
+
+#include "error_handling.h"
+
+#define ENERGY_EPSILON_MJ 1e-4f
+
+/**
+ * \brief Outcome of simulating the battery over the horizon.
+ */
+typedef struct {
+    bool feasible;        ///< Whether no slot goes below its floor.
+    uint16_t failed_slot; ///< First slot below its floor when infeasible.
+    float overflow_mj;    ///< Harvest lost because the battery was full.
+    float min_margin_mj;  ///< Smallest distance between the charge and its floor.
+} Trajectory;
+
+static float absolute(float value) {
+    return value < 0.0f ? -value : value;
+}
+
+static uint32_t release_of(const LookaheadPlanner* planner, uint8_t task, uint32_t slot) {
+    return slot - slot % planner->tasks[task].period_slots;
+}
+
+static bool is_done_since(const LookaheadPlanner* planner, uint8_t task, uint32_t release) {
+    return planner->done_slot[task] != PLAN_NO_SLOT && planner->done_slot[task] >= release;
+}
+
+/**
+ * \brief Tells whether a job at slot t may draw the battery below the reserve.
+ *
+ * A critical job may. So may the first job of a dependency of a critical
+ * job still pending at t, inside the window of that critical job; the other
+ * jobs of the dependency released in the same window do nothing for it. The
+ * extra job of an evaluation, if any, counts as planned.
+ */
+static bool job_draws_reserve(const LookaheadPlanner* planner, uint8_t task, uint16_t t, int extra_slot, int extra_task) {
+    uint32_t slot = planner->slot + t;
+
+    if (planner->tasks[task].critical) {
+        return true;
+    }
+    for (uint8_t c = 0; c < planner->task_count; c++) {
+        uint32_t release = 0;
+        uint16_t first = 0;
+        bool earlier = false;
+
+        if (!planner->tasks[c].critical || (planner->required_mask[c] & (1u << task)) == 0) {
+            continue;
+        }
+        release = release_of(planner, c, slot);
+        if (slot >= release + planner->tasks[c].deadline_slots || is_done_since(planner, c, release) ||
+            is_done_since(planner, task, release)) {
+            continue;
+        }
+        first = release > planner->slot ? (uint16_t)(release - planner->slot) : 0;
+        for (uint16_t k = first; k < t && !earlier; k++) {
+            earlier = (planner->plan[k] & (1u << task)) != 0 || (extra_task == task && extra_slot == k);
+        }
+        if (!earlier) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * \brief Tells whether a slot holds a job that may not draw the reserve.
+ */
+static bool holds_non_critical(const LookaheadPlanner* planner, uint16_t t, int extra_slot, int extra_task) {
+    uint32_t jobs = planner->plan[t] | (t == extra_slot ? 1u << extra_task : 0u);
+
+    if ((jobs & ~planner->critical_mask) != 0) {
+        return true;
+    }
+    for (uint8_t i = 0; i < planner->task_count; i++) {
+        if ((jobs & (1u << i)) != 0 && !job_draws_reserve(planner, i, t, extra_slot, extra_task)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * \brief Simulates the battery with the planned jobs and one optional extra job of extra_task.
+ *
+ * A slot holding a job that may not draw the reserve may not end below it;
+ * any other slot may not end below empty.
+ */
+static Trajectory evaluate(LookaheadPlanner* planner, int extra_slot, int extra_task) {
+    Trajectory result = {true, 0, 0.0f, planner->capacity_mj};
+    float charge = planner->charge_mj;
+
+    planner->evaluations++;
+    for (uint16_t t = 0; t < planner->horizon; t++) {
+        bool non_critical = false;
+        float net = charge + planner->forecast_mj[t] - planner->demand_mj[t];
+        float margin = 0.0f;
+
+        if (t == extra_slot) {
+            net -= planner->tasks[extra_task].energy_mj;
+        }
+        if (planner->plan[t] != 0 || t == extra_slot) {
+            non_critical = holds_non_critical(planner, t, extra_slot, extra_task);
+        }
+
+        margin = net - (non_critical ? planner->reserve_mj : 0.0f);
+        if (margin < -ENERGY_EPSILON_MJ) {
+            result.feasible = false;
+            result.failed_slot = t;
+            return result;
+        }
+        if (margin < result.min_margin_mj) {
+            result.min_margin_mj = margin;
+        }
+        if (net > planner->capacity_mj) {
+            result.overflow_mj += net - planner->capacity_mj;
+            net = planner->capacity_mj;
+        }
+        charge = net;
+    }
+    return result;
+}
+
+static void set_job(LookaheadPlanner* planner, uint8_t task, uint16_t t) {
+    planner->plan[t] |= 1u << task;
+    planner->demand_mj[t] += planner->tasks[task].energy_mj;
+}
+
+static void clear_job(LookaheadPlanner* planner, uint8_t task, uint16_t t) {
+    planner->plan[t] &= ~(1u << task);
+    planner->demand_mj[t] -= planner->tasks[task].energy_mj;
+    if (planner->plan[t] == 0) {
+        planner->demand_mj[t] = 0.0f;
+    }
+}
+
+/**
+ * \brief Tells whether the dependencies of a job released at `release` are met by slot t.
+ */
+static bool dependencies_met(const LookaheadPlanner* planner, uint8_t task, uint32_t release, uint16_t t) {
+    uint32_t dependencies = planner->tasks[task].dependency_mask;
+
+    for (uint8_t j = 0; j < planner->task_count; j++) {
+        bool met = false;
+
+        if ((dependencies & (1u << j)) == 0) {
+            continue;
+        }
+        met = is_done_since(planner, j, release);
+        for (uint16_t k = release > planner->slot ? (uint16_t)(release - planner->slot) : 0; !met && k <= t; k++) {
+            met = (planner->plan[k] & (1u << j)) != 0;
+        }
+        if (!met) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * \brief Drops planned jobs that completed already or whose dependencies are no longer planned.
+ */
+static void drop_unsupported_jobs(LookaheadPlanner* planner) {
+    bool changed = true;
+
+    while (changed) {
+        changed = false;
+        for (uint16_t t = 0; t < planner->horizon; t++) {
+            for (uint8_t i = 0; i < planner->task_count; i++) {
+                uint32_t release = 0;
+
+                if ((planner->plan[t] & (1u << i)) == 0) {
+                    continue;
+                }
+                release = release_of(planner, i, planner->slot + t);
+                if (planner->slot + t >= release + planner->tasks[i].deadline_slots ||
+                    is_done_since(planner, i, release) || !dependencies_met(planner, i, release, t)) {
+                    clear_job(planner, i, t);
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * \brief Shifts the plan to the new slot; slots entering the horizon have no forecast yet.
+ */
+static void shift_plan(LookaheadPlanner* planner, uint32_t slot) {
+    uint32_t shift = slot - planner->slot;
+
+    if (slot < planner->slot || shift >= planner->horizon) {
+        memset(planner->plan, 0, sizeof(planner->plan));
+        memset(planner->demand_mj, 0, sizeof(planner->demand_mj));
+        shift = planner->horizon;
+    } else if (shift > 0) {
+        size_t kept = planner->horizon - shift;
+
+        memmove(planner->plan, planner->plan + shift, kept * sizeof(planner->plan[0]));
+        memmove(planner->demand_mj, planner->demand_mj + shift, kept * sizeof(planner->demand_mj[0]));
+        memmove(planner->forecast_mj, planner->forecast_mj + shift, kept * sizeof(planner->forecast_mj[0]));
+        memset(planner->plan + kept, 0, shift * sizeof(planner->plan[0]));
+        memset(planner->demand_mj + kept, 0, shift * sizeof(planner->demand_mj[0]));
+    }
+
+    for (uint16_t t = (uint16_t)(planner->horizon - shift); t < planner->horizon; t++) {
+        planner->forecast_mj[t] = -1.0f;
+    }
+    planner->slot = slot;
+}
+
+/**
+ * \brief Frees the jobs whose window contains a slot with a new or changed forecast.
+ */
+static void release_changed_windows(LookaheadPlanner* planner, const float* forecast_mj) {
+    uint16_t changed_before[PLAN_MAX_HORIZON + 1];
+
+    changed_before[0] = 0;
+    for (uint16_t t = 0; t < planner->horizon; t++) {
+        float previous = planner->forecast_mj[t];
+        float current = forecast_mj[t] > 0.0f ? forecast_mj[t] : 0.0f;
+        float scale = previous > current ? previous : current;
+        bool changed = previous < 0.0f || absolute(current - previous) > PLAN_REPLAN_TOLERANCE * (scale > 1.0f ? scale : 1.0f);
+
+        changed_before[t + 1] = (uint16_t)(changed_before[t] + (changed ? 1 : 0));
+        planner->forecast_mj[t] = current;
+    }
+
+    for (uint16_t t = 0; t < planner->horizon; t++) {
+        for (uint8_t i = 0; i < planner->task_count; i++) {
+            uint32_t release = 0;
+            uint32_t end = 0;
+            uint16_t first = 0;
+
+            if ((planner->plan[t] & (1u << i)) == 0) {
+                continue;
+            }
+            release = release_of(planner, i, planner->slot + t);
+            end = release + planner->tasks[i].deadline_slots - planner->slot;
+            first = release > planner->slot ? (uint16_t)(release - planner->slot) : 0;
+            if (end > planner->horizon) {
+                end = planner->horizon;
+            }
+            if (changed_before[end] != changed_before[first]) {
+                clear_job(planner, i, t);
+            }
+        }
+    }
+}
+
+/**
+ * \brief Removes jobs until the trajectory is feasible, non-critical and late ones first.
+ */
+static void repair_plan(LookaheadPlanner* planner) {
+    Trajectory trajectory = evaluate(planner, -1, -1);
+
+    while (!trajectory.feasible) {
+        int victim_slot = -1;
+        int victim_task = -1;
+        bool victim_critical = true;
+
+        for (int t = trajectory.failed_slot; t >= 0; t--) {
+            for (uint8_t i = 0; i < planner->task_count; i++) {
+                bool critical = false;
+
+                if ((planner->plan[t] & (1u << i)) == 0) {
+                    continue;
+                }
+                critical = job_draws_reserve(planner, i, (uint16_t)t, -1, -1);
+                if (victim_task < 0 || (victim_critical && !critical)) {
+                    victim_slot = t;
+                    victim_task = i;
+                    victim_critical = critical;
+                }
+            }
+        }
+        if (victim_task < 0) {
+            return;
+        }
+        clear_job(planner, (uint8_t)victim_task, (uint16_t)victim_slot);
+        trajectory = evaluate(planner, -1, -1);
+    }
+}
+
+/**
+ * \brief Evicts the latest job planned before a slot that may not draw the reserve, to make room for one that may.
+ */
+static bool evict_non_critical(LookaheadPlanner* planner, uint16_t before) {
+    for (int t = (int)before - 1; t >= 0; t--) {
+        for (uint8_t i = 0; i < planner->task_count; i++) {
+            if ((planner->plan[t] & (1u << i)) != 0 && !job_draws_reserve(planner, i, (uint16_t)t, -1, -1)) {
+                clear_job(planner, i, (uint16_t)t);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * \brief Tells whether a job may draw the reserve in some slot of [first, last).
+ */
+static bool may_draw_reserve(const LookaheadPlanner* planner, uint8_t task, uint16_t first, uint16_t last) {
+    if ((planner->critical_mask & (1u << task)) == 0) {
+        return false;
+    }
+    for (uint16_t t = first; t < last; t++) {
+        if (job_draws_reserve(planner, task, t, -1, -1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * \brief Places one job in the best feasible slot of its window.
+ *
+ * \return True if the job was placed.
+ */
+static bool place_job(LookaheadPlanner* planner, uint8_t task, uint32_t release, float* overflow_mj) {
+    const PlanTask* plan_task = &planner->tasks[task];
+    uint16_t first = release > planner->slot ? (uint16_t)(release - planner->slot) : 0;
+    uint32_t end = release + plan_task->deadline_slots - planner->slot;
+    uint16_t last = (uint16_t)(end < planner->horizon ? end : planner->horizon);
+
+    for (;;) {
+        int best_slot = -1;
+        Trajectory best = {false, 0, 0.0f, 0.0f};
+
+        for (uint16_t t = first; t < last; t++) {
+            Trajectory trajectory;
+            float gain = 0.0f;
+            float best_gain = *overflow_mj - best.overflow_mj;
+
+            if (!dependencies_met(planner, task, release, t)) {
+                continue;
+            }
+            if (planner->evaluations >= planner->max_evaluations) {
+                planner->truncated = true;
+                return false;
+            }
+
+            trajectory = evaluate(planner, t, task);
+            if (!trajectory.feasible) {
+                continue;
+            }
+
+            // Harvest that would be wasted first, then the highest lowest charge.
+            gain = *overflow_mj - trajectory.overflow_mj;
+            if (best_slot < 0 || gain > best_gain + ENERGY_EPSILON_MJ ||
+                (gain > best_gain - ENERGY_EPSILON_MJ && trajectory.min_margin_mj > best.min_margin_mj + ENERGY_EPSILON_MJ)) {
+                best_slot = t;
+                best = trajectory;
+            }
+        }
+
+        if (best_slot >= 0) {
+            set_job(planner, task, (uint16_t)best_slot);
+            *overflow_mj = best.overflow_mj;
+            return true;
+        }
+        if (!may_draw_reserve(planner, task, first, last) || !evict_non_critical(planner, last)) {
+            return false;
+        }
+        *overflow_mj = evaluate(planner, -1, -1).overflow_mj;
+    }
+}
+
+static bool is_planned_in_window(const LookaheadPlanner* planner, uint8_t task, uint32_t release) {
+    uint16_t first = release > planner->slot ? (uint16_t)(release - planner->slot) : 0;
+    uint32_t end = release + planner->tasks[task].deadline_slots - planner->slot;
+
+    for (uint16_t t = first; t < end && t < planner->horizon; t++) {
+        if ((planner->plan[t] & (1u << task)) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * \brief Places every unplanned job released in the horizon, until nothing more fits.
+ */
+static void place_jobs(LookaheadPlanner* planner) {
+    float overflow_mj = evaluate(planner, -1, -1).overflow_mj;
+    bool placed = true;
+
+    // Dependents can only be placed after their dependencies, hence the passes.
+    for (uint8_t pass = 0; placed && pass < planner->task_count; pass++) {
+        placed = false;
+        for (uint8_t k = 0; k < planner->task_count; k++) {
+            uint8_t task = planner->order[k];
+            const PlanTask* plan_task = &planner->tasks[task];
+
+            for (uint32_t release = release_of(planner, task, planner->slot); release < planner->slot + planner->horizon;
+                 release += plan_task->period_slots) {
+                if (release + plan_task->deadline_slots <= planner->slot || is_done_since(planner, task, release) ||
+                    is_planned_in_window(planner, task, release)) {
+                    continue;
+                }
+                if (place_job(planner, task, release, &overflow_mj)) {
+                    placed = true;
+                }
+                if (planner->truncated) {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+bool lookahead_planner_init(LookaheadPlanner* planner, const PlanTask* tasks, uint8_t task_count, uint16_t horizon,
+                            float capacity_mj, float reserve_mj) {
+    uint32_t required[PLAN_MAX_TASKS];
+
+    if (planner == NULL || tasks == NULL || task_count == 0 || task_count > PLAN_MAX_TASKS || horizon == 0 ||
+        horizon > PLAN_MAX_HORIZON || !(capacity_mj > 0.0f) || reserve_mj < 0.0f || reserve_mj > capacity_mj) {
+        handle_error("Invalid lookahead planner parameters");
+        return false;
+    }
+
+    memset(planner, 0, sizeof(*planner));
+    for (uint8_t i = 0; i < task_count; i++) {
+        const PlanTask* task = &tasks[i];
+
+        if (task->period_slots == 0 || task->deadline_slots == 0 || task->deadline_slots > task->period_slots ||
+            task->energy_mj < 0.0f || (task->dependency_mask >> task_count) != 0) {
+            handle_error("Invalid planned task");
+            return false;
+        }
+        planner->tasks[i] = *task;
+        planner->done_slot[i] = PLAN_NO_SLOT;
+        required[i] = task->dependency_mask;
+    }
+
+    // Transitive dependencies, to reject cycles and propagate criticality.
+    for (uint8_t round = 0; round < task_count; round++) {
+        for (uint8_t i = 0; i < task_count; i++) {
+            for (uint8_t j = 0; j < task_count; j++) {
+                if ((required[i] & (1u << j)) != 0) {
+                    required[i] |= required[j];
+                }
+            }
+        }
+    }
+    for (uint8_t i = 0; i < task_count; i++) {
+        if ((required[i] & (1u << i)) != 0) {
+            handle_error("Planned task dependencies form a cycle");
+            return false;
+        }
+        if (tasks[i].critical) {
+            planner->critical_mask |= (1u << i) | required[i];
+        }
+        planner->required_mask[i] = required[i];
+    }
+
+    // Critical jobs claim energy first; cheap jobs then complete the most tasks per joule.
+    for (uint8_t i = 0; i < task_count; i++) {
+        uint8_t k = i;
+
+        while (k > 0) {
+            uint8_t previous = planner->order[k - 1];
+            bool critical = (planner->critical_mask & (1u << i)) != 0;
+            bool previous_critical = (planner->critical_mask & (1u << previous)) != 0;
+
+            if (previous_critical && !critical) {
+                break;
+            }
+            if (previous_critical == critical && tasks[previous].energy_mj <= tasks[i].energy_mj) {
+                break;
+            }
+            planner->order[k] = previous;
+            k--;
+        }
+        planner->order[k] = i;
+    }
+
+    planner->task_count = task_count;
+    planner->horizon = horizon;
+    planner->capacity_mj = capacity_mj;
+    planner->reserve_mj = reserve_mj;
+    planner->max_evaluations = PLAN_DEFAULT_MAX_EVALUATIONS;
+    for (uint16_t t = 0; t < PLAN_MAX_HORIZON; t++) {
+        planner->forecast_mj[t] = -1.0f;
+    }
+    return true;
+}
+
+void lookahead_planner_replan(LookaheadPlanner* planner, uint32_t slot, const float* forecast_mj, float charge_mj) {
+    if (planner == NULL || forecast_mj == NULL || planner->task_count == 0) {
+        handle_error("Cannot replan without a planner and a forecast");
+        return;
+    }
+
+    planner->evaluations = 0;
+    planner->truncated = false;
+    planner->charge_mj = charge_mj > 0.0f ? charge_mj : 0.0f;
+
+    shift_plan(planner, slot);
+    release_changed_windows(planner, forecast_mj);
+    drop_unsupported_jobs(planner);
+    repair_plan(planner);
+    drop_unsupported_jobs(planner);
+    place_jobs(planner);
+}
+
+bool lookahead_planner_job_done(const LookaheadPlanner* planner, uint8_t task) {
+    uint32_t release = 0;
+
+    if (planner == NULL || task >= planner->task_count) {
+        return true;
+    }
+
+    release = release_of(planner, task, planner->slot);
+    return planner->slot >= release + planner->tasks[task].deadline_slots || is_done_since(planner, task, release);
+}
+
+/**
+ * \brief Tells whether a critical task is in the last slot of a window it has not completed.
+ */
+static bool is_last_chance(const LookaheadPlanner* planner, uint8_t task) {
+    uint32_t release = release_of(planner, task, planner->slot);
+
+    return planner->tasks[task].critical && !lookahead_planner_job_done(planner, task) &&
+           planner->slot + 1 == release + planner->tasks[task].deadline_slots;
+}
+
+/**
+ * \brief Tells whether every dependency of a task missing since release runs now, planned or for it.
+ */
+static bool dependencies_run_now(const LookaheadPlanner* planner, uint8_t task, uint32_t release) {
+    for (uint8_t j = 0; j < planner->task_count; j++) {
+        if ((planner->tasks[task].dependency_mask & (1u << j)) == 0 || is_done_since(planner, j, release)) {
+            continue;
+        }
+        if ((planner->plan[0] & (1u << j)) == 0 && !dependencies_run_now(planner, j, release)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool lookahead_planner_should_run(const LookaheadPlanner* planner, uint8_t task) {
+    if (planner == NULL || task >= planner->task_count) {
+        return false;
+    }
+    if ((planner->plan[0] & (1u << task)) != 0) {
+        return true;
+    }
+    if ((planner->critical_mask & (1u << task)) == 0 || lookahead_planner_job_done(planner, task)) {
+        return false;
+    }
+
+    // Last chance for a critical job the forecast left no room for, and for the
+    // dependencies it still misses in its window, not for their other jobs.
+    for (uint8_t c = 0; c < planner->task_count; c++) {
+        uint32_t release = release_of(planner, c, planner->slot);
+
+        if ((c == task || ((planner->required_mask[c] & (1u << task)) != 0 && !is_done_since(planner, task, release))) &&
+            is_last_chance(planner, c) && dependencies_run_now(planner, c, release)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void lookahead_planner_complete(LookaheadPlanner* planner, uint8_t task) {
+    uint32_t end = 0;
+
+    if (planner == NULL || task >= planner->task_count) {
+        return;
+    }
+
+    planner->done_slot[task] = planner->slot;
+    end = release_of(planner, task, planner->slot) + planner->tasks[task].deadline_slots - planner->slot;
+    for (uint16_t t = 0; t < end && t < planner->horizon; t++) {
+        if ((planner->plan[t] & (1u << task)) != 0) {
+            clear_job(planner, task, t);
+        }
+    }
+}
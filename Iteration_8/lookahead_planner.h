@@ -0,0 +1,141 @@
+#ifndef LOOKAHEAD_PLANNER_H
+#define LOOKAHEAD_PLANNER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * \brief Maximum number of periodic tasks a planner handles.
+ */
+#define PLAN_MAX_TASKS 16
+
+/**
+ * \brief Maximum number of slots a plan looks ahead.
+ */
+#define PLAN_MAX_HORIZON 48
+
+/**
+ * \brief Marks a task that never completed.
+ */
+#define PLAN_NO_SLOT UINT32_MAX
+
+/**
+ * \brief Default bound on the battery trajectory evaluations of one replan.
+ *
+ * One evaluation costs O(horizon), so a replan costs at most
+ * O(max_evaluations * horizon) whatever the task set.
+ */
+#define PLAN_DEFAULT_MAX_EVALUATIONS 2048u
+
+/**
+ * \brief Relative forecast change of a slot that frees the jobs planned around it.
+ */
+#define PLAN_REPLAN_TOLERANCE 0.1f
+
+/**
+ * \brief Periodic task as seen by the planner.
+ *
+ * A task releases one job every period_slots slots, at the slots that are
+ * multiples of the period. The job may run in any slot of its window,
+ * [release, release + deadline_slots).
+ */
+typedef struct {
+    float energy_mj;           ///< Energy consumed by one job.
+    uint16_t period_slots;     ///< Slots between two releases, at least 1.
+    uint16_t deadline_slots;   ///< Window length, from 1 to period_slots.
+    bool critical;             ///< Whether jobs may draw the battery below its reserve.
+    uint32_t dependency_mask;  ///< Bit j set: task j must complete in this task's window first.
+} PlanTask;
+
+/**
+ * \brief Receding-horizon planner placing periodic jobs in forecast harvest.
+ *
+ * Each slot the planner receives the harvest forecast of the next `horizon`
+ * slots and the battery charge. Jobs are placed where the forecast battery
+ * trajectory stays feasible: non-critical jobs may not take the battery
+ * below its reserve, and nothing may take it below empty, which keeps the
+ * energy of planned critical jobs. A dependency of a critical task draws
+ * the reserve only for the job that precedes a pending critical job in its
+ * window; its other jobs are non-critical. Among feasible slots a job goes where it
+ * absorbs harvest the full battery would otherwise waste, then where the
+ * lowest charge of the horizon stays highest.
+ *
+ * Replanning is incremental: the previous plan is shifted and kept, except
+ * for the jobs whose window saw its forecast change by more than
+ * PLAN_REPLAN_TOLERANCE or that became infeasible.
+ */
+typedef struct {
+    PlanTask tasks[PLAN_MAX_TASKS];           ///< Planned tasks.
+    uint8_t task_count;                       ///< Number of tasks.
+    uint8_t order[PLAN_MAX_TASKS];            ///< Placement order: critical first, then cheapest.
+    uint32_t critical_mask;                   ///< Tasks that are critical or required by a critical task.
+    uint32_t required_mask[PLAN_MAX_TASKS];   ///< Direct and transitive dependencies of each task.
+    uint16_t horizon;                         ///< Slots covered by the plan.
+    float capacity_mj;                        ///< Battery capacity.
+    float reserve_mj;                         ///< Charge non-critical jobs may not use.
+    uint32_t max_evaluations;                 ///< Bound on trajectory evaluations per replan.
+    uint32_t slot;                            ///< Absolute slot of plan[0].
+    uint32_t plan[PLAN_MAX_HORIZON];          ///< Tasks planned in each slot, bit i for task i.
+    float demand_mj[PLAN_MAX_HORIZON];        ///< Energy of the jobs planned in each slot.
+    float forecast_mj[PLAN_MAX_HORIZON];      ///< Forecast the plan was solved with, negative if unknown.
+    float charge_mj;                          ///< Battery charge at the start of plan[0].
+    uint32_t done_slot[PLAN_MAX_TASKS];       ///< Slot of the latest completion of each task.
+    uint32_t evaluations;                     ///< Evaluations spent by the latest replan.
+    bool truncated;                           ///< Whether the latest replan ran out of evaluations.
+} LookaheadPlanner;
+
+/**
+ * \brief Validates a task set and clears the plan.
+ *
+ * \param planner Planner to initialize.
+ * \param tasks Periodic tasks; dependencies must not form a cycle.
+ * \param task_count Number of tasks, at most PLAN_MAX_TASKS.
+ * \param horizon Slots to look ahead, at most PLAN_MAX_HORIZON.
+ * \param capacity_mj Battery capacity.
+ * \param reserve_mj Battery charge kept for critical jobs.
+ * \return False if a parameter is out of range.
+ */
+bool lookahead_planner_init(LookaheadPlanner* planner, const PlanTask* tasks, uint8_t task_count, uint16_t horizon,
+                            float capacity_mj, float reserve_mj);
+
+/**
+ * \brief Moves the plan to a new slot and re-solves it.
+ *
+ * \param planner Initialized planner.
+ * \param slot Absolute index of the current slot.
+ * \param forecast_mj Harvest forecast of the `horizon` slots starting at `slot`.
+ * \param charge_mj Battery charge at the start of the slot.
+ */
+void lookahead_planner_replan(LookaheadPlanner* planner, uint32_t slot, const float* forecast_mj, float charge_mj);
+
+/**
+ * \brief Tells whether a task should run in the current slot.
+ *
+ * Besides the planned jobs, a critical job that was never placed runs in
+ * the last slot of its window whenever its dependencies allow, in case the
+ * forecast was too pessimistic, together with the dependencies it misses.
+ *
+ * \param planner Planner solved for the current slot.
+ * \param task Index of the task.
+ * \return True if the task should run now.
+ */
+bool lookahead_planner_should_run(const LookaheadPlanner* planner, uint8_t task);
+
+/**
+ * \brief Tells whether a task has nothing left to do in the current slot.
+ *
+ * \param planner Planner solved for the current slot.
+ * \param task Index of the task.
+ * \return True if the job of the current window completed, or no window is open.
+ */
+bool lookahead_planner_job_done(const LookaheadPlanner* planner, uint8_t task);
+
+/**
+ * \brief Records that a task completed in the current slot.
+ *
+ * \param planner Planner solved for the current slot.
+ * \param task Index of the task.
+ */
+void lookahead_planner_complete(LookaheadPlanner* planner, uint8_t task);
+
+#endif // LOOKAHEAD_PLANNER_H
@@ -1,190 +1,158 @@
-#include "energy_manager.h"
-#include "hardware_abstraction.h"
-#include "task_manager.h"
+#include "alloc_tracker.h"
+#include "error_handling.h"
+#include "fault_injection.h"
+#include "fleet.h"
+#include "run_profiler.h"
+#include "scheduler.h"
 
-#include <stdbool.h>
-#include <stdint.h>
-#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
 
-#define NUM_MEASURES 10
-
-static float temperature_values[NUM_MEASURES];
-static uint8_t measure_index = 0;
-static bool buffer_full = false;
-static uint8_t simulated_hour = 0;
-static uint8_t simulated_day = 0;
-static uint8_t tensor_arena[2048];
-static TinyMLModel ml_model;
-static uint8_t global_taskcounter = 0;
-
-static void incrementTaskCounter(const char* taskName) {
-    global_taskcounter++;
-    printf("%u tasks executed so far. Last task: %s\n", global_taskcounter, taskName);
+static void print_usage_and_exit(const char* program) {
+    printf("Invalid argument. Usage: %s [duration_days] [--checkpoint=FILE] [--checkpoint-policy=task|cycle]\n"
+           "       [--time-scale=X] [--history-days=N | --history-alpha=A] [--fault-at=N] [--fault-rate=P] [--fault-seed=S] [--fault-log=FILE]\n"
+           "       [--wind-trace=FILE] [--solar-trace=FILE] [--trace-loop] [--scheduler=POLICY] [--plan-horizon=H]\n"
+           "       [--goal=tasks|resilience] [--priorities=P,P,P] [--weights=W,W,W] [--battery=CAPACITY,CHARGE,RESERVE]\n"
+           "       [--solar=START,HOURS,OCCURRENCES,MW] [--wind=START,HOURS,OCCURRENCES,MW] [--summary]\n"
+           "       [--fleet=NODES] [--fleet-variation=V] [--seed=S] [--profile=FILE] [--power-model=ACTIVE_W,IDLE_W]\n"
+           "       [--calibrate-power] [--tickless]\n",
+           program);
+    exit(1);
 }
 
-static float compute_task_metric(const Task* task, const EnergySource* source, const GoalParameters* goal_params) {
-    float critical_bonus = 0.0f;
-    float weight_bonus = 0.0f;
+/**
+ * \brief Simulates options->fleet_nodes copies of the configured node and reports fleet statistics.
+ */
+static int run_fleet(SchedulerContext* prototype, const SchedulerOptions* options) {
+    Fleet fleet;
 
-    if (goal_params->goal == MAXIMIZE_RESILIENCE && task->critical) {
-        critical_bonus = 2.0f;
+    if (!fleet_init(&fleet, prototype, options->fleet_nodes, options->fleet_variation)) {
+        return 1;
     }
-
-    if (task->weight > 0) {
-        weight_bonus = 1.0f / (float)task->weight;
+    fleet_run(&fleet, (uint32_t)options->duration_days);
+    fleet_print_report(&fleet, stdout);
+    if (options->summary) {
+        fleet_print_summary(&fleet, stdout);
     }
-
-    return (float)task->priority + critical_bonus + source->predictability + weight_bonus;
+    fleet_free(&fleet);
+    return 0;
 }
 
-static int parse_duration_days(int argc, char* argv[], bool* infinite_loop) {
-    int duration_days = 1;
+/**
+ * \brief Fits the power model to the RAPL counters and prints it as a --power-model option.
+ */
+static int calibrate_power_model(void) {
+    PowerModel model;
 
-    *infinite_loop = false;
-    if (argc <= 1) {
-        return duration_days;
+    printf("Measuring 2 s idle, then 2 s busy; keep the host otherwise idle.\n");
+    fflush(stdout);
+    if (!energy_meter_calibrate(&model, 2.0)) {
+        handle_error("No readable RAPL counter in /sys/class/powercap, the power model cannot be calibrated");
+        return 1;
     }
+    printf("--power-model=%.4f,%.4f\n", model.active_w, model.idle_w);
+    return 0;
+}
 
-    duration_days = atoi(argv[1]);
-    if (duration_days < 0) {
-        printf("Invalid argument. Usage: %s [duration_days]\n", argv[0]);
-        exit(1);
+/**
+ * \brief Writes the break-even time, entries, residency and energy of each low-power state of the board.
+ */
+static void write_power_states(const HardwareContext* hardware, FILE* output) {
+    fprintf(output, "{");
+    for (int state = POWER_STATE_IDLE; state < POWER_STATE_COUNT; state++) {
+        fprintf(output, "%s\n    \"%s\": {\"break_even_ms\": %u, \"entries\": %u, \"residency_ms\": %llu, \"energy_mj\": %.3f}",
+                state > POWER_STATE_IDLE ? "," : "", power_state_spec((PowerState)state)->name,
+                power_state_break_even_ms((PowerState)state), hardware->state_entries[state],
+                (unsigned long long)hardware->state_residency_ms[state], hardware->state_energy_mj[state]);
     }
-
-    *infinite_loop = (duration_days == 0);
-    return duration_days;
+    fprintf(output, "\n  }");
 }
 
-static float read_temperature(void) {
-    const float min_temperature = -40.0f;
-    const float max_temperature = 60.0f;
-    float random_value = (float)rand() / (float)RAND_MAX;
-    float temperature = min_temperature + random_value * (max_temperature - min_temperature);
-    float rounded_temperature = ((int)(temperature * 10.0f)) / 10.0f;
-
-    printf("Read a temperature of %.1f C\n", rounded_temperature);
-    return rounded_temperature;
+/**
+ * \brief Writes the number of waits of the board, the missed ones and the lateness of their wake-ups.
+ */
+static void write_timing(const HardwareContext* hardware, FILE* output) {
+    fprintf(output,
+            "{\"waits\": %llu, \"missed_deadlines\": %llu, \"lateness_p50_ns\": %llu, \"lateness_p99_ns\": %llu, "
+            "\"lateness_max_ns\": %llu}",
+            (unsigned long long)hardware->jitter.waits, (unsigned long long)hardware->missed_deadlines,
+            (unsigned long long)jitter_stats_percentile(&hardware->jitter, 0.5f),
+            (unsigned long long)jitter_stats_percentile(&hardware->jitter, 0.99f),
+            (unsigned long long)hardware->jitter.max_ns);
 }
 
-static float average_temperature(void) {
-    float sum = 0.0f;
-    uint8_t count = buffer_full ? NUM_MEASURES : measure_index;
+/**
+ * \brief Writes the --profile report: the configuration of the run, its resource usage, energy, power states,
+ * timing and allocations.
+ */
+static int write_profile_report(const SchedulerOptions* options, const RunProfile* profile, const EnergyMeter* meter,
+                                const HardwareContext* hardware) {
+    FILE* output = fopen(options->profile_path, "w");
 
-    for (uint8_t i = 0; i < count; i++) {
-        sum += temperature_values[i];
-    }
-
-    return count > 0 ? (sum / count) : 0.0f;
-}
-
-static void runTempTask(void) {
-    temperature_values[measure_index] = read_temperature();
-    measure_index = (measure_index + 1) % NUM_MEASURES;
-    if (measure_index == 0) {
-        buffer_full = true;
+    if (output == NULL) {
+        handle_error("Failed to open the profile report");
+        return 1;
     }
-
-    incrementTaskCounter("runTempTask");
+    fprintf(output, "{\n  \"days\": %d,\n  \"seed\": %llu,\n  \"nodes\": %u,\n  \"profile\": ", options->duration_days,
+            (unsigned long long)options->seed, options->fleet_nodes > 0 ? options->fleet_nodes : 1);
+    run_profile_write_json(profile, output);
+    fprintf(output, ",\n  \"energy\": ");
+    // Fleet nodes are simulated in bulk, so only single-node runs attribute energy to tasks.
+    energy_meter_write_json(meter, options->fleet_nodes > 0 ? 0 : NUM_SIMULATION_TASKS, output);
+    fprintf(output, ",\n  \"power_states\": ");
+    write_power_states(hardware, output);
+    fprintf(output, ",\n  \"timing\": ");
+    write_timing(hardware, output);
+    fprintf(output, ",\n  \"allocations\": ");
+    alloc_tracker_write_json(output);
+    fprintf(output, "\n}\n");
+    fclose(output);
+    return 0;
 }
 
-static void computeAvgTempTask(void) {
-    if (!buffer_full) {
-        printf("Skipping average computation until the sample buffer is full.\n");
-        return;
+int main(int argc, char* argv[]) {
+    static SchedulerContext scheduler;
+    SchedulerOptions options;
+    RunProfiler profiler;
+    RunProfile profile;
+    EnergyMeter meter;
+    int status = 0;
+
+    if (!scheduler_parse_options(argc, argv, &options)) {
+        print_usage_and_exit(argv[0]);
     }
-
-    printf("Average of collected temperatures: %.2f C\n", average_temperature());
-    incrementTaskCounter("computeAvgTempTask");
-}
-
-static void sendResultTask(void) {
-    if (!buffer_full) {
-        printf("Skipping data transmission until the sample buffer is full.\n");
-        return;
+    if (options.calibrate_power) {
+        return calibrate_power_model();
     }
-
-    blink_led(NUM_MEASURES);
-    buffer_full = false;
-    measure_index = 0;
-    incrementTaskCounter("sendResultTask");
-}
-
-void update_simulated_hour(void) {
-    simulated_hour = (simulated_hour + 1) % 24;
-    if (simulated_hour == 0) {
-        simulated_day++;
+    if (options.profile_path != NULL) {
+        run_profiler_start(&profiler);
+        energy_meter_init(&meter, &options.power_model);
     }
-}
-
-uint8_t get_current_hour(void) {
-    return simulated_hour;
-}
-
-static void enqueue_simulation_tasks(TaskQueue* queue, Task tasks[], size_t task_count) {
-    for (size_t i = 0; i < task_count; i++) {
-        tasks[i].completed = false;
-        enqueue_task(queue, &tasks[i]);
+    if (!fault_injection_init(&options.faults)) {
+        return 1;
     }
-}
-
-int main(int argc, char* argv[]) {
-    bool infinite_loop = false;
-    int duration_days = 0;
-    float input_data[] = {1.0f, 0.5f};
-    TaskQueue* queue = NULL;
-    Task runTempTaskStruct = {runTempTask, 5000, 2, 3, false, 0.0f, false, NULL, 0};
-    Task computeAvgTempTaskStruct = {computeAvgTempTask, 5000, 1, 2, true, 0.0f, false, NULL, 0};
-    Task sendResultTaskStruct = {sendResultTask, 1000, 3, 1, true, 0.0f, false, NULL, 0};
-    EnergySource energy_source = {WIND, 6, 3, 3, {0}, 0.0f};
-    GoalParameters goal_params;
-    Task simulation_tasks[] = {runTempTaskStruct, computeAvgTempTaskStruct, sendResultTaskStruct};
-    Task* compute_dependencies_runtime[] = {&simulation_tasks[0]};
-    Task* send_dependencies_runtime[] = {&simulation_tasks[1]};
-    size_t simulation_task_count = sizeof(simulation_tasks) / sizeof(simulation_tasks[0]);
-
-    srand((unsigned int)time(NULL));
-
-    ml_model.tensor_arena = tensor_arena;
-    ml_model.tensor_arena_size = sizeof(tensor_arena);
-    printf("Predicted energy availability: %.2f\n",
-           predict_energy(&ml_model, input_data, sizeof(input_data) / sizeof(input_data[0])));
-
-    init_peripherals();
-    queue = init_task_queue(MAX_TASKS);
-    if (queue == NULL) {
+    if (!scheduler_init(&scheduler, &options, options.fleet_nodes > 0 ? NULL : stdout)) {
         return 1;
     }
-
-    duration_days = parse_duration_days(argc, argv, &infinite_loop);
-    goal_params.goal = MAXIMIZE_RESILIENCE;
-    goal_params.duration_days = (uint8_t)duration_days;
-
-    simulation_tasks[1].dependencies = compute_dependencies_runtime;
-    simulation_tasks[1].num_dependencies = 1;
-    simulation_tasks[2].dependencies = send_dependencies_runtime;
-    simulation_tasks[2].num_dependencies = 1;
-
-    while (infinite_loop || simulated_day < goal_params.duration_days) {
-        if (!is_energy_available(&energy_source)) {
-            enter_deep_sleep(5000);
-            update_simulated_hour();
-            continue;
+    if (options.profile_path != NULL) {
+        scheduler_set_energy_meter(&scheduler, &meter);
+    }
+    if (options.fleet_nodes > 0) {
+        status = run_fleet(&scheduler, &options);
+    } else {
+        scheduler_run(&scheduler);
+        if (options.summary) {
+            scheduler_print_summary(&scheduler, stdout);
         }
+    }
+    scheduler_close(&scheduler);
 
-        update_energy_profile(&energy_source);
-        for (size_t i = 0; i < simulation_task_count; i++) {
-            simulation_tasks[i].heuristic_metric =
-                compute_task_metric(&simulation_tasks[i], &energy_source, &goal_params);
+    if (options.profile_path != NULL) {
+        energy_meter_close(&meter);
+        run_profiler_stop(&profiler, &profile);
+        if (status == 0) {
+            status = write_profile_report(&options, &profile, &meter, &scheduler.hardware);
         }
-
-        enqueue_simulation_tasks(queue, simulation_tasks, simulation_task_count);
-        execute_tasks(queue, &energy_source, &goal_params);
-        update_simulated_hour();
     }
-
-    free_task_queue(queue);
-    return 0;
+    return status;
 }
@@ -0,0 +1,82 @@
+#include "monotonic_clock.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static int compare_lateness(const void* left, const void* right) {
+    uint32_t a = *(const uint32_t*)left;
+    uint32_t b = *(const uint32_t*)right;
+    return (a > b) - (a < b);
+}
+
+uint64_t monotonic_now_ns(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * NS_PER_SECOND + (uint64_t)now.tv_nsec;
+}
+
+uint64_t monotonic_sleep_until(uint64_t deadline_ns) {
+    struct timespec deadline;
+    uint64_t now_ns = 0;
+
+    deadline.tv_sec = (time_t)(deadline_ns / NS_PER_SECOND);
+    deadline.tv_nsec = (long)(deadline_ns % NS_PER_SECOND);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {
+    }
+    now_ns = monotonic_now_ns();
+    return now_ns > deadline_ns ? now_ns - deadline_ns : 0;
+}
+
+void jitter_stats_init(JitterStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+}
+
+void jitter_stats_add(JitterStats* stats, uint64_t lateness_ns) {
+    stats->recent_ns[stats->waits % JITTER_WINDOW] = lateness_ns > UINT32_MAX ? UINT32_MAX : (uint32_t)lateness_ns;
+    stats->waits++;
+    if (lateness_ns > stats->max_ns) {
+        stats->max_ns = lateness_ns;
+    }
+}
+
+uint64_t jitter_stats_percentile(const JitterStats* stats, float fraction) {
+    uint32_t sorted[JITTER_WINDOW];
+    size_t count = stats->waits < JITTER_WINDOW ? (size_t)stats->waits : JITTER_WINDOW;
+    size_t rank = 0;
+
+    if (count == 0) {
+        return 0;
+    }
+    memcpy(sorted, stats->recent_ns, count * sizeof(sorted[0]));
+    qsort(sorted, count, sizeof(sorted[0]), compare_lateness);
+    rank = (size_t)(fraction * (float)(count - 1) + 0.5f);
+    return sorted[rank < count ? rank : count - 1];
+}
+
+void periodic_deadline_init(PeriodicDeadline* deadline, uint64_t start_ns, uint64_t period_ns) {
+    deadline->period_ns = period_ns;
+    deadline->next_ns = start_ns + period_ns;
+    deadline->missed = 0;
+}
+
+uint64_t periodic_deadline_wait(PeriodicDeadline* deadline, JitterStats* jitter) {
+    uint64_t now_ns = monotonic_now_ns();
+    uint64_t skipped = 0;
+    uint64_t lateness_ns = 0;
+
+    if (now_ns > deadline->next_ns + deadline->period_ns) {
+        // Keep the phase of the series but drop the deadlines that are already over.
+        skipped = (now_ns - deadline->next_ns) / deadline->period_ns;
+        deadline->next_ns += skipped * deadline->period_ns;
+        deadline->missed += skipped;
+    }
+    lateness_ns = monotonic_sleep_until(deadline->next_ns);
+    if (jitter != NULL) {
+        jitter_stats_add(jitter, lateness_ns);
+    }
+    deadline->next_ns += deadline->period_ns;
+    return skipped;
+}
@@ -0,0 +1,99 @@
+#ifndef MONOTONIC_CLOCK_H
+#define MONOTONIC_CLOCK_H
+
+#include <stdint.h>
+
+#define NS_PER_MS 1000000ull
+#define NS_PER_SECOND 1000000000ull
+
+/**
+ * \brief Number of most recent wake-ups the lateness percentiles are computed over.
+ */
+#define JITTER_WINDOW 1024
+
+/**
+ * \brief Lateness of the wake-ups of a sleeper, in nanoseconds past their deadline.
+ */
+typedef struct {
+    uint64_t waits;                      ///< Wake-ups recorded since the start.
+    uint64_t max_ns;                     ///< Largest lateness since the start.
+    uint32_t recent_ns[JITTER_WINDOW];   ///< Lateness of the last wake-ups, saturated at UINT32_MAX.
+} JitterStats;
+
+/**
+ * \brief Deadlines of a periodic activity, each one period after the previous deadline.
+ *
+ * Deadlines do not depend on when the previous wait returned, so the work
+ * done in every period does not accumulate into drift.
+ */
+typedef struct {
+    uint64_t next_ns;    ///< Next deadline on CLOCK_MONOTONIC.
+    uint64_t period_ns;  ///< Time between two deadlines.
+    uint64_t missed;     ///< Deadlines skipped because the activity overran them.
+} PeriodicDeadline;
+
+/**
+ * \brief Reads CLOCK_MONOTONIC.
+ *
+ * \return Nanoseconds since an arbitrary origin.
+ */
+uint64_t monotonic_now_ns(void);
+
+/**
+ * \brief Sleeps until an absolute CLOCK_MONOTONIC deadline.
+ *
+ * Uses clock_nanosleep() with TIMER_ABSTIME and resumes after signals, so
+ * an interrupted wait still ends at the deadline. A deadline already past
+ * returns at once.
+ *
+ * \param deadline_ns Deadline on CLOCK_MONOTONIC.
+ * \return Lateness of the wake-up, in nanoseconds past the deadline.
+ */
+uint64_t monotonic_sleep_until(uint64_t deadline_ns);
+
+/**
+ * \brief Clears jitter statistics.
+ *
+ * \param stats Statistics to initialize.
+ */
+void jitter_stats_init(JitterStats* stats);
+
+/**
+ * \brief Records the lateness of one wake-up.
+ *
+ * \param stats Statistics to update.
+ * \param lateness_ns Nanoseconds past the deadline.
+ */
+void jitter_stats_add(JitterStats* stats, uint64_t lateness_ns);
+
+/**
+ * \brief Returns a percentile of the lateness of the last JITTER_WINDOW wake-ups.
+ *
+ * \param stats Statistics to read.
+ * \param fraction Percentile between 0 and 1, for instance 0.99.
+ * \return Lateness in nanoseconds, 0 if nothing was recorded.
+ */
+uint64_t jitter_stats_percentile(const JitterStats* stats, float fraction);
+
+/**
+ * \brief Starts a series of deadlines, the first one a period after start_ns.
+ *
+ * \param deadline Series to initialize.
+ * \param start_ns Start of the first period on CLOCK_MONOTONIC, usually monotonic_now_ns().
+ * \param period_ns Time between two deadlines, greater than 0.
+ */
+void periodic_deadline_init(PeriodicDeadline* deadline, uint64_t start_ns, uint64_t period_ns);
+
+/**
+ * \brief Sleeps until the next deadline of a series, then moves it one period on.
+ *
+ * When the activity overran whole periods, their deadlines are skipped and
+ * counted rather than fired back to back.
+ *
+ * \param deadline Series to wait on.
+ * \param jitter Statistics receiving the lateness of the wake-up, or NULL.
+ * \return Number of deadlines skipped by this call.
+ */
+uint64_t periodic_deadline_wait(PeriodicDeadline* deadline, JitterStats* jitter);
+
+#endif // MONOTONIC_CLOCK_H
@@ -0,0 +1,105 @@
+#include "prng.h"
+
+#define UNIT_SCALE (1.0f / 16777216.0f)
+
+static uint64_t splitmix64(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static uint32_t rotate_left(uint32_t value, int shift) {
+    return (value << shift) | (value >> (32 - shift));
+}
+
+void prng_seed(Prng* prng, uint64_t seed, uint64_t stream) {
+    // Mixing the stream into the splitmix64 start keeps neighbouring streams unrelated.
+    uint64_t mixer = stream;
+    uint64_t state = seed ^ splitmix64(&mixer);
+    uint64_t first = splitmix64(&state);
+    uint64_t second = splitmix64(&state);
+
+    prng->state[0] = (uint32_t)first;
+    prng->state[1] = (uint32_t)(first >> 32);
+    prng->state[2] = (uint32_t)second;
+    prng->state[3] = (uint32_t)(second >> 32);
+    if ((prng->state[0] | prng->state[1] | prng->state[2] | prng->state[3]) == 0) {
+        prng->state[0] = 1;
+    }
+}
+
+uint32_t prng_next(Prng* prng) {
+    uint32_t* s = prng->state;
+    uint32_t result = rotate_left(s[1] * 5u, 7) * 9u;
+    uint32_t shifted = s[1] << 9;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= shifted;
+    s[3] = rotate_left(s[3], 11);
+    return result;
+}
+
+float prng_unit(Prng* prng) {
+    return (float)(prng_next(prng) >> 8) * UNIT_SCALE;
+}
+
+uint32_t prng_below(Prng* prng, uint32_t bound) {
+    // Lemire's multiply-shift with rejection of the biased low products.
+    uint64_t product = (uint64_t)prng_next(prng) * bound;
+    uint32_t low = (uint32_t)product;
+
+    if (low < bound) {
+        uint32_t threshold = (0u - bound) % bound;
+
+        while (low < threshold) {
+            product = (uint64_t)prng_next(prng) * bound;
+            low = (uint32_t)product;
+        }
+    }
+    return (uint32_t)(product >> 32);
+}
+
+void prng_fill_unit(Prng* prng, float* values, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        values[i] = prng_unit(prng);
+    }
+}
+
+void prng_lanes_seed(PrngLanes* lanes, uint64_t seed, uint64_t first_stream) {
+    for (size_t i = 0; i < lanes->count; i++) {
+        Prng prng;
+
+        prng_seed(&prng, seed, first_stream + i);
+        for (size_t w = 0; w < PRNG_STATE_WORDS; w++) {
+            lanes->state[w][i] = prng.state[w];
+        }
+    }
+}
+
+void prng_lanes_unit(PrngLanes* lanes, float* values) {
+    uint32_t* restrict s0 = lanes->state[0];
+    uint32_t* restrict s1 = lanes->state[1];
+    uint32_t* restrict s2 = lanes->state[2];
+    uint32_t* restrict s3 = lanes->state[3];
+    float* restrict output = values;
+    size_t count = lanes->count;
+
+    // prng_next() on every lane, written out so that the loop vectorizes.
+    for (size_t i = 0; i < count; i++) {
+        uint32_t result = rotate_left(s1[i] * 5u, 7) * 9u;
+        uint32_t shifted = s1[i] << 9;
+        uint32_t t2 = s2[i] ^ s0[i];
+        uint32_t t3 = s3[i] ^ s1[i];
+
+        s1[i] ^= t2;
+        s0[i] ^= t3;
+        s2[i] = t2 ^ shifted;
+        s3[i] = rotate_left(t3, 11);
+        output[i] = (float)(result >> 8) * UNIT_SCALE;
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef PRNG_H
+#define PRNG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * \brief Number of 32-bit words of a generator state.
+ */
+#define PRNG_STATE_WORDS 4
+
+/**
+ * \brief xoshiro128** pseudo-random generator.
+ *
+ * Every stochastic component owns its generator, so runs are reproducible
+ * from their seed and independent contexts may draw in parallel. The state
+ * is 16 bytes and a draw costs a few integer operations; the same seed and
+ * stream always give the same sequence on every platform.
+ */
+typedef struct {
+    uint32_t state[PRNG_STATE_WORDS];
+} Prng;
+
+/**
+ * \brief Independent generators stored as one array per state word.
+ *
+ * Lane i holds the generator of stream i, so a fleet draws one value for
+ * every node in a single loop that the compiler vectorizes.
+ */
+typedef struct {
+    uint32_t* state[PRNG_STATE_WORDS]; ///< Word w of every lane; each array holds `count` elements.
+    size_t count;                      ///< Number of lanes.
+} PrngLanes;
+
+/**
+ * \brief Seeds a generator.
+ *
+ * \param prng Generator to seed.
+ * \param seed Seed of the run.
+ * \param stream Index distinguishing the generators seeded from the same seed.
+ */
+void prng_seed(Prng* prng, uint64_t seed, uint64_t stream);
+
+/**
+ * \brief Draws 32 random bits.
+ *
+ * \param prng Seeded generator.
+ * \return Next value of the sequence.
+ */
+uint32_t prng_next(Prng* prng);
+
+/**
+ * \brief Draws a float uniformly distributed in [0, 1).
+ *
+ * \param prng Seeded generator.
+ * \return Multiple of 2^-24 in [0, 1).
+ */
+float prng_unit(Prng* prng);
+
+/**
+ * \brief Draws an integer uniformly distributed in [0, bound).
+ *
+ * \param prng Seeded generator.
+ * \param bound Exclusive upper bound, at least 1.
+ * \return Value below bound.
+ */
+uint32_t prng_below(Prng* prng, uint32_t bound);
+
+/**
+ * \brief Fills an array with floats uniformly distributed in [0, 1).
+ *
+ * \param prng Seeded generator.
+ * \param values Destination.
+ * \param count Number of values.
+ */
+void prng_fill_unit(Prng* prng, float* values, size_t count);
+
+/**
+ * \brief Seeds every lane, lane i with stream first_stream + i.
+ *
+ * \param lanes Lanes whose state arrays are allocated.
+ * \param seed Seed of the run.
+ * \param first_stream Stream of the first lane.
+ */
+void prng_lanes_seed(PrngLanes* lanes, uint64_t seed, uint64_t first_stream);
+
+/**
+ * \brief Draws one float in [0, 1) from every lane.
+ *
+ * \param lanes Seeded lanes.
+ * \param values Destination, one value per lane.
+ */
+void prng_lanes_unit(PrngLanes* lanes, float* values);
+
+#endif // PRNG_H
@@ -0,0 +1,140 @@
+#include "run_profiler.h"
+
+#include <string.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static const char* const counter_names[PROFILE_COUNTER_COUNT] = {
+    "cycles", "instructions", "cache_references", "cache_misses", "branch_misses"
+};
+
+static double seconds_between(const struct timespec* start, const struct timespec* end) {
+    return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static double timeval_seconds(const struct timeval* value) {
+    return (double)value->tv_sec + (double)value->tv_usec / 1e6;
+}
+
+#ifdef __linux__
+static const uint64_t counter_configs[PROFILE_COUNTER_COUNT] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_REFERENCES,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+};
+
+static int open_counter(uint64_t config) {
+    struct perf_event_attr attributes;
+
+    memset(&attributes, 0, sizeof(attributes));
+    attributes.type = PERF_TYPE_HARDWARE;
+    attributes.size = sizeof(attributes);
+    attributes.config = config;
+    attributes.disabled = 1;
+    // User mode only, which perf_event_paranoid 2, the usual default, still allows.
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+}
+
+/**
+ * \brief Reads a counter, scaled up when the kernel multiplexed it with other events.
+ */
+static bool read_counter(int fd, uint64_t* count) {
+    uint64_t values[3];
+
+    if (read(fd, values, sizeof(values)) != (ssize_t)sizeof(values) || values[2] == 0) {
+        return false;
+    }
+    *count = values[2] < values[1] ? (uint64_t)((double)values[0] * values[1] / values[2]) : values[0];
+    return true;
+}
+#endif
+
+void run_profiler_start(RunProfiler* profiler) {
+    for (size_t i = 0; i < PROFILE_COUNTER_COUNT; i++) {
+#ifdef __linux__
+        profiler->counter_fds[i] = open_counter(counter_configs[i]);
+#else
+        profiler->counter_fds[i] = -1;
+#endif
+    }
+
+    // The wall clock brackets the CPU clocks on both sides, so the CPU time never spans more than the wall time.
+    clock_gettime(CLOCK_MONOTONIC, &profiler->wall_start);
+    getrusage(RUSAGE_SELF, &profiler->usage_start);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &profiler->cpu_start);
+#ifdef __linux__
+    for (size_t i = 0; i < PROFILE_COUNTER_COUNT; i++) {
+        if (profiler->counter_fds[i] >= 0) {
+            ioctl(profiler->counter_fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+void run_profiler_stop(RunProfiler* profiler, RunProfile* profile) {
+    struct timespec wall_end;
+    struct timespec cpu_end;
+    struct rusage usage_end;
+
+#ifdef __linux__
+    for (size_t i = 0; i < PROFILE_COUNTER_COUNT; i++) {
+        if (profiler->counter_fds[i] >= 0) {
+            ioctl(profiler->counter_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+#endif
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_end);
+    getrusage(RUSAGE_SELF, &usage_end);
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+
+    memset(profile, 0, sizeof(*profile));
+    profile->wall_s = seconds_between(&profiler->wall_start, &wall_end);
+    profile->cpu_s = seconds_between(&profiler->cpu_start, &cpu_end);
+    profile->user_s = timeval_seconds(&usage_end.ru_utime) - timeval_seconds(&profiler->usage_start.ru_utime);
+    profile->system_s = timeval_seconds(&usage_end.ru_stime) - timeval_seconds(&profiler->usage_start.ru_stime);
+    profile->voluntary_switches = usage_end.ru_nvcsw - profiler->usage_start.ru_nvcsw;
+    profile->involuntary_switches = usage_end.ru_nivcsw - profiler->usage_start.ru_nivcsw;
+    profile->minor_faults = usage_end.ru_minflt - profiler->usage_start.ru_minflt;
+    profile->major_faults = usage_end.ru_majflt - profiler->usage_start.ru_majflt;
+    profile->max_rss_kb = usage_end.ru_maxrss;
+
+    for (size_t i = 0; i < PROFILE_COUNTER_COUNT; i++) {
+#ifdef __linux__
+        if (profiler->counter_fds[i] >= 0) {
+            profile->counter_available[i] = read_counter(profiler->counter_fds[i], &profile->counters[i]);
+            close(profiler->counter_fds[i]);
+        }
+#endif
+        profiler->counter_fds[i] = -1;
+    }
+}
+
+void run_profile_write_json(const RunProfile* profile, FILE* output) {
+    double cpu_usage = profile->wall_s > 0.0 ? 100.0 * profile->cpu_s / profile->wall_s : 0.0;
+
+    // The scheduler runs on one thread: a ratio above 100% can only come from the resolution of the clocks.
+    cpu_usage = cpu_usage < 100.0 ? cpu_usage : 100.0;
+
+    fprintf(output, "{\n    \"wall_time_s\": %.6f,\n    \"cpu_time_s\": %.6f,\n    \"user_time_s\": %.6f,\n"
+            "    \"system_time_s\": %.6f,\n    \"cpu_usage\": %.2f,\n", profile->wall_s, profile->cpu_s,
+            profile->user_s, profile->system_s, cpu_usage);
+    fprintf(output, "    \"voluntary_context_switches\": %ld,\n    \"involuntary_context_switches\": %ld,\n"
+            "    \"minor_page_faults\": %ld,\n    \"major_page_faults\": %ld,\n    \"max_rss_kb\": %ld",
+            profile->voluntary_switches, profile->involuntary_switches, profile->minor_faults,
+            profile->major_faults, profile->max_rss_kb);
+    for (size_t i = 0; i < PROFILE_COUNTER_COUNT; i++) {
+        if (profile->counter_available[i]) {
+            fprintf(output, ",\n    \"%s\": %llu", counter_names[i], (unsigned long long)profile->counters[i]);
+        } else {
+            fprintf(output, ",\n    \"%s\": null", counter_names[i]);
+        }
+    }
+    fprintf(output, "\n  }");
+}
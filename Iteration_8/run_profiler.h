@@ -0,0 +1,76 @@
+#ifndef RUN_PROFILER_H
+#define RUN_PROFILER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <sys/resource.h>
+
+/**
+ * \brief Hardware events counted during a profiled run.
+ */
+typedef enum {
+    PROFILE_COUNTER_CYCLES,             ///< CPU cycles.
+    PROFILE_COUNTER_INSTRUCTIONS,       ///< Retired instructions.
+    PROFILE_COUNTER_CACHE_REFERENCES,   ///< Last-level cache accesses.
+    PROFILE_COUNTER_CACHE_MISSES,       ///< Last-level cache misses.
+    PROFILE_COUNTER_BRANCH_MISSES,      ///< Mispredicted branches.
+    PROFILE_COUNTER_COUNT               ///< Number of hardware counters.
+} ProfileCounter;
+
+/**
+ * \brief Resource usage of the process between run_profiler_start() and run_profiler_stop().
+ */
+typedef struct {
+    double wall_s;                          ///< Elapsed monotonic time.
+    double cpu_s;                           ///< CPU time of the process, from the process CPU-time clock.
+    double user_s;                          ///< User-mode CPU time.
+    double system_s;                        ///< Kernel-mode CPU time.
+    long voluntary_switches;                ///< Context switches while waiting, such as in sleeps.
+    long involuntary_switches;              ///< Preemptions by the kernel.
+    long minor_faults;                      ///< Page faults served without I/O.
+    long major_faults;                      ///< Page faults that needed I/O.
+    long max_rss_kb;                        ///< Peak resident set size of the process.
+    uint64_t counters[PROFILE_COUNTER_COUNT];       ///< User-mode event counts, scaled when multiplexed.
+    bool counter_available[PROFILE_COUNTER_COUNT];  ///< Whether the kernel let the event be counted.
+} RunProfile;
+
+/**
+ * \brief Snapshot taken when profiling starts.
+ */
+typedef struct {
+    struct timespec wall_start;
+    struct timespec cpu_start;
+    struct rusage usage_start;
+    int counter_fds[PROFILE_COUNTER_COUNT]; ///< perf_event descriptors, -1 where unavailable.
+} RunProfiler;
+
+/**
+ * \brief Opens the hardware counters and takes the starting snapshot.
+ *
+ * Hardware counters come from perf_event_open() on Linux. They are left out
+ * when the CPU, a virtual machine or perf_event_paranoid denies them; the
+ * time, context-switch and page-fault figures are always collected.
+ *
+ * \param profiler Profiler to start.
+ */
+void run_profiler_start(RunProfiler* profiler);
+
+/**
+ * \brief Takes the final snapshot and closes the hardware counters.
+ *
+ * \param profiler Started profiler.
+ * \param profile Destination of the usage since run_profiler_start().
+ */
+void run_profiler_stop(RunProfiler* profiler, RunProfile* profile);
+
+/**
+ * \brief Writes a profile as a JSON object; unavailable counters are null.
+ *
+ * \param profile Profile to write.
+ * \param output Destination; the object is not followed by a newline, so it may be nested.
+ */
+void run_profile_write_json(const RunProfile* profile, FILE* output);
+
+#endif // RUN_PROFILER_H
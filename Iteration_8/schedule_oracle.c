@@ -0,0 +1,620 @@
+#include "schedule_oracle.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc_tracker.h"
+#include "error_handling.h"
+
+/**
+ * \brief Scenario compiled for fast slot execution.
+ *
+ * State bit i (i < task_count) is set when task i has no pending job; bit
+ * task_count + e is set when the dependency of edge e completed since its
+ * dependent's latest release.
+ */
+typedef struct {
+    const ScheduleScenario* scenario;
+    uint8_t order[ORACLE_MAX_TASKS];              ///< Dependency order of execution within a slot.
+    uint32_t task_mask;                           ///< Bits of the tasks.
+    uint32_t critical_mask;                       ///< Tasks critical or required by a critical task.
+    uint32_t dependent_edges[ORACLE_MAX_TASKS];   ///< Edge bits a task needs before it may run.
+    uint32_t dependency_edges[ORACLE_MAX_TASKS];  ///< Edge bits a task satisfies when it runs.
+} ScheduleModel;
+
+/**
+ * \brief One DP state, linked to the state it came from.
+ */
+typedef struct {
+    uint32_t bits;          ///< Pending jobs and satisfied dependencies.
+    float charge_mj;        ///< Battery charge at the start of the next slot.
+    uint32_t completed;     ///< Jobs completed so far.
+    uint32_t critical;      ///< Critical jobs completed so far.
+    int64_t value;          ///< Objective reached so far.
+    float consumed_mj;      ///< Energy used so far.
+    float wasted_mj;        ///< Harvest lost so far.
+    uint32_t parent;        ///< Index of the previous state in the history.
+    uint32_t ran;           ///< Jobs run in the slot leading to this state.
+    uint32_t link;          ///< Next state of the layer with the same bits, or FRONTIER_END.
+} OracleState;
+
+/**
+ * \brief Ends a frontier chain; also marks a state another one dominates.
+ */
+#define FRONTIER_END UINT32_MAX
+
+/**
+ * \brief Growable array of states.
+ */
+typedef struct {
+    OracleState* states;
+    size_t count;
+    size_t capacity;
+} StateArray;
+
+/**
+ * \brief Open-addressing table from bits to the chain of frontier states of a layer.
+ *
+ * Buckets stamped with an older layer are empty, so the table is not
+ * cleared between layers.
+ */
+typedef struct {
+    uint32_t* keys;      ///< Bits of each bucket.
+    uint32_t* heads;     ///< First state of the chain of each bucket.
+    uint32_t* stamps;    ///< Layer that last used each bucket.
+    size_t capacity;     ///< Number of buckets, a power of two.
+    size_t used;         ///< Buckets used by the current layer.
+    uint32_t layer;      ///< Current layer, starting at 1.
+} FrontierIndex;
+
+static bool build_model(const ScheduleScenario* scenario, ScheduleModel* model) {
+    uint8_t edge_count = 0;
+    uint32_t placed = 0;
+
+    memset(model, 0, sizeof(*model));
+    model->scenario = scenario;
+    if (scenario == NULL || scenario->tasks == NULL || scenario->harvest_mj == NULL || scenario->task_count == 0 ||
+        scenario->task_count > ORACLE_MAX_TASKS || scenario->slot_count == 0 || !(scenario->capacity_mj > 0.0f) ||
+        scenario->reserve_mj < 0.0f || scenario->reserve_mj > scenario->capacity_mj ||
+        scenario->initial_charge_mj < 0.0f || scenario->initial_charge_mj > scenario->capacity_mj) {
+        handle_error("Invalid schedule scenario");
+        return false;
+    }
+
+    model->task_mask = (1u << scenario->task_count) - 1u;
+    for (uint8_t i = 0; i < scenario->task_count; i++) {
+        const PlanTask* task = &scenario->tasks[i];
+
+        if (task->period_slots == 0 || task->deadline_slots == 0 || task->deadline_slots > task->period_slots ||
+            (task->dependency_mask & ~model->task_mask) != 0 || (task->dependency_mask & (1u << i)) != 0) {
+            handle_error("Invalid scenario task");
+            return false;
+        }
+        for (uint8_t j = 0; j < scenario->task_count; j++) {
+            if ((task->dependency_mask & (1u << j)) == 0) {
+                continue;
+            }
+            if (scenario->task_count + edge_count >= ORACLE_MAX_STATE_BITS) {
+                handle_error("Scenario has too many dependencies");
+                return false;
+            }
+            model->dependent_edges[i] |= 1u << (scenario->task_count + edge_count);
+            model->dependency_edges[j] |= 1u << (scenario->task_count + edge_count);
+            edge_count++;
+        }
+    }
+
+    // Dependencies first; a task placed in a round only depends on earlier rounds.
+    for (uint8_t k = 0; k < scenario->task_count; k++) {
+        uint8_t next = ORACLE_MAX_TASKS;
+
+        for (uint8_t i = 0; i < scenario->task_count && next == ORACLE_MAX_TASKS; i++) {
+            if ((placed & (1u << i)) == 0 && (scenario->tasks[i].dependency_mask & ~placed) == 0) {
+                next = i;
+            }
+        }
+        if (next == ORACLE_MAX_TASKS) {
+            handle_error("Scenario dependencies form a cycle");
+            return false;
+        }
+        model->order[k] = next;
+        placed |= 1u << next;
+    }
+
+    for (int k = scenario->task_count - 1; k >= 0; k--) {
+        uint8_t i = model->order[k];
+
+        if (scenario->tasks[i].critical || (model->critical_mask & (1u << i)) != 0) {
+            model->critical_mask |= (1u << i) | scenario->tasks[i].dependency_mask;
+        }
+    }
+    return true;
+}
+
+/**
+ * \brief Forgets the dependencies of tasks without a pending job, which no longer matter.
+ *
+ * States that differ only by such bits have the same future and merge.
+ */
+static uint32_t canonical_bits(const ScheduleModel* model, uint32_t bits) {
+    for (uint8_t i = 0; i < model->scenario->task_count; i++) {
+        if ((bits & (1u << i)) != 0) {
+            bits &= ~model->dependent_edges[i];
+        }
+    }
+    return bits;
+}
+
+/**
+ * \brief Applies the releases and window ends of the start of a slot.
+ */
+static uint32_t start_slot(const ScheduleModel* model, uint32_t slot, uint32_t bits) {
+    for (uint8_t i = 0; i < model->scenario->task_count; i++) {
+        const PlanTask* task = &model->scenario->tasks[i];
+        uint32_t offset = slot % task->period_slots;
+
+        if (offset == 0) {
+            bits &= ~((1u << i) | model->dependent_edges[i]);
+        } else if (offset == task->deadline_slots) {
+            bits |= 1u << i;
+        }
+    }
+    return canonical_bits(model, bits);
+}
+
+/**
+ * \brief Runs the attempted jobs a slot allows and charges the battery with the rest of the harvest.
+ *
+ * Jobs are tried in the given order. Unless it is the dependency order, the
+ * jobs are tried again while one of them ran, so a job placed before its
+ * dependencies runs once they have.
+ *
+ * \return Jobs that ran.
+ */
+static uint32_t execute_slot(const ScheduleModel* model, const uint8_t* order, uint32_t slot, uint32_t* bits,
+                             uint32_t attempted, float* charge_mj, float* wasted_mj) {
+    const ScheduleScenario* scenario = model->scenario;
+    float harvest = scenario->harvest_mj[slot];
+    uint32_t ran = 0;
+    uint32_t ran_before = 0;
+
+    do {
+        ran_before = ran;
+        for (uint8_t k = 0; k < scenario->task_count; k++) {
+            uint8_t i = order[k];
+            float energy = scenario->tasks[i].energy_mj;
+            float floor = (model->critical_mask & (1u << i)) != 0 ? 0.0f : scenario->reserve_mj;
+
+            if ((attempted & (1u << i)) == 0 || (*bits & (1u << i)) != 0 ||
+                (*bits & model->dependent_edges[i]) != model->dependent_edges[i]) {
+                continue;
+            }
+
+            if (energy <= harvest) {
+                harvest -= energy;
+            } else if (*charge_mj - (energy - harvest) >= floor) {
+                *charge_mj -= energy - harvest;
+                harvest = 0.0f;
+            } else {
+                continue;
+            }
+            ran |= 1u << i;
+            *bits |= (1u << i) | model->dependency_edges[i];
+        }
+    } while (order != model->order && ran != ran_before);
+    *bits = canonical_bits(model, *bits);
+
+    *charge_mj += harvest;
+    if (*charge_mj > scenario->capacity_mj) {
+        *wasted_mj += *charge_mj - scenario->capacity_mj;
+        *charge_mj = scenario->capacity_mj;
+    }
+    return ran;
+}
+
+static void count_releases(const ScheduleModel* model, ScheduleOutcome* outcome) {
+    const ScheduleScenario* scenario = model->scenario;
+
+    for (uint8_t i = 0; i < scenario->task_count; i++) {
+        uint32_t period = scenario->tasks[i].period_slots;
+        uint32_t releases = (scenario->slot_count + period - 1) / period;
+
+        outcome->released += releases;
+        if (scenario->tasks[i].critical) {
+            outcome->critical_released += releases;
+        }
+    }
+}
+
+static uint32_t count_critical(const ScheduleScenario* scenario, uint32_t ran) {
+    uint32_t count = 0;
+
+    for (uint8_t i = 0; i < scenario->task_count; i++) {
+        if ((ran & (1u << i)) != 0 && scenario->tasks[i].critical) {
+            count++;
+        }
+    }
+    return count;
+}
+
+static float ran_energy(const ScheduleScenario* scenario, uint32_t ran) {
+    float energy = 0.0f;
+
+    for (uint8_t i = 0; i < scenario->task_count; i++) {
+        if ((ran & (1u << i)) != 0) {
+            energy += scenario->tasks[i].energy_mj;
+        }
+    }
+    return energy;
+}
+
+static uint32_t count_bits(uint32_t bits) {
+    uint32_t count = 0;
+
+    for (; bits != 0; bits &= bits - 1) {
+        count++;
+    }
+    return count;
+}
+
+void schedule_order_by_rank(const float* ranks, uint8_t count, uint8_t* order) {
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t position = i;
+
+        while (position > 0 && ranks[order[position - 1]] < ranks[i]) {
+            order[position] = order[position - 1];
+            position--;
+        }
+        order[position] = i;
+    }
+}
+
+static bool is_task_permutation(const ScheduleScenario* scenario, const uint8_t* order) {
+    uint32_t seen = 0;
+
+    for (uint8_t k = 0; k < scenario->task_count; k++) {
+        if (order[k] >= scenario->task_count || (seen & (1u << order[k])) != 0) {
+            return false;
+        }
+        seen |= 1u << order[k];
+    }
+    return true;
+}
+
+bool schedule_simulate(const ScheduleScenario* scenario, const SchedulePolicy* policy, ScheduleOutcome* outcome) {
+    ScheduleModel model;
+    const uint8_t* order = NULL;
+    uint32_t bits = 0;
+    float charge_mj = 0.0f;
+    float wasted_mj = 0.0f;
+
+    if (outcome == NULL || policy == NULL || policy->choose == NULL || !build_model(scenario, &model)) {
+        return false;
+    }
+    if (policy->order != NULL && !is_task_permutation(scenario, policy->order)) {
+        handle_error("Invalid policy execution order");
+        return false;
+    }
+    order = policy->order != NULL ? policy->order : model.order;
+
+    memset(outcome, 0, sizeof(*outcome));
+    count_releases(&model, outcome);
+    bits = model.task_mask;
+    charge_mj = scenario->initial_charge_mj;
+    for (uint32_t slot = 0; slot < scenario->slot_count; slot++) {
+        uint32_t attempted = 0;
+        uint32_t ran = 0;
+
+        bits = start_slot(&model, slot, bits);
+        attempted = policy->choose(policy->context, slot, charge_mj, ~bits & model.task_mask);
+        ran = execute_slot(&model, order, slot, &bits, attempted, &charge_mj, &wasted_mj);
+
+        outcome->completed += count_bits(ran);
+        outcome->critical_completed += count_critical(scenario, ran);
+        outcome->consumed_mj += ran_energy(scenario, ran);
+        for (uint8_t i = 0; i < scenario->task_count && policy->completed != NULL; i++) {
+            if ((ran & (1u << i)) != 0) {
+                policy->completed(policy->context, i);
+            }
+        }
+    }
+    outcome->wasted_mj = wasted_mj;
+    return true;
+}
+
+static uint32_t attempt_every_pending(void* context, uint32_t slot, float charge_mj, uint32_t pending) {
+    (void)context;
+    (void)slot;
+    (void)charge_mj;
+    return pending;
+}
+
+static bool push_state(StateArray* array, const OracleState* state) {
+    if (array->count == array->capacity) {
+        size_t capacity = array->capacity > 0 ? array->capacity * 2 : 1024;
+        OracleState* states = tracked_realloc(ALLOC_SUBSYSTEM_ORACLE, array->states, capacity * sizeof(*states));
+
+        if (states == NULL) {
+            return false;
+        }
+        array->states = states;
+        array->capacity = capacity;
+    }
+    array->states[array->count++] = *state;
+    return true;
+}
+
+static int64_t objective_value(uint32_t completed, uint32_t critical, OracleObjective objective, int64_t critical_weight) {
+    if (objective == ORACLE_MAXIMIZE_CRITICAL) {
+        return (int64_t)critical * critical_weight + completed;
+    }
+    return completed;
+}
+
+static size_t frontier_bucket(const FrontierIndex* index, uint32_t bits) {
+    size_t bucket = (bits * 0x9e3779b1u) & (index->capacity - 1);
+
+    while (index->stamps[bucket] == index->layer && index->keys[bucket] != bits) {
+        bucket = (bucket + 1) & (index->capacity - 1);
+    }
+    return bucket;
+}
+
+static bool frontier_resize(FrontierIndex* index, size_t capacity) {
+    FrontierIndex grown = {NULL, NULL, NULL, capacity, index->used, index->layer};
+
+    grown.keys = tracked_malloc(ALLOC_SUBSYSTEM_ORACLE, capacity * sizeof(*grown.keys));
+    grown.heads = tracked_malloc(ALLOC_SUBSYSTEM_ORACLE, capacity * sizeof(*grown.heads));
+    grown.stamps = tracked_calloc(ALLOC_SUBSYSTEM_ORACLE, capacity, sizeof(*grown.stamps));
+    if (grown.keys == NULL || grown.heads == NULL || grown.stamps == NULL) {
+        tracked_free(ALLOC_SUBSYSTEM_ORACLE, grown.keys);
+        tracked_free(ALLOC_SUBSYSTEM_ORACLE, grown.heads);
+        tracked_free(ALLOC_SUBSYSTEM_ORACLE, grown.stamps);
+        return false;
+    }
+    for (size_t i = 0; i < index->capacity; i++) {
+        if (index->stamps[i] == index->layer) {
+            size_t bucket = frontier_bucket(&grown, index->keys[i]);
+
+            grown.keys[bucket] = index->keys[i];
+            grown.heads[bucket] = index->heads[i];
+            grown.stamps[bucket] = grown.layer;
+        }
+    }
+    tracked_free(ALLOC_SUBSYSTEM_ORACLE, index->keys);
+    tracked_free(ALLOC_SUBSYSTEM_ORACLE, index->heads);
+    tracked_free(ALLOC_SUBSYSTEM_ORACLE, index->stamps);
+    *index = grown;
+    return true;
+}
+
+/**
+ * \brief Adds a state to the layer unless a state with the same bits beats it on both charge and value.
+ *
+ * The states it beats in turn are marked dead and unlinked, so every chain
+ * holds the Pareto frontier of its bits.
+ */
+static bool frontier_insert(FrontierIndex* index, StateArray* layer, OracleState* candidate) {
+    size_t bucket = 0;
+    uint32_t* link = NULL;
+
+    if ((index->used + 1) * 2 > index->capacity && !frontier_resize(index, index->capacity * 2)) {
+        return false;
+    }
+
+    bucket = frontier_bucket(index, candidate->bits);
+    if (index->stamps[bucket] != index->layer) {
+        index->keys[bucket] = candidate->bits;
+        index->heads[bucket] = FRONTIER_END;
+        index->stamps[bucket] = index->layer;
+        index->used++;
+    }
+
+    for (link = &index->heads[bucket]; *link != FRONTIER_END;) {
+        OracleState* state = &layer->states[*link];
+
+        if (state->charge_mj >= candidate->charge_mj && state->value >= candidate->value) {
+            return true;
+        }
+        if (state->charge_mj <= candidate->charge_mj && state->value <= candidate->value) {
+            *link = state->link;
+            state->link = FRONTIER_END;
+            state->ran = FRONTIER_END;
+        } else {
+            link = &state->link;
+        }
+    }
+
+    candidate->link = index->heads[bucket];
+    index->heads[bucket] = (uint32_t)layer->count;
+    return push_state(layer, candidate);
+}
+
+/**
+ * \brief Starts a new layer: drops the dominated states and forgets the buckets.
+ */
+static void frontier_next_layer(FrontierIndex* index, StateArray* layer) {
+    size_t kept = 0;
+
+    for (size_t i = 0; i < layer->count; i++) {
+        // Jobs run fit in ORACLE_MAX_TASKS bits, so FRONTIER_END only marks dead states.
+        if (layer->states[i].ran != FRONTIER_END) {
+            layer->states[kept++] = layer->states[i];
+        }
+    }
+    layer->count = kept;
+    index->used = 0;
+    index->layer++;
+}
+
+/**
+ * \brief Value of the jobs released from each slot on, the bound used to prune states.
+ */
+static int64_t* remaining_release_values(const ScheduleModel* model, OracleObjective objective, int64_t critical_weight) {
+    const ScheduleScenario* scenario = model->scenario;
+    int64_t* remaining = tracked_calloc(ALLOC_SUBSYSTEM_ORACLE, scenario->slot_count + 1, sizeof(*remaining));
+
+    if (remaining == NULL) {
+        return NULL;
+    }
+    for (uint32_t slot = scenario->slot_count; slot-- > 0;) {
+        remaining[slot] = remaining[slot + 1];
+        for (uint8_t i = 0; i < scenario->task_count; i++) {
+            if (slot % scenario->tasks[i].period_slots == 0) {
+                bool critical = objective == ORACLE_MAXIMIZE_CRITICAL && scenario->tasks[i].critical;
+                remaining[slot] += critical ? critical_weight + 1 : 1;
+            }
+        }
+    }
+    return remaining;
+}
+
+bool schedule_oracle_solve(const ScheduleScenario* scenario, OracleObjective objective, uint32_t* schedule,
+                           ScheduleOutcome* outcome) {
+    SchedulePolicy greedy = {attempt_every_pending, NULL, NULL, NULL};
+    ScheduleModel model;
+    ScheduleOutcome incumbent;
+    StateArray history = {NULL, 0, 0};
+    StateArray current = {NULL, 0, 0};
+    StateArray next = {NULL, 0, 0};
+    FrontierIndex index = {NULL, NULL, NULL, 0, 0, 1};
+    OracleState start;
+    int64_t critical_weight = 0;
+    int64_t incumbent_value = 0;
+    int64_t* remaining = NULL;
+    size_t layer_start = 0;
+    uint64_t expanded = 0;
+    bool success = false;
+
+    if (outcome == NULL || !build_model(scenario, &model) || !schedule_simulate(scenario, &greedy, &incumbent)) {
+        return false;
+    }
+
+    // The critical weight exceeds any job count, so one critical job outweighs all others.
+    critical_weight = (int64_t)incumbent.released + 1;
+    incumbent_value =
+        objective_value(incumbent.completed, incumbent.critical_completed, objective, critical_weight);
+    remaining = remaining_release_values(&model, objective, critical_weight);
+    if (remaining == NULL || !frontier_resize(&index, 1024)) {
+        tracked_free(ALLOC_SUBSYSTEM_ORACLE, remaining);
+        handle_error("Out of memory in the schedule oracle");
+        return false;
+    }
+
+    memset(&start, 0, sizeof(start));
+    start.bits = model.task_mask;
+    start.charge_mj = scenario->initial_charge_mj;
+    start.parent = UINT32_MAX;
+    if (!push_state(&current, &start)) {
+        goto done;
+    }
+
+    for (uint32_t slot = 0; slot < scenario->slot_count; slot++) {
+        next.count = 0;
+        if (schedule != NULL) {
+            layer_start = history.count;
+            for (size_t s = 0; s < current.count; s++) {
+                if (!push_state(&history, &current.states[s])) {
+                    goto done;
+                }
+            }
+        }
+
+        for (size_t s = 0; s < current.count; s++) {
+            const OracleState* state = &current.states[s];
+            uint32_t bits = start_slot(&model, slot, state->bits);
+            uint32_t pending = ~bits & model.task_mask;
+            int64_t bound = state->value + remaining[slot + 1];
+
+            // Jobs pending now were released at or before this slot.
+            for (uint8_t i = 0; i < scenario->task_count; i++) {
+                if ((pending & (1u << i)) != 0) {
+                    bool critical = objective == ORACLE_MAXIMIZE_CRITICAL && scenario->tasks[i].critical;
+                    bound += critical ? critical_weight + 1 : 1;
+                }
+            }
+            if (bound < incumbent_value) {
+                continue;
+            }
+
+            expanded++;
+            for (uint32_t subset = pending;; subset = (subset - 1) & pending) {
+                OracleState candidate = *state;
+                uint32_t ran = 0;
+
+                candidate.bits = bits;
+                ran = execute_slot(&model, model.order, slot, &candidate.bits, subset, &candidate.charge_mj,
+                                   &candidate.wasted_mj);
+                // Failed attempts leave the same state as the subset that ran, enumerated on its own.
+                if (ran == subset) {
+                    candidate.completed += count_bits(ran);
+                    candidate.critical += count_critical(scenario, ran);
+                    candidate.consumed_mj += ran_energy(scenario, ran);
+                    candidate.value = objective_value(candidate.completed, candidate.critical, objective, critical_weight);
+                    candidate.parent = (uint32_t)(layer_start + s);
+                    candidate.ran = ran;
+                    if (!frontier_insert(&index, &next, &candidate)) {
+                        goto done;
+                    }
+                }
+                if (subset == 0) {
+                    break;
+                }
+            }
+        }
+
+        frontier_next_layer(&index, &next);
+        {
+            StateArray swap = current;
+            current = next;
+            next = swap;
+        }
+    }
+
+    if (current.count > 0) {
+        const OracleState* best = &current.states[0];
+
+        for (size_t s = 1; s < current.count; s++) {
+            if (current.states[s].value > best->value) {
+                best = &current.states[s];
+            }
+        }
+
+        memset(outcome, 0, sizeof(*outcome));
+        count_releases(&model, outcome);
+        outcome->completed = best->completed;
+        outcome->critical_completed = best->critical;
+        outcome->consumed_mj = best->consumed_mj;
+        outcome->wasted_mj = best->wasted_mj;
+        outcome->states = expanded;
+
+        if (schedule != NULL) {
+            uint32_t index = best->parent;
+
+            schedule[scenario->slot_count - 1] = best->ran;
+            for (uint32_t slot = scenario->slot_count - 1; slot-- > 0;) {
+                schedule[slot] = history.states[index].ran;
+                index = history.states[index].parent;
+            }
+        }
+        success = true;
+    } else {
+        // Every state was pruned, so greedy is optimal.
+        *outcome = incumbent;
+        outcome->states = expanded;
+        success = schedule == NULL;
+    }
+
+done:
+    if (!success && current.count > 0) {
+        handle_error("Schedule oracle failed");
+    }
+    tracked_free(ALLOC_SUBSYSTEM_ORACLE, remaining);
+    tracked_free(ALLOC_SUBSYSTEM_ORACLE, history.states);
+    tracked_free(ALLOC_SUBSYSTEM_ORACLE, current.states);
+    tracked_free(ALLOC_SUBSYSTEM_ORACLE, next.states);
+    tracked_free(ALLOC_SUBSYSTEM_ORACLE, index.keys);
+    tracked_free(ALLOC_SUBSYSTEM_ORACLE, index.heads);
+    tracked_free(ALLOC_SUBSYSTEM_ORACLE, index.stamps);
+    return success;
+}
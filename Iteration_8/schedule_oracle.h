@@ -0,0 +1,128 @@
+#ifndef SCHEDULE_ORACLE_H
+#define SCHEDULE_ORACLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "lookahead_planner.h"
+
+/**
+ * \brief Maximum number of tasks of a scenario.
+ */
+#define ORACLE_MAX_TASKS 10
+
+/**
+ * \brief Maximum number of tasks plus dependencies of a scenario, the bits of a DP state.
+ */
+#define ORACLE_MAX_STATE_BITS 32
+
+/**
+ * \brief What the oracle maximizes.
+ */
+typedef enum {
+    ORACLE_MAXIMIZE_TASKS,    ///< Completed jobs.
+    ORACLE_MAXIMIZE_CRITICAL  ///< Completed critical jobs, then completed jobs.
+} OracleObjective;
+
+/**
+ * \brief Periodic task set run against a known harvest trace.
+ *
+ * Jobs follow the PlanTask model. In each slot the attempted jobs run in
+ * dependency order; a job runs if its dependencies completed in its window
+ * and the energy allows: it draws the slot's harvest first, then the
+ * battery, which a non-critical job may not take below the reserve. Harvest
+ * left at the end of the slot charges the battery up to its capacity.
+ */
+typedef struct {
+    const PlanTask* tasks;       ///< Periodic tasks.
+    uint8_t task_count;          ///< Number of tasks, at most ORACLE_MAX_TASKS.
+    const float* harvest_mj;     ///< Energy harvested in each slot.
+    uint32_t slot_count;         ///< Number of slots.
+    float capacity_mj;           ///< Battery capacity.
+    float reserve_mj;            ///< Charge non-critical jobs may not use.
+    float initial_charge_mj;     ///< Battery charge at the start of slot 0.
+} ScheduleScenario;
+
+/**
+ * \brief Result of running a scenario.
+ */
+typedef struct {
+    uint32_t released;             ///< Jobs released.
+    uint32_t completed;            ///< Jobs completed.
+    uint32_t critical_released;    ///< Critical jobs released.
+    uint32_t critical_completed;   ///< Critical jobs completed.
+    double consumed_mj;            ///< Energy used by the completed jobs.
+    double wasted_mj;              ///< Harvest lost to a full battery.
+    uint64_t states;               ///< DP states expanded by the oracle.
+} ScheduleOutcome;
+
+/**
+ * \brief Online policy driven by schedule_simulate().
+ */
+typedef struct {
+    /**
+     * \brief Chooses the tasks to attempt in a slot.
+     *
+     * \param context Policy data.
+     * \param slot Current slot.
+     * \param charge_mj Battery charge at the start of the slot.
+     * \param pending Bit i set when task i has a job waiting in its window.
+     * \return Tasks to attempt, bit i for task i.
+     */
+    uint32_t (*choose)(void* context, uint32_t slot, float charge_mj, uint32_t pending);
+    /**
+     * \brief Optional notification that a task completed in the current slot.
+     */
+    void (*completed)(void* context, uint8_t task);
+    void* context;   ///< Policy data.
+    /**
+     * \brief Order in which the attempted jobs of a slot run, or NULL for dependency order.
+     *
+     * A job whose dependencies have not run yet in its window waits for them
+     * within the slot, like a task deferred by execute_tasks().
+     */
+    const uint8_t* order;
+} SchedulePolicy;
+
+/**
+ * \brief Orders tasks by decreasing rank, ties keeping the task order.
+ *
+ * Applied to the ranks of a SchedulingPolicy, it gives the execution order
+ * of that policy for SchedulePolicy.order.
+ *
+ * \param ranks Rank of each task.
+ * \param count Number of tasks, at most ORACLE_MAX_TASKS.
+ * \param order Destination of the task indexes, highest rank first.
+ */
+void schedule_order_by_rank(const float* ranks, uint8_t count, uint8_t* order);
+
+/**
+ * \brief Runs an online policy over a scenario.
+ *
+ * \param scenario Scenario to run.
+ * \param policy Policy choosing the attempted jobs.
+ * \param outcome Destination of the result.
+ * \return False if the scenario is invalid.
+ */
+bool schedule_simulate(const ScheduleScenario* scenario, const SchedulePolicy* policy, ScheduleOutcome* outcome);
+
+/**
+ * \brief Computes an optimal offline schedule of a scenario.
+ *
+ * Dynamic programming over the slots. A state is the set of tasks with a
+ * pending job, which dependencies completed in their dependent's window, and
+ * the battery charge. Charges are kept exact: for each set only the Pareto
+ * frontier of (charge, value) survives, since a state with less charge and no
+ * more value can never do better. States that cannot beat the greedy
+ * schedule even by completing every remaining job are pruned too.
+ *
+ * \param scenario Scenario to solve.
+ * \param objective Quantity to maximize.
+ * \param schedule Destination of the jobs run in each slot, bit i for task i, or NULL.
+ * \param outcome Destination of the optimal result.
+ * \return False if the scenario is invalid or memory runs out.
+ */
+bool schedule_oracle_solve(const ScheduleScenario* scenario, OracleObjective objective, uint32_t* schedule,
+                           ScheduleOutcome* outcome);
+
+#endif // SCHEDULE_ORACLE_H
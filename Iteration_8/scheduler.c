@@ -0,0 +1,865 @@
+#include "scheduler.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "energy_forecast_model.h"
+#include "error_handling.h"
+
+#define FORECAST_ALPHA 0.3f
+#define FORECAST_BETA 0.01f
+#define FORECAST_GAMMA 0.3f
+#define DEFAULT_PLAN_HORIZON 24
+#define DEFAULT_FLEET_VARIATION 0.2f
+#define DEFAULT_SEED 1
+#define DEEP_SLEEP_MS_PER_HOUR 5000u
+#define TICKLESS_MAX_IDLE_HOURS 24u
+#define MS_PER_SECOND 1000u
+#define MS_PER_HOUR ((uint64_t)SECONDS_PER_HOUR * MS_PER_SECOND)
+#define TASK_RELEASE_PERIOD_MS MS_PER_HOUR
+
+#define TOUCH_STATE(context, field) \
+    checkpoint_mark_dirty(&(context)->checkpoint_store, offsetof(NodeState, field), sizeof((context)->node.field))
+
+// offsetof() only takes constant designators in ISO C, so elements picked at run time are located by hand.
+#define TOUCH_STATE_ELEMENT(context, array, index)                                                          \
+    checkpoint_mark_dirty(&(context)->checkpoint_store,                                                     \
+                          offsetof(NodeState, array) + (size_t)(index) * sizeof((context)->node.array[0]), \
+                          sizeof((context)->node.array[0]))
+
+/**
+ * \brief Sampling, averaging and transmission tasks of a fresh node.
+ */
+static const Task default_tasks[NUM_SIMULATION_TASKS] = {
+    {NULL, 5000, 2, 3, false, 0.0f, false, NULL, 0, 5.0f},
+    {NULL, 5000, 1, 2, true, 0.0f, false, NULL, 0, 2.0f},
+    {NULL, 1000, 3, 1, true, 0.0f, false, NULL, 0, 60.0f}
+};
+
+/**
+ * \brief Harvesters and battery source of a fresh node.
+ */
+static const EnergySource default_energy_sources[NUM_ENERGY_SOURCES] = {
+    {WIND, 6, 3, 3, {0}, 0.0f, 0.02f, 0},
+    {SOLAR, 7, 10, 1, {0}, 0.0f, 0.05f, 0},
+    {BATTERY, 0, 0, 0, {0}, 1.0f, 0.0f, 0}
+};
+
+static const BatteryState default_battery = {400.0f, 200.0f, 120.0f};
+
+static void incrementTaskCounter(SchedulerContext* context, const char* taskName) {
+    context->node.global_taskcounter++;
+    TOUCH_STATE(context, global_taskcounter);
+    context->summary.executed++;
+    console_print(&context->hardware, "%u tasks executed so far. Last task: %s\n", context->node.global_taskcounter, taskName);
+}
+
+static const char* option_value(const char* argument, const char* name) {
+    size_t length = strlen(name);
+
+    if (strncmp(argument, name, length) == 0 && argument[length] == '=') {
+        return argument + length + 1;
+    }
+    return NULL;
+}
+
+/**
+ * \brief Parses exactly `count` comma-separated numbers.
+ */
+static bool parse_values(const char* text, float* values, size_t count) {
+    char* end = NULL;
+
+    for (size_t i = 0; i < count; i++) {
+        values[i] = strtof(text, &end);
+        if (end == text || values[i] < 0.0f || *end != (i + 1 < count ? ',' : '\0')) {
+            return false;
+        }
+        text = end + 1;
+    }
+    return true;
+}
+
+void scheduler_default_options(SchedulerOptions* options) {
+    memset(options, 0, sizeof(*options));
+    options->duration_days = 1;
+    options->checkpoint_policy = CHECKPOINT_EVERY_TASK;
+    options->time_scale = 1.0f;
+    options->history_days = DEFAULT_HISTORY_DAYS;
+    options->policy = scheduling_policy_default();
+    options->plan_horizon = DEFAULT_PLAN_HORIZON;
+    options->goal = MAXIMIZE_RESILIENCE;
+    for (size_t i = 0; i < NUM_SIMULATION_TASKS; i++) {
+        options->task_priorities[i] = -1.0f;
+        options->task_weights[i] = -1.0f;
+    }
+    for (size_t i = 0; i < NUM_ENERGY_SOURCES; i++) {
+        for (size_t f = 0; f < SOURCE_PROFILE_FIELDS; f++) {
+            options->source_profiles[i][f] = -1.0f;
+        }
+    }
+    for (size_t f = 0; f < BATTERY_FIELDS; f++) {
+        options->battery[f] = -1.0f;
+    }
+    options->fleet_variation = DEFAULT_FLEET_VARIATION;
+    options->seed = DEFAULT_SEED;
+    options->power_model.active_w = POWER_MODEL_DEFAULT_ACTIVE_W;
+    options->power_model.idle_w = POWER_MODEL_DEFAULT_IDLE_W;
+    options->power_model.calibrated = false;
+}
+
+bool scheduler_parse_options(int argc, char* argv[], SchedulerOptions* options) {
+    scheduler_default_options(options);
+    for (int i = 1; i < argc; i++) {
+        const char* value = NULL;
+
+        if ((value = option_value(argv[i], "--checkpoint")) != NULL) {
+            options->checkpoint_path = value;
+        } else if ((value = option_value(argv[i], "--checkpoint-policy")) != NULL) {
+            if (strcmp(value, "task") == 0) {
+                options->checkpoint_policy = CHECKPOINT_EVERY_TASK;
+            } else if (strcmp(value, "cycle") == 0) {
+                options->checkpoint_policy = CHECKPOINT_EVERY_CYCLE;
+            } else {
+                return false;
+            }
+        } else if ((value = option_value(argv[i], "--time-scale")) != NULL) {
+            options->time_scale = (float)atof(value);
+        } else if ((value = option_value(argv[i], "--history-days")) != NULL) {
+            options->history_days = (uint16_t)strtoul(value, NULL, 10);
+        } else if ((value = option_value(argv[i], "--history-alpha")) != NULL) {
+            options->history_alpha = (float)atof(value);
+        } else if ((value = option_value(argv[i], "--fault-at")) != NULL) {
+            options->faults.fail_at_point = (uint32_t)strtoul(value, NULL, 10);
+        } else if ((value = option_value(argv[i], "--fault-rate")) != NULL) {
+            options->faults.failure_rate = (float)atof(value);
+        } else if ((value = option_value(argv[i], "--fault-seed")) != NULL) {
+            options->faults.seed = (uint32_t)strtoul(value, NULL, 10);
+        } else if ((value = option_value(argv[i], "--fault-log")) != NULL) {
+            options->faults.log_path = value;
+        } else if ((value = option_value(argv[i], "--wind-trace")) != NULL) {
+            options->trace_paths[WIND] = value;
+        } else if ((value = option_value(argv[i], "--solar-trace")) != NULL) {
+            options->trace_paths[SOLAR] = value;
+        } else if (strcmp(argv[i], "--trace-loop") == 0) {
+            options->trace_loop = true;
+        } else if ((value = option_value(argv[i], "--scheduler")) != NULL) {
+            options->policy = scheduling_policy_find(value);
+            if (options->policy == NULL) {
+                return false;
+            }
+        } else if ((value = option_value(argv[i], "--plan-horizon")) != NULL) {
+            options->plan_horizon = (uint16_t)strtoul(value, NULL, 10);
+            if (options->plan_horizon == 0 || options->plan_horizon > PLAN_MAX_HORIZON) {
+                return false;
+            }
+        } else if ((value = option_value(argv[i], "--goal")) != NULL) {
+            if (strcmp(value, "tasks") == 0) {
+                options->goal = MAXIMIZE_TASKS;
+            } else if (strcmp(value, "resilience") == 0) {
+                options->goal = MAXIMIZE_RESILIENCE;
+            } else {
+                return false;
+            }
+        } else if ((value = option_value(argv[i], "--priorities")) != NULL) {
+            if (!parse_values(value, options->task_priorities, NUM_SIMULATION_TASKS)) {
+                return false;
+            }
+        } else if ((value = option_value(argv[i], "--weights")) != NULL) {
+            if (!parse_values(value, options->task_weights, NUM_SIMULATION_TASKS)) {
+                return false;
+            }
+        } else if ((value = option_value(argv[i], "--solar")) != NULL) {
+            if (!parse_values(value, options->source_profiles[SOLAR], SOURCE_PROFILE_FIELDS)) {
+                return false;
+            }
+        } else if ((value = option_value(argv[i], "--wind")) != NULL) {
+            if (!parse_values(value, options->source_profiles[WIND], SOURCE_PROFILE_FIELDS)) {
+                return false;
+            }
+        } else if ((value = option_value(argv[i], "--battery")) != NULL) {
+            if (!parse_values(value, options->battery, BATTERY_FIELDS)) {
+                return false;
+            }
+        } else if (strcmp(argv[i], "--summary") == 0) {
+            options->summary = true;
+        } else if ((value = option_value(argv[i], "--fleet")) != NULL) {
+            options->fleet_nodes = (uint32_t)strtoul(value, NULL, 10);
+        } else if ((value = option_value(argv[i], "--fleet-variation")) != NULL) {
+            options->fleet_variation = (float)atof(value);
+            if (options->fleet_variation < 0.0f || options->fleet_variation > 1.0f) {
+                return false;
+            }
+        } else if ((value = option_value(argv[i], "--seed")) != NULL) {
+            options->seed = strtoull(value, NULL, 10);
+        } else if ((value = option_value(argv[i], "--profile")) != NULL) {
+            options->profile_path = value;
+        } else if ((value = option_value(argv[i], "--power-model")) != NULL) {
+            float coefficients[2];
+
+            if (!parse_values(value, coefficients, 2)) {
+                return false;
+            }
+            options->power_model.active_w = coefficients[0];
+            options->power_model.idle_w = coefficients[1];
+            options->power_model.calibrated = true;
+        } else if (strcmp(argv[i], "--calibrate-power") == 0) {
+            options->calibrate_power = true;
+        } else if (strcmp(argv[i], "--tickless") == 0) {
+            options->tickless = true;
+        } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+            return false;
+        } else {
+            options->duration_days = atoi(argv[i]);
+            if (options->duration_days < 0 || (unsigned)options->duration_days > MAX_DURATION_DAYS) {
+                return false;
+            }
+        }
+    }
+
+    options->infinite_loop = (options->duration_days == 0);
+    // A fleet reports its statistics at the end, so it needs a finite run.
+    return !(options->infinite_loop && options->fleet_nodes > 0);
+}
+
+static float read_temperature(SchedulerContext* context) {
+    const float min_temperature = -40.0f;
+    const float max_temperature = 60.0f;
+    float random_value = prng_unit(&context->node.sensor_random);
+    float temperature = min_temperature + random_value * (max_temperature - min_temperature);
+    float rounded_temperature = ((int)(temperature * 10.0f)) / 10.0f;
+
+    TOUCH_STATE(context, sensor_random);
+
+    console_print(&context->hardware, "Read a temperature of %.1f C\n", rounded_temperature);
+    return rounded_temperature;
+}
+
+static float average_temperature(const SchedulerContext* context) {
+    float sum = 0.0f;
+    uint8_t count = context->node.buffer_full ? NUM_MEASURES : context->node.measure_index;
+
+    for (uint8_t i = 0; i < count; i++) {
+        sum += context->node.temperature_values[i];
+    }
+
+    return count > 0 ? (sum / count) : 0.0f;
+}
+
+static void runTempTask(void* task_context) {
+    SchedulerContext* context = task_context;
+    float temperature = read_temperature(context);
+
+    FAULT_POINT(FAULT_SITE_TASK_BODY);
+    context->node.temperature_values[context->node.measure_index] = temperature;
+    TOUCH_STATE_ELEMENT(context, temperature_values, context->node.measure_index);
+    context->node.measure_index = (context->node.measure_index + 1) % NUM_MEASURES;
+    TOUCH_STATE(context, measure_index);
+    if (context->node.measure_index == 0) {
+        context->node.buffer_full = true;
+        TOUCH_STATE(context, buffer_full);
+    }
+
+    incrementTaskCounter(context, "runTempTask");
+}
+
+static void computeAvgTempTask(void* task_context) {
+    SchedulerContext* context = task_context;
+
+    if (!context->node.buffer_full) {
+        console_print(&context->hardware, "Skipping average computation until the sample buffer is full.\n");
+        return;
+    }
+
+    console_print(&context->hardware, "Average of collected temperatures: %.2f C\n", average_temperature(context));
+    incrementTaskCounter(context, "computeAvgTempTask");
+}
+
+static void sendResultTask(void* task_context) {
+    SchedulerContext* context = task_context;
+
+    if (!context->node.buffer_full) {
+        console_print(&context->hardware, "Skipping data transmission until the sample buffer is full.\n");
+        return;
+    }
+
+    blink_led(&context->hardware, NUM_MEASURES);
+    FAULT_POINT(FAULT_SITE_TASK_BODY);
+    context->node.buffer_full = false;
+    context->node.measure_index = 0;
+    TOUCH_STATE(context, buffer_full);
+    TOUCH_STATE(context, measure_index);
+    context->summary.reports++;
+    incrementTaskCounter(context, "sendResultTask");
+}
+
+static void update_simulated_hour(SchedulerContext* context) {
+    context->node.simulated_hour = (context->node.simulated_hour + 1) % 24;
+    if (context->node.simulated_hour == 0) {
+        context->node.simulated_day++;
+    }
+    TOUCH_STATE(context, simulated_hour);
+    TOUCH_STATE(context, simulated_day);
+}
+
+SimTime scheduler_time(const SchedulerContext* context) {
+    return (SimTime)context->node.simulated_day * SECONDS_PER_DAY + (SimTime)context->node.simulated_hour * SECONDS_PER_HOUR;
+}
+
+/**
+ * \brief Tick of the timer wheel at the current simulated hour.
+ *
+ * Counted in 64 bits from the day and hour rather than from scheduler_time(),
+ * whose SimTime wraps in an endless run: the wheel clock must never move back.
+ */
+static uint64_t scheduler_tick(const SchedulerContext* context) {
+    return ((uint64_t)context->node.simulated_day * 24u + context->node.simulated_hour) * MS_PER_HOUR;
+}
+
+static void commit_checkpoint(SchedulerContext* context) {
+    if (context->checkpoint_store.mapping != NULL && !checkpoint_commit(&context->checkpoint_store)) {
+        handle_error("Checkpoint commit failed, progress since the last commit is volatile");
+    }
+}
+
+/**
+ * \brief Makes a completed task runnable again at the start of its next period.
+ */
+static void release_simulation_task(WheelTimer* timer, void* timer_context) {
+    SchedulerContext* context = timer_context;
+    size_t index = (size_t)(timer - context->release_timers);
+
+    context->node.task_completed[index] = false;
+    TOUCH_STATE_ELEMENT(context, task_completed, index);
+}
+
+/**
+ * \brief Starts the clock of the timers and re-arms the releases of the restored completions.
+ *
+ * A task completed in an interrupted cycle is released at the next hour;
+ * one completed in an hour that ended is released at once.
+ */
+static void setup_timers(SchedulerContext* context) {
+    uint64_t now = scheduler_tick(context);
+    uint64_t release = context->node.cycle_in_progress ? now + MS_PER_HOUR : now;
+
+    timer_wheel_init(&context->timers, now);
+    for (size_t i = 0; i < NUM_SIMULATION_TASKS; i++) {
+        wheel_timer_init(&context->release_timers[i], release_simulation_task, context);
+        if (context->node.task_completed[i]) {
+            timer_wheel_schedule(&context->timers, &context->release_timers[i], release, 0);
+        }
+    }
+    set_task_timers(context->queue, &context->timers);
+}
+
+static void on_simulation_task_completed(Task* task, void* hook_context) {
+    SchedulerContext* context = hook_context;
+    size_t index = (size_t)(task - context->tasks);
+
+    if (context->energy_meter != NULL) {
+        energy_meter_task_end(context->energy_meter, index);
+    }
+    context->node.task_completed[index] = true;
+    TOUCH_STATE_ELEMENT(context, task_completed, index);
+    context->summary.completions[index]++;
+    context->summary.consumed_mj += task->energy_cost_mj;
+    timer_wheel_schedule(&context->timers, &context->release_timers[index],
+                         (context->timers.now / TASK_RELEASE_PERIOD_MS + 1u) * TASK_RELEASE_PERIOD_MS, 0);
+    if (context->options.policy->plans_ahead) {
+        lookahead_planner_complete(&context->node.planner, (uint8_t)index);
+        TOUCH_STATE(context, planner);
+    }
+    TOUCH_STATE(context, battery);
+    if (context->options.checkpoint_policy == CHECKPOINT_EVERY_TASK) {
+        commit_checkpoint(context);
+    }
+    // The checkpoint commit stays in the tasks phase but is left out of the next task.
+    if (context->energy_meter != NULL) {
+        energy_meter_task_begin(context->energy_meter);
+    }
+}
+
+static void restore_node_state(SchedulerContext* context, const char* checkpoint_path) {
+    struct timespec start;
+    struct timespec end;
+    bool restored = false;
+    long elapsed_ns = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (!checkpoint_open(&context->checkpoint_store, checkpoint_path, &context->node, sizeof(context->node))) {
+        console_print(&context->hardware, "Running without persistence.\n");
+        return;
+    }
+    restored = checkpoint_restore(&context->checkpoint_store);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    elapsed_ns = (end.tv_sec - start.tv_sec) * 1000000000L + (end.tv_nsec - start.tv_nsec);
+    fault_log_event("boot restored=%d restore_ns=%ld", restored ? 1 : 0, elapsed_ns);
+    if (restored) {
+        console_print(&context->hardware, "Resumed day %u hour %u from checkpoint %u in %.1f us.\n",
+               context->node.simulated_day, context->node.simulated_hour,
+               context->checkpoint_store.sequence, elapsed_ns / 1000.0);
+    } else {
+        console_print(&context->hardware, "No valid checkpoint found, starting a fresh run.\n");
+    }
+}
+
+static void enter_energy_phase(SchedulerContext* context, EnergyPhase phase) {
+    if (context->energy_meter != NULL) {
+        energy_meter_enter(context->energy_meter, phase);
+    }
+}
+
+static bool should_schedule(const SchedulerContext* context, size_t task_index) {
+    return !context->options.policy->plans_ahead || lookahead_planner_should_run(&context->node.planner, (uint8_t)task_index);
+}
+
+static bool can_run_any_task(const SchedulerContext* context) {
+    const Task* tasks = context->tasks;
+
+    for (size_t i = 0; i < NUM_SIMULATION_TASKS; i++) {
+        if (should_schedule(context, i) && energy_pool_is_available(&context->energy_pool, scheduler_time(context), tasks[i].energy_cost_mj, tasks[i].critical)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void start_task_cycle(SchedulerContext* context) {
+    context->node.cycle_in_progress = true;
+    TOUCH_STATE(context, cycle_in_progress);
+}
+
+static void report_harvest_forecast(SchedulerContext* context) {
+    float forecast[FORECAST_SEASON_HOURS];
+    float total_mj = 0.0f;
+    size_t hours = seasonal_forecaster_forecast(&context->node.harvest_forecast, forecast, FORECAST_SEASON_HOURS);
+
+    for (size_t i = 0; i < hours; i++) {
+        total_mj += forecast[i];
+    }
+    console_print(&context->hardware, "Day %u forecast: %.1f mJ of harvest, first harvest hour in %u h\n", context->node.simulated_day, total_mj,
+           seasonal_forecaster_next_surplus(&context->node.harvest_forecast, FORECAST_SEASON_HOURS, 1.0f));
+}
+
+/**
+ * \brief Marks the active seconds of the trace-driven sources, updated at the end of every step.
+ */
+static void touch_trace_activity(SchedulerContext* context) {
+    for (size_t i = 0; i < NUM_ENERGY_SOURCES; i++) {
+        EnergyType type = context->node.energy_sources[i].type;
+
+        if (type != BATTERY && context->options.trace_paths[type] != NULL) {
+            checkpoint_mark_dirty(&context->checkpoint_store,
+                                  offsetof(NodeState, energy_sources) + i * sizeof(EnergySource) +
+                                      offsetof(EnergySource, active_seconds),
+                                  sizeof(context->node.energy_sources[i].active_seconds));
+        }
+    }
+}
+
+static void finish_simulated_hour(SchedulerContext* context) {
+    context->summary.harvested_mj += context->energy_pool.step_harvest_mj;
+    seasonal_forecaster_update(&context->node.harvest_forecast, context->node.simulated_hour, context->energy_pool.step_harvest_mj);
+    TOUCH_STATE(context, harvest_forecast);
+    energy_pool_end_step(&context->energy_pool);
+    TOUCH_STATE(context, battery);
+    touch_trace_activity(context);
+    context->node.cycle_in_progress = false;
+    TOUCH_STATE(context, cycle_in_progress);
+    update_simulated_hour(context);
+    if (context->node.simulated_hour == 0) {
+        // The history holds one sample per day, recorded once the day is over.
+        energy_pool_update_profiles(&context->energy_pool);
+        TOUCH_STATE(context, energy_sources);
+        report_harvest_forecast(context);
+    }
+    commit_checkpoint(context);
+}
+
+static bool setup_energy_pool(SchedulerContext* context) {
+    const SchedulerOptions* options = &context->options;
+
+    energy_pool_init(&context->energy_pool);
+    for (size_t i = 0; i < NUM_ENERGY_SOURCES; i++) {
+        EnergyType type = context->node.energy_sources[i].type;
+
+        if (type == BATTERY) {
+            energy_pool_add_battery(&context->energy_pool, &context->node.energy_sources[i], &context->node.battery);
+        } else if (options->trace_paths[type] != NULL) {
+            if (!energy_trace_open(&context->energy_traces[type], options->trace_paths[type], options->trace_loop)) {
+                return false;
+            }
+            energy_pool_add_trace(&context->energy_pool, &context->node.energy_sources[i], &context->energy_traces[type]);
+        } else {
+            energy_pool_add_source(&context->energy_pool, &context->node.energy_sources[i]);
+        }
+    }
+    return true;
+}
+
+/**
+ * \brief Forecasts the harvest power of the next hour from the last day of harvest.
+ *
+ * \param now Start of the hour to forecast.
+ * \return Forecast power in milliwatts, summed over all harvesters.
+ */
+static float forecast_harvest_power(SchedulerContext* context, SimTime now) {
+    float history[ENERGY_FORECAST_HISTORY_HOURS];
+    float peak_mw = 0.0f;
+
+    for (size_t i = 0; i < NUM_ENERGY_SOURCES; i++) {
+        if (context->node.energy_sources[i].type != BATTERY) {
+            peak_mw += context->node.energy_sources[i].harvest_power_mw;
+        }
+    }
+    if (peak_mw <= 0.0f) {
+        return 0.0f;
+    }
+
+    // Hours before the start of the simulation wrap onto the daily profile.
+    for (size_t i = 0; i < ENERGY_FORECAST_HISTORY_HOURS; i++) {
+        SimTime hour = now + SECONDS_PER_DAY - (SimTime)(ENERGY_FORECAST_HISTORY_HOURS - i) * SECONDS_PER_HOUR;
+        history[i] = availability_index_power_at(&context->energy_pool.harvest, hour) / peak_mw;
+    }
+
+    return predict_energy(&context->ml_model, history, ENERGY_FORECAST_HISTORY_HOURS) * peak_mw;
+}
+
+/**
+ * \brief Fills the planner's horizon with the hourly harvest forecast.
+ *
+ * Until the seasonal forecaster has seen a whole day, the compiled schedule
+ * of the harvesters stands in for it.
+ */
+static void forecast_hourly_harvest(SchedulerContext* context, SimTime now, float* forecast, size_t hours) {
+    if (context->node.harvest_forecast.observations >= FORECAST_SEASON_HOURS &&
+        seasonal_forecaster_forecast(&context->node.harvest_forecast, forecast, hours) == hours) {
+        return;
+    }
+
+    for (size_t k = 0; k < hours; k++) {
+        SimTime start = now + (SimTime)k * SECONDS_PER_HOUR;
+        forecast[k] = (float)availability_index_expected_energy(&context->energy_pool.harvest, start, start + SECONDS_PER_HOUR);
+    }
+}
+
+static void plan_simulated_hour(SchedulerContext* context, SimTime now) {
+    float forecast[PLAN_MAX_HORIZON];
+
+    forecast_hourly_harvest(context, now, forecast, context->node.planner.horizon);
+    lookahead_planner_replan(&context->node.planner, now / SECONDS_PER_HOUR, forecast, context->node.battery.charge_mj);
+    TOUCH_STATE(context, planner);
+}
+
+/**
+ * \brief Describes the simulation tasks to the lookahead planner.
+ *
+ * The transmission only has data once the sample buffer is full, so it may
+ * run in any hour of a NUM_MEASURES-hour window; sampling and averaging run
+ * every hour.
+ */
+static bool setup_lookahead_planner(SchedulerContext* context) {
+    static const uint16_t periods[NUM_SIMULATION_TASKS] = {1, 1, NUM_MEASURES};
+    const Task* tasks = context->tasks;
+    PlanTask plan_tasks[NUM_SIMULATION_TASKS];
+
+    for (size_t i = 0; i < NUM_SIMULATION_TASKS; i++) {
+        plan_tasks[i].energy_mj = tasks[i].energy_cost_mj;
+        plan_tasks[i].period_slots = periods[i];
+        plan_tasks[i].deadline_slots = periods[i];
+        plan_tasks[i].critical = tasks[i].critical;
+        plan_tasks[i].dependency_mask = 0;
+        for (uint8_t d = 0; d < tasks[i].num_dependencies; d++) {
+            plan_tasks[i].dependency_mask |= 1u << (tasks[i].dependencies[d] - tasks);
+        }
+    }
+    return lookahead_planner_init(&context->node.planner, plan_tasks, NUM_SIMULATION_TASKS, context->options.plan_horizon,
+                                  context->node.battery.capacity_mj, context->node.battery.reserve_mj);
+}
+
+/**
+ * \brief Replaces the default tasks, harvesters and battery with the command-line values.
+ *
+ * \return False if a value is out of range.
+ */
+static bool apply_run_options(SchedulerContext* context) {
+    const SchedulerOptions* options = &context->options;
+    Task* tasks = context->tasks;
+    EnergySource* sources = context->node.energy_sources;
+    BatteryState* battery = &context->node.battery;
+
+    for (size_t i = 0; i < NUM_SIMULATION_TASKS; i++) {
+        if (options->task_priorities[i] > UINT8_MAX || options->task_weights[i] > UINT8_MAX) {
+            return false;
+        }
+        if (options->task_priorities[i] >= 0.0f) {
+            tasks[i].priority = (uint8_t)options->task_priorities[i];
+        }
+        if (options->task_weights[i] >= 0.0f) {
+            tasks[i].weight = (uint8_t)options->task_weights[i];
+        }
+    }
+
+    for (size_t i = 0; i < NUM_ENERGY_SOURCES; i++) {
+        const float* profile = options->source_profiles[sources[i].type];
+
+        if (sources[i].type == BATTERY || profile[0] < 0.0f) {
+            continue;
+        }
+        if (profile[0] >= 24.0f || profile[1] < 1.0f || profile[1] > 24.0f || profile[2] < 1.0f ||
+            profile[1] * profile[2] > 24.0f) {
+            return false;
+        }
+        sources[i].start_hour = (uint8_t)profile[0];
+        sources[i].duration_hours = (uint8_t)profile[1];
+        sources[i].occurrences_per_day = (uint8_t)profile[2];
+        sources[i].harvest_power_mw = profile[3];
+    }
+
+    if (options->battery[0] >= 0.0f) {
+        if (options->battery[1] > options->battery[0] || options->battery[2] > options->battery[0]) {
+            return false;
+        }
+        battery->capacity_mj = options->battery[0];
+        battery->charge_mj = options->battery[1];
+        battery->reserve_mj = options->battery[2];
+    }
+    return true;
+}
+
+/**
+ * \brief Collects the tasks still to run in the current cycle.
+ *
+ * \return Number of tasks written to pending.
+ */
+static size_t collect_pending_tasks(SchedulerContext* context, Task** pending) {
+    Task* tasks = context->tasks;
+    size_t count = 0;
+
+    for (size_t i = 0; i < NUM_SIMULATION_TASKS; i++) {
+        // Tasks left for a later hour count as done, so planned dependents are not held back.
+        tasks[i].completed = context->node.task_completed[i] || !should_schedule(context, i);
+        if (!tasks[i].completed) {
+            pending[count++] = &tasks[i];
+        }
+    }
+    return count;
+}
+
+bool scheduler_init(SchedulerContext* context, const SchedulerOptions* options, FILE* console) {
+    memset(context, 0, sizeof(*context));
+    context->checkpoint_store.fd = -1;
+    for (size_t i = 0; i < NUM_ENERGY_SOURCES; i++) {
+        context->energy_traces[i].fd = -1;
+    }
+    context->options = *options;
+    // Seeded before the restore, which resumes the sensor sequence of the interrupted run.
+    prng_seed(&context->node.sensor_random, options->seed, SCHEDULER_STREAM_SENSOR);
+
+    init_peripherals(&context->hardware, console);
+    set_time_scale(&context->hardware, options->time_scale);
+    context->queue = init_task_queue(MAX_TASKS);
+    if (context->queue == NULL) {
+        return false;
+    }
+
+    memcpy(context->tasks, default_tasks, sizeof(default_tasks));
+    context->tasks[0].taskFunction = runTempTask;
+    context->tasks[1].taskFunction = computeAvgTempTask;
+    context->tasks[2].taskFunction = sendResultTask;
+    memcpy(context->node.energy_sources, default_energy_sources, sizeof(default_energy_sources));
+    context->node.battery = default_battery;
+    if (!apply_run_options(context)) {
+        handle_error("Invalid task, harvester or battery configuration");
+        scheduler_close(context);
+        return false;
+    }
+    context->goal_params.goal = options->goal;
+    context->goal_params.duration_days = (uint32_t)options->duration_days;
+
+    seasonal_forecaster_init(&context->node.harvest_forecast, FORECAST_ALPHA, FORECAST_BETA, FORECAST_GAMMA);
+    for (size_t i = 0; i < NUM_ENERGY_SOURCES; i++) {
+        StreamStatsMode mode = options->history_alpha > 0.0f ? STREAM_STATS_EXPONENTIAL : STREAM_STATS_WINDOW;
+        if (!configure_energy_history(&context->node.energy_sources[i], mode, options->history_days, options->history_alpha)) {
+            scheduler_close(context);
+            return false;
+        }
+    }
+    context->compute_dependencies[0] = &context->tasks[0];
+    context->send_dependencies[0] = &context->tasks[1];
+    context->tasks[1].dependencies = context->compute_dependencies;
+    context->tasks[1].num_dependencies = 1;
+    context->tasks[2].dependencies = context->send_dependencies;
+    context->tasks[2].num_dependencies = 1;
+    if (options->policy->plans_ahead && !setup_lookahead_planner(context)) {
+        scheduler_close(context);
+        return false;
+    }
+    if (options->checkpoint_path != NULL) {
+        restore_node_state(context, options->checkpoint_path);
+    } else {
+        fault_log_event("boot restored=0 restore_ns=0");
+    }
+
+    set_task_completion_hook(context->queue, on_simulation_task_completed, context);
+    set_task_context(context->queue, context);
+    setup_timers(context);
+    if (!setup_energy_pool(context)) {
+        scheduler_close(context);
+        return false;
+    }
+    if (load_tinyml_model(&context->ml_model, energy_forecast_model, energy_forecast_model_size, context->tensor_arena,
+                          sizeof(context->tensor_arena))) {
+        console_print(&context->hardware, "Predicted harvest for the next hour: %.3f mW (model uses %zu of %zu arena bytes)\n",
+                      forecast_harvest_power(context, scheduler_time(context)), context->ml_model.engine.arena_used,
+                      sizeof(context->tensor_arena));
+    }
+    return true;
+}
+
+void scheduler_set_energy_meter(SchedulerContext* context, EnergyMeter* meter) {
+    context->energy_meter = meter;
+}
+
+/**
+ * \brief Counts the hours from now to the next event that may let a task run.
+ *
+ * In the dark the battery does not charge, so a node that cannot run any
+ * task now can only run one again once a harvest window starts or a timer
+ * releases a task, at the latest at the end of the run. Measured traces and
+ * the lookahead plan change hour by hour, so they keep the hourly wake-up,
+ * as does an hour that already harvests some energy.
+ *
+ * \return Hours to sleep, at least 1.
+ */
+static uint32_t count_idle_hours(const SchedulerContext* context, SimTime now) {
+    uint64_t current_hour = scheduler_tick(context) / MS_PER_HOUR;
+    uint64_t wake_hour = current_hour + TICKLESS_MAX_IDLE_HOURS;
+    SimTime next_window = SIM_TIME_NEVER;
+    uint64_t next_timer = timer_wheel_next_expiry(&context->timers);
+
+    if (!context->options.tickless || context->options.policy->plans_ahead || context->energy_pool.step_harvest_mj > 0.0f) {
+        return 1;
+    }
+    for (size_t i = 0; i < NUM_ENERGY_SOURCES; i++) {
+        if (context->options.trace_paths[i] != NULL) {
+            return 1;
+        }
+    }
+
+    next_window = availability_index_next_window_start(&context->energy_pool.harvest, now);
+    if (next_window != SIM_TIME_NEVER && next_window >= now &&
+        current_hour + (next_window - now) / SECONDS_PER_HOUR < wake_hour) {
+        wake_hour = current_hour + (next_window - now) / SECONDS_PER_HOUR;
+    }
+    if (next_timer != TIMER_WHEEL_NEVER && next_timer / MS_PER_HOUR < wake_hour) {
+        wake_hour = next_timer / MS_PER_HOUR;
+    }
+    if (!context->options.infinite_loop && (uint64_t)context->goal_params.duration_days * 24u < wake_hour) {
+        wake_hour = (uint64_t)context->goal_params.duration_days * 24u;
+    }
+    return wake_hour > current_hour ? (uint32_t)(wake_hour - current_hour) : 1;
+}
+
+/**
+ * \brief Sleeps until the next wake-up and accounts for every hour slept.
+ */
+static void sleep_until_wakeup(SchedulerContext* context, SimTime now) {
+    uint32_t hours = count_idle_hours(context, now);
+    // Hibernation loses RAM, so it is only allowed to a node that resumes from a checkpoint.
+    PowerState deepest = context->options.checkpoint_path != NULL ? POWER_STATE_HIBERNATE : POWER_STATE_DEEP_SLEEP;
+
+    enter_energy_phase(context, ENERGY_PHASE_IDLE);
+    enter_low_power(&context->hardware, hours * MS_PER_HOUR, deepest, hours * DEEP_SLEEP_MS_PER_HOUR);
+    enter_energy_phase(context, ENERGY_PHASE_SCHEDULING);
+    context->summary.sleep_hours += hours;
+    context->summary.wakeups++;
+
+    // The hours slept are simulated as they would have been polled, with no task and no harvest.
+    finish_simulated_hour(context);
+    for (uint32_t hour = 1; hour < hours; hour++) {
+        now = scheduler_time(context);
+        timer_wheel_advance(&context->timers, scheduler_tick(context));
+        energy_pool_refresh(&context->energy_pool);
+        energy_pool_begin_step(&context->energy_pool, now, now + SECONDS_PER_HOUR);
+        finish_simulated_hour(context);
+    }
+}
+
+bool scheduler_step(SchedulerContext* context) {
+    const SchedulingPolicy* policy = context->options.policy;
+    SimTime now = scheduler_time(context);
+    Task* pending[NUM_SIMULATION_TASKS];
+    PolicyCycle cycle;
+
+    if (!context->options.infinite_loop && context->node.simulated_day >= context->goal_params.duration_days) {
+        return false;
+    }
+
+    timer_wheel_advance(&context->timers, scheduler_tick(context));
+    energy_pool_refresh(&context->energy_pool);
+    energy_pool_begin_step(&context->energy_pool, now, now + SECONDS_PER_HOUR);
+    if (policy->plans_ahead) {
+        plan_simulated_hour(context, now);
+    }
+    if (!context->node.cycle_in_progress && policy->gates_on_energy && !can_run_any_task(context)) {
+        if (policy->deep_sleeps) {
+            sleep_until_wakeup(context, now);
+        } else {
+            finish_simulated_hour(context);
+        }
+        return true;
+    }
+
+    if (!context->node.cycle_in_progress) {
+        start_task_cycle(context);
+    }
+
+    cycle.tasks = pending;
+    cycle.count = collect_pending_tasks(context, pending);
+    cycle.queue = context->queue;
+    cycle.pool = &context->energy_pool;
+    cycle.goal_params = &context->goal_params;
+    cycle.predictability = energy_pool_predictability(&context->energy_pool);
+    cycle.now = now;
+    cycle.hardware = &context->hardware;
+    enter_energy_phase(context, ENERGY_PHASE_TASKS);
+    policy->run_cycle(policy, &cycle);
+    enter_energy_phase(context, ENERGY_PHASE_SCHEDULING);
+    finish_simulated_hour(context);
+    return true;
+}
+
+void scheduler_run(SchedulerContext* context) {
+    while (scheduler_step(context)) {
+    }
+    fault_log_event("run_complete");
+}
+
+void scheduler_print_summary(const SchedulerContext* context, FILE* output) {
+    uint32_t completed = 0;
+
+    for (size_t i = 0; i < NUM_SIMULATION_TASKS; i++) {
+        completed += context->summary.completions[i];
+    }
+    fprintf(output, "summary days=%u seed=%llu completed=%u executed=%u reports=%u", context->node.simulated_day,
+            (unsigned long long)context->options.seed, completed, context->summary.executed, context->summary.reports);
+    for (size_t i = 0; i < NUM_SIMULATION_TASKS; i++) {
+        fprintf(output, " task%zu=%u", i, context->summary.completions[i]);
+    }
+    fprintf(output, " sleep_hours=%u wakeups=%u consumed_mj=%.1f harvested_mj=%.1f battery_mj=%.1f\n",
+            context->summary.sleep_hours, context->summary.wakeups, context->summary.consumed_mj, context->summary.harvested_mj,
+            context->node.battery.charge_mj);
+}
+
+void scheduler_close(SchedulerContext* context) {
+    checkpoint_close(&context->checkpoint_store);
+    for (size_t i = 0; i < NUM_ENERGY_SOURCES; i++) {
+        energy_trace_close(&context->energy_traces[i]);
+    }
+    free_task_queue(context->queue);
+    context->queue = NULL;
+}
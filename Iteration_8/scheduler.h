@@ -0,0 +1,225 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "checkpoint.h"
+#include "energy_manager.h"
+#include "energy_meter.h"
+#include "energy_pool.h"
+#include "energy_trace.h"
+#include "fault_injection.h"
+#include "hardware_abstraction.h"
+#include "lookahead_planner.h"
+#include "prng.h"
+#include "scheduling_policy.h"
+#include "task_manager.h"
+#include "timer_wheel.h"
+
+#define NUM_MEASURES 10
+#define NUM_SIMULATION_TASKS 3
+#define NUM_ENERGY_SOURCES 3
+#define SOURCE_PROFILE_FIELDS 4
+#define BATTERY_FIELDS 3
+#define SCHEDULER_TENSOR_ARENA_SIZE 2048
+
+/**
+ * \brief Longest finite run, in days; later simulated times no longer fit a SimTime.
+ */
+#define MAX_DURATION_DAYS (SIM_TIME_NEVER / SECONDS_PER_DAY - 1u)
+
+/**
+ * \brief Generator streams derived from the seed of a run.
+ *
+ * Fleet node n draws from stream SCHEDULER_STREAM_FLEET + n.
+ */
+#define SCHEDULER_STREAM_SENSOR 0
+#define SCHEDULER_STREAM_FLEET 1
+
+/**
+ * \brief Scheduler and application state that must survive a power failure.
+ *
+ * The structure is the RAM image of the checkpoint file, so every field
+ * written here must be followed by a TOUCH_STATE() of that field.
+ */
+typedef struct {
+    float temperature_values[NUM_MEASURES];
+    uint8_t measure_index;
+    bool buffer_full;
+    uint8_t simulated_hour;
+    uint32_t simulated_day;
+    uint32_t global_taskcounter;                 ///< Task runs that did useful work since the first boot.
+    bool cycle_in_progress;                      ///< A task cycle started in the current hour.
+    bool task_completed[NUM_SIMULATION_TASKS];   ///< Completion flags of the current cycle.
+    EnergySource energy_sources[NUM_ENERGY_SOURCES];
+    BatteryState battery;
+    SeasonalForecaster harvest_forecast;         ///< Hourly harvest forecaster of the pool.
+    LookaheadPlanner planner;                    ///< Hourly plan of the lookahead scheduler.
+    Prng sensor_random;                          ///< Generator of the simulated temperature sensor.
+} NodeState;
+
+_Static_assert(sizeof(NodeState) <= CHECKPOINT_MAX_STATE_SIZE,
+               "NodeState no longer fits a checkpoint; raise CHECKPOINT_MAX_REGIONS");
+
+/**
+ * \brief When progress is committed to the checkpoint file.
+ */
+typedef enum {
+    CHECKPOINT_EVERY_TASK,   ///< After every completed task and every simulated hour.
+    CHECKPOINT_EVERY_CYCLE   ///< Only at the end of every simulated hour.
+} CheckpointPolicy;
+
+/**
+ * \brief Configuration of a run, usually parsed from the command line.
+ */
+typedef struct {
+    int duration_days;
+    bool infinite_loop;
+    const char* checkpoint_path;
+    CheckpointPolicy checkpoint_policy;
+    float time_scale;
+    uint16_t history_days;   ///< Availability history window, in days.
+    float history_alpha;     ///< Exponential history weight; 0 selects the sliding window.
+    FaultConfig faults;
+    const char* trace_paths[NUM_ENERGY_SOURCES]; ///< Harvest trace per EnergyType, NULL for the synthetic profile.
+    bool trace_loop;         ///< Replay traces from the start after their end.
+    const SchedulingPolicy* policy; ///< How the tasks of an hour are chosen.
+    uint16_t plan_horizon;   ///< Hours the lookahead planner looks ahead.
+    GoalType goal;
+    float task_priorities[NUM_SIMULATION_TASKS];  ///< Priority of each task, negative to keep the default.
+    float task_weights[NUM_SIMULATION_TASKS];     ///< Weight of each task, negative to keep the default.
+    float source_profiles[NUM_ENERGY_SOURCES][SOURCE_PROFILE_FIELDS]; ///< Start hour, duration, occurrences and power per EnergyType, negative to keep the default.
+    float battery[BATTERY_FIELDS];                ///< Capacity, charge and reserve, negative to keep the default.
+    bool summary;            ///< Print a one-line summary of the run at the end.
+    uint64_t seed;           ///< Seed of every generator of the run, printed in the summary.
+    uint32_t fleet_nodes;    ///< Nodes of a fleet run, 0 to simulate a single node.
+    float fleet_variation;   ///< Spread of the per-node harvest of a fleet.
+    const char* profile_path; ///< Destination of the JSON resource-usage report of the run, NULL to skip profiling.
+    PowerModel power_model;   ///< Power of the host when the profile cannot read RAPL counters.
+    bool calibrate_power;     ///< Fit power_model to the RAPL counters and print it instead of running.
+    bool tickless;            ///< Sleep through a whole idle period at once instead of waking every hour.
+} SchedulerOptions;
+
+/**
+ * \brief Totals of a scheduler instance since it started, printed by --summary.
+ */
+typedef struct {
+    uint32_t completions[NUM_SIMULATION_TASKS];
+    uint32_t executed;        ///< Completions that did useful work, without the averages and transmissions skipped for want of a full buffer.
+    uint32_t reports;         ///< Transmissions of a full buffer, the reports the node delivered.
+    uint32_t sleep_hours;     ///< Hours spent asleep because no task could run.
+    uint32_t wakeups;         ///< Deep sleeps entered, each ended by one wake-up.
+    double consumed_mj;       ///< Energy of the completed tasks.
+    double harvested_mj;      ///< Energy harvested by all sources.
+} RunSummary;
+
+/**
+ * \brief One simulated node: its board, energy subsystem, tasks and persistent state.
+ *
+ * Every function of the scheduler works on a context and no other mutable
+ * state, so several nodes may run in one process, each on its own thread.
+ * The only process-wide facility is fault injection, whose failures end the
+ * whole process; leave it disabled when running several contexts.
+ */
+typedef struct {
+    NodeState node;                       ///< State persisted by the checkpoint.
+    CheckpointStore checkpoint_store;     ///< Checkpoint file of the node, if any.
+    SchedulerOptions options;             ///< Configuration of the run.
+    HardwareContext hardware;             ///< Simulated board.
+    EnergyPool energy_pool;               ///< Harvesters and battery supplying the tasks.
+    EnergyTrace energy_traces[NUM_ENERGY_SOURCES]; ///< Measured harvest per EnergyType.
+    TaskQueue* queue;                     ///< Queue of the current task cycle.
+    Task tasks[NUM_SIMULATION_TASKS];     ///< Sampling, averaging and transmission tasks.
+    Task* compute_dependencies[1];        ///< Tasks the averaging depends on.
+    Task* send_dependencies[1];           ///< Tasks the transmission depends on.
+    TimerWheel timers;                    ///< Release and delay timers of the node, in simulated milliseconds.
+    WheelTimer release_timers[NUM_SIMULATION_TASKS]; ///< Release of each completed task at its next period.
+    GoalParameters goal_params;           ///< Goal of the run.
+    uint8_t tensor_arena[SCHEDULER_TENSOR_ARENA_SIZE]; ///< Working memory of the forecast model.
+    TinyMLModel ml_model;                 ///< Next-hour harvest forecast model.
+    RunSummary summary;                   ///< Totals printed by scheduler_print_summary().
+    EnergyMeter* energy_meter;            ///< Meter attributing energy to phases and tasks, NULL when not metered.
+} SchedulerContext;
+
+/**
+ * \brief Fills options with the defaults of a one-day greedy run.
+ *
+ * \param options Options to initialize.
+ */
+void scheduler_default_options(SchedulerOptions* options);
+
+/**
+ * \brief Parses command-line arguments into options.
+ *
+ * \param argc Number of arguments, the first one being the program name.
+ * \param argv Arguments; the options keep pointers into them.
+ * \param options Destination, reset to the defaults first.
+ * \return False if an argument is unknown or out of range.
+ */
+bool scheduler_parse_options(int argc, char* argv[], SchedulerOptions* options);
+
+/**
+ * \brief Builds a node, restores its checkpoint and loads its forecast model.
+ *
+ * \param context Context to initialize; it must not move until scheduler_close().
+ * \param options Configuration of the run, copied into the context.
+ * \param console Destination of the node's output, NULL to discard it.
+ * \return False if the configuration is invalid or a resource cannot be opened.
+ */
+bool scheduler_init(SchedulerContext* context, const SchedulerOptions* options, FILE* console);
+
+/**
+ * \brief Attributes the energy of the following steps to their phases and tasks.
+ *
+ * The meter reads process-wide counters, so meter one context at a time.
+ *
+ * \param context Initialized context.
+ * \param meter Initialized meter, or NULL to stop metering.
+ */
+void scheduler_set_energy_meter(SchedulerContext* context, EnergyMeter* meter);
+
+/**
+ * \brief Simulates one hour: plans, runs the tasks the energy allows, then advances the clock.
+ *
+ * With the tickless option, an hour in which the node goes to deep sleep is
+ * followed by every hour until its next wake-up, so one step may simulate
+ * several hours.
+ *
+ * \param context Initialized context.
+ * \return False once the configured duration has elapsed, before simulating anything.
+ */
+bool scheduler_step(SchedulerContext* context);
+
+/**
+ * \brief Simulates hours until the configured duration has elapsed.
+ *
+ * \param context Initialized context.
+ */
+void scheduler_run(SchedulerContext* context);
+
+/**
+ * \brief Returns the simulated time of a node.
+ *
+ * \param context Initialized context.
+ * \return Seconds elapsed since the start of the simulation.
+ */
+SimTime scheduler_time(const SchedulerContext* context);
+
+/**
+ * \brief Prints the totals of the run as one line of key=value pairs, read by the sweep tool.
+ *
+ * \param context Initialized context.
+ * \param output Destination of the line.
+ */
+void scheduler_print_summary(const SchedulerContext* context, FILE* output);
+
+/**
+ * \brief Releases the checkpoint, traces and queue of a node.
+ *
+ * \param context Context to release.
+ */
+void scheduler_close(SchedulerContext* context);
+
+#endif // SCHEDULER_H
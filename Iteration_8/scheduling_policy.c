@@ -0,0 +1,161 @@
+#include "scheduling_policy.h"
+
+#include <string.h>
+
+#include "error_handling.h"
+
+#define DEFAULT_POLICY_INDEX 8
+
+/**
+ * \brief Declaration order, Iteration 0.
+ */
+static float rank_in_declaration_order(const Task* task, const GoalParameters* goal_params, float predictability) {
+    (void)task;
+    (void)goal_params;
+    (void)predictability;
+    return 0.0f;
+}
+
+/**
+ * \brief Highest priority first, Iteration 1.
+ */
+static float rank_by_priority(const Task* task, const GoalParameters* goal_params, float predictability) {
+    (void)goal_params;
+    (void)predictability;
+    return (float)task->priority;
+}
+
+/**
+ * \brief Highest priority, then lowest weight first, Iterations 2 and 3.
+ */
+static float rank_by_priority_and_weight(const Task* task, const GoalParameters* goal_params, float predictability) {
+    (void)goal_params;
+    (void)predictability;
+    return (float)task->priority * (UINT8_MAX + 1) + (float)(UINT8_MAX - task->weight);
+}
+
+/**
+ * \brief Critical tasks first under the resilience goal, then as Iteration 2, Iteration 4.
+ */
+static float rank_by_goal(const Task* task, const GoalParameters* goal_params, float predictability) {
+    float critical_rank = goal_params->goal == MAXIMIZE_RESILIENCE && task->critical ? (UINT8_MAX + 1) * (UINT8_MAX + 1) : 0.0f;
+
+    return critical_rank + rank_by_priority_and_weight(task, goal_params, predictability);
+}
+
+/**
+ * \brief Weighted sum of priority, weight and criticality, Iterations 5 to 7.
+ */
+static float rank_by_weighted_metric(const Task* task, const GoalParameters* goal_params, float predictability) {
+    (void)predictability;
+    if (goal_params->goal == MAXIMIZE_TASKS) {
+        return task->priority * 0.5f + task->weight * 0.5f;
+    }
+    return task->priority * 0.3f + task->weight * 0.2f + (task->critical ? 0.5f : 0.0f);
+}
+
+/**
+ * \brief Priority, criticality bonus, harvest predictability and inverse weight, Iteration 8.
+ */
+static float rank_by_predictable_metric(const Task* task, const GoalParameters* goal_params, float predictability) {
+    float critical_bonus = 0.0f;
+    float weight_bonus = 0.0f;
+
+    if (goal_params->goal == MAXIMIZE_RESILIENCE && task->critical) {
+        critical_bonus = 2.0f;
+    }
+
+    if (task->weight > 0) {
+        weight_bonus = 1.0f / (float)task->weight;
+    }
+
+    return (float)task->priority + critical_bonus + predictability + weight_bonus;
+}
+
+/**
+ * \brief Sorts the tasks by rank, stable so that ties keep the declaration order, then runs each once.
+ */
+static void run_in_order(const SchedulingPolicy* policy, PolicyCycle* cycle) {
+    Task* ordered[MAX_TASKS];
+    float ranks[MAX_TASKS];
+
+    if (cycle->count > MAX_TASKS) {
+        handle_error("Too many tasks in a cycle");
+        return;
+    }
+
+    for (size_t i = 0; i < cycle->count; i++) {
+        float rank = policy->rank_task(cycle->tasks[i], cycle->goal_params, cycle->predictability);
+        size_t position = i;
+
+        while (position > 0 && ranks[position - 1] < rank) {
+            ordered[position] = ordered[position - 1];
+            ranks[position] = ranks[position - 1];
+            position--;
+        }
+        ordered[position] = cycle->tasks[i];
+        ranks[position] = rank;
+    }
+
+    execute_tasks_in_order(cycle->queue, ordered, cycle->count, cycle->pool, policy->checks_dependencies, cycle->now,
+                           cycle->hardware);
+}
+
+/**
+ * \brief Runs the tasks from the heap queue, deferring them until their dependencies complete.
+ */
+static void run_queued(const SchedulingPolicy* policy, PolicyCycle* cycle) {
+    for (size_t i = 0; i < cycle->count; i++) {
+        cycle->tasks[i]->heuristic_metric = policy->rank_task(cycle->tasks[i], cycle->goal_params, cycle->predictability);
+        enqueue_task(cycle->queue, cycle->tasks[i]);
+    }
+
+    execute_tasks(cycle->queue, cycle->pool, cycle->goal_params, cycle->now, cycle->hardware);
+}
+
+/**
+ * \brief Strategies of every iteration, in order; the dependency checks of
+ * Iterations 2 to 7 are applied as they were meant, not as they were written.
+ */
+static const SchedulingPolicy policies[] = {
+    {"iteration-0", 0, "every task in a fixed sequence", false, false, false, false,
+     rank_in_declaration_order, run_in_order},
+    {"iteration-1", 1, "tasks sorted by priority", false, false, false, false, rank_by_priority, run_in_order},
+    {"iteration-2", 2, "priority then lightest weight, with dependency checks", false, false, true, false,
+     rank_by_priority_and_weight, run_in_order},
+    {"iteration-3", 3, "as iteration-2, paused while no energy is available", true, false, true, false,
+     rank_by_priority_and_weight, run_in_order},
+    {"iteration-4", 4, "as iteration-3, critical tasks first under the resilience goal", true, false, true, false,
+     rank_by_goal, run_in_order},
+    {"iteration-5", 5, "weighted heuristic metric of priority, weight and criticality", true, false, true, false,
+     rank_by_weighted_metric, run_in_order},
+    {"iteration-6", 6, "as iteration-5, deep sleep while no energy is available", true, true, true, false,
+     rank_by_weighted_metric, run_in_order},
+    {"iteration-7", 7, "as iteration-6, split into task, energy and hardware modules", true, true, true, false,
+     rank_by_weighted_metric, run_in_order},
+    {"greedy", 8, "heap queue with deferred dependencies, battery reserve and harvest predictability", true, true,
+     true, false, rank_by_predictable_metric, run_queued},
+    {"lookahead", 8, "as greedy, limited to the tasks the lookahead planner places in the hour", true, true, true,
+     true, rank_by_predictable_metric, run_queued}
+};
+
+const SchedulingPolicy* scheduling_policy_find(const char* name) {
+    for (size_t i = 0; i < scheduling_policy_count(); i++) {
+        if (strcmp(policies[i].name, name) == 0) {
+            return &policies[i];
+        }
+    }
+    return NULL;
+}
+
+const SchedulingPolicy* scheduling_policy_default(void) {
+    return &policies[DEFAULT_POLICY_INDEX];
+}
+
+size_t scheduling_policy_count(void) {
+    return sizeof(policies) / sizeof(policies[0]);
+}
+
+const SchedulingPolicy* scheduling_policy_at(size_t index) {
+    return index < scheduling_policy_count() ? &policies[index] : NULL;
+}
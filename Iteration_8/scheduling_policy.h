@@ -0,0 +1,86 @@
+#ifndef SCHEDULING_POLICY_H
+#define SCHEDULING_POLICY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "energy_pool.h"
+#include "hardware_abstraction.h"
+#include "task_manager.h"
+
+/**
+ * \brief Tasks and resources of the task cycle of one simulated hour.
+ */
+typedef struct {
+    Task** tasks;                 ///< Tasks still to run this hour, in declaration order.
+    size_t count;                 ///< Number of tasks.
+    TaskQueue* queue;             ///< Queue of the node, carrying the completion hook and task context.
+    EnergyPool* pool;             ///< Energy sources supplying the cycle.
+    GoalParameters* goal_params;  ///< Goal of the run.
+    float predictability;         ///< Predictability of the harvest, from the energy pool.
+    SimTime now;                  ///< Start of the hour.
+    HardwareContext* hardware;    ///< Board running the tasks.
+} PolicyCycle;
+
+typedef struct SchedulingPolicy SchedulingPolicy;
+
+/**
+ * \brief Scheduling strategy of one iteration of the project, selected with --scheduler=NAME.
+ *
+ * The scheduler context asks the policy whether to sleep through hours in
+ * which no task can run, then hands it the tasks of every other hour. Every
+ * policy runs on the same tasks, harvest and battery, so runs with the same
+ * options and seed differ only by the decisions of their policies.
+ */
+struct SchedulingPolicy {
+    const char* name;            ///< Value of --scheduler.
+    uint8_t iteration;           ///< Iteration of the project the strategy comes from.
+    const char* description;     ///< One-line summary of the strategy.
+    bool gates_on_energy;        ///< Skips the hours in which no task can run.
+    bool deep_sleeps;            ///< Spends the skipped hours in deep sleep, counted as sleep hours.
+    bool checks_dependencies;    ///< Skips tasks whose dependencies have not completed.
+    bool plans_ahead;            ///< Runs only the tasks the lookahead planner places in the current hour.
+
+    /**
+     * \brief Scores a task; higher scores run first and ties keep the declaration order.
+     */
+    float (*rank_task)(const Task* task, const GoalParameters* goal_params, float predictability);
+
+    /**
+     * \brief Runs the tasks of a cycle.
+     */
+    void (*run_cycle)(const SchedulingPolicy* policy, PolicyCycle* cycle);
+};
+
+/**
+ * \brief Finds a policy by name.
+ *
+ * \param name Value of --scheduler.
+ * \return The policy, or NULL if no policy has this name.
+ */
+const SchedulingPolicy* scheduling_policy_find(const char* name);
+
+/**
+ * \brief Returns the policy of a run without --scheduler, the greedy policy of Iteration 8.
+ *
+ * \return Default policy.
+ */
+const SchedulingPolicy* scheduling_policy_default(void);
+
+/**
+ * \brief Returns the number of policies.
+ *
+ * \return Number of policies, ordered by iteration.
+ */
+size_t scheduling_policy_count(void);
+
+/**
+ * \brief Returns a policy by position.
+ *
+ * \param index Position, below scheduling_policy_count().
+ * \return The policy, or NULL if index is out of range.
+ */
+const SchedulingPolicy* scheduling_policy_at(size_t index);
+
+#endif // SCHEDULING_POLICY_H
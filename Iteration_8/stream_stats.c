@@ -0,0 +1,83 @@
+#include "stream_stats.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "error_handling.h"
+
+bool stream_stats_init(StreamStats* stats, StreamStatsMode mode, uint16_t window, float alpha) {
+    if (stats == NULL) {
+        return false;
+    }
+
+    if (mode == STREAM_STATS_WINDOW && (window == 0 || window > STREAM_STATS_MAX_WINDOW)) {
+        handle_error("Statistics window length is out of range");
+        return false;
+    }
+
+    if (mode == STREAM_STATS_EXPONENTIAL && (alpha <= 0.0f || alpha > 1.0f)) {
+        handle_error("Exponential smoothing factor must be in (0, 1]");
+        return false;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    stats->mode = mode;
+    stats->window = window;
+    stats->alpha = alpha;
+    return true;
+}
+
+void stream_stats_push(StreamStats* stats, float sample) {
+    if (stats == NULL) {
+        return;
+    }
+
+    if (stats->mode == STREAM_STATS_EXPONENTIAL) {
+        float delta = sample - stats->mean;
+        float increment = stats->alpha * delta;
+
+        if (stats->count == 0) {
+            stats->mean = sample;
+            stats->m2 = 0.0f;
+        } else {
+            stats->mean += increment;
+            stats->m2 = (1.0f - stats->alpha) * (stats->m2 + delta * increment);
+        }
+        if (stats->count < UINT16_MAX) {
+            stats->count++;
+        }
+        return;
+    }
+
+    if (stats->count < stats->window) {
+        float delta = sample - stats->mean;
+
+        stats->count++;
+        stats->mean += delta / stats->count;
+        stats->m2 += delta * (sample - stats->mean);
+    } else {
+        float evicted = stats->samples[stats->head];
+        float old_mean = stats->mean;
+
+        stats->mean += (sample - evicted) / stats->window;
+        stats->m2 += (sample - evicted) * (sample - stats->mean + evicted - old_mean);
+        if (stats->m2 < 0.0f) {
+            stats->m2 = 0.0f;
+        }
+    }
+
+    stats->samples[stats->head] = sample;
+    stats->head = (uint16_t)((stats->head + 1) % stats->window);
+}
+
+float stream_stats_mean(const StreamStats* stats) {
+    return (stats != NULL && stats->count > 0) ? stats->mean : 0.0f;
+}
+
+float stream_stats_variance(const StreamStats* stats) {
+    if (stats == NULL || stats->count < 2) {
+        return 0.0f;
+    }
+
+    return stats->mode == STREAM_STATS_EXPONENTIAL ? stats->m2 : stats->m2 / stats->count;
+}
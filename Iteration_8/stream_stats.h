@@ -0,0 +1,81 @@
+#ifndef STREAM_STATS_H
+#define STREAM_STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * \brief Largest sliding window supported, in samples.
+ *
+ * The default keeps about three months of daily samples; override it at
+ * compile time (-DSTREAM_STATS_MAX_WINDOW=366) for longer histories. Every
+ * energy source of a node checkpoints its window, so beyond about 230
+ * samples CHECKPOINT_MAX_REGIONS must be raised as well.
+ */
+#ifndef STREAM_STATS_MAX_WINDOW
+#define STREAM_STATS_MAX_WINDOW 92
+#endif
+
+/**
+ * \brief Weighting of past samples.
+ */
+typedef enum {
+    STREAM_STATS_WINDOW,       ///< Equal weights over the last `window` samples.
+    STREAM_STATS_EXPONENTIAL   ///< Exponentially decaying weights controlled by `alpha`.
+} StreamStatsMode;
+
+/**
+ * \brief Online mean and variance estimator with O(1) update cost.
+ *
+ * The window mode keeps the samples in a ring buffer and applies Welford's
+ * update for the incoming sample and its reverse for the evicted one, so the
+ * cost of a push does not depend on the window length. The exponential mode
+ * needs no sample storage at all.
+ */
+typedef struct {
+    StreamStatsMode mode;   ///< Weighting of past samples.
+    uint16_t window;        ///< Number of samples averaged in window mode.
+    uint16_t count;         ///< Number of samples currently contributing.
+    uint16_t head;          ///< Ring position receiving the next sample.
+    float alpha;            ///< Weight of the newest sample in exponential mode.
+    float mean;             ///< Current mean.
+    float m2;               ///< Sum of squared deviations (window) or variance (exponential).
+    float samples[STREAM_STATS_MAX_WINDOW]; ///< Ring buffer of the window mode.
+} StreamStats;
+
+/**
+ * \brief Configures an estimator and clears its history.
+ *
+ * \param stats Estimator to initialize.
+ * \param mode Weighting of past samples.
+ * \param window Window length in samples, 1 to STREAM_STATS_MAX_WINDOW (window mode).
+ * \param alpha Weight of the newest sample, in (0, 1] (exponential mode).
+ * \return False if the parameters are out of range.
+ */
+bool stream_stats_init(StreamStats* stats, StreamStatsMode mode, uint16_t window, float alpha);
+
+/**
+ * \brief Adds a sample, evicting the oldest one when the window is full.
+ *
+ * \param stats Estimator to update.
+ * \param sample New observation.
+ */
+void stream_stats_push(StreamStats* stats, float sample);
+
+/**
+ * \brief Returns the mean of the contributing samples.
+ *
+ * \param stats Estimator to query.
+ * \return Mean, 0 when no sample was pushed.
+ */
+float stream_stats_mean(const StreamStats* stats);
+
+/**
+ * \brief Returns the population variance of the contributing samples.
+ *
+ * \param stats Estimator to query.
+ * \return Variance, 0 when fewer than two samples were pushed.
+ */
+float stream_stats_variance(const StreamStats* stats);
+
+#endif // STREAM_STATS_H
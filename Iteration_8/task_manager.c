@@ -1,9 +1,12 @@
 #include "task_manager.h"
 
 #include <stddef.h>
+#include <stdio.h>
 #include <stdlib.h>
 
+#include "alloc_tracker.h"
 #include "error_handling.h"
+#include "fault_injection.h"
 #include "hardware_abstraction.h"
 
 static void swap_tasks(Task** left, Task** right) {
@@ -22,6 +25,80 @@ static bool are_dependencies_met(const Task* task) {
     return true;
 }
 
+static bool depends_on_any(const Task* task, Task* const* tasks, uint8_t count) {
+    for (uint8_t i = 0; i < task->num_dependencies; i++) {
+        for (uint8_t j = 0; j < count; j++) {
+            if (task->dependencies[i] == tasks[j]) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static bool depends_transitively_on(const Task* task, const Task* target, uint8_t depth) {
+    if (depth > MAX_TASKS) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < task->num_dependencies; i++) {
+        const Task* dependency = task->dependencies[i];
+        if (dependency == target ||
+            (dependency != NULL && depends_transitively_on(dependency, target, (uint8_t)(depth + 1)))) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * \brief Tells whether a pending critical task needs this task to complete first.
+ *
+ * Such a task inherits the criticality of its dependent, so it may draw the
+ * energy reserved for critical work.
+ */
+static bool is_required_by_critical(const Task* task, const TaskQueue* queue, Task* const* deferred, uint8_t deferred_count) {
+    for (uint8_t i = 0; i < queue->size; i++) {
+        if (queue->tasks[i]->critical && depends_transitively_on(queue->tasks[i], task, 0)) {
+            return true;
+        }
+    }
+
+    for (uint8_t i = 0; i < deferred_count; i++) {
+        if (deferred[i]->critical && depends_transitively_on(deferred[i], task, 0)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * \brief Runs a task, draws its energy and reports its completion.
+ */
+static void run_task(TaskQueue* queue, Task* task, EnergyPool* pool, int source_index, HardwareContext* hardware) {
+    fault_log_event("task_start");
+    FAULT_POINT(FAULT_SITE_TASK_START);
+    task->taskFunction(queue->task_context);
+    FAULT_POINT(FAULT_SITE_TASK_END);
+    if (pool != NULL) {
+        energy_pool_draw(pool, source_index, task->energy_cost_mj);
+    }
+    task->completed = true;
+    if (queue->on_task_completed != NULL) {
+        queue->on_task_completed(task, queue->hook_context);
+    }
+    fault_log_event("task_done");
+    FAULT_POINT(FAULT_SITE_SCHEDULER_STEP);
+    if (queue->timers != NULL) {
+        timer_wheel_schedule(queue->timers, &queue->delay_timer, queue->timers->now + task->delay_ms, 0);
+        timer_wheel_advance(queue->timers, queue->delay_timer.expires);
+    }
+    delay(hardware, task->delay_ms);
+}
+
 TaskQueue* init_task_queue(uint8_t capacity) {
     TaskQueue* queue = NULL;
 
@@ -30,24 +107,60 @@ TaskQueue* init_task_queue(uint8_t capacity) {
         return NULL;
     }
 
-    queue = (TaskQueue*)malloc(sizeof(TaskQueue));
+    queue = tracked_malloc(ALLOC_SUBSYSTEM_TASKS, sizeof(TaskQueue));
     if (queue == NULL) {
         handle_error("Failed to allocate task queue");
         return NULL;
     }
 
-    queue->tasks = (Task**)malloc(sizeof(Task*) * capacity);
+    queue->tasks = tracked_malloc(ALLOC_SUBSYSTEM_TASKS, sizeof(Task*) * capacity);
     if (queue->tasks == NULL) {
-        free(queue);
+        tracked_free(ALLOC_SUBSYSTEM_TASKS, queue);
         handle_error("Failed to allocate task storage");
         return NULL;
     }
 
     queue->capacity = capacity;
     queue->size = 0;
+    queue->on_task_completed = NULL;
+    queue->hook_context = NULL;
+    queue->task_context = NULL;
+    queue->timers = NULL;
+    wheel_timer_init(&queue->delay_timer, NULL, NULL);
     return queue;
 }
 
+void set_task_completion_hook(TaskQueue* queue, TaskCompletionHook hook, void* context) {
+    if (queue == NULL) {
+        handle_error("Cannot register a hook on a NULL queue");
+        return;
+    }
+
+    queue->on_task_completed = hook;
+    queue->hook_context = context;
+}
+
+void set_task_context(TaskQueue* queue, void* context) {
+    if (queue == NULL) {
+        handle_error("Cannot set the task context of a NULL queue");
+        return;
+    }
+
+    queue->task_context = context;
+}
+
+void set_task_timers(TaskQueue* queue, TimerWheel* timers) {
+    if (queue == NULL) {
+        handle_error("Cannot set the timers of a NULL queue");
+        return;
+    }
+
+    if (queue->timers != NULL) {
+        timer_wheel_cancel(queue->timers, &queue->delay_timer);
+    }
+    queue->timers = timers;
+}
+
 void enqueue_task(TaskQueue* queue, Task* task) {
     if (queue == NULL || task == NULL) {
         handle_error("Cannot enqueue a NULL queue or task");
@@ -89,10 +202,11 @@ Task* dequeue_task(TaskQueue* queue) {
 
     queue->tasks[0] = queue->tasks[queue->size];
 
-    for (uint8_t index = 0;;) {
-        uint8_t left = (uint8_t)(2 * index + 1);
-        uint8_t right = (uint8_t)(2 * index + 2);
-        uint8_t largest = index;
+    // Child indices reach 2 * 254 + 2, so they do not fit the uint8_t queue size.
+    for (uint16_t index = 0;;) {
+        uint16_t left = (uint16_t)(2 * index + 1);
+        uint16_t right = (uint16_t)(2 * index + 2);
+        uint16_t largest = index;
 
         if (left < queue->size &&
             queue->tasks[left]->heuristic_metric > queue->tasks[largest]->heuristic_metric) {
@@ -120,12 +234,16 @@ void free_task_queue(TaskQueue* queue) {
         return;
     }
 
-    free(queue->tasks);
-    free(queue);
+    set_task_timers(queue, NULL);
+    tracked_free(ALLOC_SUBSYSTEM_TASKS, queue->tasks);
+    tracked_free(ALLOC_SUBSYSTEM_TASKS, queue);
 }
 
-void execute_tasks(TaskQueue* queue, EnergySource* source, GoalParameters* goal_params) {
-    (void)source;
+void execute_tasks(TaskQueue* queue, EnergyPool* pool, GoalParameters* goal_params, SimTime now,
+                   HardwareContext* hardware) {
+    Task* skipped[MAX_TASKS];
+    uint8_t skipped_count = 0;
+
     (void)goal_params;
 
     if (queue == NULL) {
@@ -140,7 +258,18 @@ void execute_tasks(TaskQueue* queue, EnergySource* source, GoalParameters* goal_
 
         while (queue->size > 0) {
             Task* task = dequeue_task(queue);
-            if (task == NULL) {
+            int source_index = ENERGY_SOURCE_NONE;
+
+            FAULT_POINT(FAULT_SITE_SCHEDULER_STEP);
+            if (task == NULL || task->completed) {
+                continue;
+            }
+
+            if (depends_on_any(task, skipped, skipped_count)) {
+                if (skipped_count < MAX_TASKS) {
+                    skipped[skipped_count++] = task;
+                }
+                progress_made = true;
                 continue;
             }
 
@@ -155,9 +284,20 @@ void execute_tasks(TaskQueue* queue, EnergySource* source, GoalParameters* goal_
                 continue;
             }
 
-            task->taskFunction();
-            task->completed = true;
-            delay(task->delay_ms);
+            if (pool != NULL) {
+                bool critical = task->critical || is_required_by_critical(task, queue, deferred, deferred_count);
+                source_index = energy_pool_select_source(pool, now, task->energy_cost_mj, critical);
+                if (source_index == ENERGY_SOURCE_NONE) {
+                    console_print(hardware, "Not enough energy for a task, skipping it and its dependents this cycle.\n");
+                    if (skipped_count < MAX_TASKS) {
+                        skipped[skipped_count++] = task;
+                    }
+                    progress_made = true;
+                    continue;
+                }
+            }
+
+            run_task(queue, task, pool, source_index, hardware);
             progress_made = true;
         }
 
@@ -165,9 +305,37 @@ void execute_tasks(TaskQueue* queue, EnergySource* source, GoalParameters* goal_
             enqueue_task(queue, deferred[i]);
         }
 
-        if (!progress_made) {
+        if (deferred_count > 0 && !progress_made) {
             handle_error("Dependency cycle detected or no executable task available");
             return;
         }
     }
 }
+
+void execute_tasks_in_order(TaskQueue* queue, Task* const* tasks, size_t count, EnergyPool* pool,
+                            bool check_dependencies, SimTime now, HardwareContext* hardware) {
+    if (queue == NULL || (tasks == NULL && count > 0)) {
+        handle_error("Cannot execute tasks without a queue");
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        Task* task = tasks[i];
+        int source_index = ENERGY_SOURCE_NONE;
+
+        FAULT_POINT(FAULT_SITE_SCHEDULER_STEP);
+        if (task == NULL || task->completed || (check_dependencies && !are_dependencies_met(task))) {
+            continue;
+        }
+
+        if (pool != NULL) {
+            source_index = energy_pool_select_source(pool, now, task->energy_cost_mj, true);
+            if (source_index == ENERGY_SOURCE_NONE) {
+                console_print(hardware, "Not enough energy for a task, skipping it this cycle.\n");
+                continue;
+            }
+        }
+
+        run_task(queue, task, pool, source_index, hardware);
+    }
+}
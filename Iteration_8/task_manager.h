@@ -2,9 +2,12 @@
 #define TASK_MANAGER_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
-#include "energy_manager.h"
+#include "energy_pool.h"
+#include "hardware_abstraction.h"
+#include "timer_wheel.h"
 
 /**
  * \brief Maximum number of tasks supported by the demo scheduler queue.
@@ -18,7 +21,7 @@
  * and an optional dependency list used by the scheduler before execution.
  */
 typedef struct Task {
-    void (*taskFunction)();      ///< Function executed when the task is scheduled.
+    void (*taskFunction)(void* context); ///< Function executed when the task is scheduled, given the queue's task context.
     uint32_t delay_ms;           ///< Delay applied after task execution.
     uint8_t priority;            ///< Base priority used by the heuristic scheduler.
     uint8_t weight;              ///< Relative execution cost used in the heuristic score.
@@ -27,8 +30,17 @@ typedef struct Task {
     bool completed;              ///< Completion marker for the current scheduling cycle.
     struct Task** dependencies;  ///< Tasks that must complete before this task may run.
     uint8_t num_dependencies;    ///< Number of task dependencies.
+    float energy_cost_mj;        ///< Energy consumed by one execution, in millijoules.
 } Task;
 
+/**
+ * \brief Callback invoked after a task has run and been marked completed.
+ *
+ * \param task Task that just completed.
+ * \param context User data registered with the hook.
+ */
+typedef void (*TaskCompletionHook)(Task* task, void* context);
+
 /**
  * \brief Heap-backed priority queue of tasks.
  */
@@ -36,6 +48,11 @@ typedef struct TaskQueue {
     Task** tasks;      ///< Heap storage for queued tasks.
     uint8_t capacity;  ///< Maximum number of tasks accepted by the queue.
     uint8_t size;      ///< Current number of queued tasks.
+    TaskCompletionHook on_task_completed; ///< Optional hook run after each completed task.
+    void* hook_context;                   ///< User data passed to the completion hook.
+    void* task_context;                   ///< User data passed to the task functions.
+    TimerWheel* timers;                   ///< Wheel timing the delays after tasks, NULL to only wait on the board.
+    WheelTimer delay_timer;               ///< One-shot timer of the delay after the last task.
 } TaskQueue;
 
 /**
@@ -51,7 +68,7 @@ typedef enum {
  */
 typedef struct {
     GoalType goal;        ///< Scheduler optimization objective.
-    uint8_t duration_days;///< Number of simulated days to execute.
+    uint32_t duration_days; ///< Number of simulated days to execute.
 } GoalParameters;
 
 /**
@@ -87,17 +104,81 @@ Task* dequeue_task(TaskQueue* queue);
  */
 void free_task_queue(TaskQueue* queue);
 
+/**
+ * \brief Registers a hook called after every task completed by execute_tasks.
+ *
+ * The hook lets the caller persist progress, for instance to checkpoint
+ * state so a completed task is never executed again after a power failure.
+ *
+ * \param queue Queue whose executions are observed.
+ * \param hook Callback to invoke, or NULL to remove the hook.
+ * \param context User data passed to the callback.
+ */
+void set_task_completion_hook(TaskQueue* queue, TaskCompletionHook hook, void* context);
+
+/**
+ * \brief Sets the argument every task function of the queue receives.
+ *
+ * The context is usually the scheduler instance owning the tasks, so task
+ * functions need no global state.
+ *
+ * \param queue Queue whose tasks receive the context.
+ * \param context User data passed to the task functions.
+ */
+void set_task_context(TaskQueue* queue, void* context);
+
+/**
+ * \brief Times the delay after each task with a one-shot timer of a wheel.
+ *
+ * The delay after a task then advances the wheel to the expiry of the
+ * timer, firing every timer due in between, before the board waits.
+ *
+ * \param queue Queue whose delays are timed.
+ * \param timers Wheel clocked in milliseconds, or NULL to only wait on the board.
+ */
+void set_task_timers(TaskQueue* queue, TimerWheel* timers);
+
 /**
  * \brief Executes queued tasks while enforcing their dependencies.
  *
- * Tasks whose dependencies are not yet completed are deferred and retried
+ * Tasks already marked completed are dropped without running again. Tasks
+ * whose dependencies are not yet completed are deferred and retried
  * within the current scheduling cycle. A scheduling error is reported if no
  * progress can be made.
  *
+ * When an energy pool is given, each task draws its energy cost from the
+ * source chosen by energy_pool_select_source(). A task required by a pending
+ * critical task is treated as critical. Tasks no source can supply are
+ * skipped for this cycle, together with the tasks depending on them.
+ *
  * \param queue Queue of tasks to execute.
- * \param source Energy source associated with the current cycle.
+ * \param pool Energy sources supplying the cycle, or NULL to run without energy accounting.
  * \param goal_params Goal configuration for the running simulation.
+ * \param now Current simulated time, used to choose the energy sources.
+ * \param hardware Board that runs the tasks and waits after each of them.
+ */
+void execute_tasks(TaskQueue* queue, EnergyPool* pool, GoalParameters* goal_params, SimTime now,
+                   HardwareContext* hardware);
+
+/**
+ * \brief Executes tasks once each, in the given order, as the schedulers before the heap queue did.
+ *
+ * A task runs only if it is not completed and, when check_dependencies is
+ * set, its dependencies completed earlier; it is never retried within the
+ * cycle, so a task ordered before one of its dependencies is skipped. Each
+ * task draws its energy cost from the source chosen by
+ * energy_pool_select_source() as a critical task, since these schedulers
+ * knew no battery reserve; tasks no source can supply are skipped.
+ *
+ * \param queue Queue providing the completion hook and the task context; its contents are not used.
+ * \param tasks Tasks to execute, in execution order.
+ * \param count Number of tasks.
+ * \param pool Energy sources supplying the cycle, or NULL to run without energy accounting.
+ * \param check_dependencies Whether to skip tasks whose dependencies have not completed.
+ * \param now Current simulated time, used to choose the energy sources.
+ * \param hardware Board that runs the tasks and waits after each of them.
  */
-void execute_tasks(TaskQueue* queue, EnergySource* source, GoalParameters* goal_params);
+void execute_tasks_in_order(TaskQueue* queue, Task* const* tasks, size_t count, EnergyPool* pool,
+                            bool check_dependencies, SimTime now, HardwareContext* hardware);
 
 #endif
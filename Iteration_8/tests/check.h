@@ -0,0 +1,34 @@
+/**
+ * \file check.h
+ * \brief Minimal assertions shared by the regression tests of tests/.
+ *
+ * Each test is a standalone program built with the scheduler sources; it
+ * prints every failed check and exits with status 1 if any failed.
+ */
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+
+static int check_failures = 0;
+
+/**
+ * \brief Records a failure, with its location, when a condition does not hold.
+ */
+#define CHECK(condition)                                                          \
+    do {                                                                          \
+        if (!(condition)) {                                                       \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            check_failures++;                                                     \
+        }                                                                         \
+    } while (0)
+
+/**
+ * \brief Prints the outcome of a test and returns its exit status.
+ */
+static inline int check_report(const char* name) {
+    printf("%s: %s\n", name, check_failures == 0 ? "ok" : "FAILED");
+    return check_failures == 0 ? 0 : 1;
+}
+
+#endif // CHECK_H
@@ -0,0 +1,50 @@
+/**
+ * \file test_availability_index.c
+ * \brief Window boundaries of availability indexes whose last window wraps past midnight.
+ *
+ * Build from the repository root with make check.
+ */
+#include "../availability_index.h"
+#include "check.h"
+
+#define HOUR(h) ((SimTime)(h) * SECONDS_PER_HOUR)
+
+static void test_default_wind(void) {
+    EnergySource wind = {WIND, 6, 3, 3, {0}, 0.0f, 0.02f, 0};
+    AvailabilityIndex index;
+
+    // Windows 06-09, 14-17 and 22-01, the last one wrapping into the next day.
+    availability_index_sync(&index, &wind);
+    CHECK(availability_index_current_window_end(&index, HOUR(6)) == HOUR(9));
+    CHECK(availability_index_current_window_end(&index, HOUR(8)) == HOUR(9));
+    CHECK(availability_index_current_window_end(&index, HOUR(15)) == HOUR(17));
+    CHECK(availability_index_current_window_end(&index, HOUR(22)) == HOUR(25));
+    CHECK(availability_index_current_window_end(&index, HOUR(23)) == HOUR(25));
+    CHECK(availability_index_current_window_end(&index, HOUR(0)) == HOUR(1));
+    CHECK(availability_index_current_window_end(&index, SECONDS_PER_DAY + HOUR(22)) == SECONDS_PER_DAY + HOUR(25));
+    CHECK(availability_index_current_window_end(&index, SECONDS_PER_DAY + HOUR(7)) == SECONDS_PER_DAY + HOUR(9));
+    CHECK(availability_index_current_window_end(&index, HOUR(10)) == HOUR(10));
+}
+
+static void test_adjacent_wrapping_runs(void) {
+    AvailabilityIndex index;
+
+    // The last window is split in two contiguous segments before it wraps.
+    availability_index_init(&index, SECONDS_PER_DAY);
+    availability_index_add(&index, HOUR(0), HOUR(2), 10.0f);
+    availability_index_add(&index, HOUR(5), HOUR(1), 10.0f);
+    availability_index_add(&index, HOUR(20), HOUR(2), 10.0f);
+    availability_index_add(&index, HOUR(22), HOUR(2), 20.0f);
+    availability_index_build(&index);
+
+    CHECK(availability_index_current_window_end(&index, HOUR(5)) == HOUR(6));
+    CHECK(availability_index_current_window_end(&index, HOUR(21)) == HOUR(26));
+    CHECK(availability_index_current_window_end(&index, HOUR(23)) == HOUR(26));
+    CHECK(availability_index_current_window_end(&index, HOUR(1)) == HOUR(2));
+}
+
+int main(void) {
+    test_default_wind();
+    test_adjacent_wrapping_runs();
+    return check_report("availability_index");
+}
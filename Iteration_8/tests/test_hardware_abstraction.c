@@ -0,0 +1,46 @@
+/**
+ * \file test_hardware_abstraction.c
+ * \brief Deadlines of the simulated board's waits across a stall.
+ *
+ * Build from the repository root with make check.
+ */
+#include "../hardware_abstraction.h"
+#include "../monotonic_clock.h"
+#include "check.h"
+
+#define WAIT_MS 20u
+#define NS_PER_WAIT ((uint64_t)WAIT_MS * 1000000u)
+
+static HardwareContext hardware;
+
+static void start_board(void) {
+    init_peripherals(&hardware, NULL);
+    set_time_scale(&hardware, 1.0f);
+}
+
+static void test_back_to_back_waits_keep_their_deadlines(void) {
+    start_board();
+    sleep_ms(&hardware, WAIT_MS);
+    sleep_ms(&hardware, WAIT_MS);
+    CHECK(hardware.missed_deadlines == 0);
+}
+
+static void test_stall_restarts_the_deadlines(void) {
+    uint64_t start_ns = 0;
+
+    start_board();
+    sleep_ms(&hardware, WAIT_MS);
+    // Stall for three waits, so the next deadline has passed by more than a whole wait.
+    monotonic_sleep_until(monotonic_now_ns() + 3 * NS_PER_WAIT);
+
+    start_ns = monotonic_now_ns();
+    sleep_ms(&hardware, WAIT_MS);
+    CHECK(hardware.missed_deadlines == 1);
+    CHECK(monotonic_now_ns() - start_ns >= NS_PER_WAIT);
+}
+
+int main(void) {
+    test_back_to_back_waits_keep_their_deadlines();
+    test_stall_restarts_the_deadlines();
+    return check_report("hardware_abstraction");
+}
@@ -0,0 +1,314 @@
+/**
+ * \file test_inference_engine.c
+ * \brief Rejection of truncated and inconsistent model blobs, and recurrent
+ * layers checked against a float reference with every kernel variant.
+ *
+ * Build from the repository root with make check.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../energy_forecast_model.h"
+#include "../inference_engine.h"
+#include "check.h"
+
+#define ARENA_SIZE 16384
+#define BLOB_CAPACITY 4096
+#define STEPS 8
+#define INPUTS 2
+#define HIDDEN 4
+#define MAX_GATES 4
+#define STATE_SCALE (1.0f / 127.0f)
+
+/**
+ * \brief Largest difference allowed with the float reference, two steps of the hidden state scale.
+ */
+#define RECURRENT_TOLERANCE (2.0f / 127.0f)
+
+static _Alignas(4) uint8_t arena[ARENA_SIZE];
+
+/**
+ * \brief Dense 1x1 model whose arrays are padded to 4 bytes: weight, scale, bias.
+ */
+typedef struct {
+    ModelHeader header;
+    ModelLayerHeader layer;
+    int8_t weight[4];
+    float scale;
+    int32_t bias;
+} TinyModel;
+
+static void make_tiny_model(TinyModel* model) {
+    memset(model, 0, sizeof(*model));
+    model->header = (ModelHeader){INFERENCE_MODEL_MAGIC, INFERENCE_MODEL_VERSION, 1, 1, 1, 1, 0, 1.0f, 0};
+    model->layer.type = LAYER_DENSE;
+    model->layer.in_dim = 1;
+    model->layer.out_dim = 1;
+    model->layer.output_scale = 1.0f;
+    model->layer.payload_size = sizeof(model->weight) + sizeof(model->scale) + sizeof(model->bias);
+    model->weight[0] = 1;
+    model->scale = 1.0f;
+}
+
+/**
+ * \brief Sends stderr to /dev/null, since every rejected blob reports an error.
+ *
+ * \return Descriptor to pass to restore_stderr().
+ */
+static int silence_stderr(void) {
+    int saved = dup(STDERR_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+
+    fflush(stderr);
+    dup2(null, STDERR_FILENO);
+    close(null);
+    return saved;
+}
+
+static void restore_stderr(int saved) {
+    fflush(stderr);
+    dup2(saved, STDERR_FILENO);
+    close(saved);
+}
+
+/**
+ * \brief Loads a copy of the first bytes of a blob into a buffer of exactly that size.
+ */
+static bool load_prefix(const uint8_t* data, size_t size) {
+    InferenceModel model;
+    uint8_t* copy = malloc(size > 0 ? size : 1);
+    bool loaded = false;
+
+    memcpy(copy, data, size);
+    loaded = inference_model_load(&model, copy, size, arena, sizeof(arena));
+    free(copy);
+    return loaded;
+}
+
+static void test_truncated_blobs(const char* name, const uint8_t* data, size_t size) {
+    size_t accepted = 0;
+    int saved_stderr = silence_stderr();
+    bool complete_loads = load_prefix(data, size);
+
+    for (size_t prefix = 0; prefix < size; prefix++) {
+        accepted += load_prefix(data, prefix) ? 1 : 0;
+    }
+    restore_stderr(saved_stderr);
+
+    CHECK(complete_loads);
+    if (accepted != 0) {
+        fprintf(stderr, "%s: %zu truncated blobs accepted\n", name, accepted);
+    }
+    CHECK(accepted == 0);
+}
+
+static void test_payload_without_padding(void) {
+    TinyModel tiny;
+    InferenceModel model;
+    int saved_stderr = 0;
+    bool loaded = false;
+
+    // The payload ends right after the weight: its padding, scale and bias are
+    // outside the layer even though the blob goes on.
+    make_tiny_model(&tiny);
+    tiny.layer.payload_size = 1;
+    saved_stderr = silence_stderr();
+    loaded = inference_model_load(&model, (const uint8_t*)&tiny, sizeof(tiny), arena, sizeof(arena));
+    restore_stderr(saved_stderr);
+    CHECK(!loaded);
+}
+
+/**
+ * \brief Float weights of a recurrent layer and the blob holding their int8 quantization.
+ *
+ * The reference runs on the dequantized weights and biases, so it differs from
+ * the engine only by the quantization of the input and of the hidden state.
+ */
+typedef struct {
+    unsigned gates;
+    float input_weights[MAX_GATES * HIDDEN][INPUTS];
+    float recurrent_weights[MAX_GATES * HIDDEN][HIDDEN];
+    float input_bias[MAX_GATES * HIDDEN];
+    float recurrent_bias[MAX_GATES * HIDDEN];
+    _Alignas(4) uint8_t blob[BLOB_CAPACITY];
+    size_t size;
+} RecurrentModel;
+
+static void append_bytes(RecurrentModel* model, const void* bytes, size_t length) {
+    memcpy(model->blob + model->size, bytes, length);
+    model->size += length;
+    while (model->size % 4 != 0) {
+        model->blob[model->size++] = 0;
+    }
+}
+
+/**
+ * \brief Quantizes the rows of a matrix with one scale each, and replaces them by their dequantized values.
+ */
+static void quantize_rows(float* weights, size_t rows, size_t columns, int8_t* quantized, float* scales) {
+    for (size_t row = 0; row < rows; row++) {
+        float largest = 0.0f;
+
+        for (size_t column = 0; column < columns; column++) {
+            largest = fmaxf(largest, fabsf(weights[row * columns + column]));
+        }
+        scales[row] = largest > 0.0f ? largest / 127.0f : 1.0f;
+        for (size_t column = 0; column < columns; column++) {
+            quantized[row * columns + column] = inference_quantize(weights[row * columns + column], scales[row]);
+            weights[row * columns + column] = quantized[row * columns + column] * scales[row];
+        }
+    }
+}
+
+/**
+ * \brief Quantizes a bias with the product of its input and channel scales, and dequantizes it back.
+ */
+static void quantize_bias(float* bias, size_t rows, float input_scale, const float* scales, int32_t* quantized) {
+    for (size_t row = 0; row < rows; row++) {
+        quantized[row] = (int32_t)lroundf(bias[row] / (input_scale * scales[row]));
+        bias[row] = quantized[row] * input_scale * scales[row];
+    }
+}
+
+static void make_recurrent_model(RecurrentModel* model, LayerType type) {
+    ModelHeader header = {INFERENCE_MODEL_MAGIC, INFERENCE_MODEL_VERSION, 1, STEPS, INPUTS, HIDDEN, 0, 1.0f / 127.0f, 0};
+    ModelLayerHeader layer = {(uint8_t)type, ACTIVATION_NONE, 0, INPUTS, HIDDEN, 0, 1, STATE_SCALE, 0, 0};
+    int8_t input_weights[MAX_GATES * HIDDEN * INPUTS];
+    int8_t recurrent_weights[MAX_GATES * HIDDEN * HIDDEN];
+    float input_scales[MAX_GATES * HIDDEN];
+    float recurrent_scales[MAX_GATES * HIDDEN];
+    int32_t input_bias[MAX_GATES * HIDDEN];
+    int32_t recurrent_bias[MAX_GATES * HIDDEN];
+    size_t rows = 0;
+    size_t layer_offset = 0;
+    size_t payload_start = 0;
+
+    memset(model, 0, sizeof(*model));
+    model->gates = type == LAYER_GRU ? 3 : 4;
+    rows = (size_t)model->gates * HIDDEN;
+    for (size_t row = 0; row < rows; row++) {
+        for (size_t column = 0; column < INPUTS; column++) {
+            model->input_weights[row][column] = 0.9f * sinf(1.3f * (float)(row * INPUTS + column) + 0.4f);
+        }
+        for (size_t column = 0; column < HIDDEN; column++) {
+            model->recurrent_weights[row][column] = 0.7f * cosf(0.9f * (float)(row * HIDDEN + column) + 1.1f);
+        }
+        model->input_bias[row] = 0.2f * sinf(2.1f * (float)row);
+        model->recurrent_bias[row] = 0.1f * cosf(1.7f * (float)row);
+    }
+    quantize_rows(&model->input_weights[0][0], rows, INPUTS, input_weights, input_scales);
+    quantize_rows(&model->recurrent_weights[0][0], rows, HIDDEN, recurrent_weights, recurrent_scales);
+    quantize_bias(model->input_bias, rows, header.input_scale, input_scales, input_bias);
+    quantize_bias(model->recurrent_bias, rows, STATE_SCALE, recurrent_scales, recurrent_bias);
+
+    append_bytes(model, &header, sizeof(header));
+    layer_offset = model->size;
+    append_bytes(model, &layer, sizeof(layer));
+    payload_start = model->size;
+    append_bytes(model, input_weights, rows * INPUTS);
+    append_bytes(model, recurrent_weights, rows * HIDDEN);
+    append_bytes(model, input_scales, rows * sizeof(float));
+    append_bytes(model, recurrent_scales, rows * sizeof(float));
+    append_bytes(model, input_bias, rows * sizeof(int32_t));
+    append_bytes(model, recurrent_bias, rows * sizeof(int32_t));
+    layer.payload_size = (uint32_t)(model->size - payload_start);
+    memcpy(model->blob + layer_offset, &layer, sizeof(layer));
+}
+
+static float sigmoid(float value) {
+    return 1.0f / (1.0f + expf(-value));
+}
+
+/**
+ * \brief Runs the layer in float over the whole sequence, gates ordered z, r, n (GRU) or i, f, g, o (LSTM).
+ */
+static void run_reference(const RecurrentModel* model, const float* input, float* hidden) {
+    float from_input[MAX_GATES * HIDDEN];
+    float from_state[MAX_GATES * HIDDEN];
+    float cell[HIDDEN] = {0};
+
+    memset(hidden, 0, HIDDEN * sizeof(float));
+    for (size_t step = 0; step < STEPS; step++) {
+        for (size_t row = 0; row < model->gates * HIDDEN; row++) {
+            from_input[row] = model->input_bias[row];
+            from_state[row] = model->recurrent_bias[row];
+            for (size_t column = 0; column < INPUTS; column++) {
+                from_input[row] += model->input_weights[row][column] * input[step * INPUTS + column];
+            }
+            for (size_t column = 0; column < HIDDEN; column++) {
+                from_state[row] += model->recurrent_weights[row][column] * hidden[column];
+            }
+        }
+        for (size_t unit = 0; unit < HIDDEN; unit++) {
+            if (model->gates == 3) {
+                float update = sigmoid(from_input[unit] + from_state[unit]);
+                float reset = sigmoid(from_input[HIDDEN + unit] + from_state[HIDDEN + unit]);
+                float candidate = tanhf(from_input[2 * HIDDEN + unit] + reset * from_state[2 * HIDDEN + unit]);
+
+                hidden[unit] = (1.0f - update) * candidate + update * hidden[unit];
+            } else {
+                float in = sigmoid(from_input[unit] + from_state[unit]);
+                float forget = sigmoid(from_input[HIDDEN + unit] + from_state[HIDDEN + unit]);
+                float candidate = tanhf(from_input[2 * HIDDEN + unit] + from_state[2 * HIDDEN + unit]);
+                float out = sigmoid(from_input[3 * HIDDEN + unit] + from_state[3 * HIDDEN + unit]);
+
+                cell[unit] = forget * cell[unit] + in * candidate;
+                from_input[unit] = out * tanhf(cell[unit]);
+            }
+        }
+        if (model->gates == 4) {
+            memcpy(hidden, from_input, HIDDEN * sizeof(float));
+        }
+    }
+}
+
+static void test_recurrent_layer(const char* name, LayerType type) {
+    static const KernelVariant variants[] = {
+        KERNEL_VARIANT_SCALAR, KERNEL_VARIANT_AUTO, KERNEL_VARIANT_SSE41, KERNEL_VARIANT_AVX2, KERNEL_VARIANT_NEON
+    };
+    static RecurrentModel recurrent;
+    InferenceModel model;
+    float input[STEPS * INPUTS];
+    float expected[HIDDEN];
+    float output[HIDDEN];
+
+    for (size_t i = 0; i < STEPS * INPUTS; i++) {
+        // Multiples of the input scale, so that quantizing the input is exact.
+        input[i] = roundf(100.0f * sinf(0.7f * (float)i + 0.3f)) / 127.0f;
+    }
+    make_recurrent_model(&recurrent, type);
+    run_reference(&recurrent, input, expected);
+    CHECK(inference_model_load(&model, recurrent.blob, recurrent.size, arena, sizeof(arena)));
+
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        float error = 0.0f;
+
+        if (!inference_model_set_kernels(&model, variants[v])) {
+            continue;
+        }
+        CHECK(inference_model_run(&model, input, STEPS * INPUTS, output, HIDDEN));
+        for (size_t unit = 0; unit < HIDDEN; unit++) {
+            error = fmaxf(error, fabsf(output[unit] - expected[unit]));
+        }
+        if (error > RECURRENT_TOLERANCE) {
+            fprintf(stderr, "%s with %s kernels: error %.4f\n", name, model.kernels->name, error);
+        }
+        CHECK(error <= RECURRENT_TOLERANCE);
+    }
+}
+
+int main(void) {
+    TinyModel tiny;
+
+    make_tiny_model(&tiny);
+    test_truncated_blobs("tiny model", (const uint8_t*)&tiny, sizeof(tiny));
+    test_truncated_blobs("forecast model", energy_forecast_model, energy_forecast_model_size);
+    test_payload_without_padding();
+    test_recurrent_layer("GRU", LAYER_GRU);
+    test_recurrent_layer("LSTM", LAYER_LSTM);
+    return check_report("inference_engine");
+}
@@ -0,0 +1,102 @@
+/**
+ * \file test_lookahead_planner.c
+ * \brief Reserve access of the lookahead planner for the dependencies of critical jobs.
+ *
+ * Build from the repository root with make check.
+ */
+#include <string.h>
+
+#include "../lookahead_planner.h"
+#include "../schedule_oracle.h"
+#include "check.h"
+
+#define DAYS 7u
+#define SLOT_COUNT (DAYS * 24u)
+#define HORIZON_SLOTS 24u
+
+/**
+ * \brief Lookahead policy with a perfect forecast of the harvest.
+ */
+typedef struct {
+    const ScheduleScenario* scenario;
+    LookaheadPlanner planner;
+} PerfectLookahead;
+
+static uint32_t choose_lookahead(void* context, uint32_t slot, float charge_mj, uint32_t pending) {
+    PerfectLookahead* lookahead = context;
+    float forecast[HORIZON_SLOTS] = {0};
+    uint32_t attempted = 0;
+
+    for (uint32_t k = 0; k < HORIZON_SLOTS && slot + k < lookahead->scenario->slot_count; k++) {
+        forecast[k] = lookahead->scenario->harvest_mj[slot + k];
+    }
+    lookahead_planner_replan(&lookahead->planner, slot, forecast, charge_mj);
+    for (uint8_t i = 0; i < lookahead->scenario->task_count; i++) {
+        if ((pending & (1u << i)) != 0 && lookahead_planner_should_run(&lookahead->planner, i)) {
+            attempted |= 1u << i;
+        }
+    }
+    return attempted;
+}
+
+static void lookahead_completed(void* context, uint8_t task) {
+    PerfectLookahead* lookahead = context;
+    lookahead_planner_complete(&lookahead->planner, task);
+}
+
+static uint32_t choose_greedy(void* context, uint32_t slot, float charge_mj, uint32_t pending) {
+    (void)context;
+    (void)slot;
+    (void)charge_mj;
+    return pending;
+}
+
+/**
+ * \brief A daily critical job depending on a task released every three slots, under weak sunshine.
+ *
+ * Only the job of task 2 that precedes the critical job may draw the
+ * reserve. If every job of task 2 may, the planner runs them until the
+ * battery is empty and the critical job never completes.
+ */
+static void test_critical_dependency_keeps_reserve(void) {
+    static const PlanTask tasks[] = {
+        {3.657f, 1, 1, false, 0},
+        {9.109f, 3, 1, false, 0},
+        {36.142f, 3, 2, false, 0},
+        {127.685f, 24, 13, true, 1u << 2},
+        {137.745f, 24, 3, false, 0},
+        {189.864f, 24, 8, false, 0},
+    };
+    static const float daylight[24] = {0, 0, 0, 0, 0, 0, 0.05f, 0.2f, 0.4f, 0.6f, 0.8f, 0.95f,
+                                       1.0f, 0.95f, 0.8f, 0.6f, 0.4f, 0.2f, 0.05f, 0, 0, 0, 0, 0};
+    static const float weather[DAYS] = {0.9f, 0.4f, 1.1f, 0.6f, 0.8f, 0.3f, 1.0f};
+    static PerfectLookahead lookahead;
+    float harvest_mj[SLOT_COUNT];
+    ScheduleScenario scenario = {tasks, sizeof(tasks) / sizeof(tasks[0]), harvest_mj, SLOT_COUNT,
+                                 389.265f, 97.316f, 194.632f};
+    SchedulePolicy greedy = {choose_greedy, NULL, NULL, NULL};
+    SchedulePolicy planned = {choose_lookahead, lookahead_completed, &lookahead, NULL};
+    ScheduleOutcome greedy_outcome;
+    ScheduleOutcome planned_outcome;
+    ScheduleOutcome optimum;
+
+    for (uint32_t slot = 0; slot < SLOT_COUNT; slot++) {
+        harvest_mj[slot] = 28.0f * daylight[slot % 24] * weather[slot / 24];
+    }
+    memset(&lookahead, 0, sizeof(lookahead));
+    lookahead.scenario = &scenario;
+    CHECK(lookahead_planner_init(&lookahead.planner, tasks, scenario.task_count, HORIZON_SLOTS, scenario.capacity_mj,
+                                 scenario.reserve_mj));
+    CHECK(schedule_simulate(&scenario, &greedy, &greedy_outcome));
+    CHECK(schedule_simulate(&scenario, &planned, &planned_outcome));
+    CHECK(schedule_oracle_solve(&scenario, ORACLE_MAXIMIZE_CRITICAL, NULL, &optimum));
+
+    CHECK(planned_outcome.critical_completed > 0);
+    CHECK(planned_outcome.critical_completed >= greedy_outcome.critical_completed);
+    CHECK(planned_outcome.critical_completed <= optimum.critical_completed);
+}
+
+int main(void) {
+    test_critical_dependency_keeps_reserve();
+    return check_report("lookahead_planner");
+}
@@ -0,0 +1,61 @@
+/**
+ * \file test_scheduler_long_run.c
+ * \brief Endless runs keep releasing and executing tasks far into the simulation.
+ *
+ * Build from the repository root with make check.
+ */
+#include "../scheduler.h"
+#include "check.h"
+
+static SchedulerContext context;
+
+/**
+ * \brief Steps an endless run until a day and returns the useful executions of its last day.
+ */
+static uint32_t run_until_day(uint32_t day) {
+    uint32_t executed = 0;
+
+    while (context.node.simulated_day < day) {
+        if (context.node.simulated_day + 1u == day && context.node.simulated_hour == 0) {
+            executed = context.summary.executed;
+        }
+        CHECK(scheduler_step(&context));
+    }
+    return context.summary.executed - executed;
+}
+
+static bool start_endless_run(void) {
+    SchedulerOptions options;
+
+    scheduler_default_options(&options);
+    options.duration_days = 0;
+    options.infinite_loop = true;
+    options.time_scale = 0.0f;
+    return scheduler_init(&context, &options, NULL);
+}
+
+static void test_past_day_256(void) {
+    CHECK(start_endless_run());
+    CHECK(run_until_day(1) > 0);
+    // Day 256 is where an 8-bit day used to wrap the wheel clock back to 0.
+    CHECK(run_until_day(258) > 0);
+    scheduler_close(&context);
+}
+
+static void test_past_sim_time_wrap(void) {
+    uint32_t executed = 0;
+
+    CHECK(start_endless_run());
+    // Jump to the last days whose seconds fit a SimTime; the wheel ticks keep growing past them.
+    context.node.simulated_day = MAX_DURATION_DAYS;
+    executed = run_until_day(MAX_DURATION_DAYS + 1u);
+    CHECK(executed > 0);
+    CHECK(run_until_day(MAX_DURATION_DAYS + 3u) > 0);
+    scheduler_close(&context);
+}
+
+int main(void) {
+    test_past_day_256();
+    test_past_sim_time_wrap();
+    return check_report("scheduler_long_run");
+}
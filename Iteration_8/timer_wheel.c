@@ -0,0 +1,170 @@
+#include "timer_wheel.h"
+
+#include <string.h>
+
+#define SLOT_MASK ((uint64_t)TIMER_WHEEL_SLOTS - 1u)
+
+static unsigned level_shift(unsigned level) {
+    return level * TIMER_WHEEL_SLOT_BITS;
+}
+
+/**
+ * \brief Links a timer into the lowest level whose slots still tell its expiry apart from now.
+ */
+static void link_timer(TimerWheel* wheel, WheelTimer* timer) {
+    uint64_t expires = timer->expires < wheel->now ? wheel->now : timer->expires;
+    unsigned level = 0;
+    uint64_t bucket = 0;
+    unsigned slot = 0;
+
+    while (level + 1 < TIMER_WHEEL_LEVELS &&
+           (expires >> level_shift(level)) - (wheel->now >> level_shift(level)) >= TIMER_WHEEL_SLOTS) {
+        level++;
+    }
+    bucket = expires >> level_shift(level);
+    if (bucket - (wheel->now >> level_shift(level)) >= TIMER_WHEEL_SLOTS) {
+        // Beyond the top level: wait in its last slot and be cascaded again from there.
+        bucket = (wheel->now >> level_shift(level)) + TIMER_WHEEL_SLOTS - 1u;
+    }
+    slot = (unsigned)(bucket & SLOT_MASK);
+
+    timer->next = wheel->slots[level][slot];
+    if (timer->next != NULL) {
+        timer->next->link = &timer->next;
+    }
+    wheel->slots[level][slot] = timer;
+    timer->link = &wheel->slots[level][slot];
+    timer->slot = (uint16_t)(level * TIMER_WHEEL_SLOTS + slot);
+    wheel->occupied[level] |= (uint64_t)1u << slot;
+    wheel->pending++;
+}
+
+static void unlink_timer(TimerWheel* wheel, WheelTimer* timer) {
+    unsigned level = timer->slot / TIMER_WHEEL_SLOTS;
+    unsigned slot = timer->slot % TIMER_WHEEL_SLOTS;
+
+    *timer->link = timer->next;
+    if (timer->next != NULL) {
+        timer->next->link = timer->link;
+    }
+    timer->next = NULL;
+    timer->link = NULL;
+    if (wheel->slots[level][slot] == NULL) {
+        wheel->occupied[level] &= ~((uint64_t)1u << slot);
+    }
+    wheel->pending--;
+}
+
+/**
+ * \brief First tick at which a slot of the level needs attention: an expiry
+ * on level 0, the start of the slot to cascade on the others.
+ */
+static uint64_t level_next_tick(const TimerWheel* wheel, unsigned level) {
+    uint64_t position = wheel->now >> level_shift(level);
+    unsigned start = (unsigned)(position & SLOT_MASK);
+    uint64_t rotated = wheel->occupied[level];
+
+    if (rotated == 0) {
+        return TIMER_WHEEL_NEVER;
+    }
+    if (start != 0) {
+        rotated = (rotated >> start) | (rotated << (TIMER_WHEEL_SLOTS - start));
+    }
+    return (position + (uint64_t)__builtin_ctzll(rotated)) << level_shift(level);
+}
+
+/**
+ * \brief Cascades the slots starting at the current tick, then fires the timers due at it.
+ */
+static size_t expire_current_tick(TimerWheel* wheel) {
+    unsigned slot = (unsigned)(wheel->now & SLOT_MASK);
+    WheelTimer* timer = NULL;
+    size_t fired = 0;
+
+    for (unsigned level = TIMER_WHEEL_LEVELS - 1; level > 0; level--) {
+        unsigned level_slot = (unsigned)((wheel->now >> level_shift(level)) & SLOT_MASK);
+
+        if ((wheel->now & (((uint64_t)1u << level_shift(level)) - 1u)) != 0) {
+            continue;
+        }
+        while ((timer = wheel->slots[level][level_slot]) != NULL) {
+            unlink_timer(wheel, timer);
+            link_timer(wheel, timer);
+        }
+    }
+
+    // Callbacks may link timers due now into this slot; they fire in the same pass.
+    while ((timer = wheel->slots[0][slot]) != NULL) {
+        unlink_timer(wheel, timer);
+        if (timer->period > 0) {
+            timer->expires += timer->period;
+            link_timer(wheel, timer);
+        }
+        fired++;
+        if (timer->callback != NULL) {
+            timer->callback(timer, timer->context);
+        }
+    }
+    return fired;
+}
+
+void timer_wheel_init(TimerWheel* wheel, uint64_t now) {
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->now = now;
+}
+
+void wheel_timer_init(WheelTimer* timer, WheelTimerCallback callback, void* context) {
+    memset(timer, 0, sizeof(*timer));
+    timer->callback = callback;
+    timer->context = context;
+}
+
+bool wheel_timer_pending(const WheelTimer* timer) {
+    return timer->link != NULL;
+}
+
+void timer_wheel_schedule(TimerWheel* wheel, WheelTimer* timer, uint64_t expires, uint64_t period) {
+    timer_wheel_cancel(wheel, timer);
+    timer->expires = expires;
+    timer->period = period;
+    link_timer(wheel, timer);
+}
+
+void timer_wheel_cancel(TimerWheel* wheel, WheelTimer* timer) {
+    if (wheel_timer_pending(timer)) {
+        unlink_timer(wheel, timer);
+    }
+}
+
+uint64_t timer_wheel_next_expiry(const TimerWheel* wheel) {
+    uint64_t next = TIMER_WHEEL_NEVER;
+
+    for (unsigned level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        uint64_t tick = level_next_tick(wheel, level);
+        if (tick < next) {
+            next = tick;
+        }
+    }
+    return next;
+}
+
+size_t timer_wheel_advance(TimerWheel* wheel, uint64_t now) {
+    size_t fired = 0;
+
+    if (now < wheel->now) {
+        now = wheel->now;
+    }
+    for (;;) {
+        uint64_t next = timer_wheel_next_expiry(wheel);
+
+        if (next == TIMER_WHEEL_NEVER || next > now) {
+            break;
+        }
+        if (next > wheel->now) {
+            wheel->now = next;
+        }
+        fired += expire_current_tick(wheel);
+    }
+    wheel->now = now;
+    return fired;
+}
@@ -0,0 +1,131 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * \brief Levels of a wheel and slots per level; each level is 64 times coarser than the one below.
+ */
+#define TIMER_WHEEL_LEVELS 6
+#define TIMER_WHEEL_SLOT_BITS 6
+#define TIMER_WHEEL_SLOTS (1u << TIMER_WHEEL_SLOT_BITS)
+
+/**
+ * \brief Expiry returned when no timer is pending.
+ */
+#define TIMER_WHEEL_NEVER UINT64_MAX
+
+typedef struct WheelTimer WheelTimer;
+
+/**
+ * \brief Callback invoked when a timer expires.
+ *
+ * The callback may schedule or cancel any timer of the wheel, itself included.
+ *
+ * \param timer Timer that expired, already re-armed if periodic.
+ * \param context User data registered with the timer.
+ */
+typedef void (*WheelTimerCallback)(WheelTimer* timer, void* context);
+
+/**
+ * \brief Timer owned by the caller and linked into a wheel while pending.
+ *
+ * The wheel never allocates: a timer lives in the structure of its owner,
+ * so insertion and cancellation are a few pointer updates.
+ */
+struct WheelTimer {
+    WheelTimer* next;             ///< Next timer of the same slot.
+    WheelTimer** link;            ///< Pointer to this timer in its slot, NULL when not pending.
+    uint64_t expires;             ///< Tick at which the timer fires.
+    uint64_t period;              ///< Ticks between two expiries, 0 for a one-shot timer.
+    WheelTimerCallback callback;  ///< Called on expiry, may be NULL.
+    void* context;                ///< User data passed to the callback.
+    uint16_t slot;                ///< Level times TIMER_WHEEL_SLOTS plus slot, while pending.
+};
+
+/**
+ * \brief Hierarchical timing wheel.
+ *
+ * Level 0 holds the timers due in the next 64 ticks, one slot per tick;
+ * level n holds the later ones in slots of 64^n ticks, and a slot is
+ * cascaded into the levels below when the clock reaches its start. Timers
+ * beyond the range of the top level wait in its last slot and are cascaded
+ * again. Insertion and cancellation are O(1), and each timer is moved at
+ * most once per level before it fires. Per-level occupancy masks let the
+ * wheel jump over empty stretches of time, so advancing by hours costs the
+ * same as advancing by one tick.
+ */
+typedef struct {
+    uint64_t now;                                          ///< Current tick.
+    size_t pending;                                        ///< Number of timers linked in the wheel.
+    uint64_t occupied[TIMER_WHEEL_LEVELS];                 ///< Bit s set when slot s of the level is not empty.
+    WheelTimer* slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS]; ///< Timers of each slot, unordered.
+} TimerWheel;
+
+/**
+ * \brief Empties a wheel and sets its clock.
+ *
+ * \param wheel Wheel to initialize.
+ * \param now Current tick.
+ */
+void timer_wheel_init(TimerWheel* wheel, uint64_t now);
+
+/**
+ * \brief Prepares a timer that is not pending.
+ *
+ * \param timer Timer to initialize.
+ * \param callback Function called on expiry, or NULL.
+ * \param context User data passed to the callback.
+ */
+void wheel_timer_init(WheelTimer* timer, WheelTimerCallback callback, void* context);
+
+/**
+ * \brief Tells whether a timer is waiting in a wheel.
+ *
+ * \param timer Initialized timer.
+ * \return True between its scheduling and its expiry or cancellation.
+ */
+bool wheel_timer_pending(const WheelTimer* timer);
+
+/**
+ * \brief Arms a timer, moving it if it is already pending.
+ *
+ * \param wheel Wheel holding the timer.
+ * \param timer Initialized timer.
+ * \param expires Tick of the first expiry; a tick already past fires on the next advance.
+ * \param period Ticks between expiries of a periodic timer, 0 for a one-shot timer.
+ */
+void timer_wheel_schedule(TimerWheel* wheel, WheelTimer* timer, uint64_t expires, uint64_t period);
+
+/**
+ * \brief Disarms a timer; cancelling a timer that is not pending does nothing.
+ *
+ * \param wheel Wheel holding the timer.
+ * \param timer Timer to cancel.
+ */
+void timer_wheel_cancel(TimerWheel* wheel, WheelTimer* timer);
+
+/**
+ * \brief Returns a bound on the next expiry, for the wake-up of a sleeping node.
+ *
+ * The bound is exact for the timers due within 64 ticks. Later ones are
+ * bounded by the start of their slot, so a node sleeping until the bound
+ * may wake early to cascade a slot, but never after a timer is due.
+ *
+ * \param wheel Wheel to inspect.
+ * \return Earliest tick at which a timer may fire, or TIMER_WHEEL_NEVER if none is pending.
+ */
+uint64_t timer_wheel_next_expiry(const TimerWheel* wheel);
+
+/**
+ * \brief Moves the clock forward, firing every timer due up to the new tick, in expiry order.
+ *
+ * \param wheel Wheel to advance.
+ * \param now New tick; an earlier tick only fires the timers already due.
+ * \return Number of expiries.
+ */
+size_t timer_wheel_advance(TimerWheel* wheel, uint64_t now);
+
+#endif // TIMER_WHEEL_H
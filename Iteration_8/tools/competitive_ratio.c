@@ -0,0 +1,354 @@
+/**
+ * \file competitive_ratio.c
+ * \brief Competitive ratio of the online scheduling policies over random scenarios.
+ *
+ * Generates random periodic task sets, batteries and week-long solar
+ * harvest traces, runs the greedy, metric and lookahead policies on each
+ * through schedule_simulate, and divides what they achieve by the optimum of
+ * the schedule oracle. Greedy attempts every due job in dependency order;
+ * metric attempts them in the order of the heuristic metric of the greedy
+ * scheduling policy, over random task priorities and weights. The mean, 5th percentile and worst ratio of each policy
+ * are the regression metric of scheduling changes: a heuristic change must
+ * not lower them. With --fail-below the program exits with status 1 when the
+ * mean ratio of a policy falls under the given value.
+ *
+ * Scenario i is generated from seed + i alone, on the fixed generator stream
+ * SCENARIO_STREAM, so the worst scenario printed at the end can be replayed
+ * with --seed=S --scenarios=1.
+ *
+ * Build and run:
+ * \code
+ * gcc -Wall -Wextra -pedantic -O2 -o bin/competitive_ratio Iteration_8/tools/competitive_ratio.c \
+ *     $(find Iteration_8 -maxdepth 1 -name '*.c' ! -name main.c)
+ * ./bin/competitive_ratio [--scenarios=N] [--seed=S] [--max-tasks=K] [--objective=tasks|critical]
+ *     [--fail-below=RATIO]
+ * \endcode
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../energy_manager.h"
+#include "../lookahead_planner.h"
+#include "../prng.h"
+#include "../schedule_oracle.h"
+#include "../scheduling_policy.h"
+
+#define DEFAULT_SCENARIOS 1000u
+#define DEFAULT_MAX_TASKS 6u
+#define SCENARIO_DAYS 7u
+#define SLOT_COUNT (SCENARIO_DAYS * 24u)
+#define HORIZON_SLOTS 24u
+#define POLICY_COUNT 4u
+#define LOOKAHEAD_POLICY 2u
+#define SCENARIO_STREAM 0u
+
+/**
+ * \brief One random scenario, with a week of harvest before it to warm up the forecaster.
+ */
+typedef struct {
+    PlanTask tasks[ORACLE_MAX_TASKS];
+    uint8_t priorities[ORACLE_MAX_TASKS];
+    uint8_t weights[ORACLE_MAX_TASKS];
+    float history_mj[SLOT_COUNT];
+    float harvest_mj[SLOT_COUNT];
+    ScheduleScenario scenario;
+} RandomScenario;
+
+/**
+ * \brief State of the lookahead policy.
+ */
+typedef struct {
+    const RandomScenario* random;
+    LookaheadPlanner planner;
+    SeasonalForecaster forecaster;
+    bool perfect_forecast;
+} LookaheadContext;
+
+static const char* const policy_names[POLICY_COUNT] = {"greedy", "metric", "lookahead", "lookahead (perfect)"};
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [--scenarios=N] [--seed=S] [--max-tasks=K] [--objective=tasks|critical] "
+            "[--fail-below=RATIO]\n",
+            program);
+    exit(1);
+}
+
+static const char* option_value(const char* argument, const char* name) {
+    size_t length = strlen(name);
+
+    if (strncmp(argument, name, length) == 0 && argument[length] == '=') {
+        return argument + length + 1;
+    }
+    return NULL;
+}
+
+static double now_ms(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+}
+
+/**
+ * \brief Two weeks of solar harvest: a daylight bump scaled by a daily and an hourly cloud factor.
+ */
+static void generate_harvest(RandomScenario* random, Prng* prng) {
+    static const float daylight[24] = {0, 0, 0, 0, 0, 0, 0.05f, 0.2f, 0.4f, 0.6f, 0.8f, 0.95f,
+                                       1.0f, 0.95f, 0.8f, 0.6f, 0.4f, 0.2f, 0.05f, 0, 0, 0, 0, 0};
+    float peak_mj = 20.0f + 100.0f * prng_unit(prng);
+    float weather = 0.0f;
+
+    for (uint32_t slot = 0; slot < 2 * SLOT_COUNT; slot++) {
+        float* destination = slot < SLOT_COUNT ? &random->history_mj[slot] : &random->harvest_mj[slot - SLOT_COUNT];
+
+        if (slot % 24 == 0) {
+            weather = 0.25f + prng_unit(prng);
+        }
+        *destination = peak_mj * daylight[slot % 24] * weather * (0.7f + 0.6f * prng_unit(prng));
+    }
+}
+
+/**
+ * \brief Random task set; a task may depend on one earlier task with a period it divides.
+ */
+static void generate_scenario(RandomScenario* random, uint32_t seed, uint8_t max_tasks) {
+    static const uint16_t periods[] = {1, 2, 3, 4, 6, 8, 12, 24};
+    Prng prng;
+    uint8_t task_count = 0;
+    float capacity_mj = 0.0f;
+
+    prng_seed(&prng, seed, SCENARIO_STREAM);
+    task_count = (uint8_t)(2 + prng_below(&prng, max_tasks - 1));
+    for (uint8_t i = 0; i < task_count; i++) {
+        PlanTask* task = &random->tasks[i];
+
+        task->period_slots = periods[prng_below(&prng, sizeof(periods) / sizeof(periods[0]))];
+        task->deadline_slots = (uint16_t)(1 + prng_below(&prng, task->period_slots));
+        task->energy_mj = 2.0f + 3.0f * task->period_slots * prng_unit(&prng) * (1.0f + 4.0f * prng_unit(&prng));
+        task->critical = prng_below(&prng, 4) == 0;
+        task->dependency_mask = 0;
+        if (i > 0 && prng_below(&prng, 3) == 0) {
+            uint8_t dependency = (uint8_t)prng_below(&prng, i);
+
+            if (task->period_slots % random->tasks[dependency].period_slots == 0) {
+                task->dependency_mask = 1u << dependency;
+            }
+        }
+    }
+
+    generate_harvest(random, &prng);
+    capacity_mj = 100.0f + 400.0f * prng_unit(&prng);
+    random->scenario = (ScheduleScenario){random->tasks, task_count, random->harvest_mj, SLOT_COUNT, capacity_mj,
+                                          0.25f * capacity_mj, 0.5f * capacity_mj};
+
+    // Drawn last, so the tasks and harvest of a seed are those of the other policies.
+    for (uint8_t i = 0; i < task_count; i++) {
+        random->priorities[i] = (uint8_t)(1 + prng_below(&prng, 3));
+        random->weights[i] = (uint8_t)(1 + prng_below(&prng, 3));
+    }
+}
+
+static uint32_t choose_greedy(void* context, uint32_t slot, float charge_mj, uint32_t pending) {
+    (void)context;
+    (void)slot;
+    (void)charge_mj;
+    return pending;
+}
+
+/**
+ * \brief Execution order of the greedy scheduling policy, from its heuristic metric.
+ */
+static void metric_order(const RandomScenario* random, OracleObjective objective, uint8_t* order) {
+    const SchedulingPolicy* policy = scheduling_policy_default();
+    GoalParameters goal_params = {objective == ORACLE_MAXIMIZE_CRITICAL ? MAXIMIZE_RESILIENCE : MAXIMIZE_TASKS, 0};
+    float ranks[ORACLE_MAX_TASKS];
+
+    for (uint8_t i = 0; i < random->scenario.task_count; i++) {
+        Task task;
+
+        memset(&task, 0, sizeof(task));
+        task.priority = random->priorities[i];
+        task.weight = random->weights[i];
+        task.critical = random->tasks[i].critical;
+        task.energy_cost_mj = random->tasks[i].energy_mj;
+        // The predictability is the same for every task and does not change the order.
+        ranks[i] = policy->rank_task(&task, &goal_params, 1.0f);
+    }
+    schedule_order_by_rank(ranks, random->scenario.task_count, order);
+}
+
+static uint32_t choose_lookahead(void* context, uint32_t slot, float charge_mj, uint32_t pending) {
+    LookaheadContext* lookahead = context;
+    const RandomScenario* random = lookahead->random;
+    float forecast[HORIZON_SLOTS] = {0};
+    uint32_t attempted = 0;
+
+    if (slot > 0) {
+        seasonal_forecaster_update(&lookahead->forecaster, (uint8_t)((slot - 1) % 24), random->harvest_mj[slot - 1]);
+    }
+    if (lookahead->perfect_forecast) {
+        for (uint32_t k = 0; k < HORIZON_SLOTS && slot + k < SLOT_COUNT; k++) {
+            forecast[k] = random->harvest_mj[slot + k];
+        }
+    } else {
+        seasonal_forecaster_forecast(&lookahead->forecaster, forecast, HORIZON_SLOTS);
+    }
+
+    lookahead_planner_replan(&lookahead->planner, slot, forecast, charge_mj);
+    for (uint8_t i = 0; i < random->scenario.task_count; i++) {
+        if ((pending & (1u << i)) != 0 && lookahead_planner_should_run(&lookahead->planner, i)) {
+            attempted |= 1u << i;
+        }
+    }
+    return attempted;
+}
+
+static void lookahead_completed(void* context, uint8_t task) {
+    LookaheadContext* lookahead = context;
+    lookahead_planner_complete(&lookahead->planner, task);
+}
+
+static bool run_lookahead(const RandomScenario* random, bool perfect_forecast, ScheduleOutcome* outcome) {
+    static LookaheadContext lookahead;
+    SchedulePolicy policy = {choose_lookahead, lookahead_completed, &lookahead, NULL};
+    const ScheduleScenario* scenario = &random->scenario;
+
+    memset(&lookahead, 0, sizeof(lookahead));
+    lookahead.random = random;
+    lookahead.perfect_forecast = perfect_forecast;
+    if (!lookahead_planner_init(&lookahead.planner, scenario->tasks, scenario->task_count, HORIZON_SLOTS,
+                                scenario->capacity_mj, scenario->reserve_mj) ||
+        !seasonal_forecaster_init(&lookahead.forecaster, 0.3f, 0.01f, 0.3f)) {
+        return false;
+    }
+    for (uint32_t slot = 0; slot < SLOT_COUNT; slot++) {
+        seasonal_forecaster_update(&lookahead.forecaster, (uint8_t)(slot % 24), random->history_mj[slot]);
+    }
+    return schedule_simulate(scenario, &policy, outcome);
+}
+
+static double objective_ratio(const ScheduleOutcome* outcome, const ScheduleOutcome* optimum,
+                              OracleObjective objective) {
+    uint32_t achieved = objective == ORACLE_MAXIMIZE_CRITICAL ? outcome->critical_completed : outcome->completed;
+    uint32_t best = objective == ORACLE_MAXIMIZE_CRITICAL ? optimum->critical_completed : optimum->completed;
+
+    return best > 0 ? (double)achieved / best : 1.0;
+}
+
+static int compare_doubles(const void* left, const void* right) {
+    double a = *(const double*)left;
+    double b = *(const double*)right;
+
+    return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+int main(int argc, char* argv[]) {
+    static RandomScenario random;
+    SchedulePolicy greedy = {choose_greedy, NULL, NULL, NULL};
+    uint8_t order[ORACLE_MAX_TASKS];
+    SchedulePolicy metric = {choose_greedy, NULL, NULL, order};
+    OracleObjective objective = ORACLE_MAXIMIZE_TASKS;
+    uint32_t scenario_count = DEFAULT_SCENARIOS;
+    uint32_t seed = 1;
+    uint8_t max_tasks = DEFAULT_MAX_TASKS;
+    double fail_below = 0.0;
+    double* ratios[POLICY_COUNT] = {NULL};
+    double worst_ratio = 2.0;
+    uint32_t worst_scenario = 0;
+    double oracle_ms = 0.0;
+    double max_oracle_ms = 0.0;
+    uint64_t states = 0;
+    int status = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* value = NULL;
+
+        if ((value = option_value(argv[i], "--scenarios")) != NULL) {
+            scenario_count = (uint32_t)strtoul(value, NULL, 10);
+        } else if ((value = option_value(argv[i], "--seed")) != NULL) {
+            seed = (uint32_t)strtoul(value, NULL, 10);
+        } else if ((value = option_value(argv[i], "--max-tasks")) != NULL) {
+            max_tasks = (uint8_t)atoi(value);
+        } else if ((value = option_value(argv[i], "--objective")) != NULL && strcmp(value, "tasks") == 0) {
+            objective = ORACLE_MAXIMIZE_TASKS;
+        } else if ((value = option_value(argv[i], "--objective")) != NULL && strcmp(value, "critical") == 0) {
+            objective = ORACLE_MAXIMIZE_CRITICAL;
+        } else if ((value = option_value(argv[i], "--fail-below")) != NULL) {
+            fail_below = atof(value);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (scenario_count == 0 || max_tasks < 2 || max_tasks > ORACLE_MAX_TASKS) {
+        usage(argv[0]);
+    }
+
+    for (uint32_t p = 0; p < POLICY_COUNT; p++) {
+        ratios[p] = malloc(scenario_count * sizeof(double));
+        if (ratios[p] == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+    }
+
+    for (uint32_t s = 0; s < scenario_count; s++) {
+        ScheduleOutcome optimum;
+        ScheduleOutcome outcomes[POLICY_COUNT];
+        double start = 0.0;
+        double elapsed = 0.0;
+
+        generate_scenario(&random, seed + s, max_tasks);
+        metric_order(&random, objective, order);
+        start = now_ms();
+        if (!schedule_oracle_solve(&random.scenario, objective, NULL, &optimum)) {
+            fprintf(stderr, "Scenario %u: the oracle failed\n", seed + s);
+            return 1;
+        }
+        elapsed = now_ms() - start;
+        oracle_ms += elapsed;
+        max_oracle_ms = elapsed > max_oracle_ms ? elapsed : max_oracle_ms;
+        states += optimum.states;
+
+        if (!schedule_simulate(&random.scenario, &greedy, &outcomes[0]) ||
+            !schedule_simulate(&random.scenario, &metric, &outcomes[1]) ||
+            !run_lookahead(&random, false, &outcomes[LOOKAHEAD_POLICY]) ||
+            !run_lookahead(&random, true, &outcomes[LOOKAHEAD_POLICY + 1])) {
+            fprintf(stderr, "Scenario %u: a policy failed\n", seed + s);
+            return 1;
+        }
+        for (uint32_t p = 0; p < POLICY_COUNT; p++) {
+            ratios[p][s] = objective_ratio(&outcomes[p], &optimum, objective);
+        }
+        if (ratios[LOOKAHEAD_POLICY][s] < worst_ratio) {
+            worst_ratio = ratios[LOOKAHEAD_POLICY][s];
+            worst_scenario = seed + s;
+        }
+    }
+
+    printf("%u scenarios of %u slots, oracle %.2f ms mean, %.2f ms max, %.0f states mean\n", scenario_count,
+           SLOT_COUNT, oracle_ms / scenario_count, max_oracle_ms, (double)states / scenario_count);
+    printf("%-20s %8s %8s %8s\n", "policy", "mean", "p5", "min");
+    for (uint32_t p = 0; p < POLICY_COUNT; p++) {
+        double mean = 0.0;
+
+        for (uint32_t s = 0; s < scenario_count; s++) {
+            mean += ratios[p][s];
+        }
+        mean /= scenario_count;
+        qsort(ratios[p], scenario_count, sizeof(double), compare_doubles);
+        printf("%-20s %8.4f %8.4f %8.4f\n", policy_names[p], mean, ratios[p][scenario_count / 20], ratios[p][0]);
+        if (mean < fail_below) {
+            status = 1;
+        }
+        free(ratios[p]);
+    }
+    printf("worst lookahead scenario: --seed=%u (ratio %.4f)\n", worst_scenario, worst_ratio);
+    if (status != 0) {
+        printf("Mean ratio below %.4f\n", fail_below);
+    }
+    return status;
+}
@@ -0,0 +1,336 @@
+/**
+ * \file fault_campaign.c
+ * \brief Power-failure injection campaign for the Iteration_8 scheduler.
+ *
+ * Runs the scheduler binary repeatedly with random power failures injected
+ * at its fault points, restarting it after every failure until the simulated
+ * period completes, exactly like an intermittently powered node. Each
+ * recovery strategy is evaluated over the same seeded trials and compared on
+ * wasted re-execution, forward progress and recovery latency.
+ *
+ * Build and run:
+ * \code
+ * gcc -Wall -Wextra -pedantic -o bin/fault_campaign Iteration_8/tools/fault_campaign.c
+ * ./bin/fault_campaign bin/iteration_8 --trials=1000 --fault-rate=0.02
+ * \endcode
+ */
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../fault_injection.h"
+
+#define MAX_RECOVERY_SAMPLES 65536
+
+/**
+ * \brief Recovery strategy evaluated by the campaign.
+ */
+typedef struct {
+    const char* name;               ///< Label printed in the result table.
+    const char* checkpoint_policy;  ///< Value of --checkpoint-policy, or NULL to run without persistence.
+} RecoveryStrategy;
+
+/**
+ * \brief Campaign settings.
+ */
+typedef struct {
+    const char* binary;
+    unsigned trials;
+    unsigned days;
+    float fault_rate;
+    unsigned seed;
+    unsigned max_restarts;
+    const char* workdir;
+} CampaignOptions;
+
+/**
+ * \brief Events counted in the log of one trial.
+ */
+typedef struct {
+    unsigned boots;
+    unsigned restored_boots;
+    unsigned task_starts;
+    unsigned task_completions;
+    bool completed;
+} TrialLog;
+
+/**
+ * \brief Aggregated results of one strategy.
+ */
+typedef struct {
+    unsigned completed_trials;
+    unsigned long failures;
+    unsigned long task_starts;
+    unsigned long wasted_starts;
+    double* recovery_us;
+    size_t recovery_count;
+} StrategyResult;
+
+static const RecoveryStrategy strategies[] = {
+    {"restart", NULL},
+    {"cycle", "cycle"},
+    {"task", "task"}
+};
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s SCHEDULER_BINARY [--trials=N] [--days=D] [--fault-rate=P] [--seed=S]\n"
+            "       [--max-restarts=M] [--workdir=DIR]\n",
+            program);
+    exit(1);
+}
+
+static const char* option_value(const char* argument, const char* name) {
+    size_t length = strlen(name);
+
+    if (strncmp(argument, name, length) == 0 && argument[length] == '=') {
+        return argument + length + 1;
+    }
+    return NULL;
+}
+
+static void parse_options(int argc, char* argv[], CampaignOptions* options) {
+    options->binary = NULL;
+    options->trials = 200;
+    options->days = 1;
+    options->fault_rate = 0.02f;
+    options->seed = 1;
+    options->max_restarts = 1000;
+    options->workdir = "/tmp";
+
+    for (int i = 1; i < argc; i++) {
+        const char* value = NULL;
+
+        if ((value = option_value(argv[i], "--trials")) != NULL) {
+            options->trials = (unsigned)strtoul(value, NULL, 10);
+        } else if ((value = option_value(argv[i], "--days")) != NULL) {
+            options->days = (unsigned)strtoul(value, NULL, 10);
+        } else if ((value = option_value(argv[i], "--fault-rate")) != NULL) {
+            options->fault_rate = (float)atof(value);
+        } else if ((value = option_value(argv[i], "--seed")) != NULL) {
+            options->seed = (unsigned)strtoul(value, NULL, 10);
+        } else if ((value = option_value(argv[i], "--max-restarts")) != NULL) {
+            options->max_restarts = (unsigned)strtoul(value, NULL, 10);
+        } else if ((value = option_value(argv[i], "--workdir")) != NULL) {
+            options->workdir = value;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+        } else {
+            options->binary = argv[i];
+        }
+    }
+
+    if (options->binary == NULL || options->trials == 0 || options->days == 0) {
+        usage(argv[0]);
+    }
+}
+
+/**
+ * \brief Runs the scheduler once and returns its exit status, or -1 on failure to launch.
+ */
+static int run_scheduler(const CampaignOptions* options, const RecoveryStrategy* strategy,
+                         const char* checkpoint_path, const char* log_path, float fault_rate, unsigned fault_seed) {
+    char days[16];
+    char checkpoint_arg[512];
+    char policy_arg[64];
+    char rate_arg[64];
+    char seed_arg[64];
+    char log_arg[512];
+    char* args[10];
+    int count = 0;
+    int status = 0;
+    pid_t pid = 0;
+
+    snprintf(days, sizeof(days), "%u", options->days);
+    snprintf(checkpoint_arg, sizeof(checkpoint_arg), "--checkpoint=%s", checkpoint_path);
+    snprintf(policy_arg, sizeof(policy_arg), "--checkpoint-policy=%s",
+             strategy->checkpoint_policy != NULL ? strategy->checkpoint_policy : "task");
+    snprintf(rate_arg, sizeof(rate_arg), "--fault-rate=%g", fault_rate);
+    snprintf(seed_arg, sizeof(seed_arg), "--fault-seed=%u", fault_seed);
+    snprintf(log_arg, sizeof(log_arg), "--fault-log=%s", log_path);
+
+    args[count++] = (char*)options->binary;
+    args[count++] = days;
+    args[count++] = "--time-scale=0";
+    if (strategy->checkpoint_policy != NULL) {
+        args[count++] = checkpoint_arg;
+        args[count++] = policy_arg;
+    }
+    args[count++] = rate_arg;
+    args[count++] = seed_arg;
+    args[count++] = log_arg;
+    args[count] = NULL;
+
+    pid = fork();
+    if (pid < 0) {
+        return -1;
+    }
+
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDOUT_FILENO);
+            close(null_fd);
+        }
+        execv(options->binary, args);
+        _exit(127);
+    }
+
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status)) {
+        return -1;
+    }
+    return WEXITSTATUS(status);
+}
+
+static bool read_trial_log(const char* log_path, TrialLog* log, StrategyResult* result) {
+    char line[256];
+    FILE* file = fopen(log_path, "r");
+
+    memset(log, 0, sizeof(*log));
+    if (file == NULL) {
+        return false;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        int restored = 0;
+        long restore_ns = 0;
+
+        if (sscanf(line, "boot restored=%d restore_ns=%ld", &restored, &restore_ns) == 2) {
+            log->boots++;
+            if (restored) {
+                log->restored_boots++;
+                if (result != NULL && result->recovery_count < MAX_RECOVERY_SAMPLES) {
+                    result->recovery_us[result->recovery_count++] = restore_ns / 1000.0;
+                }
+            }
+        } else if (strncmp(line, "task_start", 10) == 0) {
+            log->task_starts++;
+        } else if (strncmp(line, "task_done", 9) == 0) {
+            log->task_completions++;
+        } else if (strncmp(line, "run_complete", 12) == 0) {
+            log->completed = true;
+        }
+    }
+
+    fclose(file);
+    return true;
+}
+
+static int compare_doubles(const void* left, const void* right) {
+    double a = *(const double*)left;
+    double b = *(const double*)right;
+    return (a > b) - (a < b);
+}
+
+static bool run_trial(const CampaignOptions* options, const RecoveryStrategy* strategy, unsigned trial,
+                      unsigned baseline_starts, StrategyResult* result) {
+    char checkpoint_path[256];
+    char log_path[256];
+    TrialLog log;
+    int status = FAULT_EXIT_CODE;
+    unsigned attempt = 0;
+
+    snprintf(checkpoint_path, sizeof(checkpoint_path), "%s/fault_campaign_%d.ckpt", options->workdir, (int)getpid());
+    snprintf(log_path, sizeof(log_path), "%s/fault_campaign_%d.log", options->workdir, (int)getpid());
+    unlink(checkpoint_path);
+    unlink(log_path);
+
+    for (attempt = 0; attempt <= options->max_restarts && status == FAULT_EXIT_CODE; attempt++) {
+        unsigned fault_seed = options->seed + trial * (options->max_restarts + 1) + attempt;
+        status = run_scheduler(options, strategy, checkpoint_path, log_path, options->fault_rate, fault_seed);
+        if (status != 0 && status != FAULT_EXIT_CODE) {
+            fprintf(stderr, "Scheduler exited with status %d in trial %u\n", status, trial);
+            return false;
+        }
+    }
+
+    if (!read_trial_log(log_path, &log, result)) {
+        fprintf(stderr, "Missing event log for trial %u\n", trial);
+        return false;
+    }
+
+    result->failures += log.boots > 0 ? log.boots - 1 : 0;
+    result->task_starts += log.task_starts;
+    if (log.completed) {
+        result->completed_trials++;
+        result->wasted_starts += log.task_starts > baseline_starts ? log.task_starts - baseline_starts : 0;
+    }
+
+    unlink(checkpoint_path);
+    unlink(log_path);
+    return true;
+}
+
+static bool measure_baseline(const CampaignOptions* options, unsigned* baseline_starts) {
+    char log_path[256];
+    TrialLog log;
+    const RecoveryStrategy* reference = &strategies[0];
+
+    snprintf(log_path, sizeof(log_path), "%s/fault_campaign_%d_baseline.log", options->workdir, (int)getpid());
+    unlink(log_path);
+    if (run_scheduler(options, reference, NULL, log_path, 0.0f, 0) != 0 || !read_trial_log(log_path, &log, NULL)) {
+        fprintf(stderr, "Fault-free reference run of %s failed\n", options->binary);
+        return false;
+    }
+
+    unlink(log_path);
+    *baseline_starts = log.task_starts;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    CampaignOptions options;
+    unsigned baseline_starts = 0;
+    size_t strategy_count = sizeof(strategies) / sizeof(strategies[0]);
+
+    parse_options(argc, argv, &options);
+    if (!measure_baseline(&options, &baseline_starts)) {
+        return 1;
+    }
+
+    printf("Fault campaign: %u trials, %u day(s), failure rate %.4f per fault point, seed %u\n",
+           options.trials, options.days, options.fault_rate, options.seed);
+    printf("Fault-free reference: %u task executions\n\n", baseline_starts);
+    printf("%-8s %9s %10s %12s %12s %10s %14s %14s\n", "strategy", "completed", "failures", "executions",
+           "wasted/trial", "progress", "recovery_p50", "recovery_p99");
+
+    for (size_t s = 0; s < strategy_count; s++) {
+        StrategyResult result;
+        double p50 = 0.0;
+        double p99 = 0.0;
+
+        memset(&result, 0, sizeof(result));
+        result.recovery_us = (double*)malloc(sizeof(double) * MAX_RECOVERY_SAMPLES);
+        if (result.recovery_us == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+
+        for (unsigned trial = 0; trial < options.trials; trial++) {
+            if (!run_trial(&options, &strategies[s], trial, baseline_starts, &result)) {
+                free(result.recovery_us);
+                return 1;
+            }
+        }
+
+        if (result.recovery_count > 0) {
+            qsort(result.recovery_us, result.recovery_count, sizeof(double), compare_doubles);
+            p50 = result.recovery_us[result.recovery_count / 2];
+            p99 = result.recovery_us[(result.recovery_count * 99) / 100];
+        }
+
+        printf("%-8s %9u %10lu %12lu %12.2f %9.1f%% %12.1fus %12.1fus\n", strategies[s].name,
+               result.completed_trials, result.failures, result.task_starts,
+               result.completed_trials > 0 ? (double)result.wasted_starts / result.completed_trials : 0.0,
+               result.task_starts > 0 ? 100.0 * baseline_starts * result.completed_trials / result.task_starts : 0.0,
+               p50, p99);
+        free(result.recovery_us);
+    }
+
+    return 0;
+}
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""Generates energy_forecast_model.c/.h, the int8 harvest forecaster blob.
+
+The model predicts the normalized harvest power of the next hour from the
+last 24 hourly values (oldest first). Its weights are set by hand rather than
+trained: a Conv1D front end extracts per-hour values, 3-hour means and rising
+edges, a hidden dense layer picks the samples around the same hour yesterday
+and the latest hour, and the output blends seasonal and plain persistence.
+
+Usage: python3 tools/gen_forecast_model.py [output_directory]
+"""
+
+import os
+import struct
+import sys
+
+MAGIC = 0x4C4D534F
+VERSION = 1
+LAYER_DENSE = 1
+LAYER_CONV1D = 2
+ACTIVATION_NONE = 0
+ACTIVATION_RELU = 1
+
+HISTORY_HOURS = 24
+INPUT_SCALE = 1.0 / 127.0
+
+
+def pad4(data):
+    return data + b"\0" * (-len(data) % 4)
+
+
+def quantize_rows(rows):
+    """Symmetric per-row int8 quantization, returning weights and scales."""
+    weights = []
+    scales = []
+    for row in rows:
+        peak = max(abs(value) for value in row)
+        scale = peak / 127.0 if peak > 0.0 else 1.0
+        scales.append(scale)
+        weights.extend(max(-127, min(127, round(value / scale))) for value in row)
+    return weights, scales
+
+
+def layer(kind, activation, in_dim, out_dim, rows, output_scale, kernel=0, stride=0):
+    weights, scales = quantize_rows(rows)
+    payload = pad4(struct.pack("<%db" % len(weights), *weights))
+    payload += struct.pack("<%df" % len(scales), *scales)
+    payload += struct.pack("<%di" % out_dim, *([0] * out_dim))
+    header = struct.pack("<BBHHHHHfII", kind, activation, 0, in_dim, out_dim,
+                         kernel, stride, output_scale, len(payload), 0)
+    return header + payload
+
+
+def build_model():
+    third = 1.0 / 3.0
+    conv_rows = [
+        [1.0, 0.0, 0.0],       # value at the start of the receptive field
+        [0.0, 0.0, 1.0],       # value at its end
+        [third, third, third], # 3-hour mean
+        [-1.0, 0.0, 1.0],      # rising edge
+    ]
+    conv_length = HISTORY_HOURS - 3 + 1
+    conv_channels = len(conv_rows)
+
+    def pick(position, channel):
+        row = [0.0] * (conv_length * conv_channels)
+        row[position * conv_channels + channel] = 1.0
+        return row
+
+    last = conv_length - 1
+    hidden_rows = [
+        pick(0, 0),     # same hour yesterday
+        pick(last, 1),  # latest hour
+        pick(0, 2),     # mean around the same hour yesterday
+        pick(last, 2),  # mean of the latest hours
+        pick(0, 3),     # harvest ramping up yesterday at this hour
+    ]
+    hidden_rows += [[0.0] * (conv_length * conv_channels)] * (8 - len(hidden_rows))
+    output_rows = [[0.5, 0.2, 0.1, 0.2, 0.05, 0.0, 0.0, 0.0]]
+
+    layers = [
+        layer(LAYER_CONV1D, ACTIVATION_RELU, 1, conv_channels, conv_rows, 1.0 / 127.0, kernel=3, stride=1),
+        layer(LAYER_DENSE, ACTIVATION_RELU, conv_length * conv_channels, 8, hidden_rows, 1.0 / 127.0),
+        layer(LAYER_DENSE, ACTIVATION_NONE, 8, 1, output_rows, 1.0 / 127.0),
+    ]
+    header = struct.pack("<IHHHHHHfI", MAGIC, VERSION, len(layers), HISTORY_HOURS, 1, 1, 0, INPUT_SCALE, 0)
+    return header + b"".join(layers)
+
+
+def write_sources(directory, blob):
+    with open(os.path.join(directory, "energy_forecast_model.h"), "w") as header:
+        header.write("""#ifndef ENERGY_FORECAST_MODEL_H
+#define ENERGY_FORECAST_MODEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * \\brief Hours of harvest history consumed by the forecast model.
+ */
+#define ENERGY_FORECAST_HISTORY_HOURS %d
+
+/**
+ * \\brief Int8 model forecasting the normalized harvest of the next hour.
+ *
+ * The input is the normalized harvest power of the last
+ * ENERGY_FORECAST_HISTORY_HOURS hours, oldest first. Generated by
+ * tools/gen_forecast_model.py; do not edit.
+ */
+extern const uint8_t energy_forecast_model[];
+
+/**
+ * \\brief Size of energy_forecast_model in bytes.
+ */
+extern const size_t energy_forecast_model_size;
+
+#endif // ENERGY_FORECAST_MODEL_H
+""" % HISTORY_HOURS)
+
+    with open(os.path.join(directory, "energy_forecast_model.c"), "w") as source:
+        source.write('#include "energy_forecast_model.h"\n\n')
+        source.write("// Generated by tools/gen_forecast_model.py; do not edit.\n")
+        source.write("_Alignas(4) const uint8_t energy_forecast_model[] = {\n")
+        for offset in range(0, len(blob), 12):
+            chunk = blob[offset:offset + 12]
+            source.write("    " + ", ".join("0x%02x" % byte for byte in chunk) + ",\n")
+        source.write("};\n\n")
+        source.write("const size_t energy_forecast_model_size = sizeof(energy_forecast_model);\n")
+
+
+def main():
+    directory = sys.argv[1] if len(sys.argv) > 1 else os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+    write_sources(directory, build_model())
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,406 @@
+/**
+ * \file policy_compare.c
+ * \brief Head-to-head comparison of the scheduling policies of every iteration.
+ *
+ * Runs every policy of scheduling_policy.h, or those given with --policies,
+ * on the same tasks, harvest and battery: the scheduler options after the
+ * tool's own are applied to every run, and each policy runs once per seed
+ * from --seed to --seed + --seeds - 1. A seed draws the sensor readings and
+ * scales the power of every harvester by a constant factor within
+ * 1 +- --fleet-variation, as it would for a fleet node, so the seeds sample
+ * different harvests; harvest traces are replayed unscaled, and with
+ * --fleet-variation=0 the seeds only differ in their readings. Runs are simulated in this process,
+ * each in its own SchedulerContext on a pool of worker threads, so a
+ * comparison of all iterations over a month takes well under a second
+ * instead of one full-speed process per iteration.
+ *
+ * The report gives, for each policy, the mean over the seeds of the
+ * delivered reports, useful executions, the completions of each task, sleep
+ * hours, energy consumed, final battery charge and the CPU time of a run,
+ * best policy first. Policies are ranked by delivered reports, then useful
+ * executions: a policy that keeps averaging a full buffer it never sends
+ * executes a lot and delivers nothing. With --output, every run is also
+ * written as one row of a CSV table. Fault injection, profiling and checkpoints are process-wide
+ * or file-backed, so their options are rejected; fleets only support the
+ * greedy policy and are rejected too.
+ *
+ * Build and run:
+ * \code
+ * gcc -Wall -Wextra -pedantic -O2 -pthread -o bin/policy_compare Iteration_8/tools/policy_compare.c \
+ *     $(find Iteration_8 -maxdepth 1 -name '*.c' ! -name main.c)
+ * ./bin/policy_compare [--policies=NAME,NAME] [--seeds=N] [--jobs=N] [--output=FILE] [SCHEDULER_OPTIONS]
+ * \endcode
+ */
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../scheduler.h"
+
+#define MAX_POLICIES 32
+#define MAX_SEEDS 100000u
+#define MAX_ARGUMENTS 64
+
+/**
+ * \brief Outcome of one policy on one seed.
+ */
+typedef struct {
+    bool succeeded;
+    RunSummary summary;
+    float battery_mj;
+    double cpu_ms;     ///< CPU time of the worker thread during the run.
+} PolicyRun;
+
+/**
+ * \brief Comparison settings and per-run results.
+ */
+typedef struct {
+    SchedulerOptions options;                        ///< Options shared by every run.
+    const SchedulingPolicy* policies[MAX_POLICIES];
+    size_t policy_count;
+    uint32_t seeds;
+    unsigned jobs;
+    const char* output_path;
+
+    PolicyRun* runs;                                 ///< Policy-major, seeds consecutive.
+    size_t run_count;
+    pthread_mutex_t lock;                            ///< Guards next_run.
+    size_t next_run;
+} Comparison;
+
+static void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [--policies=NAME,NAME] [--seeds=N] [--jobs=N] [--output=FILE] [SCHEDULER_OPTIONS]\n",
+            program);
+    fprintf(stderr, "Policies:");
+    for (size_t i = 0; i < scheduling_policy_count(); i++) {
+        fprintf(stderr, " %s", scheduling_policy_at(i)->name);
+    }
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+static const char* option_value(const char* argument, const char* name) {
+    size_t length = strlen(name);
+
+    if (strncmp(argument, name, length) == 0 && argument[length] == '=') {
+        return argument + length + 1;
+    }
+    return NULL;
+}
+
+static double clock_ms(clockid_t clock) {
+    struct timespec now;
+
+    clock_gettime(clock, &now);
+    return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+}
+
+static bool parse_policies(char* list, Comparison* comparison) {
+    for (char* name = strtok(list, ","); name != NULL; name = strtok(NULL, ",")) {
+        const SchedulingPolicy* policy = scheduling_policy_find(name);
+
+        if (policy == NULL || comparison->policy_count == MAX_POLICIES) {
+            fprintf(stderr, "Unknown policy %s\n", name);
+            return false;
+        }
+        comparison->policies[comparison->policy_count++] = policy;
+    }
+    return comparison->policy_count > 0;
+}
+
+/**
+ * \brief Splits the tool's options from the scheduler options, which are parsed as a scheduler command line.
+ */
+static void parse_options(int argc, char* argv[], Comparison* comparison) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    char* scheduler_argv[MAX_ARGUMENTS];
+    int scheduler_argc = 1;
+    const SchedulerOptions* options = &comparison->options;
+
+    comparison->seeds = 1;
+    comparison->jobs = cores > 0 ? (unsigned)cores : 1;
+    scheduler_argv[0] = argv[0];
+
+    for (int i = 1; i < argc; i++) {
+        const char* value = NULL;
+
+        if ((value = option_value(argv[i], "--policies")) != NULL) {
+            if (!parse_policies(argv[i] + strlen("--policies="), comparison)) {
+                usage(argv[0]);
+            }
+        } else if ((value = option_value(argv[i], "--seeds")) != NULL) {
+            comparison->seeds = (uint32_t)strtoul(value, NULL, 10);
+        } else if ((value = option_value(argv[i], "--jobs")) != NULL) {
+            comparison->jobs = (unsigned)strtoul(value, NULL, 10);
+        } else if ((value = option_value(argv[i], "--output")) != NULL) {
+            comparison->output_path = value;
+        } else if (scheduler_argc < MAX_ARGUMENTS) {
+            scheduler_argv[scheduler_argc++] = argv[i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    if (!scheduler_parse_options(scheduler_argc, scheduler_argv, &comparison->options) || options->infinite_loop ||
+        options->faults.fail_at_point > 0 || options->faults.failure_rate > 0.0f || options->faults.log_path != NULL ||
+        options->profile_path != NULL || options->checkpoint_path != NULL || options->fleet_nodes > 0 ||
+        options->calibrate_power || comparison->seeds == 0 || comparison->seeds > MAX_SEEDS || comparison->jobs == 0) {
+        usage(argv[0]);
+    }
+    comparison->options.time_scale = 0.0f;
+
+    if (comparison->policy_count == 0) {
+        for (size_t i = 0; i < scheduling_policy_count() && i < MAX_POLICIES; i++) {
+            comparison->policies[comparison->policy_count++] = scheduling_policy_at(i);
+        }
+    }
+}
+
+/**
+ * \brief Scales the power of every harvester by a factor within 1 +- the fleet variation, drawn from the seed.
+ */
+static void vary_harvest(SchedulerContext* context) {
+    Prng random;
+
+    prng_seed(&random, context->options.seed, SCHEDULER_STREAM_FLEET);
+    for (size_t i = 0; i < NUM_ENERGY_SOURCES; i++) {
+        float scale = 1.0f + context->options.fleet_variation * (2.0f * prng_unit(&random) - 1.0f);
+
+        context->node.energy_sources[i].harvest_power_mw *= scale;
+    }
+}
+
+/**
+ * \brief Simulates one policy on one seed in a private context.
+ */
+static void run_policy(const Comparison* comparison, size_t run, PolicyRun* result) {
+    SchedulerOptions options = comparison->options;
+    SchedulerContext* context = malloc(sizeof(*context));
+    double start = 0.0;
+
+    options.policy = comparison->policies[run / comparison->seeds];
+    options.seed = comparison->options.seed + run % comparison->seeds;
+    result->succeeded = false;
+    if (context == NULL || !scheduler_init(context, &options, NULL)) {
+        free(context);
+        return;
+    }
+
+    vary_harvest(context);
+    start = clock_ms(CLOCK_THREAD_CPUTIME_ID);
+    scheduler_run(context);
+    result->cpu_ms = clock_ms(CLOCK_THREAD_CPUTIME_ID) - start;
+    result->summary = context->summary;
+    result->battery_mj = context->node.battery.charge_mj;
+    result->succeeded = true;
+    scheduler_close(context);
+    free(context);
+}
+
+static void* compare_worker(void* argument) {
+    Comparison* comparison = argument;
+
+    for (;;) {
+        size_t run = 0;
+
+        pthread_mutex_lock(&comparison->lock);
+        run = comparison->next_run++;
+        pthread_mutex_unlock(&comparison->lock);
+        if (run >= comparison->run_count) {
+            return NULL;
+        }
+        run_policy(comparison, run, &comparison->runs[run]);
+    }
+}
+
+static uint32_t completed_tasks(const RunSummary* summary) {
+    uint32_t completed = 0;
+
+    for (size_t i = 0; i < NUM_SIMULATION_TASKS; i++) {
+        completed += summary->completions[i];
+    }
+    return completed;
+}
+
+static bool write_runs(const Comparison* comparison) {
+    FILE* output = fopen(comparison->output_path, "w");
+
+    if (output == NULL) {
+        fprintf(stderr, "Cannot open %s\n", comparison->output_path);
+        return false;
+    }
+    fprintf(output, "policy;iteration;seed;reports;executed;completed");
+    for (size_t i = 0; i < NUM_SIMULATION_TASKS; i++) {
+        fprintf(output, ";task%zu", i);
+    }
+    fprintf(output, ";sleep_hours;wakeups;consumed_mj;harvested_mj;battery_mj;cpu_ms\n");
+    for (size_t run = 0; run < comparison->run_count; run++) {
+        const SchedulingPolicy* policy = comparison->policies[run / comparison->seeds];
+        const PolicyRun* result = &comparison->runs[run];
+
+        if (!result->succeeded) {
+            continue;
+        }
+        fprintf(output, "%s;%u;%llu;%u;%u;%u", policy->name, policy->iteration,
+                (unsigned long long)(comparison->options.seed + run % comparison->seeds), result->summary.reports,
+                result->summary.executed, completed_tasks(&result->summary));
+        for (size_t i = 0; i < NUM_SIMULATION_TASKS; i++) {
+            fprintf(output, ";%u", result->summary.completions[i]);
+        }
+        fprintf(output, ";%u;%u;%.1f;%.1f;%.1f;%.3f\n", result->summary.sleep_hours, result->summary.wakeups,
+                result->summary.consumed_mj, result->summary.harvested_mj, result->battery_mj, result->cpu_ms);
+    }
+    fclose(output);
+    return true;
+}
+
+/**
+ * \brief Mean results of one policy over the seeds it completed.
+ */
+typedef struct {
+    const SchedulingPolicy* policy;
+    uint32_t succeeded;
+    double reports;
+    double executed;
+    double completions[NUM_SIMULATION_TASKS];
+    double sleep_hours;
+    double consumed_mj;
+    double battery_mj;
+    double cpu_ms;
+} PolicyMean;
+
+static int compare_reports(const void* left, const void* right) {
+    const PolicyMean* a = left;
+    const PolicyMean* b = right;
+
+    if (a->succeeded == 0 || b->succeeded == 0) {
+        return (a->succeeded == 0) - (b->succeeded == 0);
+    }
+    if (a->reports != b->reports) {
+        return a->reports < b->reports ? 1 : -1;
+    }
+    if (a->executed != b->executed) {
+        return a->executed < b->executed ? 1 : -1;
+    }
+    return (a->policy->iteration > b->policy->iteration) - (a->policy->iteration < b->policy->iteration);
+}
+
+/**
+ * \brief Prints the mean of every policy over the seeds, most delivered reports first.
+ *
+ * \return Number of failed runs.
+ */
+static size_t print_report(const Comparison* comparison, double elapsed_ms) {
+    PolicyMean means[MAX_POLICIES];
+    size_t failed = 0;
+
+    memset(means, 0, sizeof(means));
+    for (size_t p = 0; p < comparison->policy_count; p++) {
+        PolicyMean* mean = &means[p];
+
+        mean->policy = comparison->policies[p];
+        for (uint32_t s = 0; s < comparison->seeds; s++) {
+            const PolicyRun* result = &comparison->runs[p * comparison->seeds + s];
+
+            if (!result->succeeded) {
+                failed++;
+                continue;
+            }
+            mean->succeeded++;
+            mean->reports += result->summary.reports;
+            mean->executed += result->summary.executed;
+            for (size_t i = 0; i < NUM_SIMULATION_TASKS; i++) {
+                mean->completions[i] += result->summary.completions[i];
+            }
+            mean->sleep_hours += result->summary.sleep_hours;
+            mean->consumed_mj += result->summary.consumed_mj;
+            mean->battery_mj += result->battery_mj;
+            mean->cpu_ms += result->cpu_ms;
+        }
+        if (mean->succeeded > 0) {
+            mean->reports /= mean->succeeded;
+            mean->executed /= mean->succeeded;
+            for (size_t i = 0; i < NUM_SIMULATION_TASKS; i++) {
+                mean->completions[i] /= mean->succeeded;
+            }
+            mean->sleep_hours /= mean->succeeded;
+            mean->consumed_mj /= mean->succeeded;
+            mean->battery_mj /= mean->succeeded;
+            mean->cpu_ms /= mean->succeeded;
+        }
+    }
+    qsort(means, comparison->policy_count, sizeof(means[0]), compare_reports);
+
+    printf("%zu policies x %u seeds over %d days on %u threads in %.1f ms\n", comparison->policy_count,
+           comparison->seeds, comparison->options.duration_days, comparison->jobs, elapsed_ms);
+    printf("%-12s %4s %8s %10s", "policy", "iter", "reports", "executed");
+    for (size_t i = 0; i < NUM_SIMULATION_TASKS; i++) {
+        printf("   task%zu", i);
+    }
+    printf(" %6s %12s %11s %9s\n", "sleep", "consumed_mj", "battery_mj", "cpu_ms");
+
+    for (size_t p = 0; p < comparison->policy_count; p++) {
+        const PolicyMean* mean = &means[p];
+
+        if (mean->succeeded == 0) {
+            printf("%-12s %4u %8s\n", mean->policy->name, mean->policy->iteration, "failed");
+            continue;
+        }
+        printf("%-12s %4u %8.1f %10.1f", mean->policy->name, mean->policy->iteration, mean->reports, mean->executed);
+        for (size_t i = 0; i < NUM_SIMULATION_TASKS; i++) {
+            printf(" %7.1f", mean->completions[i]);
+        }
+        printf(" %6.1f %12.1f %11.1f %9.3f\n", mean->sleep_hours, mean->consumed_mj, mean->battery_mj,
+               mean->cpu_ms);
+    }
+    return failed;
+}
+
+int main(int argc, char* argv[]) {
+    static Comparison comparison;
+    pthread_t* threads = NULL;
+    unsigned started = 0;
+    double start = 0.0;
+    size_t failed = 0;
+
+    parse_options(argc, argv, &comparison);
+    comparison.run_count = comparison.policy_count * comparison.seeds;
+    if (comparison.jobs > comparison.run_count) {
+        comparison.jobs = (unsigned)comparison.run_count;
+    }
+    comparison.runs = calloc(comparison.run_count, sizeof(*comparison.runs));
+    threads = malloc(comparison.jobs * sizeof(*threads));
+    if (comparison.runs == NULL || threads == NULL) {
+        fprintf(stderr, "Cannot allocate %zu runs\n", comparison.run_count);
+        return 1;
+    }
+    pthread_mutex_init(&comparison.lock, NULL);
+
+    start = clock_ms(CLOCK_MONOTONIC);
+    for (started = 0; started < comparison.jobs; started++) {
+        if (pthread_create(&threads[started], NULL, compare_worker, &comparison) != 0) {
+            break;
+        }
+    }
+    if (started == 0) {
+        fprintf(stderr, "Cannot start the worker threads\n");
+        return 1;
+    }
+    comparison.jobs = started;
+    for (unsigned i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    failed = print_report(&comparison, clock_ms(CLOCK_MONOTONIC) - start);
+    if (comparison.output_path != NULL && !write_runs(&comparison)) {
+        failed++;
+    }
+    free(comparison.runs);
+    free(threads);
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,690 @@
+/**
+ * \file sweep.c
+ * \brief Parallel parameter sweep of the Iteration_8 scheduler.
+ *
+ * Runs the scheduler binary once per configuration on a pool of worker
+ * threads, one run per core at a time. Every run is its own process started
+ * with --time-scale=0 --summary, so runs share no state; the token {run} in
+ * an argument is replaced with the run number, which keeps checkpoint and
+ * log files apart. The summary line of every run is streamed as one row of a
+ * single CSV table as soon as the run ends, and the sweep ends with the best
+ * runs and, for a grid, the mean of the ranked metric for every value of
+ * every option.
+ *
+ * With --in-process, the sweep is linked with the scheduler sources and each
+ * worker simulates its runs in its own SchedulerContext instead of starting a
+ * process, which removes the fork/exec and output parsing cost of short runs.
+ * Fault injection and resource usage are process-wide, so runs with
+ * --fault-* or --profile options fail in this mode.
+ *
+ * A grid specification holds one option per line; `|` separates its values
+ * and the sweep runs the Cartesian product of all lines:
+ * \code
+ * 30
+ * --goal=tasks|resilience
+ * --priorities=2,1,3|3,2,1|1,1,1
+ * --battery=400,200,120|800,400,120
+ * --scheduler=greedy|lookahead
+ * \endcode
+ * A line without `=` lists whole arguments, and an empty value omits the
+ * argument, as in `--trace-loop|`. With --list, each line instead holds the
+ * space-separated arguments of one run. Blank lines and lines starting with
+ * `#` are ignored.
+ *
+ * Build and run:
+ * \code
+ * gcc -Wall -Wextra -pedantic -O2 -pthread -o bin/sweep Iteration_8/tools/sweep.c \
+ *     $(find Iteration_8 -maxdepth 1 -name '*.c' ! -name main.c)
+ * ./bin/sweep bin/iteration_8 Iteration_8/tools/sweep_grid.txt [--list] [--jobs=N] [--output=FILE]
+ *     [--metric=KEY]
+ * ./bin/sweep --in-process Iteration_8/tools/sweep_grid.txt [...]
+ * \endcode
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../fleet.h"
+#include "../scheduler.h"
+
+#define MAX_DIMENSIONS 32
+#define MAX_VALUES 64
+#define MAX_RUN_ARGUMENTS 64
+#define MAX_ARGUMENT_LENGTH 256
+#define MAX_LINE_LENGTH 4096
+#define MAX_RUNS 10000000u
+#define MAX_TOP_RUNS 5
+#define SUMMARY_PREFIX "summary "
+
+extern char** environ;
+
+/**
+ * \brief One line of a grid: an option and the values it takes.
+ */
+typedef struct {
+    char* prefix;                  ///< Text before the value, such as "--goal=", empty for whole arguments.
+    char* values[MAX_VALUES];      ///< Values of the option; an empty whole argument is omitted.
+    size_t count;                  ///< Number of values.
+} SweepDimension;
+
+/**
+ * \brief Run of the best-runs table.
+ */
+typedef struct {
+    uint64_t run;
+    double metric;
+    char arguments[MAX_LINE_LENGTH];
+} TopRun;
+
+/**
+ * \brief Result of one scheduler run.
+ */
+typedef struct {
+    bool succeeded;
+    char summary[MAX_LINE_LENGTH];   ///< Summary line without its prefix.
+    double wall_ms;
+} RunResult;
+
+/**
+ * \brief Sweep settings, configurations and shared results.
+ */
+typedef struct {
+    const char* binary;
+    const char* spec_path;
+    const char* output_path;
+    const char* metric;              ///< Summary key ranked and aggregated.
+    unsigned jobs;
+    bool list_mode;
+    bool in_process;                 ///< Run the configurations in this process.
+
+    SweepDimension dimensions[MAX_DIMENSIONS];
+    size_t dimension_count;
+    char** lines;                    ///< Runs of a list specification.
+    size_t line_count;
+    uint64_t run_count;
+
+    pthread_mutex_t lock;            ///< Guards everything below.
+    FILE* output;
+    uint64_t next_run;
+    uint64_t finished;
+    uint64_t failed;
+    bool header_written;
+    double metric_sum[MAX_DIMENSIONS][MAX_VALUES];
+    uint64_t metric_runs[MAX_DIMENSIONS][MAX_VALUES];
+    TopRun top[MAX_TOP_RUNS];
+    size_t top_count;
+} Sweep;
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s SCHEDULER_BINARY SPEC_FILE [--list] [--jobs=N] [--output=FILE] [--metric=KEY]\n"
+            "       %s --in-process SPEC_FILE [--list] [--jobs=N] [--output=FILE] [--metric=KEY]\n",
+            program, program);
+    exit(1);
+}
+
+static const char* option_value(const char* argument, const char* name) {
+    size_t length = strlen(name);
+
+    if (strncmp(argument, name, length) == 0 && argument[length] == '=') {
+        return argument + length + 1;
+    }
+    return NULL;
+}
+
+static double now_ms(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+}
+
+static void parse_options(int argc, char* argv[], Sweep* sweep) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    const char* paths[2] = {NULL, NULL};
+    size_t path_count = 0;
+    size_t expected_paths = 2;
+
+    sweep->output_path = "sweep.csv";
+    sweep->metric = "executed";
+    sweep->jobs = cores > 0 ? (unsigned)cores : 1;
+
+    for (int i = 1; i < argc; i++) {
+        const char* value = NULL;
+
+        if ((value = option_value(argv[i], "--jobs")) != NULL) {
+            sweep->jobs = (unsigned)strtoul(value, NULL, 10);
+        } else if ((value = option_value(argv[i], "--output")) != NULL) {
+            sweep->output_path = value;
+        } else if ((value = option_value(argv[i], "--metric")) != NULL) {
+            sweep->metric = value;
+        } else if (strcmp(argv[i], "--list") == 0) {
+            sweep->list_mode = true;
+        } else if (strcmp(argv[i], "--in-process") == 0) {
+            sweep->in_process = true;
+        } else if (argv[i][0] == '-' || path_count == 2) {
+            usage(argv[0]);
+        } else {
+            paths[path_count++] = argv[i];
+        }
+    }
+
+    expected_paths = sweep->in_process ? 1 : 2;
+    if (path_count != expected_paths || sweep->jobs == 0) {
+        usage(argv[0]);
+    }
+    sweep->binary = sweep->in_process ? "scheduler" : paths[0];
+    sweep->spec_path = paths[expected_paths - 1];
+}
+
+static char* trim(char* text) {
+    char* end = text + strlen(text);
+
+    while (*text == ' ' || *text == '\t') {
+        text++;
+    }
+    while (end > text && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) {
+        *--end = '\0';
+    }
+    return text;
+}
+
+/**
+ * \brief Splits a grid line into its option prefix and values.
+ */
+static bool parse_dimension(char* line, SweepDimension* dimension) {
+    char* equals = strchr(line, '=');
+    char* values = line;
+    char* value = NULL;
+    char* saved = NULL;
+
+    dimension->count = 0;
+    if (equals != NULL) {
+        dimension->prefix = strndup(line, (size_t)(equals - line + 1));
+        values = equals + 1;
+    } else {
+        dimension->prefix = strdup("");
+    }
+    if (dimension->prefix == NULL) {
+        return false;
+    }
+
+    // strtok would drop the empty values that omit an argument.
+    for (value = values;; value = saved + 1) {
+        saved = strchr(value, '|');
+        if (saved != NULL) {
+            *saved = '\0';
+        }
+        if (dimension->count == MAX_VALUES) {
+            fprintf(stderr, "More than %d values for %s\n", MAX_VALUES, dimension->prefix);
+            return false;
+        }
+        dimension->values[dimension->count] = strdup(value);
+        if (dimension->values[dimension->count++] == NULL) {
+            return false;
+        }
+        if (saved == NULL) {
+            return true;
+        }
+    }
+}
+
+static bool read_specification(Sweep* sweep) {
+    char buffer[MAX_LINE_LENGTH];
+    FILE* file = fopen(sweep->spec_path, "r");
+    size_t line_capacity = 0;
+
+    if (file == NULL) {
+        fprintf(stderr, "Cannot open %s: %s\n", sweep->spec_path, strerror(errno));
+        return false;
+    }
+
+    sweep->run_count = sweep->list_mode ? 0 : 1;
+    while (fgets(buffer, sizeof(buffer), file) != NULL) {
+        char* line = trim(buffer);
+
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+        if (sweep->list_mode) {
+            if (sweep->line_count == line_capacity) {
+                char** lines = NULL;
+
+                line_capacity = line_capacity > 0 ? line_capacity * 2 : 256;
+                lines = realloc(sweep->lines, line_capacity * sizeof(*lines));
+                if (lines == NULL) {
+                    fclose(file);
+                    return false;
+                }
+                sweep->lines = lines;
+            }
+            sweep->lines[sweep->line_count] = strdup(line);
+            if (sweep->lines[sweep->line_count++] == NULL) {
+                fclose(file);
+                return false;
+            }
+            sweep->run_count++;
+        } else {
+            SweepDimension* dimension = &sweep->dimensions[sweep->dimension_count];
+
+            if (sweep->dimension_count == MAX_DIMENSIONS || !parse_dimension(line, dimension)) {
+                fprintf(stderr, "Invalid grid line: %s\n", line);
+                fclose(file);
+                return false;
+            }
+            sweep->dimension_count++;
+            sweep->run_count *= dimension->count;
+            if (sweep->run_count > MAX_RUNS) {
+                fprintf(stderr, "The grid holds more than %u runs\n", MAX_RUNS);
+                fclose(file);
+                return false;
+            }
+        }
+    }
+
+    fclose(file);
+    return sweep->run_count > 0;
+}
+
+/**
+ * \brief Copies an argument, replacing every {run} with the run number.
+ */
+static void expand_argument(char* destination, const char* prefix, const char* value, uint64_t run) {
+    char text[MAX_ARGUMENT_LENGTH];
+    size_t length = 0;
+
+    snprintf(text, sizeof(text), "%s%s", prefix, value);
+    for (const char* c = text; *c != '\0' && length + 1 < MAX_ARGUMENT_LENGTH;) {
+        if (strncmp(c, "{run}", 5) == 0) {
+            length += (size_t)snprintf(destination + length, MAX_ARGUMENT_LENGTH - length, "%llu",
+                                       (unsigned long long)run);
+            length = length < MAX_ARGUMENT_LENGTH ? length : MAX_ARGUMENT_LENGTH - 1;
+            c += 5;
+        } else {
+            destination[length++] = *c++;
+        }
+    }
+    destination[length] = '\0';
+}
+
+/**
+ * \brief Builds the argument vector of a run.
+ *
+ * \param choices Destination of the value chosen in every grid dimension.
+ * \return Number of arguments, or 0 if a run holds too many.
+ */
+static size_t build_arguments(const Sweep* sweep, uint64_t run, char storage[][MAX_ARGUMENT_LENGTH], char* argv[],
+                              size_t choices[]) {
+    size_t count = 0;
+
+    argv[count++] = (char*)sweep->binary;
+    argv[count++] = "--time-scale=0";
+    argv[count++] = "--summary";
+
+    if (sweep->list_mode) {
+        char line[MAX_LINE_LENGTH];
+        char* saved = NULL;
+
+        snprintf(line, sizeof(line), "%s", sweep->lines[run]);
+        for (char* token = strtok_r(line, " \t", &saved); token != NULL; token = strtok_r(NULL, " \t", &saved)) {
+            if (count + 1 == MAX_RUN_ARGUMENTS) {
+                return 0;
+            }
+            expand_argument(storage[count], "", token, run);
+            argv[count] = storage[count];
+            count++;
+        }
+    } else {
+        uint64_t rest = run;
+
+        // The run number is the mixed-radix number of the chosen values, last dimension fastest.
+        for (size_t d = sweep->dimension_count; d-- > 0;) {
+            choices[d] = (size_t)(rest % sweep->dimensions[d].count);
+            rest /= sweep->dimensions[d].count;
+        }
+        for (size_t d = 0; d < sweep->dimension_count; d++) {
+            const SweepDimension* dimension = &sweep->dimensions[d];
+            const char* value = dimension->values[choices[d]];
+
+            if (dimension->prefix[0] == '\0' && value[0] == '\0') {
+                continue;
+            }
+            if (count + 1 == MAX_RUN_ARGUMENTS) {
+                return 0;
+            }
+            expand_argument(storage[count], dimension->prefix, value, run);
+            argv[count] = storage[count];
+            count++;
+        }
+    }
+
+    argv[count] = NULL;
+    return count;
+}
+
+/**
+ * \brief Runs the scheduler and keeps the summary line of its output.
+ */
+static void run_configuration(char* argv[], RunResult* result) {
+    posix_spawn_file_actions_t actions;
+    char line[MAX_LINE_LENGTH];
+    char chunk[16384];
+    size_t length = 0;
+    ssize_t received = 0;
+    int pipe_fds[2];
+    int status = 0;
+    pid_t pid = 0;
+    double start = now_ms();
+
+    result->succeeded = false;
+    result->summary[0] = '\0';
+    // Close-on-exec keeps the pipe out of the runs other workers start meanwhile.
+    if (pipe2(pipe_fds, O_CLOEXEC) != 0) {
+        return;
+    }
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, pipe_fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    if (posix_spawn(&pid, argv[0], &actions, NULL, argv, environ) != 0) {
+        posix_spawn_file_actions_destroy(&actions);
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        return;
+    }
+    posix_spawn_file_actions_destroy(&actions);
+    close(pipe_fds[1]);
+
+    while ((received = read(pipe_fds[0], chunk, sizeof(chunk))) > 0 || (received < 0 && errno == EINTR)) {
+        for (ssize_t i = 0; i < received; i++) {
+            if (chunk[i] != '\n') {
+                line[length] = chunk[i];
+                length += length + 1 < sizeof(line) ? 1 : 0;
+                continue;
+            }
+            line[length] = '\0';
+            if (strncmp(line, SUMMARY_PREFIX, strlen(SUMMARY_PREFIX)) == 0) {
+                snprintf(result->summary, sizeof(result->summary), "%s", line + strlen(SUMMARY_PREFIX));
+            }
+            length = 0;
+        }
+    }
+    close(pipe_fds[0]);
+
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    result->wall_ms = now_ms() - start;
+    result->succeeded = WIFEXITED(status) && WEXITSTATUS(status) == 0 && result->summary[0] != '\0';
+}
+
+/**
+ * \brief Simulates a run in a private context and keeps its summary line.
+ */
+static void run_configuration_in_process(int argc, char* argv[], RunResult* result) {
+    SchedulerOptions options;
+    SchedulerContext* context = malloc(sizeof(*context));
+    char* line = NULL;
+    size_t length = 0;
+    FILE* summary = NULL;
+    double start = now_ms();
+
+    result->succeeded = false;
+    result->summary[0] = '\0';
+    if (context == NULL || !scheduler_parse_options(argc, argv, &options) || options.faults.fail_at_point > 0 ||
+        options.faults.failure_rate > 0.0f || options.faults.log_path != NULL || options.profile_path != NULL ||
+        !scheduler_init(context, &options, NULL)) {
+        free(context);
+        return;
+    }
+
+    summary = open_memstream(&line, &length);
+    if (options.fleet_nodes > 0) {
+        Fleet fleet;
+
+        if (fleet_init(&fleet, context, options.fleet_nodes, options.fleet_variation)) {
+            fleet_run(&fleet, (uint32_t)options.duration_days);
+            if (summary != NULL) {
+                fleet_print_summary(&fleet, summary);
+            }
+            fleet_free(&fleet);
+        }
+    } else {
+        scheduler_run(context);
+        if (summary != NULL) {
+            scheduler_print_summary(context, summary);
+        }
+    }
+    if (summary != NULL) {
+        fclose(summary);
+    }
+    scheduler_close(context);
+    free(context);
+
+    result->wall_ms = now_ms() - start;
+    if (line != NULL && strncmp(line, SUMMARY_PREFIX, strlen(SUMMARY_PREFIX)) == 0) {
+        snprintf(result->summary, sizeof(result->summary), "%s", line + strlen(SUMMARY_PREFIX));
+        result->summary[strcspn(result->summary, "\n")] = '\0';
+        result->succeeded = true;
+    }
+    free(line);
+}
+
+/**
+ * \brief Reads a numeric key of a summary line.
+ */
+static bool summary_value(const char* summary, const char* key, double* value) {
+    size_t length = strlen(key);
+
+    for (const char* field = summary; field != NULL; field = strchr(field, ' ')) {
+        field += *field == ' ' ? 1 : 0;
+        if (strncmp(field, key, length) == 0 && field[length] == '=') {
+            *value = strtod(field + length + 1, NULL);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * \brief Writes a summary as CSV fields, either its keys or its values.
+ */
+static void write_summary_fields(FILE* output, const char* summary, bool keys) {
+    for (const char* field = summary; *field != '\0';) {
+        const char* equals = strchr(field, '=');
+        const char* end = strchr(field, ' ');
+
+        end = end != NULL ? end : field + strlen(field);
+        if (equals == NULL || equals > end) {
+            break;
+        }
+        if (keys) {
+            fprintf(output, ";%.*s", (int)(equals - field), field);
+        } else {
+            fprintf(output, ";%.*s", (int)(end - equals - 1), equals + 1);
+        }
+        field = *end == ' ' ? end + 1 : end;
+    }
+}
+
+static void record_top_run(Sweep* sweep, uint64_t run, double metric, const char* arguments) {
+    size_t position = sweep->top_count;
+
+    while (position > 0 && sweep->top[position - 1].metric < metric) {
+        position--;
+    }
+    if (position == MAX_TOP_RUNS) {
+        return;
+    }
+    if (sweep->top_count < MAX_TOP_RUNS) {
+        sweep->top_count++;
+    }
+    memmove(&sweep->top[position + 1], &sweep->top[position], (sweep->top_count - 1 - position) * sizeof(TopRun));
+    sweep->top[position].run = run;
+    sweep->top[position].metric = metric;
+    snprintf(sweep->top[position].arguments, sizeof(sweep->top[position].arguments), "%s", arguments);
+}
+
+/**
+ * \brief Streams one row into the table and folds the run into the aggregates.
+ */
+static void record_result(Sweep* sweep, uint64_t run, char* argv[], size_t argc, const size_t choices[],
+                          const RunResult* result) {
+    char arguments[MAX_LINE_LENGTH];
+    size_t length = 0;
+    double metric = 0.0;
+
+    arguments[0] = '\0';
+    // The binary, --time-scale and --summary are the same for every run.
+    for (size_t i = 3; i < argc && length < sizeof(arguments); i++) {
+        length += (size_t)snprintf(arguments + length, sizeof(arguments) - length, "%s%s", i > 3 ? " " : "", argv[i]);
+    }
+
+    pthread_mutex_lock(&sweep->lock);
+    sweep->finished++;
+    if (!result->succeeded) {
+        sweep->failed++;
+        fprintf(stderr, "Run %llu failed: %s\n", (unsigned long long)run, arguments);
+        pthread_mutex_unlock(&sweep->lock);
+        return;
+    }
+
+    if (!sweep->header_written) {
+        fprintf(sweep->output, "run;arguments");
+        write_summary_fields(sweep->output, result->summary, true);
+        fprintf(sweep->output, ";wall_ms\n");
+        sweep->header_written = true;
+    }
+    fprintf(sweep->output, "%llu;%s", (unsigned long long)run, arguments);
+    write_summary_fields(sweep->output, result->summary, false);
+    fprintf(sweep->output, ";%.3f\n", result->wall_ms);
+    fflush(sweep->output);
+
+    if (summary_value(result->summary, sweep->metric, &metric)) {
+        record_top_run(sweep, run, metric, arguments);
+        for (size_t d = 0; !sweep->list_mode && d < sweep->dimension_count; d++) {
+            sweep->metric_sum[d][choices[d]] += metric;
+            sweep->metric_runs[d][choices[d]]++;
+        }
+    }
+    pthread_mutex_unlock(&sweep->lock);
+}
+
+static void* sweep_worker(void* argument) {
+    Sweep* sweep = argument;
+
+    for (;;) {
+        char storage[MAX_RUN_ARGUMENTS][MAX_ARGUMENT_LENGTH];
+        char* argv[MAX_RUN_ARGUMENTS];
+        RunResult result;
+        size_t choices[MAX_DIMENSIONS];
+        size_t argc = 0;
+        uint64_t run = 0;
+
+        pthread_mutex_lock(&sweep->lock);
+        run = sweep->next_run++;
+        pthread_mutex_unlock(&sweep->lock);
+        if (run >= sweep->run_count) {
+            return NULL;
+        }
+
+        argc = build_arguments(sweep, run, storage, argv, choices);
+        if (argc == 0) {
+            result.succeeded = false;
+        } else if (sweep->in_process) {
+            run_configuration_in_process((int)argc, argv, &result);
+        } else {
+            run_configuration(argv, &result);
+        }
+        record_result(sweep, run, argv, argc, choices, &result);
+    }
+}
+
+static void print_report(const Sweep* sweep, double elapsed_ms) {
+    printf("%llu runs (%llu failed) on %u threads in %.1f s: %.1f runs/s\n", (unsigned long long)sweep->finished,
+           (unsigned long long)sweep->failed, sweep->jobs, elapsed_ms / 1000.0,
+           elapsed_ms > 0.0 ? sweep->finished * 1000.0 / elapsed_ms : 0.0);
+    if (sweep->top_count == 0) {
+        return;
+    }
+
+    printf("\nBest runs by %s:\n", sweep->metric);
+    for (size_t i = 0; i < sweep->top_count; i++) {
+        printf("  %12.1f  run %-8llu %s\n", sweep->top[i].metric, (unsigned long long)sweep->top[i].run,
+               sweep->top[i].arguments);
+    }
+
+    if (sweep->list_mode) {
+        return;
+    }
+    printf("\nMean %s per value:\n", sweep->metric);
+    for (size_t d = 0; d < sweep->dimension_count; d++) {
+        const SweepDimension* dimension = &sweep->dimensions[d];
+
+        if (dimension->count < 2) {
+            continue;
+        }
+        for (size_t v = 0; v < dimension->count; v++) {
+            char label[MAX_ARGUMENT_LENGTH];
+
+            snprintf(label, sizeof(label), "%s%s", dimension->prefix, dimension->values[v]);
+            printf("  %-40s %12.1f\n", label,
+                   sweep->metric_runs[d][v] > 0 ? sweep->metric_sum[d][v] / sweep->metric_runs[d][v] : 0.0);
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    static Sweep sweep;
+    pthread_t* threads = NULL;
+    double start = 0.0;
+    unsigned started = 0;
+
+    parse_options(argc, argv, &sweep);
+    if (!read_specification(&sweep)) {
+        fprintf(stderr, "No run in %s\n", sweep.spec_path);
+        return 1;
+    }
+    if (sweep.jobs > sweep.run_count) {
+        sweep.jobs = (unsigned)sweep.run_count;
+    }
+
+    sweep.output = fopen(sweep.output_path, "w");
+    threads = malloc(sweep.jobs * sizeof(*threads));
+    if (sweep.output == NULL || threads == NULL) {
+        fprintf(stderr, "Cannot open %s\n", sweep.output_path);
+        return 1;
+    }
+    pthread_mutex_init(&sweep.lock, NULL);
+
+    printf("Sweeping %llu configurations of %s on %u threads into %s\n", (unsigned long long)sweep.run_count,
+           sweep.binary, sweep.jobs, sweep.output_path);
+    fflush(stdout);
+    start = now_ms();
+    for (started = 0; started < sweep.jobs; started++) {
+        if (pthread_create(&threads[started], NULL, sweep_worker, &sweep) != 0) {
+            break;
+        }
+    }
+    if (started == 0) {
+        fprintf(stderr, "Cannot start the worker threads\n");
+        return 1;
+    }
+    sweep.jobs = started;
+    for (unsigned i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    fclose(sweep.output);
+    print_report(&sweep, now_ms() - start);
+    free(threads);
+    return sweep.failed > 0 ? 1 : 0;
+}
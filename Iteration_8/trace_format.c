@@ -0,0 +1,383 @@
+#include "trace_format.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc_tracker.h"
+#include "error_handling.h"
+
+static size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static size_t block_bytes(uint32_t count) {
+    return align_up(count * sizeof(uint16_t), 4) + align_up(count * sizeof(int16_t), 4);
+}
+
+static const uint16_t* block_times(const TraceFile* file, const TraceBlockIndex* entry) {
+    return (const uint16_t*)(file->data + entry->offset);
+}
+
+static const int16_t* block_powers(const TraceFile* file, const TraceBlockIndex* entry) {
+    return (const int16_t*)(file->data + entry->offset + align_up(entry->count * sizeof(uint16_t), 4));
+}
+
+/**
+ * \brief Integrates the part of one block inside [start, end) from its raw samples.
+ */
+static double block_energy(const TraceFile* file, size_t block, uint32_t start, uint32_t end) {
+    const TraceBlockIndex* entry = &file->index[block];
+    const uint16_t* deltas = block_times(file, entry);
+    const int16_t* powers = block_powers(file, entry);
+    uint32_t time = entry->first_time;
+    int64_t weighted = 0;
+
+    for (uint32_t i = 0; i < entry->count && time < end; i++) {
+        uint32_t next = i + 1 < entry->count ? time + deltas[i + 1] : entry->end_time;
+        uint32_t from = time > start ? time : start;
+        uint32_t to = next < end ? next : end;
+
+        if (to > from) {
+            weighted += (int64_t)powers[i] * (int64_t)(to - from);
+        }
+        time = next;
+    }
+    return (double)weighted * file->header->power_scale;
+}
+
+bool trace_file_attach(TraceFile* file, const uint8_t* data, size_t size) {
+    const TraceFileHeader* header = (const TraceFileHeader*)data;
+    uint64_t samples = 0;
+
+    if (file == NULL) {
+        return false;
+    }
+    memset(file, 0, sizeof(*file));
+
+    if (data == NULL || size < sizeof(TraceFileHeader) || ((uintptr_t)data & 7u) != 0 ||
+        header->magic != TRACE_FILE_MAGIC || header->version != TRACE_FILE_VERSION) {
+        return false;
+    }
+
+    if (header->block_count == 0 || header->block_samples == 0 || header->block_samples > UINT16_MAX ||
+        header->index_offset % 8 != 0 || header->index_offset > size ||
+        header->block_count > (size - header->index_offset) / sizeof(TraceBlockIndex)) {
+        handle_error("Corrupted indexed trace header");
+        return false;
+    }
+
+    file->data = data;
+    file->size = size;
+    file->header = header;
+    file->index = (const TraceBlockIndex*)(data + header->index_offset);
+
+    for (uint64_t i = 0; i < header->block_count; i++) {
+        const TraceBlockIndex* entry = &file->index[i];
+
+        if (entry->count == 0 || entry->count > header->block_samples || entry->offset % 4 != 0 ||
+            entry->offset > header->index_offset || block_bytes(entry->count) > header->index_offset - entry->offset ||
+            entry->end_time < entry->first_time || (i > 0 && entry->first_time < file->index[i - 1].end_time)) {
+            handle_error("Corrupted indexed trace block");
+            memset(file, 0, sizeof(*file));
+            return false;
+        }
+        samples += entry->count;
+    }
+
+    if (samples != header->sample_count) {
+        handle_error("Indexed trace sample count does not match its blocks");
+        memset(file, 0, sizeof(*file));
+        return false;
+    }
+
+    file->total_energy_mj = file->index[header->block_count - 1].energy_before_mj +
+                            block_energy(file, header->block_count - 1, 0, UINT32_MAX);
+    return true;
+}
+
+long trace_file_find_block(const TraceFile* file, uint32_t time) {
+    size_t low = 0;
+    size_t high = 0;
+
+    if (file == NULL || file->header == NULL || time < file->index[0].first_time || time >= file->header->end_time) {
+        return -1;
+    }
+
+    // Last block whose first sample is not after the time.
+    high = file->header->block_count;
+    while (high - low > 1) {
+        size_t middle = low + (high - low) / 2;
+        if (file->index[middle].first_time <= time) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return (long)low;
+}
+
+size_t trace_file_decode_block(const TraceFile* file, size_t block, uint32_t* times, float* powers_mw) {
+    const TraceBlockIndex* entry = NULL;
+
+    if (file == NULL || file->header == NULL || block >= file->header->block_count) {
+        return 0;
+    }
+
+    entry = &file->index[block];
+    if (times != NULL) {
+        const uint16_t* deltas = block_times(file, entry);
+        uint32_t time = entry->first_time;
+
+        for (uint32_t i = 0; i < entry->count; i++) {
+            time += deltas[i];
+            times[i] = time;
+        }
+    }
+    if (powers_mw != NULL) {
+        const int16_t* powers = block_powers(file, entry);
+        float scale = file->header->power_scale;
+
+        for (uint32_t i = 0; i < entry->count; i++) {
+            powers_mw[i] = powers[i] * scale;
+        }
+    }
+    return entry->count;
+}
+
+float trace_file_power_at(const TraceFile* file, uint32_t time) {
+    long block = trace_file_find_block(file, time);
+    const TraceBlockIndex* entry = NULL;
+    const uint16_t* deltas = NULL;
+    uint32_t sample_time = 0;
+    uint32_t i = 0;
+
+    if (block < 0) {
+        return 0.0f;
+    }
+
+    entry = &file->index[block];
+    deltas = block_times(file, entry);
+    sample_time = entry->first_time;
+    while (i + 1 < entry->count && sample_time + deltas[i + 1] <= time) {
+        sample_time += deltas[++i];
+    }
+    return block_powers(file, entry)[i] * file->header->power_scale;
+}
+
+double trace_file_energy(const TraceFile* file, uint32_t start, uint32_t end) {
+    long first = 0;
+    long last = 0;
+    double energy_mj = 0.0;
+
+    if (file == NULL || file->header == NULL || end <= start) {
+        return 0.0;
+    }
+
+    if (start < file->index[0].first_time) {
+        start = file->index[0].first_time;
+    }
+    if (end > file->header->end_time) {
+        end = file->header->end_time;
+    }
+    if (end <= start) {
+        return 0.0;
+    }
+
+    first = trace_file_find_block(file, start);
+    last = trace_file_find_block(file, end - 1);
+    if (first == last) {
+        return block_energy(file, (size_t)first, start, end);
+    }
+
+    energy_mj = block_energy(file, (size_t)first, start, end);
+    energy_mj += file->index[last].energy_before_mj - file->index[first + 1].energy_before_mj;
+    energy_mj += block_energy(file, (size_t)last, start, end);
+    return energy_mj;
+}
+
+bool trace_file_power_bounds(const TraceFile* file, uint32_t start, uint32_t end, float* min_mw, float* max_mw) {
+    long first = 0;
+    long last = 0;
+    int16_t low = INT16_MAX;
+    int16_t high = INT16_MIN;
+
+    if (file == NULL || file->header == NULL || min_mw == NULL || max_mw == NULL || end <= start) {
+        return false;
+    }
+
+    first = trace_file_find_block(file, start > file->index[0].first_time ? start : file->index[0].first_time);
+    last = trace_file_find_block(file, end - 1 < file->header->end_time ? end - 1 : file->header->end_time - 1);
+    if (first < 0 || last < 0 || last < first) {
+        return false;
+    }
+
+    for (long block = first; block <= last; block++) {
+        low = file->index[block].min_power < low ? file->index[block].min_power : low;
+        high = file->index[block].max_power > high ? file->index[block].max_power : high;
+    }
+    *min_mw = low * file->header->power_scale;
+    *max_mw = high * file->header->power_scale;
+    return true;
+}
+
+static int16_t to_fixed_point(float power_mw, float scale) {
+    float units = power_mw / scale;
+
+    if (units > INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (units < -INT16_MAX) {
+        return -INT16_MAX;
+    }
+    return (int16_t)(units + (units >= 0.0f ? 0.5f : -0.5f));
+}
+
+static void write_bytes(TraceFileWriter* writer, const void* data, size_t size) {
+    if (!writer->failed && size > 0 && fwrite(data, 1, size, writer->output) != size) {
+        writer->failed = true;
+    }
+}
+
+static void write_padding(TraceFileWriter* writer, size_t size) {
+    static const uint8_t zeros[8] = {0};
+    write_bytes(writer, zeros, align_up(size, 4) - size);
+}
+
+/**
+ * \brief Writes the pending block; `next_time` is the time its last sample lasts until.
+ */
+static void flush_block(TraceFileWriter* writer, uint32_t next_time) {
+    uint16_t deltas[TRACE_FILE_BLOCK_SAMPLES];
+    TraceBlockIndex entry;
+    int64_t weighted = 0;
+    long offset = ftell(writer->output);
+
+    if (writer->count == 0 || writer->failed) {
+        return;
+    }
+
+    if (writer->header.block_count == writer->index_capacity) {
+        size_t capacity = writer->index_capacity > 0 ? writer->index_capacity * 2 : 256;
+        TraceBlockIndex* index = tracked_realloc(ALLOC_SUBSYSTEM_TRACE, writer->index, capacity * sizeof(*index));
+
+        if (index == NULL) {
+            writer->failed = true;
+            return;
+        }
+        writer->index = index;
+        writer->index_capacity = capacity;
+    }
+
+    memset(&entry, 0, sizeof(entry));
+    entry.first_time = writer->times[0];
+    entry.end_time = next_time;
+    entry.offset = (uint64_t)offset;
+    entry.count = writer->count;
+    entry.min_power = INT16_MAX;
+    entry.max_power = INT16_MIN;
+    entry.energy_before_mj = writer->energy_mj;
+
+    for (uint32_t i = 0; i < writer->count; i++) {
+        uint32_t until = i + 1 < writer->count ? writer->times[i + 1] : next_time;
+
+        deltas[i] = (uint16_t)(i > 0 ? writer->times[i] - writer->times[i - 1] : 0);
+        entry.min_power = writer->powers[i] < entry.min_power ? writer->powers[i] : entry.min_power;
+        entry.max_power = writer->powers[i] > entry.max_power ? writer->powers[i] : entry.max_power;
+        entry.sum_power += writer->powers[i];
+        weighted += (int64_t)writer->powers[i] * (int64_t)(until - writer->times[i]);
+    }
+
+    write_bytes(writer, deltas, writer->count * sizeof(uint16_t));
+    write_padding(writer, writer->count * sizeof(uint16_t));
+    write_bytes(writer, writer->powers, writer->count * sizeof(int16_t));
+    write_padding(writer, writer->count * sizeof(int16_t));
+
+    writer->energy_mj += (double)weighted * writer->header.power_scale;
+    writer->index[writer->header.block_count++] = entry;
+    writer->header.sample_count += writer->count;
+    writer->count = 0;
+}
+
+static void append_sample(TraceFileWriter* writer, uint32_t time, int16_t power) {
+    if (writer->count == TRACE_FILE_BLOCK_SAMPLES) {
+        flush_block(writer, time);
+    }
+    if (writer->header.sample_count + writer->count == 1) {
+        writer->first_interval = time - writer->last_time;
+    }
+
+    writer->times[writer->count] = time;
+    writer->powers[writer->count] = power;
+    writer->count++;
+    writer->last_time = time;
+}
+
+bool trace_file_writer_open(TraceFileWriter* writer, const char* path, float power_scale) {
+    if (writer == NULL || path == NULL || !(power_scale > 0.0f)) {
+        return false;
+    }
+
+    memset(writer, 0, sizeof(*writer));
+    writer->output = fopen(path, "wb");
+    if (writer->output == NULL) {
+        handle_error("Cannot create indexed trace");
+        return false;
+    }
+
+    writer->header.magic = TRACE_FILE_MAGIC;
+    writer->header.version = TRACE_FILE_VERSION;
+    writer->header.block_samples = TRACE_FILE_BLOCK_SAMPLES;
+    writer->header.power_scale = power_scale;
+    write_bytes(writer, &writer->header, sizeof(writer->header));
+    return !writer->failed;
+}
+
+bool trace_file_writer_add(TraceFileWriter* writer, uint32_t time, float power_mw) {
+    bool first = writer->header.sample_count == 0 && writer->count == 0;
+
+    if (writer->failed) {
+        return false;
+    }
+    if (!first && time <= writer->last_time) {
+        writer->failed = true;
+        return false;
+    }
+
+    while (!first && time - writer->last_time > TRACE_FILE_MAX_DELTA) {
+        append_sample(writer, writer->last_time + TRACE_FILE_MAX_DELTA, writer->powers[writer->count - 1]);
+    }
+    append_sample(writer, time, to_fixed_point(power_mw, writer->header.power_scale));
+    return !writer->failed;
+}
+
+bool trace_file_writer_close(TraceFileWriter* writer) {
+    bool success = false;
+
+    if (writer == NULL || writer->output == NULL) {
+        return false;
+    }
+
+    writer->header.end_time = writer->last_time + writer->first_interval;
+    flush_block(writer, writer->header.end_time);
+    if (!writer->failed) {
+        long offset = ftell(writer->output);
+        static const uint8_t zeros[8] = {0};
+
+        write_bytes(writer, zeros, align_up((size_t)offset, 8) - (size_t)offset);
+        writer->header.index_offset = align_up((size_t)offset, 8);
+        write_bytes(writer, writer->index, writer->header.block_count * sizeof(TraceBlockIndex));
+    }
+    if (!writer->failed && (fseek(writer->output, 0, SEEK_SET) != 0)) {
+        writer->failed = true;
+    }
+    write_bytes(writer, &writer->header, sizeof(writer->header));
+
+    success = !writer->failed && writer->header.sample_count > 0;
+    if (fclose(writer->output) != 0) {
+        success = false;
+    }
+    tracked_free(ALLOC_SUBSYSTEM_TRACE, writer->index);
+    writer->output = NULL;
+    writer->index = NULL;
+    return success;
+}
@@ -0,0 +1,192 @@
+#ifndef TRACE_FORMAT_H
+#define TRACE_FORMAT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * \brief Magic number of an indexed trace file ("OSTI" in file order).
+ */
+#define TRACE_FILE_MAGIC 0x4954534fu
+
+/**
+ * \brief Version of the indexed trace format.
+ */
+#define TRACE_FILE_VERSION 1u
+
+/**
+ * \brief Number of samples per block written by TraceFileWriter.
+ */
+#define TRACE_FILE_BLOCK_SAMPLES 4096u
+
+/**
+ * \brief Largest gap between two samples the time column can encode, in seconds.
+ */
+#define TRACE_FILE_MAX_DELTA UINT16_MAX
+
+/**
+ * \brief Header at the start of an indexed trace file.
+ *
+ * The file is the header, the sample blocks, then the block index. Every
+ * block stores its columns one after the other, each padded to 4 bytes:
+ * - time: uint16 delta from the previous sample, 0 for the first sample,
+ *   which is at the block's first_time;
+ * - power: int16 fixed-point value, power_mw = value * power_scale.
+ *
+ * Each sample holds its power until the next one, and the last sample for
+ * as long as the first, so the trace covers [first sample, end_time).
+ */
+typedef struct {
+    uint32_t magic;          ///< TRACE_FILE_MAGIC.
+    uint32_t version;        ///< TRACE_FILE_VERSION.
+    uint32_t block_samples;  ///< Samples per block; only the last block may hold fewer.
+    uint32_t end_time;       ///< End of the trace, in seconds.
+    uint64_t sample_count;   ///< Total number of samples.
+    uint64_t block_count;    ///< Number of blocks and index entries.
+    uint64_t index_offset;   ///< Offset of the first TraceBlockIndex entry.
+    float power_scale;       ///< Milliwatts per fixed-point unit.
+    uint32_t reserved;
+} TraceFileHeader;
+
+/**
+ * \brief Index entry and summary of one block.
+ */
+typedef struct {
+    uint32_t first_time;       ///< Time of the first sample of the block.
+    uint32_t end_time;         ///< First time not covered by the block.
+    uint64_t offset;           ///< Offset of the block from the start of the file.
+    uint32_t count;            ///< Number of samples in the block.
+    int16_t min_power;         ///< Smallest fixed-point power of the block.
+    int16_t max_power;         ///< Largest fixed-point power of the block.
+    int64_t sum_power;         ///< Sum of the fixed-point powers of the block.
+    double energy_before_mj;   ///< Energy of all the previous blocks, in millijoules.
+} TraceBlockIndex;
+
+/**
+ * \brief Indexed trace file attached to its bytes in memory.
+ */
+typedef struct {
+    const uint8_t* data;             ///< Start of the file.
+    size_t size;                     ///< Size of the file in bytes.
+    const TraceFileHeader* header;   ///< Validated header.
+    const TraceBlockIndex* index;    ///< Block index.
+    double total_energy_mj;          ///< Energy of the whole trace.
+} TraceFile;
+
+/**
+ * \brief Validates an indexed trace held in memory, usually a file mapping.
+ *
+ * \param file Trace to initialize.
+ * \param data File contents, 8-byte aligned; they must outlive the trace.
+ * \param size Size of the contents in bytes.
+ * \return False if the contents are not a valid indexed trace.
+ */
+bool trace_file_attach(TraceFile* file, const uint8_t* data, size_t size);
+
+/**
+ * \brief Finds the block covering a time, in O(log blocks).
+ *
+ * \param file Attached trace.
+ * \param time Time in seconds.
+ * \return Index of the block, or -1 before the first sample and from end_time on.
+ */
+long trace_file_find_block(const TraceFile* file, uint32_t time);
+
+/**
+ * \brief Decodes the samples of one block.
+ *
+ * \param file Attached trace.
+ * \param block Block to decode.
+ * \param times Destination of the sample times, or NULL.
+ * \param powers_mw Destination of the sample powers, or NULL.
+ * \return Number of samples written, at most header->block_samples.
+ */
+size_t trace_file_decode_block(const TraceFile* file, size_t block, uint32_t* times, float* powers_mw);
+
+/**
+ * \brief Returns the power at a time.
+ *
+ * \param file Attached trace.
+ * \param time Time in seconds.
+ * \return Power in milliwatts, 0 outside the trace.
+ */
+float trace_file_power_at(const TraceFile* file, uint32_t time);
+
+/**
+ * \brief Integrates the power over an interval.
+ *
+ * Whole blocks are taken from the index; only the blocks holding the ends
+ * of the interval are decoded.
+ *
+ * \param file Attached trace.
+ * \param start First second of the interval.
+ * \param end One past the last second of the interval.
+ * \return Energy in millijoules.
+ */
+double trace_file_energy(const TraceFile* file, uint32_t start, uint32_t end);
+
+/**
+ * \brief Smallest and largest power over the blocks overlapping an interval.
+ *
+ * Computed from the block summaries only, so the bounds cover whole blocks.
+ *
+ * \param file Attached trace.
+ * \param start First second of the interval.
+ * \param end One past the last second of the interval.
+ * \param min_mw Destination of the smallest power.
+ * \param max_mw Destination of the largest power.
+ * \return False if the interval does not overlap the trace.
+ */
+bool trace_file_power_bounds(const TraceFile* file, uint32_t start, uint32_t end, float* min_mw, float* max_mw);
+
+/**
+ * \brief Streaming writer of an indexed trace file, used by host-side tools.
+ */
+typedef struct {
+    FILE* output;                    ///< File being written.
+    TraceFileHeader header;          ///< Header rewritten when the writer closes.
+    uint32_t times[TRACE_FILE_BLOCK_SAMPLES];  ///< Times of the pending block.
+    int16_t powers[TRACE_FILE_BLOCK_SAMPLES];  ///< Fixed-point powers of the pending block.
+    uint32_t count;                  ///< Samples in the pending block.
+    uint32_t first_interval;         ///< Gap between the first two samples.
+    uint32_t last_time;              ///< Time of the latest sample.
+    double energy_mj;                ///< Energy of the blocks already written.
+    TraceBlockIndex* index;          ///< Index entries of the blocks already written.
+    size_t index_capacity;           ///< Capacity of the index array.
+    bool failed;                     ///< Whether a write or an input check failed.
+} TraceFileWriter;
+
+/**
+ * \brief Creates an indexed trace file.
+ *
+ * \param writer Writer to initialize.
+ * \param path Path of the file to create.
+ * \param power_scale Milliwatts per fixed-point unit; powers beyond 32767 units saturate.
+ * \return False if the file cannot be created.
+ */
+bool trace_file_writer_open(TraceFileWriter* writer, const char* path, float power_scale);
+
+/**
+ * \brief Appends one sample.
+ *
+ * Gaps longer than TRACE_FILE_MAX_DELTA are filled with copies of the
+ * previous sample, which does not change the trace.
+ *
+ * \param writer Open writer.
+ * \param time Time of the sample, later than the previous one.
+ * \param power_mw Power from this sample to the next.
+ * \return False if the time goes backwards or a write fails.
+ */
+bool trace_file_writer_add(TraceFileWriter* writer, uint32_t time, float power_mw);
+
+/**
+ * \brief Writes the last block, the index and the final header, then closes the file.
+ *
+ * \param writer Writer to close.
+ * \return False if anything failed since the writer was opened.
+ */
+bool trace_file_writer_close(TraceFileWriter* writer);
+
+#endif // TRACE_FORMAT_H
@@ -1,10 +1,11 @@
 #!/bin/bash
 
 # Iteration number
-ITERATIONS=7
+ITERATIONS=8
 REPETITIONS=5
 
-# TDP of Processor in use (depending of host hardware)
+# TDP of Processor in use (depending of host hardware), used to estimate the power of
+# iterations that cannot measure their own energy
 TDP=95
 NUM_THREADS=16
 TDP_PER_CORE=$(($TDP / $NUM_THREADS))
@@ -20,6 +21,20 @@ read_cpu_stats() {
     awk '/^cpu0 / {print $2, $3, $4, $5, $6, $7, $8}' /proc/stat
 }
 
+# Read a numeric field of the JSON report written by --profile, wherever it sits on its line
+json_number() {
+    awk -v key="\"$1\":" '{
+        start = index($0, key)
+        if (start > 0) {
+            value = substr($0, start + length(key))
+            sub(/^ */, "", value)
+            match(value, /^[-+0-9.eE]+/)
+            print substr(value, 1, RLENGTH)
+            exit
+        }
+    }' "$2"
+}
+
 # Calculate CPU Usage between snapshot of /proc/stat
 calculate_cpu_usage() {
     local -n start=$1
@@ -39,9 +54,11 @@ calculate_cpu_usage() {
     echo "$active_diff $total_diff"
 }
 
+mkdir -p output
+
 RESULT_JSON="["
-RESULT_LATEX="\\begin{tabular}{|c|c|c|c|c|c|c|c|c|}\n\\hline\nIteration & Run & Execution Time & CPU Usage & Power Consumed & Valgrind Errors & Valgrind Allocs & Valgrind Frees & Bytes Allocated \\\\\n\\hline\n"
-echo "Iteration;Run;Execution Time;CPU Usage;Power Consumed;Valgrind Errors;Valgrind Allocs;Valgrind Frees;Bytes Allocated" > "$CSV_FILE"
+RESULT_LATEX="\\begin{tabular}{|c|c|c|c|c|c|c|c|c|c|}\n\\hline\nIteration & Run & Execution Time & CPU Usage & Power Consumed & Valgrind Errors & Leaked Blocks & Valgrind Allocs & Valgrind Frees & Bytes Allocated \\\\\n\\hline\n"
+echo "Iteration;Run;Execution Time;CPU Usage;Power Consumed;Valgrind Errors;Leaked Blocks;Valgrind Allocs;Valgrind Frees;Bytes Allocated" > "$CSV_FILE"
 
 
 # Loop of X Iterations configured
@@ -79,6 +96,7 @@ for iteration in $(seq 0 $ITERATIONS); do
     TOTAL_CPU=0
     TOTAL_POWER=0
     TOTAL_ERRORS=0
+    TOTAL_LEAKS=0
     TOTAL_ALLOCS=0
     TOTAL_FREES=0
     TOTAL_BYTES=0
@@ -86,61 +104,92 @@ for iteration in $(seq 0 $ITERATIONS); do
     # Run repetitions
     for run in $(seq 1 $REPETITIONS); do
         
-        # Take a snapshot of CPU stats and timing before execution of program
-        read -a cpu_start < <(read_cpu_stats)
-        start_time=$(date +%s)
-        echo "Start Time: ${start_time}" >> "${LOG_FILE}"
-        echo "Iteration $iteration - Run ${run} - ${start_time} ..."
-
-        # Execute the APP, only with the Core CPU_CORE to measure the Usage of one CPU Core and estimate the consumption.
-        taskset -c ${CPU_CORE} "${APP}" 5 &>> "${LOG_FILE}"
-        if [ $? -ne 0 ]; then
-            echo "Error: execution failed for iteration ${iteration}. Check ${LOG_FILE} for details."
-            continue
-        fi
-
-        # Take a snapshot of CPU stats and timing after execution of program
-        read -a cpu_end < <(read_cpu_stats)
-        end_time=$(date +%s)
-        echo "End Time: ${end_time}" >> "${LOG_FILE}"
+        if [ -f "${ITERATION_DIR}/run_profiler.c" ]; then
+            # The binary measures itself, so one run gives the time and CPU usage.
+            PROFILE_FILE="output/${APP_NAME}_run${run}_profile.json"
+            echo "Iteration $iteration - Run ${run} ..."
+            taskset -c ${CPU_CORE} "${APP}" 5 --profile="${PROFILE_FILE}" &>> "${LOG_FILE}"
+            if [ $? -ne 0 ]; then
+                echo "Error: execution failed for iteration ${iteration}. Check ${LOG_FILE} for details."
+                continue
+            fi
+            elapsed_time=$(json_number wall_time_s "${PROFILE_FILE}")
+            cpu_usage_percentage=$(json_number cpu_usage "${PROFILE_FILE}")
+            # Measured by RAPL when readable, else modelled; see "energy_source" in the report.
+            power_consumed=$(json_number average_power_w "${PROFILE_FILE}")
+            if grep -q '"energy_source": "default-model"' "${PROFILE_FILE}"; then
+                echo "Warning: uncalibrated default power model for iteration ${iteration}; see --calibrate-power and --power-model" | tee -a "${LOG_FILE}"
+            fi
+            echo "Execution Time: ${elapsed_time} seconds" >> "${LOG_FILE}"
+        else
+            # Take a snapshot of CPU stats and timing before execution of program
+            read -a cpu_start < <(read_cpu_stats)
+            start_time=$(date +%s)
+            echo "Start Time: ${start_time}" >> "${LOG_FILE}"
+            echo "Iteration $iteration - Run ${run} - ${start_time} ..."
+
+            # Execute the APP, only with the Core CPU_CORE to measure the Usage of one CPU Core and estimate the consumption.
+            taskset -c ${CPU_CORE} "${APP}" 5 &>> "${LOG_FILE}"
+            if [ $? -ne 0 ]; then
+                echo "Error: execution failed for iteration ${iteration}. Check ${LOG_FILE} for details."
+                continue
+            fi
+
+            # Take a snapshot of CPU stats and timing after execution of program
+            read -a cpu_end < <(read_cpu_stats)
+            end_time=$(date +%s)
+            echo "End Time: ${end_time}" >> "${LOG_FILE}"
         
-        # Calculer le temps d'exécution
-        elapsed_time=$((end_time - start_time))
-        echo "Execution Time: ${elapsed_time} seconds" >> "${LOG_FILE}"
-
-        # Calculate Usage CPU
-        read active_diff total_diff < <(calculate_cpu_usage cpu_start cpu_end)
-        cpu_usage_percentage=$(awk "BEGIN {print ($active_diff / $total_diff) * 100}")
-        power_consumed=$(awk "BEGIN {print ($TDP_PER_CORE * $cpu_usage_percentage) / 100}")
+            # Calculer le temps d'exécution
+            elapsed_time=$((end_time - start_time))
+            echo "Execution Time: ${elapsed_time} seconds" >> "${LOG_FILE}"
+
+            # Calculate Usage CPU
+            read active_diff total_diff < <(calculate_cpu_usage cpu_start cpu_end)
+            cpu_usage_percentage=$(awk "BEGIN {print ($active_diff / $total_diff) * 100}")
+            power_consumed=$(awk "BEGIN {print ($TDP_PER_CORE * $cpu_usage_percentage) / 100}")
+        fi
 
         echo "Iteration $iteration : CPU Usage = ${cpu_usage_percentage}% | Consummed Watts = ${power_consumed} W"
         echo "Iteration $iteration : CPU Usage = ${cpu_usage_percentage}% | Consummed Watts = ${power_consumed} W" >> "${LOG_FILE}"
         echo "Iteration $iteration - Run ${run} - CPU Usage = ${cpu_usage_percentage}% | Consummed Watts = ${power_consumed} W"
 
-        # Analyse Valgrind
-        valgrind_output=$(valgrind --tool=memcheck --leak-check=full "${APP}" 5 2>&1)
-        #echo $valgrind_output
-        valgrind_errors=$(echo "$valgrind_output" | grep "ERROR SUMMARY" | awk '{print $4}')
-        #echo "Errors: ${valgrind_errors}"
-        valgrind_allocs=$(echo "$valgrind_output" | grep "total heap usage" | awk '{print $5}')
-        #echo "Allocs: ${valgrind_allocs}"
-        valgrind_frees=$(echo "$valgrind_output" | grep "total heap usage" | awk '{print $7}')
-        #echo "Frees: ${valgrind_frees}"
-        valgrind_bytes=$(echo "$valgrind_output" | grep "bytes allocated" | awk '{print $9}' | sed 's/,//g')
-        #echo "Bytes: ${valgrind_bytes}"
+        if [ -f "${ITERATION_DIR}/alloc_tracker.c" ]; then
+            # Tracked in the same run: no memcheck errors are measured, only the blocks still allocated at exit.
+            valgrind_errors=""
+            leaked_blocks=$(json_number total_live_allocations "${PROFILE_FILE}")
+            valgrind_allocs=$(json_number total_allocations "${PROFILE_FILE}")
+            valgrind_frees=$(json_number total_frees "${PROFILE_FILE}")
+            valgrind_bytes=$(json_number total_bytes_allocated "${PROFILE_FILE}")
+        else
+            # Analyse Valgrind
+            valgrind_output=$(valgrind --tool=memcheck --leak-check=full "${APP}" 5 2>&1)
+            #echo $valgrind_output
+            valgrind_errors=$(echo "$valgrind_output" | grep "ERROR SUMMARY" | awk '{print $4}')
+            #echo "Errors: ${valgrind_errors}"
+            leaked_blocks=$(echo "$valgrind_output" | grep "definitely lost" | awk '{print $7}' | sed 's/,//g')
+            leaked_blocks=${leaked_blocks:-0}
+            valgrind_allocs=$(echo "$valgrind_output" | grep "total heap usage" | awk '{print $5}')
+            #echo "Allocs: ${valgrind_allocs}"
+            valgrind_frees=$(echo "$valgrind_output" | grep "total heap usage" | awk '{print $7}')
+            #echo "Frees: ${valgrind_frees}"
+            valgrind_bytes=$(echo "$valgrind_output" | grep "bytes allocated" | awk '{print $9}' | sed 's/,//g')
+            #echo "Bytes: ${valgrind_bytes}"
+        fi
 
         # Accumuler les résultats
-        TOTAL_TIME=$((TOTAL_TIME + elapsed_time))
+        TOTAL_TIME=$(awk "BEGIN {print $TOTAL_TIME + $elapsed_time}")
         TOTAL_CPU=$(awk "BEGIN {print $TOTAL_CPU + $cpu_usage_percentage}")
         TOTAL_POWER=$(awk "BEGIN {print $TOTAL_POWER + $power_consumed}")
-        TOTAL_ERRORS=$((TOTAL_ERRORS + valgrind_errors))
+        TOTAL_ERRORS=$((TOTAL_ERRORS + ${valgrind_errors:-0}))
+        TOTAL_LEAKS=$((TOTAL_LEAKS + leaked_blocks))
         TOTAL_ALLOCS=$((TOTAL_ALLOCS + valgrind_allocs))
         TOTAL_FREES=$((TOTAL_FREES + valgrind_frees))
         TOTAL_BYTES=$((TOTAL_BYTES + valgrind_bytes))
 
         # Append to JSON and CSV
-        ITERATION_RESULTS+="{\"run\": $run, \"execution_time\": $elapsed_time, \"cpu_usage\": $cpu_usage_percentage, \"power_consumed\": $power_consumed, \"valgrind_errors\": $valgrind_errors, \"valgrind_allocs\": $valgrind_allocs, \"valgrind_frees\": $valgrind_frees, \"bytes_allocated\": $valgrind_bytes},"
-        echo "$iteration;$run;$elapsed_time;$cpu_usage_percentage;$power_consumed;$valgrind_errors;$valgrind_allocs;$valgrind_frees;$valgrind_bytes" >> "$CSV_FILE"
+        ITERATION_RESULTS+="{\"run\": $run, \"execution_time\": $elapsed_time, \"cpu_usage\": $cpu_usage_percentage, \"power_consumed\": $power_consumed, \"valgrind_errors\": ${valgrind_errors:-null}, \"leaked_blocks\": $leaked_blocks, \"valgrind_allocs\": $valgrind_allocs, \"valgrind_frees\": $valgrind_frees, \"bytes_allocated\": $valgrind_bytes},"
+        echo "$iteration;$run;$elapsed_time;$cpu_usage_percentage;$power_consumed;$valgrind_errors;$leaked_blocks;$valgrind_allocs;$valgrind_frees;$valgrind_bytes" >> "$CSV_FILE"
     done
 
     # Calculate averages and finalize JSON
@@ -151,9 +200,10 @@ for iteration in $(seq 0 $ITERATIONS); do
     AVG_TIME=$(awk "BEGIN {print $TOTAL_TIME / $REPETITIONS}")
     AVG_CPU=$(awk "BEGIN {print $TOTAL_CPU / $REPETITIONS}")
     AVG_POWER=$(awk "BEGIN {print $TOTAL_POWER / $REPETITIONS}")
+    AVG_LEAKS=$(awk "BEGIN {print $TOTAL_LEAKS / $REPETITIONS}")
     AVG_BYTES=$(awk "BEGIN {print $TOTAL_BYTES / $REPETITIONS}")
 
-    RESULT_LATEX+="$iteration & Avg & $AVG_TIME & $AVG_CPU & $AVG_POWER & 0 & 0 & 0 & $AVG_BYTES \\\\\n\\hline\n"
+    RESULT_LATEX+="$iteration & Avg & $AVG_TIME & $AVG_CPU & $AVG_POWER & 0 & $AVG_LEAKS & 0 & 0 & $AVG_BYTES \\\\\n\\hline\n"
 
     # Revenir au répertoire précédent
     echo "...Ending the Local Analysis of Iteration ${iteration}."